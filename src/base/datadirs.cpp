@@ -45,6 +45,27 @@ void set_data_dir(const std::string& datadir)
     get_global_data_dir() = datadir;
 }
 
+static auto get_global_cache_dir() -> std::string&
+{
+    static std::string global_cachedir;
+    return global_cachedir;
+}
+
+/// Get directory for cached data
+auto get_cache_dir() -> const std::string&
+{
+    if (get_global_cache_dir().empty()) {
+        get_global_cache_dir() = get_map_dir();
+    }
+    return get_global_cache_dir();
+}
+
+/// Set directory for cached data
+void set_cache_dir(const std::string& cachedir)
+{
+    get_global_cache_dir() = cachedir;
+}
+
 data_file_handler::data_file_handler()
 {
     // scan data dir for all .data files
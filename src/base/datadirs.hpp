@@ -88,6 +88,13 @@ inline std::string get_popup_dir()
 // Note! call this at most once and very early in main()!
 void set_data_dir(const std::string& datadir);
 
+/// directory for data computed from the data files, to reuse it on next start
+/// (writable, default is the map directory)
+const std::string& get_cache_dir();
+
+// Note! call this early in main(), before any cached data is used.
+void set_cache_dir(const std::string& cachedir);
+
 class data_file_handler : public singleton<class data_file_handler>
 {
     friend class singleton<data_file_handler>;
@@ -88,6 +88,42 @@ directory::~directory()
     FindClose(dir);
 }
 
+mapped_file::mapped_file(const std::string& filename)
+{
+#ifdef UNICODE
+    file = CreateFile(
+        convertUTF8toUTF16(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+#else
+    file = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+#endif
+    if (file == INVALID_HANDLE_VALUE)
+        THROW(file_read_error, filename);
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(file, &sz) || sz.QuadPart == 0) {
+        CloseHandle(file);
+        THROW(file_read_error, filename);
+    }
+    length  = std::size_t(sz.QuadPart);
+    mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        THROW(file_read_error, filename);
+    }
+    ptr = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (ptr == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        THROW(file_read_error, filename);
+    }
+}
+
+mapped_file::~mapped_file()
+{
+    UnmapViewOfFile(ptr);
+    CloseHandle(mapping);
+    CloseHandle(file);
+}
+
 bool make_dir(const std::string& dirname)
 {
 #ifdef UNICODE
@@ -138,6 +174,8 @@ bool is_directory(const std::string& filename)
 
 #else /* Win32 */
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -168,6 +206,32 @@ directory::~directory()
     closedir(dir);
 }
 
+mapped_file::mapped_file(const std::string& filename)
+    : fd(open(filename.c_str(), O_RDONLY))
+{
+    if (fd < 0) {
+        THROW(file_read_error, filename);
+    }
+    struct stat fileinfo;
+    if (fstat(fd, &fileinfo) != 0 || fileinfo.st_size == 0) {
+        close(fd);
+        THROW(file_read_error, filename);
+    }
+    length  = std::size_t(fileinfo.st_size);
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        THROW(file_read_error, filename);
+    }
+    ptr = static_cast<const uint8_t*>(p);
+}
+
+mapped_file::~mapped_file()
+{
+    munmap(const_cast<uint8_t*>(ptr), length);
+    close(fd);
+}
+
 auto make_dir(const std::string& dirname) -> bool
 {
     int err = mkdir(dirname.c_str(), 0755);
@@ -220,6 +284,22 @@ auto is_file(const std::string& filename) -> bool
     return !is_directory(filename);
 }
 
+auto compute_file_hash(const std::string& filename) -> uint64_t
+{
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in.good()) {
+        THROW(file_read_error, filename);
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    std::vector<char> buffer(65536);
+    while (in.read(buffer.data(), std::streamsize(buffer.size())) || in.gcount() > 0) {
+        for (std::streamsize i = 0; i < in.gcount(); ++i) {
+            hash = (hash ^ uint8_t(buffer[i])) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
 void directory::walk(const std::string& path, std::function<void(const std::string&)> func)
 {
     if (path.empty()) {
@@ -31,6 +31,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <dirent.h>
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <string>
 
@@ -69,6 +71,39 @@ class directory
 #endif
 };
 
+/// read only memory mapped file, pages are loaded by the OS on first access
+class mapped_file
+{
+    mapped_file()                              = delete;
+    mapped_file(const mapped_file&)            = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+  public:
+    /// Map whole file.
+    ///@note throws file_read_error if file can't be opened or mapped
+    mapped_file(const std::string& filename);
+
+    /// Unmap file
+    ~mapped_file();
+
+    /// Pointer to file contents
+    [[nodiscard]] const uint8_t* data() const { return ptr; }
+
+    /// Size of file in bytes
+    [[nodiscard]] std::size_t size() const { return length; }
+
+  private:
+    const uint8_t* ptr{nullptr};
+    std::size_t length{0};
+    // system specific part
+#ifdef WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+};
+
 // file helper interface
 
 ///\brief Make new directory. Returns true on success.
@@ -82,3 +117,7 @@ bool is_directory(const std::string& filename);
 
 ///\brief Test if the given filename is a file (can be read by fopen())
 bool is_file(const std::string& filename);
+
+///\brief Compute 64 bit FNV-1a hash of the file contents, to detect changed files.
+///@note throws file_read_error if the file can't be read
+uint64_t compute_file_hash(const std::string& filename);
@@ -0,0 +1,117 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// fixed time step scheduler for the simulation
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include <algorithm>
+
+/// Scheduler that turns variable frame times into simulation steps of fixed length.
+/** Real time (multiplied by time compression) is accumulated and consumed in
+    steps of constant length, so physics cost and accuracy do not depend on the
+    frame rate. The number of steps per frame is limited, if the simulation
+    can't keep up the remaining time is dropped and the game just runs slower
+    instead of spending ever more time per frame on catching up.
+    The fraction of a step left in the accumulator is used to interpolate
+    rendered object transforms between the last two simulated states.
+*/
+class fixed_timestep
+{
+  public:
+    /// create scheduler
+    ///@param step_time_ - simulation step length in seconds
+    ///@param max_steps_per_frame_ - step limit per frame at time scale 1
+    fixed_timestep(double step_time_ = 1.0 / 30.0, unsigned max_steps_per_frame_ = 4)
+        : step_time(step_time_)
+        , max_steps_per_frame(max_steps_per_frame_)
+    {
+    }
+
+    /// add passed real time and compute number of simulation steps to do now
+    ///@param real_delta_t - real time passed since last frame in seconds
+    ///@param time_scale - time compression factor
+    ///@return number of steps of length get_step_time() to simulate
+    unsigned advance(double real_delta_t, unsigned time_scale = 1)
+    {
+        real_time += real_delta_t;
+        accumulator += real_delta_t * time_scale;
+        auto steps           = unsigned(accumulator / step_time);
+        const unsigned limit = max_steps_per_frame * std::max(time_scale, 1U);
+        if (steps > limit) {
+            // can't keep up, drop the whole steps above the limit but keep the
+            // fraction, so we don't spiral to death and interpolation stays
+            // continuous
+            dropped_time += (steps - limit) * step_time;
+            accumulator -= (steps - limit) * step_time;
+            ++frames_clamped;
+            steps = limit;
+        }
+        accumulator -= steps * step_time;
+        simulated_time += steps * step_time;
+        ++frames;
+        total_steps += steps;
+        return steps;
+    }
+
+    /// Reset accumulated time, e.g. after pause or loading
+    void reset_accumulator() { accumulator = 0.0; }
+
+    /// Reset statistics
+    void reset_stats()
+    {
+        real_time      = 0.0;
+        simulated_time = 0.0;
+        dropped_time   = 0.0;
+        frames         = 0;
+        frames_clamped = 0;
+        total_steps    = 0;
+    }
+
+    /// length of one simulation step in seconds
+    [[nodiscard]] double get_step_time() const { return step_time; }
+    /// interpolation factor [0...1) between the last two simulated states
+    [[nodiscard]] double get_alpha() const { return std::clamp(accumulator / step_time, 0.0, 1.0); }
+    /// real time passed since last statistics reset
+    [[nodiscard]] double get_real_time() const { return real_time; }
+    /// simulated time since last statistics reset
+    [[nodiscard]] double get_simulated_time() const { return simulated_time; }
+    /// simulated time that was dropped because of the step limit
+    [[nodiscard]] double get_dropped_time() const { return dropped_time; }
+    /// ratio of simulated to real time, should match the time scale
+    [[nodiscard]] double get_time_ratio() const { return real_time > 0.0 ? simulated_time / real_time : 0.0; }
+    /// average number of simulation steps per frame
+    [[nodiscard]] double get_steps_per_frame() const { return frames > 0 ? double(total_steps) / frames : 0.0; }
+    /// number of frames where the step limit was hit
+    [[nodiscard]] unsigned get_frames_clamped() const { return frames_clamped; }
+
+  protected:
+    double step_time;
+    unsigned max_steps_per_frame;
+    double accumulator{0.0};
+
+    // statistics
+    double real_time{0.0};
+    double simulated_time{0.0};
+    double dropped_time{0.0};
+    unsigned frames{0};
+    unsigned frames_clamped{0};
+    unsigned total_steps{0};
+};
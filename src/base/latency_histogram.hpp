@@ -0,0 +1,109 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Histogram of short durations with logarithmic buckets.
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/// Counts durations in buckets of powers of two microseconds.
+/** Bucket 0 counts durations below 1us, bucket i durations below 2^i us,
+    the last bucket all longer ones. Adding is cheap enough to be done
+    for every call that is measured.
+*/
+class latency_histogram
+{
+  public:
+    static constexpr unsigned nr_buckets = 20;
+
+    /// add a measured duration
+    void add(std::chrono::steady_clock::duration d)
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        auto us       = uint64_t(ns > 0 ? ns : 0) / 1000;
+        unsigned b    = 0;
+        while (us > 0 && b + 1 < nr_buckets) {
+            us /= 2;
+            ++b;
+        }
+        ++buckets[b];
+        ++count;
+        total_ns += uint64_t(ns);
+        if (uint64_t(ns) > max_ns) {
+            max_ns = uint64_t(ns);
+        }
+    }
+
+    /// measure the duration of func and add it
+    template<typename F>
+    void measure(F&& func)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        add(std::chrono::steady_clock::now() - start);
+    }
+
+    /// remove all samples
+    void clear() { *this = latency_histogram(); }
+
+    [[nodiscard]] uint64_t get_count() const { return count; }
+    [[nodiscard]] uint64_t get_bucket(unsigned b) const { return buckets[b]; }
+    /// upper limit of bucket in microseconds
+    [[nodiscard]] static uint64_t get_bucket_limit_us(unsigned b) { return uint64_t(1) << b; }
+    [[nodiscard]] double get_mean_us() const { return count > 0 ? total_ns * 0.001 / count : 0.0; }
+    [[nodiscard]] double get_max_us() const { return max_ns * 0.001; }
+    [[nodiscard]] double get_total_ms() const { return total_ns * 1e-6; }
+
+    /// upper bucket limit in microseconds below which the fraction of samples lies
+    [[nodiscard]] uint64_t get_percentile_us(double fraction) const
+    {
+        uint64_t sum = 0;
+        for (unsigned b = 0; b < nr_buckets; ++b) {
+            sum += buckets[b];
+            if (double(sum) >= fraction * count) {
+                return get_bucket_limit_us(b);
+            }
+        }
+        return get_bucket_limit_us(nr_buckets - 1);
+    }
+
+    /// print summary and non-empty buckets in one line
+    friend std::ostream& operator<<(std::ostream& os, const latency_histogram& h)
+    {
+        os << h.count << " calls, mean " << h.get_mean_us() << "us, max " << h.get_max_us() << "us, total "
+           << h.get_total_ms() << "ms |";
+        for (unsigned b = 0; b < nr_buckets; ++b) {
+            if (h.buckets[b] > 0) {
+                os << " <" << get_bucket_limit_us(b) << "us:" << h.buckets[b];
+            }
+        }
+        return os;
+    }
+
+  protected:
+    std::array<uint64_t, nr_buckets> buckets{};
+    uint64_t count{0};
+    uint64_t total_ns{0};
+    uint64_t max_ns{0};
+};
@@ -23,26 +23,29 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "log.hpp"
 
-#include "error.hpp"
-
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <memory>
 #include <mutex>
-#include <stdexcept>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 struct log_msg
 {
-    log::level lvl;
-    std::thread::id tid;
-    uint32_t time;
+    log::level lvl{log::level::INFO};
+    const char* threadname{nullptr};
+    uint32_t time{0};
     std::string msg;
 
-    log_msg(log::level l, std::string m)
+    log_msg() = default;
+    log_msg(log::level l, const char* tn, std::string m)
         : lvl(l)
-        , tid(std::this_thread::get_id())
+        , threadname(tn)
         , time(
               std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
                   .count())
@@ -69,7 +72,7 @@ struct log_msg
             default:
                 oss << "\033[0m";
         }
-        oss << "[" << log::instance().get_thread_name(tid) << "] <" << std::dec << time << "> " << msg << "\033[0m";
+        oss << "[" << threadname << "] <" << std::dec << time << "> " << msg << "\033[0m";
         return oss.str();
     }
 
@@ -92,42 +95,208 @@ struct log_msg
             default:
                 oss << "$c0c0c0";
         }
-        oss << "[" << log::instance().get_thread_name(tid) << "] <" << std::dec << time << "> " << msg;
+        oss << "[" << threadname << "] <" << std::dec << time << "> " << msg;
         return oss.str();
     }
 };
 
+class log_internal;
+
+namespace {
+/// Bounded single producer / single consumer ring of log messages.
+/** Every thread writes only into its own buffer, so appending a message needs
+    no lock. The consumer is the drain, which is serialized by the log.
+    When the buffer is full the message is dropped and counted, a thread
+    logging faster than the drain can empty the buffer must not block.
+*/
+class log_buffer
+{
+  public:
+    static constexpr unsigned capacity = 1024; // must be a power of two
+
+    log_buffer(const char* name_) : name(name_) { }
+
+    bool push(log::level l, const std::string& m)
+    {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & (capacity - 1)] = log_msg(l, name.load(std::memory_order_relaxed), m);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename F>
+    void pop_all(F&& func)
+    {
+        auto t       = tail.load(std::memory_order_relaxed);
+        const auto h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t) {
+            func(std::move(slots[t & (capacity - 1)]));
+        }
+        tail.store(t, std::memory_order_release);
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    std::atomic<const char*> name;
+    std::atomic<bool> in_use{true};
+    std::atomic<unsigned> dropped{0};
+
+  protected:
+    std::array<log_msg, capacity> slots;
+    std::atomic<unsigned> head{0}; // written by producer only
+    std::atomic<unsigned> tail{0}; // written by consumer only
+};
+
+/// log buffer of the current thread and the log it belongs to
+struct thread_log_buffer
+{
+    const log_internal* owner{nullptr};
+    log_buffer* buffer{nullptr};
+};
+
+thread_local thread_log_buffer current_buffer;
+
+/// how often the drain thread collects messages
+constexpr auto drain_interval = std::chrono::milliseconds(10);
+/// maximum number of lines kept in memory, older ones are discarded
+constexpr std::size_t max_history_lines = 16384;
+} // namespace
+
 class log_internal
 {
   public:
-    std::mutex mtx;
-    std::vector<log_msg> loglines;
-    std::unordered_map<std::thread::id, const char*> threadnames;
+    /// registry of all thread buffers, only locked when threads come and go
+    std::mutex buffers_mtx;
+    std::vector<std::unique_ptr<log_buffer>> buffers;
+    /// history of drained messages, also serializes draining
+    mutable std::mutex history_mtx;
+    std::deque<log_msg> history;
+    std::vector<log_msg> batch;
+    /// drain thread control
+    std::mutex drain_mtx;
+    std::condition_variable drain_cond;
+    bool drain_stop{false};
+    std::thread drain_thread;
+
     log_internal() = default;
+
+    /// get the buffer of the calling thread, registering it on first use
+    auto get_buffer(const char* name) -> log_buffer*
+    {
+        if (current_buffer.owner == this && current_buffer.buffer != nullptr) {
+            return current_buffer.buffer;
+        }
+        std::unique_lock<std::mutex> ml(buffers_mtx);
+        log_buffer* buf = nullptr;
+        // reuse buffers of ended threads once they are drained
+        for (auto& b : buffers) {
+            if (!b->in_use.load(std::memory_order_acquire) && b->empty()) {
+                buf       = b.get();
+                buf->name.store(name);
+                buf->in_use.store(true, std::memory_order_release);
+                break;
+            }
+        }
+        if (buf == nullptr) {
+            buffers.push_back(std::make_unique<log_buffer>(name));
+            buf = buffers.back().get();
+        }
+        current_buffer = {this, buf};
+        return buf;
+    }
+
+    /// move all pending messages to the history, must hold history_mtx
+    void drain_locked()
+    {
+        {
+            std::unique_lock<std::mutex> ml(buffers_mtx);
+            for (auto& b : buffers) {
+                b->pop_all([this](log_msg&& m) { batch.push_back(std::move(m)); });
+                const auto d = b->dropped.exchange(0, std::memory_order_relaxed);
+                if (d > 0) {
+                    batch.emplace_back(
+                        log::level::WARNING, b->name.load(), std::to_string(d) + " log messages dropped, buffer full");
+                }
+            }
+        }
+        if (batch.empty()) {
+            return;
+        }
+        // merge messages of all threads in time order
+        std::stable_sort(
+            batch.begin(), batch.end(), [](const log_msg& a, const log_msg& b) { return a.time < b.time; });
+        if (log::copy_output_to_console) {
+            for (const auto& m : batch) {
+                std::cout << m.pretty_print() << "\n";
+            }
+            std::cout.flush();
+        }
+        for (auto& m : batch) {
+            history.push_back(std::move(m));
+        }
+        batch.clear();
+        while (history.size() > max_history_lines) {
+            history.pop_front();
+        }
+    }
+
+    void drain()
+    {
+        std::unique_lock<std::mutex> ml(history_mtx);
+        drain_locked();
+    }
+
+    void drain_loop()
+    {
+        std::unique_lock<std::mutex> ml(drain_mtx);
+        while (!drain_stop) {
+            drain_cond.wait_for(ml, drain_interval, [this]() { return drain_stop; });
+            ml.unlock();
+            drain();
+            ml.lock();
+        }
+    }
 };
 
 log::log()
 {
-    mylogint                                          = new log_internal();
-    mylogint->threadnames[std::this_thread::get_id()] = "__main__";
+    mylogint = new log_internal();
+    mylogint->get_buffer("__main__");
+    mylogint->drain_thread = std::thread([this]() { mylogint->drain_loop(); });
+}
+
+log::~log()
+{
+    {
+        std::unique_lock<std::mutex> ml(mylogint->drain_mtx);
+        mylogint->drain_stop = true;
+    }
+    mylogint->drain_cond.notify_one();
+    mylogint->drain_thread.join();
+    mylogint->drain();
+    delete mylogint;
 }
 
 bool log::copy_output_to_console = false;
 
 void log::append(log::level l, const std::string& msg)
 {
-    std::unique_lock<std::mutex> ml(mylogint->mtx);
-    mylogint->loglines.emplace_back(l, msg);
-    if (copy_output_to_console) {
-        std::cout << mylogint->loglines.back().pretty_print() << std::endl;
-    }
+    mylogint->get_buffer("unnamed")->push(l, msg);
 }
 
 void log::write(std::ostream& out, log::level limit_level) const
 {
     // process log_msg and make ANSI colored text lines of it
-    std::unique_lock<std::mutex> ml(mylogint->mtx);
-    for (const auto& logmsg : mylogint->loglines) {
+    std::unique_lock<std::mutex> ml(mylogint->history_mtx);
+    mylogint->drain_locked();
+    for (const auto& logmsg : mylogint->history) {
         if (logmsg.lvl <= limit_level) {
             out << logmsg.pretty_print() << std::endl;
         }
@@ -137,19 +306,16 @@ void log::write(std::ostream& out, log::level limit_level) const
 auto log::get_last_n_lines(unsigned n) const -> std::string
 {
     std::string result;
-    std::unique_lock<std::mutex> ml(mylogint->mtx);
-    auto l = unsigned(mylogint->loglines.size());
+    std::unique_lock<std::mutex> ml(mylogint->history_mtx);
+    mylogint->drain_locked();
+    auto l = unsigned(mylogint->history.size());
     if (n > l) {
         for (unsigned k = 0; k < n - l; ++k) {
             result += "\n";
         }
         n = l;
     }
-    auto it = mylogint->loglines.end();
-    for (; n > 0; --n) {
-        --it;
-    }
-    for (; it != mylogint->loglines.end(); ++it) {
+    for (auto it = mylogint->history.end() - n; it != mylogint->history.end(); ++it) {
         result += it->pretty_print_console() + "\n";
     }
     return result;
@@ -157,32 +323,23 @@ auto log::get_last_n_lines(unsigned n) const -> std::string
 
 void log::new_thread(const char* name)
 {
-    {
-        std::unique_lock<std::mutex> ml(mylogint->mtx);
-        mylogint->threadnames[std::this_thread::get_id()] = name;
-    }
+    // a thread may have logged before it was named
+    mylogint->get_buffer(name)->name.store(name);
     log_sysinfo("---------- < NEW > THREAD ----------");
 }
 
 void log::end_thread()
 {
     log_sysinfo("---------- > END < THREAD ----------");
-    std::unique_lock<std::mutex> ml(mylogint->mtx);
-    /* Do not remove entry so it can be written to log file after the thread has
-     * died (and message is still in buffer). It should never get very big... */
-    //	mylogint->threadnames.erase(std::this_thread::get_id());
+    /* The buffer is kept so pending messages can still be drained after the
+     * thread has died, it is reused by the next new thread once it is empty. */
+    if (current_buffer.owner == mylogint && current_buffer.buffer != nullptr) {
+        current_buffer.buffer->in_use.store(false, std::memory_order_release);
+    }
+    current_buffer = {};
 }
 
 auto log::get_thread_name() const -> const char*
 {
-    return get_thread_name(std::this_thread::get_id());
-}
-
-auto log::get_thread_name(std::thread::id tid) const -> const char*
-{
-    auto it = mylogint->threadnames.find(tid);
-    if (it == mylogint->threadnames.end()) {
-        THROW(error, "no thread name registered for thread! BUG!");
-    }
-    return it->second;
+    return mylogint->get_buffer("unnamed")->name.load();
 }
@@ -56,6 +56,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #endif
 
 /// manager class for a global threadsafe log
+/** Each thread appends to its own bounded lock free buffer, a background
+    thread drains all buffers into the log history (and console if wanted).
+*/
 class log : public singleton<class log>
 {
     friend class singleton<log>;
@@ -71,6 +74,9 @@ class log : public singleton<class log>
         NR_LEVELS
     };
 
+    /// stop the drain thread and flush pending messages
+    ~log();
+
     /// wether log output should go to console as well
     static bool copy_output_to_console;
 
@@ -96,6 +102,4 @@ class log : public singleton<class log>
     log();
     class log_internal* mylogint{nullptr};
     [[nodiscard]] const char* get_thread_name() const;
-    [[nodiscard]] const char* get_thread_name(std::thread::id) const;
-    friend struct log_msg;
 };
@@ -0,0 +1,137 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Least recently used cache of values with a memory budget
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/// Cache of values that evicts the least recently used ones to stay within a budget.
+/** The caller tells the size of each value on insertion, the cache keeps
+    the sum below the budget. Not threadsafe, users have to lock.
+*/
+template<typename Key, typename Value>
+class lru_cache
+{
+  public:
+    /// statistics of cache usage
+    struct statistics
+    {
+        unsigned hits{0};      ///< find() found the value
+        unsigned misses{0};    ///< find() did not find the value
+        unsigned evictions{0}; ///< values removed because of budget
+        std::size_t bytes{0};  ///< size of all cached values
+    };
+
+    /// create cache
+    ///@param budget_ - maximum size of all values in bytes
+    explicit lru_cache(std::size_t budget_)
+        : budget(budget_)
+    {
+    }
+
+    /// find value and mark it as recently used, counts hits and misses
+    ///@return pointer to value or nullptr, valid until the next change
+    const Value* find(const Key& key)
+    {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            ++stats.misses;
+            return nullptr;
+        }
+        ++stats.hits;
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return &it->second.value;
+    }
+
+    /// check if value is cached, without counting or marking it
+    [[nodiscard]] bool contains(const Key& key) const { return entries.find(key) != entries.end(); }
+
+    /// insert value as most recently used, evicts others if needed
+    /** If the key is cached already the old value is kept. A value larger
+        than the budget is not cached, so it doesn't flush the cache.
+    */
+    void insert(const Key& key, Value value, std::size_t bytes)
+    {
+        if (bytes > budget) {
+            return;
+        }
+        auto [it, inserted] = entries.try_emplace(key);
+        if (!inserted) {
+            lru.splice(lru.begin(), lru, it->second.lru);
+            return;
+        }
+        it->second.value = std::move(value);
+        it->second.bytes = bytes;
+        lru.push_front(key);
+        it->second.lru = lru.begin();
+        stats.bytes += bytes;
+        evict();
+    }
+
+    /// set budget in bytes, evicts values if needed
+    void set_budget(std::size_t bytes)
+    {
+        budget = bytes;
+        evict();
+    }
+
+    /// remove all values, keeps statistics except size
+    void clear()
+    {
+        entries.clear();
+        lru.clear();
+        stats.bytes = 0;
+    }
+
+    /// get number of cached values
+    [[nodiscard]] std::size_t size() const { return entries.size(); }
+
+    /// get statistics
+    [[nodiscard]] const statistics& get_statistics() const { return stats; }
+
+  protected:
+    struct entry
+    {
+        Value value;
+        std::size_t bytes{0};
+        typename std::list<Key>::iterator lru; // position in lru list
+    };
+
+    std::unordered_map<Key, entry> entries;
+    std::list<Key> lru; // most recently used first
+    std::size_t budget;
+    statistics stats;
+
+    void evict()
+    {
+        while (stats.bytes > budget && !lru.empty()) {
+            auto it = entries.find(lru.back());
+            stats.bytes -= it->second.bytes;
+            entries.erase(it);
+            lru.pop_back();
+            ++stats.evictions;
+        }
+    }
+};
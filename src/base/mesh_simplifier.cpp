@@ -0,0 +1,528 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Mesh simplification by quadric edge collapse
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+/// minimum cosine between old and new triangle normal for a valid collapse
+const double max_normal_change = 0.2;
+/// vertices closer than this, relative to the mesh size, are welded
+const double weld_tolerance = 1e-5;
+/// maximum difference of texture coordinates of interchangeable vertex copies
+const float wedge_texcoord_tolerance = 1e-3f;
+
+/// compute (unnormalized) normal of a triangle in double precision
+vector3 triangle_normal(const vector3f& p0, const vector3f& p1, const vector3f& p2)
+{
+    return vector3(p1 - p0).cross(vector3(p2 - p0));
+}
+
+/// grid cell for welding vertices
+using cell = std::array<int64_t, 3>;
+
+struct cell_hash
+{
+    std::size_t operator()(const cell& c) const
+    {
+        return std::size_t(c[0] * 73856093) ^ std::size_t(c[1] * 19349663) ^ std::size_t(c[2] * 83492791);
+    }
+};
+
+/// end of the list of vertex copies
+const uint32_t no_copy = std::numeric_limits<uint32_t>::max();
+
+/// find the mapping of an original vertex
+auto find_corner(std::vector<std::pair<uint32_t, uint32_t>>& corner_map, uint32_t c)
+{
+    return std::find_if(corner_map.begin(), corner_map.end(), [c](const auto& m) { return m.first == c; });
+}
+} // namespace
+
+/// Construct quadric of a plane with normal n (length 1) and distance value d
+mesh_simplifier::quadric::quadric(const vector3& n, double d)
+    : a2(n.x * n.x)
+    , ab(n.x * n.y)
+    , ac(n.x * n.z)
+    , ad(n.x * d)
+    , b2(n.y * n.y)
+    , bc(n.y * n.z)
+    , bd(n.y * d)
+    , c2(n.z * n.z)
+    , cd(n.z * d)
+    , d2(d * d)
+    , nr_of_planes(1)
+{
+}
+
+/// Sum up quadrics
+mesh_simplifier::quadric& mesh_simplifier::quadric::operator+=(const quadric& q)
+{
+    a2 += q.a2;
+    ab += q.ab;
+    ac += q.ac;
+    ad += q.ad;
+    b2 += q.b2;
+    bc += q.bc;
+    bd += q.bd;
+    c2 += q.c2;
+    cd += q.cd;
+    d2 += q.d2;
+    nr_of_planes += q.nr_of_planes;
+    return *this;
+}
+
+/// Sum of squared distances of a point to all planes of the quadric
+double mesh_simplifier::quadric::evaluate(const vector3f& p) const
+{
+    const double x = p.x, y = p.y, z = p.z;
+    return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+           + c2 * z * z + 2 * cd * z + d2;
+}
+
+/// Root mean square distance of a point to the planes of the quadric
+double mesh_simplifier::quadric::distance(const vector3f& p) const
+{
+    return (nr_of_planes > 0) ? std::sqrt(std::max(evaluate(p), 0.0) / nr_of_planes) : 0.0;
+}
+
+/// Map every vertex to the first vertex at the same position
+void mesh_simplifier::weld()
+{
+    welded.resize(positions.size());
+    copies.resize(positions.size(), no_copy);
+    if (positions.empty()) {
+        return;
+    }
+    vector3f pmin = positions.front();
+    vector3f pmax = positions.front();
+    for (const auto& p : positions) {
+        pmin = pmin.min(p);
+        pmax = pmax.max(p);
+    }
+    // vertices in the same grid cell or closer than a cell size in
+    // neighbouring cells are welded
+    const double diag      = vector3(pmax - pmin).length();
+    const double cell_size = weld_tolerance * std::max(diag, 1e-6);
+    const double max_dist2 = 3 * cell_size * cell_size;
+    std::unordered_map<cell, uint32_t, cell_hash> grid;
+    grid.reserve(positions.size());
+    for (uint32_t v = 0; v < uint32_t(positions.size()); ++v) {
+        const vector3 p = vector3(positions[v] - pmin) * (1.0 / cell_size);
+        const cell c{int64_t(std::floor(p.x)), int64_t(std::floor(p.y)), int64_t(std::floor(p.z))};
+        welded[v] = v;
+        for (int n = 0; n < 27 && welded[v] == v; ++n) {
+            const auto it = grid.find({c[0] + n % 3 - 1, c[1] + (n / 3) % 3 - 1, c[2] + n / 9 - 1});
+            if (it != grid.end() && vector3(positions[it->second] - positions[v]).square_length() <= max_dist2) {
+                welded[v] = it->second;
+            }
+        }
+        if (welded[v] == v) {
+            grid.emplace(c, v);
+        } else {
+            copies[v]         = copies[welded[v]];
+            copies[welded[v]] = v;
+        }
+    }
+}
+
+/// Find interchangeable copies of every vertex
+void mesh_simplifier::compute_wedges()
+{
+    const bool use_normals   = normals.size() == positions.size();
+    const bool use_texcoords = texcoords.size() == positions.size();
+    wedges.resize(positions.size());
+    for (uint32_t v = 0; v < uint32_t(positions.size()); ++v) {
+        // copies at the same position are interchangeable if their
+        // attributes match, then they are no seam
+        wedges[v] = v;
+        for (uint32_t w = welded[v]; w != no_copy; w = copies[w]) {
+            if (w < v && wedges[w] == w && (!use_normals || normals[v] * normals[w] >= normal_tolerance)
+                && (!use_texcoords || (texcoords[v] - texcoords[w]).square_length()
+                                          <= wedge_texcoord_tolerance * wedge_texcoord_tolerance)) {
+                wedges[v] = w;
+                break;
+            }
+        }
+    }
+}
+
+/// Change normal tolerance, seams may vanish and allow more collapses
+void mesh_simplifier::set_normal_tolerance(float min_cosine)
+{
+    normal_tolerance = min_cosine;
+    compute_wedges();
+    heap.clear();
+    std::vector<uint32_t> nb;
+    for (uint32_t v = 0; v < uint32_t(positions.size()); ++v) {
+        collect_neighbours(v, nb);
+        for (auto w : nb) {
+            if (v < w) {
+                push_best_candidate(v, w);
+            }
+        }
+    }
+}
+
+/// Prepare simplification, compute quadrics, borders and initial candidates
+mesh_simplifier::mesh_simplifier(
+    std::vector<vector3f> positions_,
+    const std::vector<uint32_t>& indices,
+    const std::vector<vector3f>& normals_,
+    const std::vector<vector2f>& texcoords_)
+    : positions(std::move(positions_))
+    , normals(normals_)
+    , texcoords(texcoords_)
+    , triangles(indices)
+    , corners(indices)
+    , triangle_removed(indices.size() / 3, false)
+    , vertex_triangles(positions.size())
+    , quadrics(positions.size())
+    , locked(positions.size(), false)
+    , border(positions.size(), false)
+    , stamps(positions.size(), 0)
+{
+    // topology is computed on welded vertices, so seams are no borders
+    weld();
+    compute_wedges();
+    for (auto& i : triangles) {
+        i = welded[i];
+    }
+    const auto nr_tri = unsigned(triangles.size() / 3);
+    // count triangles per edge, edges with other than two triangles are
+    // borders or non-manifold, their vertices must not move.
+    std::unordered_map<uint64_t, unsigned> edge_count;
+    for (unsigned t = 0; t < nr_tri; ++t) {
+        const uint32_t* tri = &triangles[3 * t];
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+            // Avoid degenerated triangles
+            triangle_removed[t] = true;
+            continue;
+        }
+        ++nr_of_triangles;
+        const auto n    = triangle_normal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+        const double nl = n.length();
+        for (unsigned k = 0; k < 3; ++k) {
+            const uint32_t i0 = tri[k];
+            const uint32_t i1 = tri[(k + 1) % 3];
+            vertex_triangles[i0].push_back(t);
+            ++edge_count[(i0 < i1) ? i0 + (uint64_t(i1) << 32) : i1 + (uint64_t(i0) << 32)];
+            // triangles without area have no plane
+            if (nl > 1e-12) {
+                const auto nn = n * (1.0 / nl);
+                quadrics[i0] += quadric(nn, -(nn * vector3(positions[tri[0]])));
+            }
+        }
+    }
+    // non-manifold edges are locked. Border vertices may only move along
+    // their border, which keeps its shape by planes through the border
+    // edges orthogonal to their triangle. Vertices where borders meet are
+    // locked.
+    std::vector<unsigned> border_edges(positions.size());
+    for (unsigned t = 0; t < nr_tri; ++t) {
+        if (triangle_removed[t]) {
+            continue;
+        }
+        const uint32_t* tri = &triangles[3 * t];
+        const auto n        = triangle_normal(positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+        for (unsigned k = 0; k < 3; ++k) {
+            const uint32_t i0 = tri[k];
+            const uint32_t i1 = tri[(k + 1) % 3];
+            const unsigned c  = edge_count[(i0 < i1) ? i0 + (uint64_t(i1) << 32) : i1 + (uint64_t(i0) << 32)];
+            if (c > 2) {
+                locked[i0] = locked[i1] = true;
+            } else if (c == 1) {
+                ++border_edges[i0];
+                ++border_edges[i1];
+                const auto bn   = vector3(positions[i1] - positions[i0]).cross(n);
+                const double bl = bn.length();
+                if (bl > 1e-12) {
+                    const auto bnn = bn * (1.0 / bl);
+                    const quadric q(bnn, -(bnn * vector3(positions[i0])));
+                    quadrics[i0] += q;
+                    quadrics[i1] += q;
+                }
+            }
+        }
+    }
+    for (uint32_t v = 0; v < uint32_t(positions.size()); ++v) {
+        if (border_edges[v] == 2) {
+            border[v] = true;
+        } else if (border_edges[v] > 0) {
+            locked[v] = true;
+        }
+    }
+    heap.reserve(edge_count.size());
+    for (const auto& ec : edge_count) {
+        push_best_candidate(uint32_t(ec.first), uint32_t(ec.first >> 32));
+    }
+}
+
+/// Collect all vertices connected to a vertex by an edge
+void mesh_simplifier::collect_neighbours(uint32_t v, std::vector<uint32_t>& result) const
+{
+    result.clear();
+    for (auto t : vertex_triangles[v]) {
+        for (unsigned k = 0; k < 3; ++k) {
+            const auto w = triangles[3 * t + k];
+            if (w != v && std::find(result.begin(), result.end(), w) == result.end()) {
+                result.push_back(w);
+            }
+        }
+    }
+}
+
+/// Find the original vertex of "to" for every original vertex of "from"
+/** The triangles that vanish with the collapse connect the copies of both
+    vertices with the same attributes. All remaining triangles at "from" must
+    use a copy interchangeable with one of these, otherwise the collapse would
+    move a seam. Fills corner_map with pairs of wedge of "from" and copy of
+    "to" and returns false if no such mapping exists. */
+bool mesh_simplifier::map_corners(uint32_t from, uint32_t to) const
+{
+    corner_map.clear();
+    for (auto t : vertex_triangles[from]) {
+        const uint32_t* tri = &triangles[3 * t];
+        if (tri[0] != to && tri[1] != to && tri[2] != to) {
+            continue;
+        }
+        uint32_t cf = 0, ct = 0;
+        for (unsigned k = 0; k < 3; ++k) {
+            if (tri[k] == from) {
+                cf = wedges[corners[3 * t + k]];
+            } else if (tri[k] == to) {
+                ct = corners[3 * t + k];
+            }
+        }
+        const auto it = find_corner(corner_map, cf);
+        if (it == corner_map.end()) {
+            corner_map.emplace_back(cf, ct);
+        } else if (wedges[it->second] != wedges[ct]) {
+            return false;
+        }
+    }
+    for (auto t : vertex_triangles[from]) {
+        for (unsigned k = 0; k < 3; ++k) {
+            if (triangles[3 * t + k] == from
+                && find_corner(corner_map, wedges[corners[3 * t + k]]) == corner_map.end()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// Check if collapse is valid and compute its cost
+bool mesh_simplifier::compute_cost(uint32_t from, uint32_t to, double& cost) const
+{
+    if (locked[from]) {
+        return false;
+    }
+    // triangles around "from" must not flip or degenerate
+    unsigned shared = 0;
+    for (auto t : vertex_triangles[from]) {
+        const uint32_t* tri = &triangles[3 * t];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+            ++shared;
+            continue;
+        }
+        vector3f p[3], q[3];
+        for (unsigned k = 0; k < 3; ++k) {
+            p[k] = positions[tri[k]];
+            q[k] = (tri[k] == from) ? positions[to] : p[k];
+        }
+        const auto n_old = triangle_normal(p[0], p[1], p[2]);
+        const auto n_new = triangle_normal(q[0], q[1], q[2]);
+        const double l   = n_old.length() * n_new.length();
+        if (l <= 1e-24 || (n_old * n_new) < max_normal_change * l) {
+            return false;
+        }
+    }
+    // link condition: the only common neighbours of both vertices are the
+    // vertices opposite to the collapsed edge, otherwise the mesh would
+    // become non-manifold.
+    unsigned common = 0;
+    collect_neighbours(from, nb_from);
+    collect_neighbours(to, nb_to);
+    for (auto v : nb_from) {
+        if (std::find(nb_to.begin(), nb_to.end(), v) != nb_to.end()) {
+            ++common;
+        }
+    }
+    // border vertices only move along a border edge
+    const unsigned needed_shared = border[from] ? 1 : 2;
+    if (shared != needed_shared || common > shared || !map_corners(from, to)) {
+        return false;
+    }
+    quadric q = quadrics[from];
+    q += quadrics[to];
+    // mean squared distance, so the cost is independent of the number of
+    // planes summed up in the quadrics
+    const double dist = q.distance(positions[to]);
+    cost              = dist * dist;
+    return true;
+}
+
+/// Push the cheaper valid direction of an edge to the heap
+void mesh_simplifier::push_best_candidate(uint32_t v0, uint32_t v1)
+{
+    double cost0 = 0, cost1 = 0;
+    const bool valid0 = compute_cost(v0, v1, cost0);
+    const bool valid1 = compute_cost(v1, v0, cost1);
+    if (!valid0 && !valid1) {
+        return;
+    }
+    if (valid0 && (!valid1 || cost0 <= cost1)) {
+        heap.push_back({cost0, v0, v1, stamps[v0], stamps[v1]});
+    } else {
+        heap.push_back({cost1, v1, v0, stamps[v1], stamps[v0]});
+    }
+    std::push_heap(heap.begin(), heap.end());
+}
+
+/// Collapse vertex "from" onto vertex "to"
+void mesh_simplifier::collapse(uint32_t from, uint32_t to)
+{
+    map_corners(from, to);
+    for (auto t : vertex_triangles[from]) {
+        uint32_t* tri = &triangles[3 * t];
+        if (tri[0] == to || tri[1] == to || tri[2] == to) {
+            // triangle vanishes, remove it from the other vertices
+            triangle_removed[t] = true;
+            --nr_of_triangles;
+            for (unsigned k = 0; k < 3; ++k) {
+                if (tri[k] != from) {
+                    auto& vt = vertex_triangles[tri[k]];
+                    vt.erase(std::find(vt.begin(), vt.end(), t));
+                }
+            }
+        } else {
+            for (unsigned k = 0; k < 3; ++k) {
+                if (tri[k] == from) {
+                    tri[k]             = to;
+                    corners[3 * t + k] = find_corner(corner_map, wedges[corners[3 * t + k]])->second;
+                }
+            }
+            vertex_triangles[to].push_back(t);
+        }
+    }
+    vertex_triangles[from].clear();
+    quadrics[to] += quadrics[from];
+    ++stamps[from];
+    ++stamps[to];
+    // costs of all edges at "to" changed
+    std::vector<uint32_t> nb;
+    collect_neighbours(to, nb);
+    for (auto v : nb) {
+        push_best_candidate(v, to);
+    }
+}
+
+/// Collapse edges until target or error limit is reached
+void mesh_simplifier::simplify(unsigned target_nr_of_triangles, float max_error)
+{
+    const double max_cost = double(max_error) * double(max_error);
+    while (nr_of_triangles > target_nr_of_triangles && !heap.empty()) {
+        const candidate c = heap.front();
+        if (c.cost > max_cost) {
+            break;
+        }
+        std::pop_heap(heap.begin(), heap.end());
+        heap.pop_back();
+        // skip outdated candidates
+        if (c.from_stamp != stamps[c.from] || c.to_stamp != stamps[c.to]) {
+            continue;
+        }
+        // the neighbourhood may have changed, so check validity again
+        double cost = 0;
+        if (!compute_cost(c.from, c.to, cost)) {
+            continue;
+        }
+        collapse(c.from, c.to);
+        error = std::max(error, float(std::sqrt(cost)));
+    }
+}
+
+/// Return original vertex indices of all remaining triangles
+std::vector<uint32_t> mesh_simplifier::get_indices() const
+{
+    std::vector<uint32_t> result;
+    result.reserve(nr_of_triangles * 3);
+    for (unsigned t = 0; t < unsigned(triangle_removed.size()); ++t) {
+        if (!triangle_removed[t]) {
+            result.insert(result.end(), &corners[3 * t], &corners[3 * t + 3]);
+        }
+    }
+    return result;
+}
+
+/// Compute a chain of levels of detail in one simplification run
+std::vector<mesh_simplifier::level> mesh_simplifier::compute_lod_chain(
+    std::vector<vector3f> positions,
+    const std::vector<uint32_t>& indices,
+    const std::vector<vector3f>& normals,
+    const std::vector<vector2f>& texcoords,
+    unsigned nr_of_levels,
+    unsigned min_nr_of_triangles,
+    float max_relative_error)
+{
+    std::vector<level> result;
+    if (positions.empty()) {
+        return result;
+    }
+    vector3f pmin = positions.front();
+    vector3f pmax = positions.front();
+    for (const auto& p : positions) {
+        pmin = pmin.min(p);
+        pmax = pmax.max(p);
+    }
+    // the last collapses to reach a target can be much worse than the others,
+    // e.g. when thin parts vanish, so the error of each level is limited
+    float max_error = max_relative_error * (pmax - pmin).length();
+    mesh_simplifier ms(std::move(positions), indices, normals, texcoords);
+    for (unsigned l = 0; l < nr_of_levels; ++l, max_error *= 2) {
+        const unsigned before = ms.get_nr_of_triangles();
+        const unsigned target = before / 4;
+        if (target < min_nr_of_triangles) {
+            break;
+        }
+        if (l == 1) {
+            // coarser levels are seen from far away, where the number of
+            // triangles matters more than shading over hard edges
+            ms.set_normal_tolerance(-1.f);
+        }
+        ms.simplify(target, max_error);
+        // stop if mesh can't be simplified further, e.g. mostly borders
+        if (ms.get_nr_of_triangles() * 10 > before * 9) {
+            break;
+        }
+        result.push_back({ms.get_indices(), ms.get_error()});
+    }
+    return result;
+}
@@ -0,0 +1,152 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Mesh simplification by quadric edge collapse
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#pragma once
+
+#include "vector2.hpp"
+#include "vector3.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/// Simplifies a triangle mesh by collapsing the edges with the lowest quadric error.
+/** Edges are collapsed onto one of their end points (half edge collapse), so
+    the simplified mesh uses a subset of the original vertices and only the
+    triangle indices change. This way all levels of detail can share the
+    vertex data of the original mesh. Vertices at the same position, like the
+    copies at texture or normal seams, are welded before simplification, so
+    seams are no borders of the mesh. Every triangle corner keeps its original
+    vertex. Copies with about the same normal and texture coordinates are
+    interchangeable, a collapse is only done if every corner of the removed
+    vertex gets a copy of the target vertex that is interchangeable with its
+    own, so seams stay intact. Vertices on open edges only move along them,
+    vertices at non-manifold edges or where open edges meet are never moved,
+    so the outline of open parts is kept. Simplification can be continued
+    with lower triangle targets to build a chain of levels of detail in one
+    run.
+*/
+class mesh_simplifier
+{
+  public:
+    /// one level of detail
+    struct level
+    {
+        std::vector<uint32_t> indices; ///< 3 indices per triangle
+        float error{0.f};              ///< geometric error, mean distance to original planes
+    };
+
+    /// prepare simplification of a mesh
+    ///@param positions - vertex positions
+    ///@param indices - 3 indices per triangle
+    ///@param normals - vertex normals, may be empty
+    ///@param texcoords - vertex texture coordinates, may be empty
+    mesh_simplifier(
+        std::vector<vector3f> positions,
+        const std::vector<uint32_t>& indices,
+        const std::vector<vector3f>& normals   = {},
+        const std::vector<vector2f>& texcoords = {});
+
+    /// collapse edges until the mesh has at most the target number of
+    /// triangles or no collapse with an error below max_error is possible
+    void simplify(unsigned target_nr_of_triangles, float max_error = std::numeric_limits<float>::max());
+
+    /// set minimum cosine between normals of interchangeable vertex copies
+    /** Lower values allow collapses over hard edges, -1 ignores normals. */
+    void set_normal_tolerance(float min_cosine);
+
+    /// get number of triangles left
+    [[nodiscard]] unsigned get_nr_of_triangles() const { return nr_of_triangles; }
+
+    /// get maximum error of all collapses done so far
+    [[nodiscard]] float get_error() const { return error; }
+
+    /// get the indices of the current simplified mesh, 3 per triangle
+    [[nodiscard]] std::vector<uint32_t> get_indices() const;
+
+    /// compute levels of detail, each with about a quarter of the triangles
+    /// of the level before or less if the error limit is reached first.
+    /// Level 0 (the mesh itself) is not included.
+    ///@param nr_of_levels - maximum number of levels to compute
+    ///@param min_nr_of_triangles - stop when a level would have less triangles
+    ///@param max_relative_error - error limit of the first level relative to the mesh size, doubled per level
+    static std::vector<level> compute_lod_chain(
+        std::vector<vector3f> positions,
+        const std::vector<uint32_t>& indices,
+        const std::vector<vector3f>& normals,
+        const std::vector<vector2f>& texcoords,
+        unsigned nr_of_levels,
+        unsigned min_nr_of_triangles = 32,
+        float max_relative_error     = 0.01f);
+
+  protected:
+    /// symmetric 4x4 matrix of summed squared plane distances
+    struct quadric
+    {
+        double a2{0}, ab{0}, ac{0}, ad{0}, b2{0}, bc{0}, bd{0}, c2{0}, cd{0}, d2{0};
+        double nr_of_planes{0};
+        quadric() = default;
+        quadric(const vector3& n, double d);
+        quadric& operator+=(const quadric& q);
+        [[nodiscard]] double evaluate(const vector3f& p) const;
+        [[nodiscard]] double distance(const vector3f& p) const;
+    };
+
+    /// a possible collapse of vertex "from" onto vertex "to"
+    struct candidate
+    {
+        double cost;
+        uint32_t from, to;
+        uint32_t from_stamp, to_stamp;
+        bool operator<(const candidate& c) const { return cost > c.cost; } // for min heap
+    };
+
+    std::vector<vector3f> positions;
+    std::vector<vector3f> normals;
+    std::vector<vector2f> texcoords;
+    std::vector<uint32_t> triangles; // 3 indices of welded vertices per triangle
+    std::vector<uint32_t> corners;   // 3 original vertex indices per triangle
+    std::vector<uint32_t> welded;    // first vertex at the same position
+    std::vector<uint32_t> copies;    // next vertex at the same position
+    std::vector<uint32_t> wedges;    // first interchangeable copy of each vertex
+    float normal_tolerance{0.9f};
+    std::vector<bool> triangle_removed;
+    std::vector<std::vector<uint32_t>> vertex_triangles;
+    std::vector<quadric> quadrics;
+    std::vector<bool> locked;
+    std::vector<bool> border; // vertex on an open edge
+    std::vector<uint32_t> stamps; // changed whenever a vertex changes
+    std::vector<candidate> heap;
+    unsigned nr_of_triangles{0};
+    float error{0.f};
+    mutable std::vector<uint32_t> nb_from, nb_to;                  // temporary, avoids allocations
+    mutable std::vector<std::pair<uint32_t, uint32_t>> corner_map; // temporary, avoids allocations
+
+    void weld();
+    void compute_wedges();
+    bool map_corners(uint32_t from, uint32_t to) const;
+    bool compute_cost(uint32_t from, uint32_t to, double& cost) const;
+    void push_best_candidate(uint32_t v0, uint32_t v1);
+    void collapse(uint32_t from, uint32_t to);
+    void collect_neighbours(uint32_t v, std::vector<uint32_t>& result) const;
+};
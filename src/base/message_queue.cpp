@@ -38,64 +38,96 @@ void message::evaluate() const
     }
 }
 
+auto message::is_done() const -> bool
+{
+    return done.load(std::memory_order_acquire);
+}
+
+auto message::wait() const -> bool
+{
+    // a done message may outlive its queue, so don't touch the queue then
+    if (!is_done()) {
+        std::unique_lock<std::mutex> ml(queue->mymutex);
+        ++queue->nr_waiting;
+        queue->donecondvar.wait(ml, [this]() { return done.load(std::memory_order_relaxed); });
+        --queue->nr_waiting;
+        if (queue->closed) {
+            // destructor may wait for us
+            queue->donecondvar.notify_all();
+        }
+    }
+    return result;
+}
+
 message_queue::message_queue() = default;
 
 message_queue::~message_queue()
 {
-    // Inform receiver
-    wakeup_receiver();
-
-    // clean up queues, report all pending messages as failed, then wait
-    // until ackqueue is empty... it should not happen though...
-    bool ackqueueempty = true;
-    {
-        std::unique_lock<std::mutex> ml(mymutex);
-        for (auto& elem : myqueue) {
-            if (elem->needsanswer) {
-                ackqueue.push_back(std::move(elem));
-            }
+    std::unique_lock<std::mutex> ml(mymutex);
+    closed = true;
+    // report all pending messages as failed
+    for (message* msg = first; msg != nullptr;) {
+        message* next = msg->next;
+        msg->result   = false;
+        if (msg->owned) {
+            delete msg;
+        } else {
+            msg->done.store(true, std::memory_order_release);
         }
-        ackcondvar.notify_all();
-        ackqueueempty = ackqueue.empty();
+        msg = next;
     }
+    first     = nullptr;
+    last      = nullptr;
+    nr_queued = 0;
+    // inform receiver and senders
+    emptycondvar.notify_all();
+    donecondvar.notify_all();
+    // wait for messages the receiver evaluates right now and their senders
+    donecondvar.wait(ml, [this]() { return nr_in_flight == 0 && nr_waiting == 0; });
+}
 
-    while (!ackqueueempty) {
-        // fixme// thread::sleep(10);//fixme use sys! uses SDL_Delay...is there
-        // a c++ solution?!
-        std::unique_lock<std::mutex> ml(mymutex);
-        ackqueueempty = ackqueue.empty();
+auto message_queue::enqueue(message& msg, bool owned) -> bool
+{
+    std::unique_lock<std::mutex> ml(mymutex);
+    if (closed || !msg.is_done()) {
+        return false;
+    }
+    msg.next   = nullptr;
+    msg.queue  = this;
+    msg.owned  = owned;
+    msg.result = false;
+    msg.done.store(false, std::memory_order_relaxed);
+    if (last != nullptr) {
+        last->next = &msg;
+    } else {
+        first = &msg;
+        emptycondvar.notify_all();
     }
+    last = &msg;
+    ++nr_queued;
+    return true;
 }
 
-auto message_queue::send(message::ptr msg, bool waitforanswer) -> bool
+auto message_queue::send(message& msg) -> bool
 {
-    msg->needsanswer  = waitforanswer;
-    msg->result       = false;
-    message* msg_addr = msg.get(); // address only for comparison
-    std::unique_lock<std::mutex> oml(mymutex);
-
-    bool e = myqueue.empty();
-    myqueue.push_back(std::move(msg));
-    msginqueue = true;
+    return enqueue(msg, false) && msg.wait();
+}
 
-    if (e) {
-        emptycondvar.notify_all();
-    }
+auto message_queue::post(message& msg) -> bool
+{
+    return enqueue(msg, false);
+}
 
+auto message_queue::send(message::ptr msg, bool waitforanswer) -> bool
+{
     if (waitforanswer) {
-        while (true) {
-            ackcondvar.wait(oml);
-            // check if this message has been acknowledged
-            for (auto it = ackqueue.begin(); it != ackqueue.end();) {
-                if (it->get() == msg_addr) {
-                    // found it, return result, delete and unqueue message
-                    bool result = (*it)->result;
-                    ackqueue.erase(it);
-                    return result;
-                }
-            }
-        }
+        // msg lives here until it is done
+        return send(*msg);
+    }
+    if (!enqueue(*msg, true)) {
+        return false;
     }
+    msg.release(); // owned by queue now
     return true;
 }
 
@@ -109,52 +141,63 @@ void message_queue::wakeup_receiver()
     emptycondvar.notify_all();
 }
 
-auto message_queue::receive(bool wait) -> std::vector<message::ptr>
+auto message_queue::take_all(bool wait) -> message*
 {
-    std::vector<message::ptr> result;
     std::unique_lock<std::mutex> oml(mymutex);
-
-    if (myqueue.empty()) {
-        if (wait && !abortwait) {
-            emptycondvar.wait(oml);
-        } else {
-            // no need to wait, so clear abort signal
-            abortwait  = false;
-            msginqueue = false;
-            return result;
-        }
+    if (wait) {
+        emptycondvar.wait(oml, [this]() { return first != nullptr || abortwait || closed; });
     }
-
-    abortwait = false;
-
-    // if we woke up and queue is still empty, we received a wakeup signal
-    // so result either is empty or contains the full queue after this line
-    myqueue.swap(result);
-
-    // any way, there are now no messages in the queue. return messages or empty
-    // list.
-    msginqueue = false;
-    return result;
+    // no matter if we waited, the abort signal is consumed now
+    abortwait     = false;
+    message* msgs = first;
+    first         = nullptr;
+    last          = nullptr;
+    nr_in_flight += nr_queued;
+    nr_queued = 0;
+    return msgs;
 }
 
-void message_queue::acknowledge(message::ptr msg)
+void message_queue::complete(message* msgs, unsigned nr)
 {
-    if (msg.get() == nullptr) {
-        THROW(error, "acknowledge without message called");
-    }
-    bool needsanswer = msg->needsanswer;
-    if (needsanswer) {
+    message* owned = nullptr;
+    {
         std::unique_lock<std::mutex> oml(mymutex);
-        ackqueue.push_back(std::move(msg));
-        ackcondvar.notify_all();
+        for (message* msg = msgs; msg != nullptr;) {
+            message* next = msg->next;
+            if (msg->owned) {
+                msg->next = owned;
+                owned     = msg;
+            } else {
+                // after this the sender may destroy the message
+                msg->done.store(true, std::memory_order_release);
+            }
+            msg = next;
+        }
+        nr_in_flight -= nr;
+        if (nr_waiting > 0 || closed) {
+            donecondvar.notify_all();
+        }
+    }
+    while (owned != nullptr) {
+        message* next = owned->next;
+        delete owned;
+        owned = next;
     }
 }
 
-void message_queue::process_messages(bool wait)
+auto message_queue::process_messages(bool wait) -> unsigned
 {
-    auto msgs = receive(wait);
-    for (auto& msg : msgs) {
+    message* msgs = take_all(wait);
+    unsigned nr   = 0;
+    for (message* msg = msgs; msg != nullptr; msg = msg->next) {
         msg->evaluate();
-        acknowledge(std::move(msg));
+        ++nr;
+    }
+    // complete the whole batch with one lock, senders waiting for an early
+    // message in the batch are woken a bit later, but there is much less
+    // locking with many posted messages
+    if (nr > 0) {
+        complete(msgs, nr);
     }
+    return nr;
 }
@@ -22,11 +22,17 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <vector>
 
 /// a generic message, base class
+/** Messages are linked into the queue directly, so sending doesn't allocate.
+    A message sent by reference must live until it is done, a sender can
+    wait for that like for a future. Messages passed by pointer are owned
+    and deleted by the queue.
+*/
 class message
 {
   public:
@@ -34,8 +40,11 @@ class message
 
   private:
     friend class message_queue;
-    bool needsanswer;
-    mutable bool result;
+    message* next{nullptr};              ///< link in queue, guarded by the queue mutex
+    class message_queue* queue{nullptr}; ///< queue it was last sent to
+    bool owned{false};                   ///< deleted by queue after evaluation
+    std::atomic<bool> done{true};        ///< only changed with the queue mutex held
+    mutable bool result{false};
 
     // no copy, no move
     message(const message&)            = delete;
@@ -60,11 +69,21 @@ class message
     /// eval() instead.
     void evaluate() const;
 
-    /// get result of evaluation
+    /// get result of evaluation, only valid when done
     bool get_result() const { return result; }
+
+    /// was the message evaluated (or discarded), threadsafe
+    bool is_done() const;
+
+    /// wait until the message was evaluated (or discarded), threadsafe
+    ///@return result of evaluation, false when discarded
+    bool wait() const;
 };
 
 /// an C++ message queue with generic messages
+/** Messages are kept in an intrusive list and completed one by one, a
+    waiting sender only checks its own message when woken up.
+*/
 class message_queue
 {
   private:
@@ -73,22 +92,44 @@ class message_queue
     message_queue& operator=(const message_queue&) = delete;
 
   protected:
-    std::vector<message::ptr> myqueue;
-    std::mutex mymutex;
+    friend class message;
+    message* first{nullptr}; // queued messages in order of sending
+    message* last{nullptr};
+    mutable std::mutex mymutex;
     std::condition_variable emptycondvar;
-    std::condition_variable ackcondvar;
-    bool msginqueue{false};
-    bool abortwait{false};              // set to true by wakeup_receiver()
-    std::vector<message::ptr> ackqueue; // queue with acknowledged messages
+    mutable std::condition_variable donecondvar;
+    bool abortwait{false};          // set to true by wakeup_receiver()
+    bool closed{false};             // set by destructor, no more messages accepted
+    unsigned nr_queued{0};          // messages in the list
+    unsigned nr_in_flight{0};       // messages taken by the receiver and not yet completed
+    mutable unsigned nr_waiting{0}; // senders waiting for completion
+
+    /// append message to queue
+    bool enqueue(message& msg, bool owned);
+    /// take all queued messages, first one or nullptr
+    message* take_all(bool wait);
+    /// mark list of nr messages as done, wake waiting senders, delete owned ones
+    void complete(message* msgs, unsigned nr);
 
   public:
     /// create message queue
     message_queue();
 
-    /// destroy message queue
+    /// destroy message queue, discards pending messages and waits until
+    /// messages that are evaluated right now and their senders are done
     ~message_queue();
 
-    /// send a message
+    /// send a message synchronously
+    ///@param msg - message to send, must not be queued already
+    ///@return result of evaluation
+    bool send(message& msg);
+
+    /// send a message asynchronously
+    ///@param msg - message to send, must live until msg.is_done(), use msg.wait() for result
+    ///@return false if queue is closed or message is already queued
+    bool post(message& msg);
+
+    /// send a message, the queue takes ownership
     ///@param msg - message to send
     ///@param waitforanswer - true to send message synchronously (wait for reply
     /// with result)
@@ -98,18 +139,9 @@ class message_queue
     /// wakeup thread waiting for a message
     void wakeup_receiver();
 
-    /// wait for a messages
-    ///@param wait - if true block while queue is empty, if false only test and
-    /// do not block
-    ///@return list of messages
-    std::vector<message::ptr> receive(bool wait = true);
-
-    /// acknowledge received message.
-    ///@note Must be called for every message passed from the receive function!
-    void acknowledge(message::ptr msg);
-
     /// process all messages, that is wait for messages, run eval() for every
-    /// message and ack them
+    /// message and complete them
     ///@param wait - true: block if queue is empty
-    void process_messages(bool wait = true);
+    ///@return number of messages processed
+    unsigned process_messages(bool wait = true);
 };
@@ -0,0 +1,228 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Pooled storage of short lived objects addressed by generational handles.
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#pragma once
+
+#include "slot_map.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// Arena for many objects of one type that are created and destroyed often.
+/** Objects are stored densely in fixed size blocks that are never moved or
+    freed, so creating objects never moves existing ones and references stay
+    valid until the next compaction. Dead objects are removed only in
+    compact(), in one pass that moves the last objects into the gaps.
+    Handles are generational like slot_map keys and detect objects that
+    were removed. Capacity can be preallocated to avoid allocation at all.
+*/
+template<typename T, unsigned block_bits = 6>
+class object_pool
+{
+  public:
+    static constexpr std::size_t block_size = std::size_t(1) << block_bits;
+
+    /// handle of an object, id 0 is never used
+    struct handle
+    {
+        uint32_t id{0};
+        bool operator==(const handle& other) const { return id == other.id; }
+        bool operator!=(const handle& other) const { return id != other.id; }
+    };
+
+    template<typename P, typename V>
+    class iterator_base
+    {
+      public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = V*;
+        using reference         = V&;
+
+        iterator_base(P* pool_, std::size_t index_)
+            : pool(pool_)
+            , index(index_)
+        {
+        }
+        reference operator*() const { return (*pool)[index]; }
+        pointer operator->() const { return &(*pool)[index]; }
+        iterator_base& operator++()
+        {
+            ++index;
+            return *this;
+        }
+        iterator_base operator++(int)
+        {
+            auto tmp = *this;
+            ++index;
+            return tmp;
+        }
+        iterator_base& operator+=(difference_type d)
+        {
+            index += d;
+            return *this;
+        }
+        iterator_base operator+(difference_type d) const { return iterator_base(pool, index + d); }
+        difference_type operator-(const iterator_base& other) const
+        {
+            return difference_type(index) - difference_type(other.index);
+        }
+        bool operator==(const iterator_base& other) const { return index == other.index; }
+        bool operator!=(const iterator_base& other) const { return index != other.index; }
+
+      protected:
+        P* pool;
+        std::size_t index;
+    };
+    using iterator       = iterator_base<object_pool, T>;
+    using const_iterator = iterator_base<const object_pool, const T>;
+
+    /// create pool with space for capacity objects
+    explicit object_pool(std::size_t capacity = 0) { reserve(capacity); }
+
+    object_pool(const object_pool&)            = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    ~object_pool() { clear(); }
+
+    /// allocate space for n objects
+    void reserve(std::size_t n)
+    {
+        while (blocks.size() * block_size < n) {
+            blocks.push_back(std::make_unique<storage[]>(block_size));
+        }
+        handles.reserve(n);
+        positions.reserve(n);
+    }
+
+    /// insert object, returns its handle and the object in the pool
+    std::pair<handle, T&> insert(T&& obj)
+    {
+        if (count == blocks.size() * block_size) {
+            blocks.push_back(std::make_unique<storage[]>(block_size));
+        }
+        T* p           = new (address(count)) T(std::move(obj));
+        const handle h = {ids.allocate()};
+        const auto idx = slot_allocator::index(h.id);
+        if (idx >= positions.size()) {
+            positions.resize(idx + 1, npos);
+        }
+        positions[idx] = uint32_t(count);
+        handles.push_back(h);
+        ++count;
+        return {h, *p};
+    }
+
+    /// get object by handle or nullptr if it has been removed
+    T* get(handle h) { return contains(h) ? &(*this)[positions[slot_allocator::index(h.id)]] : nullptr; }
+    const T* get(handle h) const
+    {
+        return contains(h) ? &(*this)[positions[slot_allocator::index(h.id)]] : nullptr;
+    }
+    [[nodiscard]] bool contains(handle h) const
+    {
+        const auto idx = slot_allocator::index(h.id);
+        return h.id != 0 && idx < positions.size() && positions[idx] != npos && handles[positions[idx]] == h;
+    }
+    /// handle of object at position
+    [[nodiscard]] handle get_handle(std::size_t position) const { return handles[position]; }
+
+    /// remove all objects where is_garbage(obj) is true, in one pass.
+    ///@returns number of removed objects
+    template<typename F>
+    std::size_t compact(F&& is_garbage)
+    {
+        std::size_t removed = 0;
+        for (std::size_t i = 0; i < count;) {
+            T& obj = (*this)[i];
+            if (!is_garbage(std::as_const(obj))) {
+                ++i;
+                continue;
+            }
+            ids.release(handles[i].id);
+            positions[slot_allocator::index(handles[i].id)] = npos;
+            const std::size_t last                          = count - 1;
+            if (i != last) {
+                // move last object into the gap, it is checked next
+                obj        = std::move((*this)[last]);
+                handles[i] = handles[last];
+                positions[slot_allocator::index(handles[i].id)] = uint32_t(i);
+                ++relocations;
+            }
+            (*this)[last].~T();
+            handles.pop_back();
+            --count;
+            ++removed;
+        }
+        return removed;
+    }
+
+    /// remove all objects, keeps memory
+    void clear()
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            (*this)[i].~T();
+        }
+        count = 0;
+        handles.clear();
+        positions.clear();
+        ids.clear();
+    }
+
+    T& operator[](std::size_t i) { return *std::launder(reinterpret_cast<T*>(address(i))); }
+    const T& operator[](std::size_t i) const
+    {
+        return *std::launder(reinterpret_cast<const T*>(address(i)));
+    }
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+    [[nodiscard]] std::size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] std::size_t capacity() const { return blocks.size() * block_size; }
+
+    /// number of times objects changed their address so far
+    [[nodiscard]] unsigned get_relocation_count() const { return relocations; }
+
+  protected:
+    struct alignas(T) storage
+    {
+        unsigned char data[sizeof(T)];
+    };
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    std::vector<std::unique_ptr<storage[]>> blocks;
+    std::size_t count{0};
+    std::vector<handle> handles;     ///< handle by position
+    std::vector<uint32_t> positions; ///< position by slot index of handle
+    slot_allocator ids;
+    unsigned relocations{0};
+
+    [[nodiscard]] void* address(std::size_t i) const { return blocks[i >> block_bits][i & (block_size - 1)].data; }
+};
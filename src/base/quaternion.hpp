@@ -192,6 +192,15 @@ class quaterniont
         return quaterniont(cos(ang * scal), v * sa);
     }
 
+    /// interpolate between two rotations (normalized linear interpolation,
+    /// good enough for small angle differences like between simulation steps)
+    static quaterniont<D> nlerp(const quaterniont<D>& a, const quaterniont<D>& b, const D& t)
+    {
+        // use shortest path, q and -q are the same rotation
+        const D dot = a.s * b.s + a.v * b.v;
+        return (a * (D(1) - t) + (dot < D(0) ? -b : b) * t).normal();
+    }
+
     /// generate a 3x3 rotation matrix from quaternion
     [[nodiscard]] matrix3t<D> rotmat() const
     {
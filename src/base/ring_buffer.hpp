@@ -0,0 +1,134 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Ring buffer of fixed capacity, newest element first.
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+/// Stores the last N elements pushed, in one contiguous array.
+/** Memory is allocated once on construction, pushing to a full buffer
+    overwrites the oldest element. Elements are accessed and iterated from
+    the newest (index 0) to the oldest one.
+*/
+template<typename T>
+class ring_buffer
+{
+  public:
+    /// iterator from newest to oldest element
+    class const_iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const T*;
+        using reference         = const T&;
+
+        const_iterator(const ring_buffer& rb_, std::size_t index_)
+            : rb(&rb_)
+            , index(index_)
+        {
+        }
+        reference operator*() const { return (*rb)[index]; }
+        pointer operator->() const { return &(*rb)[index]; }
+        const_iterator& operator++()
+        {
+            ++index;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            auto tmp = *this;
+            ++index;
+            return tmp;
+        }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+      protected:
+        const ring_buffer* rb;
+        std::size_t index;
+    };
+
+    /// create buffer for up to capacity elements
+    explicit ring_buffer(std::size_t capacity)
+        : data(capacity)
+    {
+    }
+
+    /// add element as newest one, removes the oldest if buffer is full
+    void push_front(const T& elem)
+    {
+        head       = (head == 0 ? data.size() : head) - 1;
+        data[head] = elem;
+        if (count < data.size()) {
+            ++count;
+        }
+    }
+
+    /// remove all elements, keeps memory
+    void clear()
+    {
+        head  = 0;
+        count = 0;
+    }
+
+    [[nodiscard]] std::size_t size() const { return count; }
+    [[nodiscard]] std::size_t capacity() const { return data.size(); }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] bool full() const { return count == data.size(); }
+    /// newest element
+    [[nodiscard]] const T& front() const { return data[head]; }
+    /// oldest element
+    [[nodiscard]] const T& back() const { return (*this)[count - 1]; }
+    /// element by age, 0 is the newest one
+    const T& operator[](std::size_t i) const
+    {
+        const auto j = head + i;
+        return data[j < data.size() ? j : j - data.size()];
+    }
+
+    /// call func for all elements from newest to oldest, faster than iterating
+    /// because the buffer is walked in two contiguous parts
+    template<typename F>
+    void for_each(F&& func) const
+    {
+        const auto first = std::min(count, data.size() - head);
+        for (std::size_t i = 0; i < first; ++i) {
+            func(data[head + i]);
+        }
+        for (std::size_t i = 0; i < count - first; ++i) {
+            func(data[i]);
+        }
+    }
+
+    [[nodiscard]] const_iterator begin() const { return const_iterator(*this, 0); }
+    [[nodiscard]] const_iterator end() const { return const_iterator(*this, count); }
+
+  protected:
+    std::vector<T> data;
+    std::size_t head{0};  ///< index of newest element
+    std::size_t count{0}; ///< number of stored elements
+};
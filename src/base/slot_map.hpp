@@ -0,0 +1,216 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Dense storage of objects addressed by generational handles.
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/// Hands out generational handles: index of a slot plus its reuse count.
+/** The lower bits of a handle are a slot index, the upper bits count how
+    often the slot was used. A released slot is reused with the next
+    generation, so old handles to it become invalid instead of referencing
+    the new object. Handle 0 is never returned, so it can mean "invalid".
+    Several slot_maps can share one allocator, their handles are then unique
+    over all of them.
+*/
+class slot_allocator
+{
+  public:
+    static constexpr unsigned index_bits      = 20;
+    static constexpr uint32_t index_mask      = (1U << index_bits) - 1;
+    static constexpr uint32_t generation_mask = (1U << (32 - index_bits)) - 1;
+
+    [[nodiscard]] static uint32_t index(uint32_t handle) { return handle & index_mask; }
+    [[nodiscard]] static uint32_t generation(uint32_t handle) { return handle >> index_bits; }
+
+    /// get a new handle
+    uint32_t allocate()
+    {
+        uint32_t idx = 0;
+        if (free_slots.empty()) {
+            idx = uint32_t(generations.size());
+            if (idx > index_mask) {
+                throw std::length_error("slot_allocator: out of slots");
+            }
+            generations.push_back(1);
+            used.push_back(true);
+        } else {
+            idx = free_slots.back();
+            free_slots.pop_back();
+            used[idx] = true;
+        }
+        return idx | (generations[idx] << index_bits);
+    }
+
+    /// give a handle back, its slot is reused with the next generation
+    void release(uint32_t handle)
+    {
+        const auto idx = index(handle);
+        if (idx < generations.size() && used[idx] && generations[idx] == generation(handle)) {
+            used[idx] = false;
+            // generation 0 is skipped, so slot 0 never gives handle 0
+            generations[idx] = std::max((generations[idx] + 1) & generation_mask, 1U);
+            free_slots.push_back(idx);
+        }
+    }
+
+    /// mark a handle given out earlier as used, e.g. when loading a savegame
+    void reserve(uint32_t handle)
+    {
+        const auto idx = index(handle);
+        while (generations.size() <= idx) {
+            free_slots.push_back(uint32_t(generations.size()));
+            generations.push_back(1);
+            used.push_back(false);
+        }
+        if (used[idx]) {
+            throw std::invalid_argument("slot_allocator: handle reserved twice");
+        }
+        free_slots.erase(std::find(free_slots.begin(), free_slots.end(), idx));
+        generations[idx] = generation(handle);
+        used[idx]        = true;
+    }
+
+    /// release all handles
+    void clear()
+    {
+        generations.clear();
+        used.clear();
+        free_slots.clear();
+    }
+
+  protected:
+    std::vector<uint32_t> generations; ///< current generation per slot
+    std::vector<bool> used;
+    std::vector<uint32_t> free_slots;
+};
+
+/// Map from generational handles to objects, stored densely in one array.
+/** Iteration runs over a contiguous array of (key, object) pairs, lookup and
+    erase are O(1) by a table indexed with the slot index of the key. Erasing
+    moves the last element into the gap, so the order of elements changes
+    and, like inserting, objects may change their address. Use
+    get_relocation_count() to detect when pointers to elements must be
+    renewed. Keys are created by a slot_allocator, Key is a handle type with
+    an unsigned member "id" holding the handle value, like sea_object_id.
+*/
+template<typename Key, typename T>
+class slot_map
+{
+  public:
+    using value_type     = std::pair<Key, T>;
+    using iterator       = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    iterator begin() { return values.begin(); }
+    iterator end() { return values.end(); }
+    const_iterator begin() const { return values.begin(); }
+    const_iterator end() const { return values.end(); }
+    [[nodiscard]] std::size_t size() const { return values.size(); }
+    [[nodiscard]] bool empty() const { return values.empty(); }
+
+    /// reserve space, avoids relocation when inserting up to n elements
+    void reserve(std::size_t n)
+    {
+        if (n > values.capacity()) {
+            values.reserve(n);
+            ++relocations;
+        }
+    }
+
+    /// insert object with a key that is not used in this map yet
+    value_type& insert(Key key, T&& obj)
+    {
+        const auto idx = slot_allocator::index(key.id);
+        if (idx >= positions.size()) {
+            positions.resize(idx + 1, npos);
+        } else if (positions[idx] != npos) {
+            throw std::invalid_argument("slot_map: key inserted twice");
+        }
+        if (values.size() == values.capacity()) {
+            ++relocations;
+        }
+        positions[idx] = uint32_t(values.size());
+        values.emplace_back(key, std::move(obj));
+        return values.back();
+    }
+
+    iterator find(const Key& key) { return values.begin() + position_of(key); }
+    const_iterator find(const Key& key) const { return values.begin() + position_of(key); }
+    [[nodiscard]] bool contains(const Key& key) const { return position_of(key) != values.size(); }
+
+    /// erase element, returns iterator to the element that took its place
+    iterator erase(iterator it)
+    {
+        const auto pos = std::size_t(it - values.begin());
+        positions[slot_allocator::index(it->first.id)] = npos;
+        if (pos + 1 < values.size()) {
+            *it                                            = std::move(values.back());
+            positions[slot_allocator::index(it->first.id)] = uint32_t(pos);
+            ++relocations;
+        }
+        values.pop_back();
+        return values.begin() + pos;
+    }
+
+    /// erase element by key, returns false if there was none
+    bool erase(const Key& key)
+    {
+        auto it = find(key);
+        if (it == end()) {
+            return false;
+        }
+        erase(it);
+        return true;
+    }
+
+    void clear()
+    {
+        values.clear();
+        positions.clear();
+        ++relocations;
+    }
+
+    /// number of times elements changed their address so far
+    [[nodiscard]] unsigned get_relocation_count() const { return relocations; }
+
+  protected:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+    std::vector<value_type> values;
+    std::vector<uint32_t> positions; ///< position in values by slot index
+    unsigned relocations{0};
+
+    /// position of key in values or values.size() if not found
+    [[nodiscard]] std::size_t position_of(const Key& key) const
+    {
+        const auto idx = slot_allocator::index(key.id);
+        if (idx < positions.size() && positions[idx] != npos && values[positions[idx]].first == key) {
+            return positions[idx];
+        }
+        return values.size();
+    }
+};
@@ -0,0 +1,90 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Bounded lock free single producer / single consumer queue.
+// (C)+(W) by Thorsten Jordan. See LICENSE
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/// Bounded queue between exactly one producer and one consumer thread.
+/** All slots are allocated on construction and reused, so elements keep
+    their memory (e.g. string capacity) between uses and pushing does not
+    allocate. Elements are filled and consumed in place by functors.
+    Neither side ever blocks, a push to a full queue fails.
+*/
+template<typename T>
+class spsc_queue
+{
+  public:
+    /// create queue, capacity is rounded up to a power of two
+    explicit spsc_queue(std::size_t capacity_)
+    {
+        std::size_t c = 1;
+        while (c < capacity_) {
+            c *= 2;
+        }
+        slots.resize(c);
+    }
+
+    /// fill the next free slot with func(T&), producer side only
+    ///@returns false if the queue is full
+    template<typename F>
+    bool push(F&& func)
+    {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= slots.size()) {
+            return false;
+        }
+        func(slots[h & (slots.size() - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// call func(T&) for all queued elements in order, consumer side only
+    ///@returns number of elements consumed
+    template<typename F>
+    std::size_t pop_all(F&& func)
+    {
+        const auto t0 = tail.load(std::memory_order_relaxed);
+        const auto h  = head.load(std::memory_order_acquire);
+        for (auto t = t0; t != h; ++t) {
+            func(slots[t & (slots.size() - 1)]);
+            // free the slot right away, so the producer doesn't wait for the whole batch
+            tail.store(t + 1, std::memory_order_release);
+        }
+        return h - t0;
+    }
+
+    /// is queue empty, may be called from both sides
+    [[nodiscard]] bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] std::size_t capacity() const { return slots.size(); }
+
+  protected:
+    std::vector<T> slots;
+    std::atomic<std::size_t> head{0}; ///< written by producer only
+    std::atomic<std::size_t> tail{0}; ///< written by consumer only
+};
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "ai.hpp"
 
+#include "binstream.hpp"
 #include "convoy.hpp"
 #include "date.hpp"
 #include "depth_charge.hpp"
@@ -116,6 +117,52 @@ void ai::save(xml_elem& parentnode) const
     wp.set_attr(cyclewaypoints, "cyclewaypoints");
 }
 
+void ai::load(std::istream& in)
+{
+    type              = types(read_u8(in));
+    state             = states(read_u8(in));
+    zigzagstate       = read_u32(in);
+    attackrun         = read_bool(in);
+    evasive_manouver  = read_bool(in);
+    rem_manouver_time = read_double(in);
+    followme.id       = read_u32(in);
+    myconvoy.id       = read_u32(in);
+    has_contact       = read_bool(in);
+    if (has_contact) {
+        contact = read_vector3(in);
+    }
+    remaining_time = read_double(in);
+    main_course    = angle(read_double(in));
+    waypoints.clear();
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        waypoints.push_back(read_vector2(in));
+    }
+    cyclewaypoints = read_bool(in);
+}
+
+void ai::save(std::ostream& out) const
+{
+    write_u8(out, uint8_t(type));
+    write_u8(out, uint8_t(state));
+    write_u32(out, zigzagstate);
+    write_bool(out, attackrun);
+    write_bool(out, evasive_manouver);
+    write_double(out, rem_manouver_time);
+    write_u32(out, followme.id);
+    write_u32(out, myconvoy.id);
+    write_bool(out, has_contact);
+    if (has_contact) {
+        write_vector3(out, contact);
+    }
+    write_double(out, remaining_time);
+    write_double(out, main_course.value());
+    write_u32(out, unsigned(waypoints.size()));
+    for (const auto& waypoint : waypoints) {
+        write_vector2(out, waypoint);
+    }
+    write_bool(out, cyclewaypoints);
+}
+
 void ai::relax(ship& parent, game& gm)
 {
     has_contact = false;
@@ -140,13 +187,28 @@ void ai::act(ship& parent, class game& gm, double delta_time)
 {
     if (remaining_time <= -1000.0) {
         // set first value, can't be done in c'tor because c'tor has no game
-        // object
-        remaining_time = gm.randomf() * AI_THINK_CYCLE_TIME;
+        // object. The scheduler spreads the AIs evenly over the cycle.
+        remaining_time = ai_scheduler::get_initial_delay(gm.get_id(parent), AI_THINK_CYCLE_TIME);
     }
     remaining_time -= delta_time;
-    if (remaining_time > 0) {
-        return;
+}
+
+auto ai::get_think_cycle_time() -> double
+{
+    return AI_THINK_CYCLE_TIME;
+}
+
+auto ai::get_think_priority() const -> unsigned
+{
+    // hunting escorts first, they react to the player
+    if (type == escort) {
+        return (state == attackcontact || attackrun) ? 2 : 1;
     }
+    return 0;
+}
+
+void ai::think(ship& parent, class game& gm, double delta_time)
+{
     remaining_time = AI_THINK_CYCLE_TIME * (0.75F + 0.25F * gm.randomf());
 
     switch (type) {
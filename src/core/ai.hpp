@@ -95,6 +95,7 @@ Only partly, only older, simpler model.
 #include "sea_object_id.hpp"
 #include "xml.hpp"
 
+#include <iosfwd>
 #include <list>
 #include <memory>
 class game;
@@ -151,6 +152,8 @@ class ai
     // attention: all sea_objects must exist BEFORE this is called!
     void load(const xml_elem& parent);
     void save(xml_elem& parent) const;
+    void load(std::istream& in);
+    void save(std::ostream& out) const;
 
   private:
     void clear_waypoints() { waypoints.clear(); };
@@ -159,7 +162,18 @@ class ai
 
   public:
     virtual void attack_contact(const vector3& c);
+    /// advance think timer, thinking itself is scheduled by game
     virtual void act(ship& parent, game& gm, double delta_time);
+    /// analyze situation and react, called by the ai_scheduler when due
+    virtual void think(ship& parent, game& gm, double delta_time);
+    /// is it time to think again
+    [[nodiscard]] bool is_think_due() const { return remaining_time <= 0; }
+    /// how long thinking is overdue in seconds
+    [[nodiscard]] double get_overdue_time() const { return -remaining_time; }
+    /// urgency of thinking, higher values are scheduled first
+    [[nodiscard]] unsigned get_think_priority() const;
+    /// average time in seconds between two thinks
+    [[nodiscard]] static double get_think_cycle_time();
 
   private:
     // various ai's and helper functions, fixme replace with subclasses
@@ -0,0 +1,102 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// scheduler for AI thinking with a think budget per simulation step
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "ai_scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+ai_scheduler::ai_scheduler(double max_deferral_, double load_factor_)
+    : max_deferral(max_deferral_)
+    , load_factor(load_factor_)
+{
+}
+
+auto ai_scheduler::get_think_limit(unsigned nr_of_ais, double delta_t, double cycle_time) const -> unsigned
+{
+    // every AI thinks once per cycle on average, allow some more so
+    // synchronized thinks are caught up soon
+    const double thinks_per_step = load_factor * nr_of_ais * delta_t / cycle_time;
+    return std::max(1U, unsigned(std::ceil(thinks_per_step)));
+}
+
+auto ai_scheduler::get_initial_delay(sea_object_id id, double cycle_time) -> double
+{
+    // golden ratio sequence over the object ids, any number of AIs is spread
+    // evenly and the result is the same after loading a savegame or in a replay
+    const double phase = std::fmod(id.id * 0.6180339887498949, 1.0);
+    return phase * cycle_time;
+}
+
+void ai_scheduler::add_request(sea_object_id id, unsigned priority, double overdue)
+{
+    requests.push_back({id, priority, overdue});
+}
+
+void ai_scheduler::run(const std::function<void(sea_object_id)>& think, unsigned max_thinks)
+{
+    step_statistics step;
+    step.requests = unsigned(requests.size());
+    // forced ones first, then by priority, then longest waiting
+    std::sort(requests.begin(), requests.end(), [this](const request& a, const request& b) {
+        const bool fa = a.overdue >= max_deferral;
+        const bool fb = b.overdue >= max_deferral;
+        if (fa != fb) {
+            return fa;
+        }
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+        if (a.overdue != b.overdue) {
+            return a.overdue > b.overdue;
+        }
+        return a.id.id < b.id.id;
+    });
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& r : requests) {
+        // the time is only measured for statistics, so the result doesn't
+        // depend on machine load
+        const bool over_budget = max_thinks > 0 && step.thought >= max_thinks;
+        const bool forced      = r.overdue >= max_deferral;
+        if (over_budget && !forced) {
+            ++step.deferred;
+            continue;
+        }
+        if (over_budget) {
+            ++step.forced;
+        }
+        think(r.id);
+        ++step.thought;
+    }
+    step.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    requests.clear();
+
+    last_step = step;
+    total.requests += step.requests;
+    total.thought += step.thought;
+    total.deferred += step.deferred;
+    total.forced += step.forced;
+    total.time_ms += step.time_ms;
+    max_step_time_ms = std::max(max_step_time_ms, step.time_ms);
+    ++nr_steps;
+}
@@ -0,0 +1,103 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// scheduler for AI thinking with a think budget per simulation step
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "sea_object_id.hpp"
+
+#include <functional>
+#include <vector>
+
+/// Decides which AIs may think in a simulation step.
+/** AIs whose think timer expired request to think. Requests are handled
+    by priority and how long they are overdue until the think budget of the
+    step is used up, the rest is deferred to the next steps. A request
+    that has been deferred too long is handled regardless of budget, so no
+    AI starves. New AIs get their first think time spread evenly over the
+    think cycle, so ships created together don't all think in one step.
+    The budget is a number of thinks derived from the game state, not
+    wall clock time, so which AIs think in a step and thus the order of
+    random numbers drawn doesn't depend on machine load and recorded
+    games replay exactly.
+*/
+class ai_scheduler
+{
+  public:
+    /// counters of one simulation step
+    struct step_statistics
+    {
+        unsigned requests{0}; ///< AIs that wanted to think
+        unsigned thought{0};  ///< AIs that did think
+        unsigned deferred{0}; ///< AIs deferred to a later step
+        unsigned forced{0};   ///< AIs that thought over budget because deferred too long
+        double time_ms{0.0};  ///< time spent thinking, only for statistics
+    };
+
+    /// create scheduler
+    ///@param max_deferral_ - maximum time in seconds a think may be overdue before it is forced
+    ///@param load_factor_ - allowed thinks per step relative to the average think rate
+    ai_scheduler(double max_deferral_ = 2.0, double load_factor_ = 2.0);
+
+    /// get number of thinks allowed in a step
+    ///@param nr_of_ais - number of AIs in the game
+    ///@param delta_t - time of simulation step in seconds
+    ///@param cycle_time - time in seconds between two thinks of an AI
+    [[nodiscard]] unsigned get_think_limit(unsigned nr_of_ais, double delta_t, double cycle_time) const;
+
+    /// get delay until the first think of a new AI, only depends on the object
+    [[nodiscard]] static double get_initial_delay(sea_object_id id, double cycle_time);
+
+    /// request thinking for an AI
+    ///@param id - object the AI belongs to
+    ///@param priority - higher values go first
+    ///@param overdue - time in seconds the think is overdue
+    void add_request(sea_object_id id, unsigned priority, double overdue);
+
+    /// let AIs think, in order of urgency until the budget is used up, clears requests
+    ///@param max_thinks - number of thinks allowed in this step, 0 means unlimited
+    void run(const std::function<void(sea_object_id)>& think, unsigned max_thinks);
+
+    /// statistics of last step
+    [[nodiscard]] const step_statistics& get_last_step() const { return last_step; }
+    /// sum of statistics over all steps
+    [[nodiscard]] const step_statistics& get_total() const { return total; }
+    /// largest think time in one step in milliseconds
+    [[nodiscard]] double get_max_step_time() const { return max_step_time_ms; }
+    /// number of steps run
+    [[nodiscard]] unsigned get_nr_of_steps() const { return nr_steps; }
+
+  protected:
+    struct request
+    {
+        sea_object_id id;
+        unsigned priority;
+        double overdue;
+    };
+
+    double max_deferral;
+    double load_factor;
+    std::vector<request> requests;
+    step_statistics last_step;
+    step_statistics total;
+    double max_step_time_ms{0.0};
+    unsigned nr_steps{0};
+};
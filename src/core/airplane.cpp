@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "airplane.hpp"
 
+#include "binstream.hpp"
 #include "constant.hpp"
 #include "global_data.hpp"
 #include "model.hpp"
@@ -50,18 +51,32 @@ void airplane::save(xml_elem& parent) const
     ma.set_attr(pitchfac, "pitchfac");
 }
 
+void airplane::load(std::istream& in)
+{
+    sea_object::load(in);
+    rollfac  = read_double(in);
+    pitchfac = read_double(in);
+}
+
+void airplane::save(std::ostream& out) const
+{
+    sea_object::save(out);
+    write_double(out, rollfac);
+    write_double(out, pitchfac);
+}
+
 void airplane::simulate(double delta_time, game& /*gm*/)
 {
     if (!is_reference_ok()) {
         return;
     }
 
-    quaternion invrot     = orientation.conj();
-    vector3 localvelocity = invrot.rotate(velocity);
+    quaternion invrot     = hot->orientation.conj();
+    vector3 localvelocity = invrot.rotate(hot->velocity);
 
     // vector3 locx = orientation.rotate(1, 0, 0);
-    vector3 locy = orientation.rotate(0, 1, 0);
-    vector3 locz = orientation.rotate(0, 0, 1);
+    vector3 locy = hot->orientation.rotate(0, 1, 0);
+    vector3 locz = hot->orientation.rotate(0, 0, 1);
 
     /*
         fixme: 2004/06/18
@@ -128,7 +143,7 @@ void airplane::simulate(double delta_time, game& /*gm*/)
     vector3 gravity = vector3(0, 0, get_mass() * (0 - constant::GRAVITY));
 
     // deceleration by air friction (drag etc.)
-    vector3 airfriction = orientation.rotate(vector3(
+    vector3 airfriction = hot->orientation.rotate(vector3(
         -mysgn(localvelocity.x) * localvelocity.x * localvelocity.x * get_antislide_factor(),
         -mysgn(localvelocity.y) * localvelocity.y * localvelocity.y * get_drag_factor(),
         -mysgn(localvelocity.z) * localvelocity.z * localvelocity.z * get_antilift_factor()));
@@ -144,8 +159,8 @@ void airplane::simulate(double delta_time, game& /*gm*/)
 
     // update position and speed, fixme move to get_acceleration()!
     vector3 accel = (thrust + lift + gravity) * (1.0 / get_mass()) + airfriction;
-    position += velocity * delta_time + accel * (0.5 * delta_time * delta_time);
-    velocity += accel * delta_time;
+    hot->position += hot->velocity * delta_time + accel * (0.5 * delta_time * delta_time);
+    hot->velocity += accel * delta_time;
 
     quaternion qpitch = quaternion::rot(
         pitchfac * get_pitch_deg_per_sec() * delta_time,
@@ -157,7 +172,7 @@ void airplane::simulate(double delta_time, game& /*gm*/)
         0,
         1,
         0); // fixme: also depends on speed
-    orientation *= qpitch * qroll;
+    hot->orientation *= qpitch * qroll;
     // * windrotation;
 
     //	if ( myai )
@@ -0,0 +1,108 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// background autosave of games
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "autosave.hpp"
+
+#include "bzip.hpp"
+#include "error.hpp"
+#include "game.hpp"
+#include "log.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+autosave::autosave(std::string filename_, double interval_)
+    : filename(std::move(filename_))
+    , interval(interval_)
+{
+}
+
+autosave::~autosave() = default; // thread d'tor joins the writer
+
+auto autosave::update(const game& gm, double delta_time) -> bool
+{
+    if (interval <= 0.0) {
+        return false;
+    }
+    time_since_save += delta_time;
+    if (time_since_save < interval) {
+        return false;
+    }
+    time_since_save = 0.0;
+    return save(gm);
+}
+
+auto autosave::save(const game& gm) -> bool
+{
+    if (is_writing()) {
+        log_warning("autosave skipped, previous write still running");
+        return false;
+    }
+    // join finished writer before starting a new one
+    writer = nullptr;
+
+    // snapshot, this is the only time the simulation is stalled
+    const auto start = std::chrono::steady_clock::now();
+    std::ostringstream oss(std::ios::out | std::ios::binary);
+    gm.save_binary(oss, "Autosave");
+    auto blob = std::make_shared<std::string>(oss.str());
+    last_stall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    max_stall_ms  = std::max(max_stall_ms, last_stall_ms);
+    ++nr_of_saves;
+    log_info(
+        "autosave snapshot of " << blob->size() << " bytes, simulation stalled " << last_stall_ms << "ms (max "
+                                << max_stall_ms << "ms)");
+
+    writer = std::make_unique<thread>("autosave", [this, blob]() { write(*blob); });
+    return true;
+}
+
+auto autosave::is_writing() const -> bool
+{
+    return writer && writer->is_running();
+}
+
+void autosave::write(const std::string& blob) const
+{
+    const auto start          = std::chrono::steady_clock::now();
+    const std::string tmpname = filename + ".tmp";
+    {
+        std::ofstream out(tmpname.c_str(), std::ios::out | std::ios::binary);
+        if (!out.good()) {
+            THROW(file_context_error, "could not open autosave file", tmpname);
+        }
+        bzip_ostream bout(&out);
+        bout.write(blob.data(), std::streamsize(blob.size()));
+        bout.close();
+        if (!out.good()) {
+            THROW(file_context_error, "could not write autosave file", tmpname);
+        }
+    }
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+        THROW(file_context_error, "could not rename autosave file", filename);
+    }
+    const std::chrono::duration<double, std::milli> write_time = std::chrono::steady_clock::now() - start;
+    log_info("autosave written to " << filename << " in " << write_time.count() << "ms");
+}
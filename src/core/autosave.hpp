@@ -0,0 +1,80 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// background autosave of games
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "thread.hpp"
+
+#include <memory>
+#include <string>
+
+class game;
+
+///\brief Saves the game periodically without blocking the simulation.
+/** At a simulation step boundary the game is serialized into a memory blob
+    (binary savegame format), which is the only work done on the calling
+    thread. Compression and writing to disk happen on a worker thread. The
+    file is written under a temporary name and renamed afterwards, so an
+    interrupted write never destroys the last autosave.
+*/
+class autosave
+{
+  public:
+    /// create autosaver
+    ///@param filename - file to save to
+    ///@param interval - real time between saves in seconds, 0 disables autosave
+    autosave(std::string filename, double interval);
+    /// waits for pending write
+    ~autosave();
+
+    /// save if interval has passed since last save, call between simulation steps
+    ///@param gm - game to save
+    ///@param delta_time - real time in seconds played since last call
+    ///@returns true if a snapshot was taken
+    bool update(const game& gm, double delta_time);
+
+    /// take snapshot now and write it in background. If the previous write is
+    /// still running the snapshot is skipped.
+    ///@returns true if a snapshot was taken
+    bool save(const game& gm);
+
+    /// is a background write running?
+    [[nodiscard]] bool is_writing() const;
+    /// time the simulation was stalled by last snapshot, in milliseconds
+    [[nodiscard]] double get_last_stall_time() const { return last_stall_ms; }
+    /// maximum stall time of all snapshots, in milliseconds
+    [[nodiscard]] double get_max_stall_time() const { return max_stall_ms; }
+    /// number of snapshots taken
+    [[nodiscard]] unsigned get_nr_of_saves() const { return nr_of_saves; }
+
+  protected:
+    std::string filename;
+    double interval;
+    double time_since_save{0.0}; ///< real time played, kept while the game is in menus
+    std::unique_ptr<thread> writer;
+    double last_stall_ms{0.0};
+    double max_stall_ms{0.0};
+    unsigned nr_of_saves{0};
+
+    /// compress and write blob, runs on worker thread
+    void write(const std::string& blob) const;
+};
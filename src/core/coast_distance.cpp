@@ -0,0 +1,450 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// signed distance field of the coastlines for land proximity queries
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "coast_distance.hpp"
+
+#include "binstream.hpp"
+#include "datadirs.hpp"
+#include "error.hpp"
+#include "log.hpp"
+#include "texture.hpp"
+#include "xml.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+const uint32_t file_magic   = 0x46444344; // "DCDF"
+const uint32_t file_version = 1;
+const unsigned header_size  = 64;
+/// quantization steps per cell and largest stored value
+const double steps_per_cell = 4.0;
+const int max_value         = 127;
+const unsigned max_levels   = 12;
+/// squared distance for pixels without any feature pixel
+const float far_away = 1e20F;
+
+/// Squared euclidian distance transform of a sampled function in 1D
+/** Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled Functions".
+    Computes the lower envelope of parabolas rooted at the samples. */
+void distance_transform_1d(
+    const float* f,
+    unsigned n,
+    unsigned stride,
+    float* result,
+    std::vector<int>& v,
+    std::vector<float>& z,
+    std::vector<float>& tmp)
+{
+    for (unsigned q = 0; q < n; ++q) {
+        tmp[q] = f[q * stride];
+    }
+    int k = 0;
+    v[0]  = 0;
+    z[0]  = -far_away;
+    z[1]  = far_away;
+    for (int q = 1; q < int(n); ++q) {
+        float s = 0;
+        while (true) {
+            const int p = v[k];
+            s           = ((tmp[q] + float(q * q)) - (tmp[p] + float(p * p))) / float(2 * q - 2 * p);
+            if (s > z[k] || k == 0) {
+                break;
+            }
+            --k;
+        }
+        if (s <= z[k]) {
+            // only possible for k == 0, the new parabola is lower everywhere
+            v[k] = q;
+            z[k] = -far_away;
+        } else {
+            ++k;
+            v[k] = q;
+            z[k] = s;
+        }
+        z[k + 1] = far_away;
+    }
+    k = 0;
+    for (int q = 0; q < int(n); ++q) {
+        while (z[k + 1] < float(q)) {
+            ++k;
+        }
+        const float d      = float(q - v[k]);
+        result[q * stride] = std::min(d * d + tmp[v[k]], far_away);
+    }
+}
+
+/// squared distance of every pixel to the nearest pixel with mask value "feature"
+auto squared_distances(const std::vector<uint8_t>& mask, unsigned w, unsigned h, bool feature) -> std::vector<float>
+{
+    std::vector<float> d(std::size_t(w) * h);
+    for (std::size_t i = 0; i < d.size(); ++i) {
+        d[i] = ((mask[i] != 0) == feature) ? 0.0F : far_away;
+    }
+    const unsigned n = std::max(w, h);
+    std::vector<int> v(n);
+    std::vector<float> z(n + 1), tmp(n);
+    for (unsigned x = 0; x < w; ++x) {
+        distance_transform_1d(&d[x], h, w, &d[x], v, z, tmp);
+    }
+    for (unsigned y = 0; y < h; ++y) {
+        distance_transform_1d(&d[std::size_t(y) * w], w, 1, &d[std::size_t(y) * w], v, z, tmp);
+    }
+    return d;
+}
+
+auto quantize(double distance_in_cells) -> int8_t
+{
+    return int8_t(std::clamp(int(std::lround(distance_in_cells * steps_per_cell)), -max_value, max_value));
+}
+
+auto level_extent(unsigned size, unsigned lvl) -> unsigned
+{
+    return (size + (1U << lvl) - 1) >> lvl;
+}
+
+/// number of levels so that the coarsest one covers the whole map
+auto compute_nr_of_levels(unsigned w, unsigned h) -> unsigned
+{
+    const double range = max_value / steps_per_cell;
+    unsigned n         = 1;
+    while (n < max_levels && range * double(1U << (n - 1)) < double(std::max(w, h))) {
+        ++n;
+    }
+    return n;
+}
+} // namespace
+
+coast_distance_field::coast_distance_field(
+    const std::vector<uint8_t>& landmask,
+    unsigned width_,
+    unsigned height_,
+    double pixel_size_,
+    const vector2& real_offset_)
+    : real_offset(real_offset_)
+    , pixel_size(pixel_size_)
+    , width(width_)
+    , height(height_)
+{
+    if (landmask.size() != std::size_t(width) * height || width == 0 || height == 0) {
+        THROW(error, "coast_distance_field: invalid land mask size");
+    }
+    // distance of pixel centers to the nearest pixel center of the other
+    // type, the coast is half a pixel before that
+    const auto to_land = squared_distances(landmask, width, height, true);
+    const auto to_sea  = squared_distances(landmask, width, height, false);
+    std::vector<float> signed_dist(to_land.size());
+    for (std::size_t i = 0; i < signed_dist.size(); ++i) {
+        signed_dist[i] = (landmask[i] != 0) ? -(std::sqrt(to_sea[i]) - 0.5F) : std::sqrt(to_land[i]) - 0.5F;
+    }
+
+    const unsigned nr_of_levels = compute_nr_of_levels(width, height);
+    std::size_t total           = 0;
+    for (unsigned k = 0; k < nr_of_levels; ++k) {
+        total += std::size_t(level_extent(width, k)) * level_extent(height, k);
+    }
+    data.resize(total);
+    auto* dst = data.data();
+    for (std::size_t i = 0; i < signed_dist.size(); ++i) {
+        *dst++ = quantize(signed_dist[i]);
+    }
+    // coarser levels sample the full resolution field at their cell centers,
+    // the distance is 1-lipschitz so interpolation error stays below a pixel
+    for (unsigned k = 1; k < nr_of_levels; ++k) {
+        const double scale = double(1U << k);
+        const unsigned w   = level_extent(width, k);
+        const unsigned h   = level_extent(height, k);
+        for (unsigned y = 0; y < h; ++y) {
+            const double fy = std::clamp((y + 0.5) * scale - 0.5, 0.0, double(height - 1));
+            const auto y0   = unsigned(fy);
+            const auto y1   = std::min(y0 + 1, height - 1);
+            const double ay = fy - y0;
+            for (unsigned x = 0; x < w; ++x) {
+                const double fx = std::clamp((x + 0.5) * scale - 0.5, 0.0, double(width - 1));
+                const auto x0   = unsigned(fx);
+                const auto x1   = std::min(x0 + 1, width - 1);
+                const double ax = fx - x0;
+                const double d0 = signed_dist[y0 * width + x0] * (1.0 - ax) + signed_dist[y0 * width + x1] * ax;
+                const double d1 = signed_dist[y1 * width + x0] * (1.0 - ax) + signed_dist[y1 * width + x1] * ax;
+                *dst++          = quantize((d0 * (1.0 - ay) + d1 * ay) / scale);
+            }
+        }
+    }
+    setup_levels(data.data(), nr_of_levels);
+}
+
+coast_distance_field::coast_distance_field(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in.good()) {
+        THROW(file_read_error, filename);
+    }
+    if (read_u32(in) != file_magic || read_u32(in) != file_version) {
+        THROW(file_context_error, "invalid or outdated coast distance file", filename);
+    }
+    source_hash                 = read_u64(in);
+    width                       = read_u32(in);
+    height                      = read_u32(in);
+    const unsigned nr_of_levels = read_u32(in);
+    read_u32(in); // reserved
+    pixel_size    = read_double(in);
+    real_offset.x = read_double(in);
+    real_offset.y = read_double(in);
+    if (!in.good() || width == 0 || height == 0 || nr_of_levels == 0 || nr_of_levels > max_levels) {
+        THROW(file_context_error, "invalid coast distance file header", filename);
+    }
+    in.close();
+    mapped = std::make_unique<mapped_file>(filename);
+    setup_levels(reinterpret_cast<const int8_t*>(mapped->data() + header_size), nr_of_levels);
+    if (mapped->size() != header_size + get_data_size()) {
+        THROW(file_context_error, "coast distance file has wrong size", filename);
+    }
+}
+
+void coast_distance_field::setup_levels(const int8_t* values, unsigned nr_of_levels)
+{
+    levels.resize(nr_of_levels);
+    for (unsigned k = 0; k < nr_of_levels; ++k) {
+        auto& lvl     = levels[k];
+        lvl.width     = level_extent(width, k);
+        lvl.height    = level_extent(height, k);
+        lvl.cell_size = pixel_size * double(1U << k);
+        lvl.values    = values;
+        values += std::size_t(lvl.width) * lvl.height;
+    }
+}
+
+void coast_distance_field::save(const std::string& filename) const
+{
+    std::ofstream out(filename, std::ios::out | std::ios::binary);
+    if (!out.good()) {
+        THROW(file_context_error, "can't write coast distance file", filename);
+    }
+    write_u32(out, file_magic);
+    write_u32(out, file_version);
+    write_u64(out, source_hash);
+    write_u32(out, width);
+    write_u32(out, height);
+    write_u32(out, get_nr_of_levels());
+    write_u32(out, 0); // reserved
+    write_double(out, pixel_size);
+    write_double(out, real_offset.x);
+    write_double(out, real_offset.y);
+    while (unsigned(out.tellp()) < header_size) {
+        write_u8(out, 0);
+    }
+    // values are bytes, so no endianess conversion is needed
+    out.write(reinterpret_cast<const char*>(levels.front().values), std::streamsize(get_data_size()));
+    if (!out.good()) {
+        THROW(file_context_error, "error writing coast distance file", filename);
+    }
+}
+
+auto coast_distance_field::get_field_filename(const std::string& mapfilename) -> std::string
+{
+    const auto dot = mapfilename.rfind('.');
+    return mapfilename.substr(0, dot) + "_coastdist.bin";
+}
+
+auto coast_distance_field::get_cache_filename(const std::string& mapfilename) -> std::string
+{
+    const auto slash     = mapfilename.rfind('/');
+    const auto namebegin = (slash == std::string::npos) ? 0 : slash + 1;
+    return get_cache_dir() + get_field_filename(mapfilename.substr(namebegin));
+}
+
+auto coast_distance_field::get_image_filename(const std::string& mapfilename) -> std::string
+{
+    xml_doc doc(mapfilename);
+    doc.load();
+    const auto slash = mapfilename.rfind('/');
+    return mapfilename.substr(0, slash == std::string::npos ? 0 : slash + 1)
+           + doc.child("dftd-map").child("topology").attr("image");
+}
+
+auto coast_distance_field::load_for_map(const std::string& mapfilename) -> std::unique_ptr<coast_distance_field>
+{
+    const uint64_t image_hash = compute_file_hash(get_image_filename(mapfilename));
+    const auto cachefile      = get_cache_filename(mapfilename);
+    for (const auto& fieldfile : {get_field_filename(mapfilename), cachefile}) {
+        if (!is_file(fieldfile)) {
+            continue;
+        }
+        try {
+            auto field = std::make_unique<coast_distance_field>(fieldfile);
+            if (field->get_source_hash() == image_hash) {
+                return field;
+            }
+            log_info("coast distance file " << fieldfile << " doesn't match map image");
+        } catch (const error& e) {
+            log_warning("can't use coast distance file: " << e.what());
+        }
+    }
+    log_info("no precomputed coast distance file, run map_precompute --coastdist " << mapfilename);
+    auto field = compute_for_map(mapfilename);
+    // write to temporary file, so an aborted write never leaves a broken
+    // file, and map the result so the computed values don't stay in memory.
+    // The cache is optional so errors are only logged.
+    const std::string tmpfilename = cachefile + ".tmp";
+    try {
+        field->save(tmpfilename);
+        std::remove(cachefile.c_str());
+        if (std::rename(tmpfilename.c_str(), cachefile.c_str()) != 0) {
+            log_warning("could not write coast distance cache " << cachefile);
+            return field;
+        }
+        return std::make_unique<coast_distance_field>(cachefile);
+    } catch (const error& e) {
+        log_warning("could not write coast distance cache: " << e.what());
+        std::remove(tmpfilename.c_str());
+    }
+    return field;
+}
+
+auto coast_distance_field::compute_for_map(const std::string& mapfilename) -> std::unique_ptr<coast_distance_field>
+{
+    xml_doc doc(mapfilename);
+    doc.load();
+    xml_elem et             = doc.child("dftd-map").child("topology");
+    const std::string image = get_image_filename(mapfilename);
+
+    // same layout as coastmap: y points up, != 0 is land
+    sdl_image surf(image);
+    unsigned w   = 0;
+    unsigned h   = 0;
+    unsigned bpp = 0;
+    auto pixels  = surf.get_plain_data(w, h, bpp);
+    if (bpp != 1) {
+        THROW(file_context_error, "map image is no paletted black/white image", image);
+    }
+    std::vector<uint8_t> landmask(pixels.size());
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            landmask[(h - 1 - y) * w + x] = (pixels[y * w + x] > 0) ? 1 : 0;
+        }
+    }
+    const double realwidth = et.attrf("realwidth");
+    auto field             = std::make_unique<coast_distance_field>(
+        landmask, w, h, realwidth / w, vector2(et.attrf("realoffsetx"), et.attrf("realoffsety")));
+    field->source_hash = compute_file_hash(image);
+    return field;
+}
+
+auto coast_distance_field::sample(const level& lvl, double px, double py, bool& saturated) const -> double
+{
+    // cell centers are at (i + 0.5) * scale in pixel coordinates, positions
+    // outside the map get the distance of the map border
+    const double scale = lvl.cell_size / pixel_size;
+    const double fx    = std::clamp(px / scale - 0.5, 0.0, double(lvl.width - 1));
+    const double fy    = std::clamp(py / scale - 0.5, 0.0, double(lvl.height - 1));
+    const int x0       = int(fx);
+    const int y0       = int(fy);
+    const int x1       = std::min(x0 + 1, int(lvl.width) - 1);
+    const int y1       = std::min(y0 + 1, int(lvl.height) - 1);
+    const double ax    = fx - x0;
+    const double ay    = fy - y0;
+    const int v00      = lvl.at(x0, y0);
+    const int v10      = lvl.at(x1, y0);
+    const int v01      = lvl.at(x0, y1);
+    const int v11      = lvl.at(x1, y1);
+    saturated          = std::max(std::max(std::abs(v00), std::abs(v10)), std::max(std::abs(v01), std::abs(v11)))
+                >= max_value;
+    const double v0 = v00 * (1.0 - ax) + v10 * ax;
+    const double v1 = v01 * (1.0 - ax) + v11 * ax;
+    return (v0 * (1.0 - ay) + v1 * ay) * (lvl.cell_size / steps_per_cell);
+}
+
+auto coast_distance_field::get_distance(const vector2& pos) const -> double
+{
+    const double px = (pos.x - real_offset.x) / pixel_size;
+    const double py = (pos.y - real_offset.y) / pixel_size;
+    double result   = 0.0;
+    for (const auto& lvl : levels) {
+        bool saturated = false;
+        result         = sample(lvl, px, py, saturated);
+        if (!saturated) {
+            break;
+        }
+    }
+    return result;
+}
+
+void coast_distance_field::get_distances(unsigned nr, const double* x, const double* y, double* result) const
+{
+    // most positions of a batch (a convoy, a route) are in the same area, so
+    // start at the level that was needed for the previous position
+    unsigned start_level = 0;
+    for (unsigned i = 0; i < nr; ++i) {
+        const double px = (x[i] - real_offset.x) / pixel_size;
+        const double py = (y[i] - real_offset.y) / pixel_size;
+        unsigned k      = start_level;
+        bool saturated  = false;
+        double d        = sample(levels[k], px, py, saturated);
+        if (saturated) {
+            while (saturated && k + 1 < levels.size()) {
+                ++k;
+                d = sample(levels[k], px, py, saturated);
+            }
+        } else {
+            // a finer level may do for this position
+            while (k > 0) {
+                bool finer_saturated = false;
+                const double finer_d = sample(levels[k - 1], px, py, finer_saturated);
+                if (finer_saturated) {
+                    break;
+                }
+                d = finer_d;
+                --k;
+            }
+        }
+        result[i]   = d;
+        start_level = k;
+    }
+}
+
+auto coast_distance_field::get_direction_to_sea(const vector2& pos) const -> vector2
+{
+    const double h = pixel_size;
+    const vector2 g(
+        get_distance(pos + vector2(h, 0.0)) - get_distance(pos - vector2(h, 0.0)),
+        get_distance(pos + vector2(0.0, h)) - get_distance(pos - vector2(0.0, h)));
+    if (g.square_length() < 1e-6) {
+        return {};
+    }
+    return g.normal();
+}
+
+auto coast_distance_field::get_max_distance() const -> double
+{
+    return levels.back().cell_size * max_value / steps_per_cell;
+}
+
+auto coast_distance_field::get_data_size() const -> std::size_t
+{
+    std::size_t result = 0;
+    for (const auto& lvl : levels) {
+        result += std::size_t(lvl.width) * lvl.height;
+    }
+    return result;
+}
@@ -0,0 +1,132 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// signed distance field of the coastlines for land proximity queries
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "filehelper.hpp"
+#include "vector2.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Signed distance to the nearest coastline for any position on the map.
+/** Distances are positive at sea and negative on land, in meters. They are
+    computed once from the land/sea bitmap of the coastmap with an exact
+    euclidian distance transform and stored as a pyramid of 8 bit grids.
+    Level k has cells of 2^k map pixels and stores distances in quarter cells
+    up to 127 quarter cells, a query uses the finest level that isn't
+    saturated at the position. So points near the coast get pixel precision,
+    the open sea still gets the distance to land of up to thousands of
+    kilometers, and the whole field is smaller than the bitmap as 16 bit
+    values would be.
+    The precomputed field is stored in a file made by map_precompute and
+    memory mapped at load, so it costs no time at game start and only the
+    pages of the regions that are queried get loaded. Without such a file
+    the field is computed once and written to the cache directory.
+*/
+class coast_distance_field
+{
+  public:
+    /// create from land mask, one byte per pixel (!= 0 is land), y points up
+    ///@param pixel_size - width/height of one pixel in meters
+    ///@param real_offset - position of the lower left map corner in meters
+    coast_distance_field(
+        const std::vector<uint8_t>& landmask,
+        unsigned width,
+        unsigned height,
+        double pixel_size,
+        const vector2& real_offset);
+
+    /// map a field file written by save()
+    ///@note throws file_read_error if the file is invalid
+    coast_distance_field(const std::string& filename);
+
+    /// write field to file
+    void save(const std::string& filename) const;
+
+    /// create the field for a map description (like default.xml)
+    /** Uses the precomputed file next to the map image or in the cache
+        directory if it belongs to the image, otherwise computes the field
+        from the image and stores it in the cache directory. */
+    static std::unique_ptr<coast_distance_field> load_for_map(const std::string& mapfilename);
+
+    /// compute the field from the image of a map description
+    static std::unique_ptr<coast_distance_field> compute_for_map(const std::string& mapfilename);
+
+    /// name of the precomputed field file for a map description
+    static std::string get_field_filename(const std::string& mapfilename);
+
+    /// name of the field file in the cache directory for a map description
+    static std::string get_cache_filename(const std::string& mapfilename);
+
+    /// hash of the map image the field was made of, 0 if made of a land mask
+    [[nodiscard]] uint64_t get_source_hash() const { return source_hash; }
+
+    /// signed distance to the coast in meters, positive at sea
+    /** Distances beyond get_max_distance() are clamped. */
+    [[nodiscard]] double get_distance(const vector2& pos) const;
+
+    /// compute signed distances for many positions at once
+    void get_distances(unsigned nr, const double* x, const double* y, double* result) const;
+
+    /// is position on land?
+    [[nodiscard]] bool is_land(const vector2& pos) const { return get_distance(pos) < 0.0; }
+
+    /// direction away from the nearest coast (normalized), zero far from land
+    [[nodiscard]] vector2 get_direction_to_sea(const vector2& pos) const;
+
+    /// largest distance that can be represented
+    [[nodiscard]] double get_max_distance() const;
+
+    /// number of pyramid levels
+    [[nodiscard]] unsigned get_nr_of_levels() const { return unsigned(levels.size()); }
+
+    /// memory used by the distance values in bytes
+    [[nodiscard]] std::size_t get_data_size() const;
+
+  protected:
+    /// one level of the pyramid
+    struct level
+    {
+        unsigned width{0};
+        unsigned height{0};
+        double cell_size{0}; // in meters
+        const int8_t* values{nullptr};
+
+        [[nodiscard]] int8_t at(int x, int y) const { return values[unsigned(y) * width + unsigned(x)]; }
+    };
+
+    std::vector<level> levels;
+    vector2 real_offset;
+    double pixel_size{0};
+    unsigned width{0};
+    unsigned height{0};
+    uint64_t source_hash{0};
+    std::vector<int8_t> data;            // when computed
+    std::unique_ptr<mapped_file> mapped; // when loaded
+
+    void setup_levels(const int8_t* values, unsigned nr_of_levels);
+    static std::string get_image_filename(const std::string& mapfilename);
+    [[nodiscard]] double sample(const level& lvl, double px, double py, bool& saturated) const;
+};
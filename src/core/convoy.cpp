@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "convoy.hpp"
 
 #include "ai.hpp"
+#include "binstream.hpp"
 #include "datadirs.hpp"
 #include "game.hpp"
 #include "model.hpp"
@@ -317,6 +318,55 @@ void convoy::save(xml_elem& parent) const
     }
 }
 
+namespace
+{
+void load_ship_list(std::istream& in, std::list<std::pair<sea_object_id, vector2>>& ships)
+{
+    ships.clear();
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        sea_object_id id(read_u32(in));
+        ships.emplace_back(id, read_vector2(in));
+    }
+}
+
+void save_ship_list(std::ostream& out, const std::list<std::pair<sea_object_id, vector2>>& ships)
+{
+    write_u32(out, unsigned(ships.size()));
+    for (const auto& ship : ships) {
+        write_u32(out, ship.first.id);
+        write_vector2(out, ship.second);
+    }
+}
+} // namespace
+
+void convoy::load(std::istream& in)
+{
+    name     = read_string(in);
+    position = read_vector2(in);
+    velocity = read_double(in);
+    load_ship_list(in, merchants);
+    load_ship_list(in, warships);
+    load_ship_list(in, escorts);
+    waypoints.clear();
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        waypoints.push_back(read_vector2(in));
+    }
+}
+
+void convoy::save(std::ostream& out) const
+{
+    write_string(out, name);
+    write_vector2(out, position);
+    write_double(out, velocity);
+    save_ship_list(out, merchants);
+    save_ship_list(out, warships);
+    save_ship_list(out, escorts);
+    write_u32(out, unsigned(waypoints.size()));
+    for (const auto& waypoint : waypoints) {
+        write_vector2(out, waypoint);
+    }
+}
+
 auto convoy::get_nr_of_ships() const -> unsigned
 {
     return merchants.size() + warships.size() + escorts.size();
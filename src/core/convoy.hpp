@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "ai.hpp"
 #include "vector2.hpp"
 
+#include <iosfwd>
 #include <list>
 #include <memory>
 #include <new>
@@ -77,7 +78,8 @@ class convoy
     /// create empty convoy (only used in the editor!)
     convoy(const vector2& pos, std::string name);
 
-    convoy(convoy&&) = default;
+    convoy(convoy&&)            = default;
+    convoy& operator=(convoy&&) = default;
 
     virtual ~convoy() = default;
 
@@ -87,6 +89,8 @@ class convoy
 
     void load(const xml_elem& parent);
     void save(xml_elem& parent) const;
+    void load(std::istream& in);
+    void save(std::ostream& out) const;
 
     [[nodiscard]] unsigned get_nr_of_ships() const;
 
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "depth_charge.hpp"
 
+#include "binstream.hpp"
 #include "constant.hpp"
 #include "game.hpp"
 #include "log.hpp"
@@ -42,7 +43,7 @@ depth_charge::depth_charge(double expl_depth, const vector3& pos, object_store<m
     , explosion_depth(expl_depth)
 {
     // fixme depends on parent! and parent's size, dc's can be thrown, etc.!
-    position = pos;
+    hot->position = pos;
     log_info("depth charge created");
 }
 
@@ -58,6 +59,18 @@ void depth_charge::save(xml_elem& parent) const
     parent.add_child("explosion_depth").set_attr(explosion_depth);
 }
 
+void depth_charge::load(std::istream& in)
+{
+    sea_object::load(in);
+    explosion_depth = read_double(in);
+}
+
+void depth_charge::save(std::ostream& out) const
+{
+    sea_object::save(out);
+    write_double(out, explosion_depth);
+}
+
 void depth_charge::simulate(double delta_time, game& gm)
 {
     if (!is_reference_ok()) {
@@ -66,7 +79,7 @@ void depth_charge::simulate(double delta_time, game& gm)
 
     sea_object::simulate(delta_time, gm);
 
-    if (position.z < -explosion_depth) {
+    if (hot->position.z < -explosion_depth) {
         gm.dc_explosion(*this);
         kill(); // dc is "dead"
     }
@@ -75,10 +88,10 @@ void depth_charge::simulate(double delta_time, game& gm)
 void depth_charge::compute_force_and_torque(vector3& F, vector3& /*T*/, game& /*gm*/) const
 {
     // force is in world space!
-    if (position.z > 0) { // DC's can be thrown, so they can be above water.
+    if (hot->position.z > 0) { // DC's can be thrown, so they can be above water.
         F.z = -constant::GRAVITY * mass;
     } else {
-        double vm = velocity.z / DEPTH_CHARGE_SINK_SPEED;
+        double vm = hot->velocity.z / DEPTH_CHARGE_SINK_SPEED;
         F.z       = (-constant::GRAVITY + constant::GRAVITY * vm * vm) * mass;
     }
 }
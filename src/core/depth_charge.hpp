@@ -46,6 +46,8 @@ class depth_charge : public sea_object
 
     void load(const xml_elem& parent) override;
     void save(xml_elem& parent) const override;
+    void load(std::istream& in) override;
+    void save(std::ostream& out) const override;
 
     void simulate(double delta_time, game& gm) override;
     void compute_force_and_torque(vector3& F, vector3& T, game& gm) const override;
@@ -23,10 +23,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "game.hpp"
 
 #include "airplane.hpp"
+#include "binstream.hpp"
+#include "bzip.hpp"
 #include "cfg.hpp"
+#include "coast_distance.hpp"
 #include "convoy.hpp"
 #include "datadirs.hpp"
 #include "depth_charge.hpp"
+#include "game_recorder.hpp"
 #include "global_data.hpp"
 #include "gun_shell.hpp"
 #include "log.hpp"
@@ -46,8 +50,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "water_splash.hpp"
 
 #include <cfloat>
+#include <fstream>
 #include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <utility>
 using std::list;
 using std::make_pair;
@@ -59,6 +65,30 @@ using std::vector;
 const unsigned SAVEVERSION = 1;
 const unsigned GAMETYPE    = 0; // fixme, 0-mission , 1-patrol etc.
 
+// binary savegames start with magic value and version
+const uint32_t BINARY_SAVEGAME_MAGIC   = 0x42544644; // "DFTB"
+const uint32_t BINARY_SAVEGAME_VERSION = 1;
+
+namespace
+{
+/// open binary savegame, plain or bzip2 compressed (autosaves), and read it with func
+template<typename F>
+void read_binary_savegame(const string& filename, F func)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    char magic[3]         = {};
+    const bool compressed = in.read(magic, 3).good() && magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h';
+    in.clear();
+    in.seekg(0);
+    if (compressed) {
+        bzip_istream bin(&in);
+        func(static_cast<std::istream&>(bin));
+    } else {
+        func(static_cast<std::istream&>(in));
+    }
+}
+} // namespace
+
 const double game::TRAIL_TIME = 1.0;
 
 /***************************************************************************/
@@ -83,6 +113,24 @@ void game::ping::save(xml_elem& parent) const
     parent.set_attr(ping_angle.value(), "ping_angle");
 }
 
+game::ping::ping(std::istream& in)
+    : pos(read_vector2(in))
+    , dir(read_double(in))
+    , time(read_double(in))
+    , range(read_double(in))
+    , ping_angle(read_double(in))
+{
+}
+
+void game::ping::save(std::ostream& out) const
+{
+    write_vector2(out, pos);
+    write_double(out, dir.value());
+    write_double(out, time);
+    write_double(out, range);
+    write_double(out, ping_angle.value());
+}
+
 game::sink_record::sink_record(const xml_elem& parent)
 {
     dat.load(parent);
@@ -103,6 +151,26 @@ void game::sink_record::save(xml_elem& parent) const
     parent.set_attr(layoutname, "layoutname");
 }
 
+game::sink_record::sink_record(std::istream& in)
+    : dat(read_u32(in))
+    , descr(read_string(in))
+    , mdlname(read_string(in))
+    , specfilename(read_string(in))
+    , layoutname(read_string(in))
+    , tons(read_u32(in))
+{
+}
+
+void game::sink_record::save(std::ostream& out) const
+{
+    write_u32(out, dat.get_time());
+    write_string(out, descr);
+    write_string(out, mdlname);
+    write_string(out, specfilename);
+    write_string(out, layoutname);
+    write_u32(out, tons);
+}
+
 game::player_info::player_info()
     : name("Heinz Mustermann")
     , submarineid("U 999")
@@ -159,6 +227,39 @@ void game::player_info::save(xml_elem& parent) const
     }
 }
 
+game::player_info::player_info(std::istream& in)
+    : name(read_string(in))
+    , flotilla(read_u32(in))
+    , submarineid(read_string(in))
+    , photo(read_u32(in))
+    , soldbuch_nr(read_string(in))
+    , gasmask_size(read_string(in))
+    , bloodgroup(read_string(in))
+    , marine_roll(read_string(in))
+    , marine_group(read_string(in))
+{
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        career.push_back(read_string(in));
+    }
+}
+
+void game::player_info::save(std::ostream& out) const
+{
+    write_string(out, name);
+    write_u32(out, flotilla);
+    write_string(out, submarineid);
+    write_u32(out, photo);
+    write_string(out, soldbuch_nr);
+    write_string(out, gasmask_size);
+    write_string(out, bloodgroup);
+    write_string(out, marine_roll);
+    write_string(out, marine_group);
+    write_u32(out, unsigned(career.size()));
+    for (const auto& it : career) {
+        write_string(out, it);
+    }
+}
+
 game::game()
     : model_store(get_data_dir())
 {
@@ -324,6 +425,18 @@ game::game(
 // --------------------------------------------------------------------------------
 //                        LOAD GAME (SAVEGAME OR MISSION)
 // --------------------------------------------------------------------------------
+game::game(std::istream& in)
+    : my_run_state(running)
+    , time(0)
+    , last_trail_time(0)
+    , max_view_dist(0)
+    , freezetime(0)
+    , freezetime_start(0)
+    , model_store(get_data_dir())
+{
+    load_binary(in);
+}
+
 game::game(const string& filename)
     : my_run_state(running)
     , time(0)
@@ -333,6 +446,11 @@ game::game(const string& filename)
     , freezetime_start(0)
     , model_store(get_data_dir())
 {
+    if (is_binary_savegame(filename)) {
+        read_binary_savegame(filename, [this](std::istream& in) { load_binary(in); });
+        return;
+    }
+
     xml_doc doc(filename);
     doc.load();
     // could be savegame or mission, maybe check...
@@ -395,7 +513,7 @@ game::game(const string& filename)
             spec.load();
             spawn(
                 torpedo(get_date(), get_equipment_date(), get_model_store(), spec.first_child(), torpedo::setup_data()))
-                .load(elem);
+                .second.load(elem);
         }
     }
 
@@ -404,7 +522,7 @@ game::game(const string& filename)
         for (auto elem : dc.iterate("depth_charge")) {
             // xml_doc spec(get_depth_charge_dir() + elem.attr("type") +
             // ".xml"); spec.load();
-            spawn(depth_charge(/*, spec.first_child()*/ get_model_store())).load(elem);
+            spawn(depth_charge(/*, spec.first_child()*/ get_model_store())).second.load(elem);
         }
     }
 
@@ -413,7 +531,7 @@ game::game(const string& filename)
         for (auto elem : gs.iterate("gun_shell")) {
             // xml_doc spec(get_gun_shell_dir() + elem.attr("type") + ".xml");
             // spec.load();
-            spawn(gun_shell(/*, spec.first_child()*/ get_model_store())).load(elem);
+            spawn(gun_shell(/*, spec.first_child()*/ get_model_store())).second.load(elem);
         }
     }
 
@@ -473,7 +591,14 @@ game::game(const string& filename)
     playerinfo = player_info(sg.child("player_info"));
 }
 
-game::~game() = default;
+game::~game()
+{
+    [[maybe_unused]] const auto& st = ai_sched.get_total();
+    log_info(
+        "AI scheduler: " << ai_sched.get_nr_of_steps() << " steps, " << st.thought << " thinks, " << st.deferred
+                         << " deferred, " << st.forced << " forced, " << st.time_ms << "ms total, "
+                         << ai_sched.get_max_step_time() << "ms max per step");
+}
 
 // --------------------------------------------------------------------------------
 //                        SAVE GAME
@@ -615,8 +740,195 @@ void game::save(const string& savefilename, const string& description) const
     doc.save();
 }
 
+void game::save_binary(const string& savefilename, const string& description) const
+{
+    std::ofstream out(savefilename.c_str(), std::ios::out | std::ios::binary);
+    if (!out.good()) {
+        THROW(file_context_error, "could not open savegame for writing", savefilename);
+    }
+    save_binary(out, description);
+    if (!out.good()) {
+        THROW(file_context_error, "could not write savegame", savefilename);
+    }
+}
+
+void game::save_binary(std::ostream& out, const string& description) const
+{
+    // Objects are written directly to the stream in the same order as they
+    // are loaded. State comes first, because time is needed to construct the
+    // objects. Object IDs are stored, so references between objects stay valid.
+    write_u32(out, BINARY_SAVEGAME_MAGIC);
+    write_u32(out, BINARY_SAVEGAME_VERSION);
+    write_string(out, description);
+    write_u32(out, GAMETYPE);
+
+    write_double(out, time);
+    write_double(out, last_trail_time);
+    write_u32(out, equipment_date.get_time());
+    write_double(out, max_view_dist);
+    write_u32(out, player_id.id);
+
+    write_u32(out, unsigned(ships.size()));
+    for (const auto& [id, ship] : ships) {
+        write_u32(out, id.id);
+        write_string(out, ship.get_specfilename());
+        ship.save(out);
+    }
+    write_u32(out, unsigned(submarines.size()));
+    for (const auto& [id, submarine] : submarines) {
+        write_u32(out, id.id);
+        write_string(out, submarine.get_specfilename());
+        submarine.save(out);
+    }
+    write_u32(out, unsigned(airplanes.size()));
+    for (const auto& [id, airplane] : airplanes) {
+        write_u32(out, id.id);
+        write_string(out, airplane.get_specfilename());
+        airplane.save(out);
+    }
+    write_u32(out, unsigned(torpedoes.size()));
+    for (const auto& torpedo : torpedoes) {
+        write_string(out, torpedo.get_specfilename());
+        torpedo.save(out);
+    }
+    write_u32(out, unsigned(depth_charges.size()));
+    for (const auto& depth_charge : depth_charges) {
+        depth_charge.save(out);
+    }
+    write_u32(out, unsigned(gun_shells.size()));
+    for (const auto& gun_shell : gun_shells) {
+        gun_shell.save(out);
+    }
+    write_u32(out, unsigned(convoys.size()));
+    for (const auto& [id, convoy] : convoys) {
+        write_u32(out, id.id);
+        convoy.save(out);
+    }
+
+    write_u32(out, unsigned(sunken_ships.size()));
+    for (const auto& sunken_ship : sunken_ships) {
+        sunken_ship.save(out);
+    }
+    write_u32(out, unsigned(pings.size()));
+    for (const auto& it : pings) {
+        it.save(out);
+    }
+    playerinfo.save(out);
+
+    // end marker to detect truncated files
+    write_u32(out, BINARY_SAVEGAME_MAGIC);
+}
+
+void game::load_binary(std::istream& in)
+{
+    if (read_u32(in) != BINARY_SAVEGAME_MAGIC) {
+        THROW(error, "no binary savegame");
+    }
+    if (read_u32(in) != BINARY_SAVEGAME_VERSION) {
+        THROW(error, "invalid binary savegame version");
+    }
+    read_string(in); // description
+    read_u32(in);    // game type
+
+    time            = read_double(in);
+    last_trail_time = read_double(in);
+    equipment_date  = date(read_u32(in));
+    max_view_dist   = read_double(in);
+    player_id       = sea_object_id(read_u32(in));
+
+    mywater     = std::make_unique<water>(time);
+    myheightgen = std::make_unique<terrain<int16_t>>(
+        get_map_dir() + "terrain/terrain.xml", get_map_dir() + "terrain/", TERRAIN_NR_LEVELS + 1);
+
+    // many objects share the same specification, parse each spec file once.
+    std::unordered_map<std::string, std::unique_ptr<xml_doc>> specs;
+    auto spec_of = [&specs](const std::string& type) {
+        auto& spec = specs[type];
+        if (!spec) {
+            spec = std::make_unique<xml_doc>(data_file().get_filename(type));
+            spec->load();
+        }
+        return spec->first_child();
+    };
+    auto read_id = [this](std::istream& in) {
+        sea_object_id id(read_u32(in));
+        object_ids.reserve(id.id);
+        return id;
+    };
+
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        auto id   = read_id(in);
+        auto spec = spec_of(read_string(in));
+        ships.insert(id, ship(get_date(), get_model_store(), spec)).second.load(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        auto id   = read_id(in);
+        auto spec = spec_of(read_string(in));
+        submarines.insert(id, submarine(get_date(), get_model_store(), spec)).second.load(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        auto id   = read_id(in);
+        auto spec = spec_of(read_string(in));
+        airplanes.insert(id, airplane(get_date(), get_model_store(), spec)).second.load(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        auto spec = spec_of(read_string(in));
+        torpedoes.insert(torpedo(get_date(), get_equipment_date(), get_model_store(), spec, torpedo::setup_data()))
+            .second.load(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        depth_charges.insert(depth_charge(get_model_store())).second.load(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        gun_shells.insert(gun_shell(get_model_store())).second.load(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        auto id = read_id(in);
+        convoys.insert(id, convoy()).second.load(in);
+    }
+
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        sunken_ships.emplace_back(in);
+    }
+    for (unsigned i = read_u32(in); i > 0; --i) {
+        pings.emplace_back(in);
+    }
+    playerinfo = player_info(in);
+
+    if (read_u32(in) != BINARY_SAVEGAME_MAGIC || !in.good()) {
+        THROW(error, "binary savegame is truncated or corrupt");
+    }
+
+    player = &get_object(player_id);
+}
+
+auto game::is_binary_savegame(const string& filename) -> bool
+{
+    bool result = false;
+    try {
+        read_binary_savegame(
+            filename, [&result](std::istream& in) { result = read_u32(in) == BINARY_SAVEGAME_MAGIC && in.good(); });
+    }
+    catch (std::exception& e) {
+        // broken compressed data, treat as other format
+    }
+    return result;
+}
+
 auto game::read_description_of_savegame(const string& filename) -> string
 {
+    if (is_binary_savegame(filename)) {
+        string d;
+        read_binary_savegame(filename, [&d](std::istream& in) {
+            read_u32(in);
+            d = (read_u32(in) == BINARY_SAVEGAME_VERSION) ? read_string(in) : string("<ERROR> Invalid version");
+        });
+        if (d.length() == 0) {
+            return "<ERROR> Empty description";
+        }
+        return d;
+    }
+
     // causes 90mb mem leak fixme
     xml_doc doc(filename);
     doc.load();
@@ -641,10 +953,11 @@ void game::compute_max_view_dist()
 }
 
 template<class T>
-void cleanup(std::unordered_map<sea_object_id, T>& s)
+void cleanup(slot_map<sea_object_id, T>& s, slot_allocator& ids)
 {
     for (auto it = s.begin(); it != s.end();) {
         if (it->second.is_dead()) {
+            ids.release(it->first.id);
             it = s.erase(it);
         } else {
             ++it;
@@ -653,15 +966,9 @@ void cleanup(std::unordered_map<sea_object_id, T>& s)
 }
 
 template<class T>
-void cleanup(std::vector<T>& s)
+void cleanup(object_pool<T>& s)
 {
-    for (auto it = s.begin(); it != s.end();) {
-        if (it->is_dead()) {
-            it = s.erase(it);
-        } else {
-            ++it;
-        }
-    }
+    s.compact([](const T& obj) { return obj.is_dead(); });
 }
 
 void game::simulate(double delta_t)
@@ -689,8 +996,14 @@ void game::simulate(double delta_t)
         return;
     }
 
+    if (seed_every_step) {
+        srand(step_seed + unsigned(tick - step_seed_tick) * 2654435761U);
+    }
+
     // kill events left over from last run
     events.clear();
+    // objects will move, so received noise must be recomputed
+    listen_cache.listener = nullptr;
 
     if (!is_editor()) {
         if (!player->is_alive()) {
@@ -745,16 +1058,18 @@ void game::simulate(double delta_t)
     // step 1: check for invalidity of every object and remove
     // defunct objects. do NOT mix simulate() calls with real
     // calls to delete an object.
-    cleanup(ships);
-    cleanup(submarines);
-    cleanup(airplanes);
+    cleanup(ships, object_ids);
+    cleanup(submarines, object_ids);
+    cleanup(airplanes, object_ids);
     cleanup(torpedoes);
     cleanup(depth_charges);
     cleanup(gun_shells);
     cleanup(water_splashes);
+    check_object_relocation();
 
     // step 2: simulate all objects, possibly setting state to dead/defunct.
     simulate_objects(delta_t, record, nearest_contact);
+    run_ai(delta_t);
 
     // Now check for collisions. As a result objects could be set to dead state.
     // If we would call this before simulate() an object could go from alive
@@ -776,6 +1091,7 @@ void game::simulate(double delta_t)
     check_collisions();
 
     time += delta_t;
+    ++tick;
 
     // remove old pings
     for (auto it = pings.begin(); it != pings.end();) {
@@ -793,6 +1109,39 @@ void game::simulate(double delta_t)
     }
 }
 
+void game::run_ai(double delta_t)
+{
+    unsigned nr_of_ais = 0;
+    for (auto& [id, ship] : ships) {
+        const ai* a = ship.get_ai();
+        if (a != nullptr) {
+            ++nr_of_ais;
+            if (a->is_think_due()) {
+                ai_sched.add_request(id, a->get_think_priority(), a->get_overdue_time());
+            }
+        }
+    }
+    for (auto& [id, submarine] : submarines) {
+        const ai* a = submarine.get_ai();
+        if (a != nullptr) {
+            ++nr_of_ais;
+            if (a->is_think_due()) {
+                ai_sched.add_request(id, a->get_think_priority(), a->get_overdue_time());
+            }
+        }
+    }
+    // the budget only depends on the game state, so replays think the same
+    const unsigned max_thinks = ai_sched.get_think_limit(nr_of_ais, delta_t, ai::get_think_cycle_time());
+    // thinking doesn't add or remove ships, so the maps are stable here
+    ai_sched.run(
+        [this, delta_t](sea_object_id id) {
+            auto it = ships.find(id);
+            ship& s = (it != ships.end()) ? it->second : submarines.find(id)->second;
+            s.get_ai()->think(s, *this, delta_t);
+        },
+        max_thinks);
+}
+
 void game::simulate_objects(double delta_t, bool record, double& nearest_contact)
 {
     // ------------------------------ ships ------------------------------
@@ -915,7 +1264,7 @@ matrix from left and right and evaluate the result.
 */
 
 template<class T>
-inline auto visible_obj(const game* gm, const std::unordered_map<sea_object_id, T>& v, const sea_object* o)
+inline auto visible_obj(const game* gm, const slot_map<sea_object_id, T>& v, const sea_object* o)
     -> vector<const T*>
 {
     vector<const T*> result;
@@ -940,7 +1289,7 @@ inline auto visible_obj(const game* gm, const std::unordered_map<sea_object_id,
 }
 
 template<class T>
-inline auto visible_obj(const game* gm, const std::vector<T>& v, const sea_object* o) -> vector<const T*>
+inline auto visible_obj(const game* gm, const object_pool<T>& v, const sea_object* o) -> vector<const T*>
 {
     vector<const T*> result;
     const sensor* s = o->get_sensor(o->lookout_system);
@@ -1192,7 +1541,7 @@ auto game::convoy_positions() const -> vector<vector2>
     return result;
 }
 
-auto game::sonar_listen_ships(const ship* listener, angle rel_listening_dir) const -> pair<double, noise>
+void game::compute_received_noise(const ship* listener) const
 {
     // collect all ships for sound strength measurement
     vector<const ship*> tmpships;
@@ -1220,7 +1569,8 @@ auto game::sonar_listen_ships(const ship* listener, angle rel_listening_dir) con
 
     // compute noise strengths for all ships for all frequency bands, real
     // strengths, not dB!
-    noise n;
+    noise& n = listen_cache.own_noise;
+    n        = noise();
 #if 1
     // as first, add background noise
     n += noise::compute_ambient_noise_strength(0.2 /* sea state, fixme make dynamic later */);
@@ -1234,9 +1584,6 @@ auto game::sonar_listen_ships(const ship* listener, angle rel_listening_dir) con
     n += listener->get_noise_signature().compute_signal_strength(
         50 /* distance */, listener->get_speed(), false /*cavitation=off for listener*/);
 
-    angle hdg                = listener->get_heading();
-    bool listen_to_starboard = (rel_listening_dir.value_pm180() >= 0);
-
     // detection formula:
     // compute noise of target = L_t
     // compute ambient noise = L_a
@@ -1261,39 +1608,35 @@ auto game::sonar_listen_ships(const ship* listener, angle rel_listening_dir) con
     // so weaker signals have the same quantum as the background noise and
     // vanish.
 
-    // fixme: ghost images appear with higher frequencies!!! seems to be a ghg
-    // "feature"
-
-    // add noise of vessels
+    // compute noise strengths of all vessels
+    angle hdg  = listener->get_heading();
     vector2 lp = listener->get_pos().xy();
+    listen_cache.sources.clear();
     for (const auto* s : tmpships) {
         vector2 relpos  = s->get_pos().xy() - lp;
         double distance = relpos.length();
         double speed    = s->get_speed(); // s->get_throttle_speed();
         bool cavit      = s->screw_cavitation();
         angle direction_to_noise(relpos);
-        angle rel_dir_to_noise  = direction_to_noise - hdg;
-        bool noise_is_starboard = (rel_dir_to_noise.value_pm180() >= 0);
-        // check if noise is on active side of phones
-        if (listen_to_starboard == noise_is_starboard) {
-            noise nsig = s->get_noise_signature().compute_signal_strength(distance, speed, cavit);
-            // compute strengths for all bands
-            for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
-                double signalstrength =
-                    compute_signal_strength_GHG(rel_dir_to_noise, noise::typical_frequency[b], rel_listening_dir);
-                // printf("signalstrength is = %f\n", signalstrength);
-                nsig.frequencies[b] *= signalstrength;
-            }
-            n += nsig;
-        }
+        angle rel_dir_to_noise = direction_to_noise - hdg;
+        listen_cache.sources.push_back({rel_dir_to_noise,
+                                        rel_dir_to_noise.value_pm180() >= 0,
+                                        s->get_noise_signature().compute_signal_strength(distance, speed, cavit)});
     }
-    // now compute back to dB, quantize to integer dB values, to
-    // simulate shadowing of weak signals by background noise
-    // divide by receiver sensitivity before doing so, to avoid cutting off weak
-    // signals.
-    const double GHG_receiver_sensitivity_dB = -3; // weakest signal strength to be detectable
-    double abs_strength = floor(std::max(n.compute_total_noise_strength_dB() - GHG_receiver_sensitivity_dB, 0.0))
-                          + GHG_receiver_sensitivity_dB;
+    listen_cache.listener       = listener;
+    listen_cache.spectrum_valid = false;
+}
+
+auto game::sonar_listen_ships(const ship* listener, angle rel_listening_dir) const -> pair<double, noise>
+{
+    if (listen_cache.listener != listener) {
+        compute_received_noise(listener);
+    }
+    // add noise of vessels, weighted by directional response of the GHG
+    // fixme: ghost images appear with higher frequencies!!! seems to be a ghg
+    // "feature"
+    noise n = listen_cache.own_noise;
+    add_GHG_signals(n, listen_cache.sources, rel_listening_dir);
 
     // fixme: depending on listener angle, use only port or starboard phones to
     // listen to signals!
@@ -1313,32 +1656,52 @@ auto game::sonar_listen_ships(const ship* listener, angle rel_listening_dir) con
     //        the signal type by distribution to just four frequency bands is
     //        not realistic. Signals are distuingished by their frequency
     //        mixture., CHANGE THIS LATER
-    return make_pair(abs_strength, n.to_dB());
+    return compute_GHG_signal(n);
 }
 
-auto game::spawn_ship(ship&& obj) -> std::pair<const sea_object_id, ship>&
+auto game::sonar_listen_all_directions(const ship* listener) const -> const sonar_spectrum&
 {
-    return *ships.insert(std::make_pair(generate_id(), std::move(obj))).first;
+    if (listen_cache.listener != listener) {
+        compute_received_noise(listener);
+    }
+    if (!listen_cache.spectrum_valid) {
+        listen_cache.spectrum.compute(listen_cache.own_noise, listen_cache.sources);
+        listen_cache.spectrum_valid = true;
+    }
+    return listen_cache.spectrum;
+}
+
+auto game::spawn_ship(ship&& obj) -> std::pair<sea_object_id, ship>&
+{
+    auto& result = ships.insert(generate_id(), std::move(obj));
+    check_object_relocation();
+    return result;
 }
 
-auto game::spawn_submarine(submarine&& obj) -> std::pair<const sea_object_id, submarine>&
+auto game::spawn_submarine(submarine&& obj) -> std::pair<sea_object_id, submarine>&
 {
-    return *submarines.insert(std::make_pair(generate_id(), std::move(obj))).first;
+    auto& result = submarines.insert(generate_id(), std::move(obj));
+    check_object_relocation();
+    return result;
 }
 
-auto game::spawn_airplane(airplane&& obj) -> std::pair<const sea_object_id, airplane>&
+auto game::spawn_airplane(airplane&& obj) -> std::pair<sea_object_id, airplane>&
 {
-    return *airplanes.insert(std::make_pair(generate_id(), std::move(obj))).first;
+    auto& result = airplanes.insert(generate_id(), std::move(obj));
+    check_object_relocation();
+    return result;
 }
 
-auto game::spawn(torpedo&& obj) -> torpedo&
+auto game::spawn(torpedo&& obj) -> std::pair<object_pool<torpedo>::handle, torpedo&>
 {
-    torpedoes.push_back(std::move(obj));
     // add events here, fixme torpedo fired event or so, launch noise
-    return torpedoes.back();
+    auto result = torpedoes.insert(std::move(obj));
+    // torpedoes can be seen, so track their address before they are moved
+    result.second.update_address();
+    return result;
 }
 
-auto game::spawn(gun_shell&& obj) -> gun_shell&
+auto game::spawn(gun_shell&& obj) -> std::pair<object_pool<gun_shell>::handle, gun_shell&>
 {
     // vary the sound effect based on the gun size
     auto calibre = obj.get_caliber();
@@ -1349,27 +1712,24 @@ auto game::spawn(gun_shell&& obj) -> gun_shell&
     } else {
         events.push_back(std::make_unique<event_gunfire_heavy>(obj.get_pos()));
     }
-    gun_shells.push_back(std::move(obj));
-    return gun_shells.back();
+    return gun_shells.insert(std::move(obj));
 }
 
-auto game::spawn(depth_charge&& obj) -> depth_charge&
+auto game::spawn(depth_charge&& obj) -> std::pair<object_pool<depth_charge>::handle, depth_charge&>
 {
     events.push_back(std::make_unique<event_depth_charge_in_water>(obj.get_pos()));
-    depth_charges.push_back(std::move(obj));
-    return depth_charges.back();
+    return depth_charges.insert(std::move(obj));
 }
 
-auto game::spawn(water_splash&& obj) -> water_splash&
+auto game::spawn(water_splash&& obj) -> std::pair<object_pool<water_splash>::handle, water_splash&>
 {
-    water_splashes.push_back(std::move(obj));
     // add events here
-    return water_splashes.back();
+    return water_splashes.insert(std::move(obj));
 }
 
-auto game::spawn(convoy&& cv) -> std::pair<const sea_object_id, convoy>&
+auto game::spawn(convoy&& cv) -> std::pair<sea_object_id, convoy>&
 {
-    return *convoys.insert(std::make_pair(generate_id(), std::move(cv))).first;
+    return convoys.insert(generate_id(), std::move(cv));
 }
 
 void game::spawn(std::unique_ptr<particle>&& pt)
@@ -1467,7 +1827,7 @@ void game::ping_ASDIC(list<vector3>& contacts, sea_object* d, const bool& move_s
 }
 
 template<class C>
-auto check_units(torpedo* t, std::unordered_map<sea_object_id, C>& units) -> ship*
+auto check_units(torpedo* t, slot_map<sea_object_id, C>& units) -> ship*
 {
     const vector3& t_pos = t->get_pos();
     bv_tree::param p0    = t->compute_bv_tree_params();
@@ -1600,16 +1960,23 @@ auto game::sub_in_direction_from_pos(const sea_object* o, const angle& direction
     return result;
 }
 
-auto game::get_torpedo_for_camera_track(unsigned nr) const -> const torpedo*
+auto game::get_torpedo_for_camera_track(object_pool<torpedo>::handle h) const -> object_pool<torpedo>::handle
 {
-    if (nr < torpedoes.size()) {
-        for (const auto& torpedo : torpedoes) {
-            if (torpedo.is_reference_ok()) {
-                return &torpedo;
-            }
+    // cycle through the torpedoes in pool order, starting after h
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < torpedoes.size(); ++i) {
+        if (torpedoes.get_handle(i) == h) {
+            start = i + 1;
+            break;
         }
     }
-    return nullptr;
+    for (std::size_t k = 0; k < torpedoes.size(); ++k) {
+        const std::size_t i = (start + k) % torpedoes.size();
+        if (torpedoes[i].is_reference_ok()) {
+            return torpedoes.get_handle(i);
+        }
+    }
+    return {};
 }
 
 /* old code for torpedo collision. to be removed later, fixme.
@@ -1711,6 +2078,55 @@ auto game::get_object(sea_object_id id) -> sea_object&
     return it->second;
 }
 
+void game::check_object_relocation()
+{
+    // objects may have been added or removed
+    listen_cache.listener = nullptr;
+    // collect objects that have moved in memory since the last check. Torpedoes
+    // are included because they can be in the lists of visible objects.
+    std::unordered_map<const sea_object*, const sea_object*> moved;
+    auto collect = [&moved](sea_object& obj) {
+        if (const auto* previous = obj.update_address(); previous != nullptr) {
+            moved[previous] = &obj;
+        }
+    };
+    for (auto& [id, ship] : ships) {
+        collect(ship);
+    }
+    for (auto& [id, submarine] : submarines) {
+        collect(submarine);
+    }
+    for (auto& [id, airplane] : airplanes) {
+        collect(airplane);
+    }
+    for (auto& torpedo : torpedoes) {
+        collect(torpedo);
+    }
+    if (moved.empty()) {
+        return;
+    }
+    // renew all pointers to moved objects, so that sensor lists and their
+    // staggered redetection times are kept.
+    if (player_id.is_valid()) {
+        if (auto it = submarines.find(player_id); it != submarines.end()) {
+            player = &it->second;
+        } else if (auto it2 = ships.find(player_id); it2 != ships.end()) {
+            player = &it2->second;
+        } else if (auto it3 = airplanes.find(player_id); it3 != airplanes.end()) {
+            player = &it3->second;
+        }
+    }
+    for (auto& [id, ship] : ships) {
+        ship.remap_detected_objects(moved);
+    }
+    for (auto& [id, submarine] : submarines) {
+        submarine.remap_detected_objects(moved);
+    }
+    for (auto& [id, airplane] : airplanes) {
+        airplane.remap_detected_objects(moved);
+    }
+}
+
 auto game::get_ship(sea_object_id id) -> ship&
 {
     auto it = ships.find(id);
@@ -1729,6 +2145,15 @@ auto game::get_convoy(sea_object_id id) -> convoy&
     return it->second;
 }
 
+auto game::get_coast_distance() const -> const coast_distance_field&
+{
+    // loading or computing the field takes time, so only do it when needed
+    if (!mycoastdist) {
+        mycoastdist = coast_distance_field::load_for_map(get_map_dir() + "default.xml");
+    }
+    return *mycoastdist;
+}
+
 auto game::get_id(const sea_object& s) const -> sea_object_id
 {
     // fixme ugly! should only be available in game_editor later!
@@ -2090,6 +2515,99 @@ void game::unfreeze_time()
     freezetime_start = 0;
 }
 
+auto game::execute_command(const player_command& cmd) -> int
+{
+    auto* s = dynamic_cast<ship*>(player);
+    if (s == nullptr) {
+        THROW(error, "player commands need a ship as player");
+    }
+    // record before execution, so replay sees the same state
+    if (recorder) {
+        recorder->record(tick, cmd);
+    }
+    auto* sub = dynamic_cast<submarine*>(player);
+    int result = 0;
+    switch (cmd.type) {
+        case player_command::set_rudder:
+            s->set_rudder(cmd.vvalue.x);
+            break;
+        case player_command::set_throttle:
+            s->set_throttle(cmd.ivalue);
+            break;
+        case player_command::set_target:
+            s->set_target(sea_object_id(unsigned(cmd.ivalue)), *this);
+            break;
+        case player_command::head_to_course:
+            s->head_to_course(angle(cmd.vvalue.x));
+            break;
+        case player_command::fire_deck_gun:
+            result = s->fire_shell_at(cmd.vvalue.xy(), *this);
+            break;
+        case player_command::man_guns:
+            result = (cmd.ivalue != 0) ? s->man_guns() : s->unman_guns();
+            break;
+        default:
+            // submarine specific commands
+            if (sub == nullptr) {
+                log_warning("player command " << unsigned(cmd.type) << " needs a submarine as player");
+                break;
+            }
+            switch (cmd.type) {
+                case player_command::set_planes:
+                    sub->set_planes_to(cmd.vvalue.x, *this);
+                    break;
+                case player_command::launch_torpedo:
+                    result = sub->launch_torpedo(cmd.ivalue, cmd.vvalue, *this);
+                    break;
+                case player_command::scope:
+                    if (cmd.ivalue != 0) {
+                        sub->scope_up();
+                    } else {
+                        sub->scope_down();
+                    }
+                    break;
+                case player_command::snorkel:
+                    if (cmd.ivalue != 0) {
+                        sub->snorkel_up();
+                    } else {
+                        sub->snorkel_down();
+                    }
+                    break;
+                case player_command::crash_dive:
+                    sub->crash_dive(*this);
+                    break;
+                case player_command::dive_to_depth:
+                    sub->dive_to_depth(unsigned(cmd.ivalue), *this);
+                    break;
+                default:
+                    THROW(error, "invalid player command");
+            }
+    }
+    return result;
+}
+
+void game::start_recording(const std::string& filename, double step_time)
+{
+    recorder = std::make_unique<game_recorder>(filename, *this, step_time);
+}
+
+void game::stop_recording()
+{
+    if (recorder) {
+        recorder->finish(tick);
+        recorder = nullptr;
+    }
+}
+
+void game::reseed(unsigned seed)
+{
+    srand(seed);
+    random_gen.set_seed(seed);
+    seed_every_step = true;
+    step_seed       = seed;
+    step_seed_tick  = tick;
+}
+
 auto game::is_valid(sea_object_id id) const -> bool
 {
     if (id == sea_object_id::invalid) {
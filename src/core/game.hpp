@@ -37,13 +37,14 @@ constexpr auto max_acoustic_contacts = 5;       // max. nr of simultaneous
 #define TERRAIN_NR_LEVELS    10
 #define TERRAIN_RESOLUTION_N 7
 
+#include "object_pool.hpp"
 #include "random_generator.hpp"
+#include "slot_map.hpp"
 #include "thread.hpp"
 
 #include <condition_variable>
 #include <list>
 #include <mutex>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -51,13 +52,17 @@ constexpr auto max_acoustic_contacts = 5;       // max. nr of simultaneous
 class particle;
 class water;
 class height_generator;
+class coast_distance_field;
+class game_recorder;
 
+#include "ai_scheduler.hpp"
 #include "angle.hpp"
 #include "color.hpp"
 #include "date.hpp"
 #include "event.hpp"
 #include "logbook.hpp"
 #include "model.hpp"
+#include "player_command.hpp"
 #include "sensors.hpp"
 #include "sonar.hpp"
 #include "vector2.hpp"
@@ -101,6 +106,8 @@ class game
         ~ping() = default;
         ping(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        ping(std::istream& in);
+        void save(std::ostream& out) const;
     };
 
     struct sink_record
@@ -123,6 +130,8 @@ class game
         }
         sink_record(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        sink_record(std::istream& in);
+        void save(std::ostream& out) const;
     };
 
     struct player_info
@@ -145,6 +154,8 @@ class game
         player_info();
         player_info(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        player_info(std::istream& in);
+        void save(std::ostream& out) const;
     };
 
     // in which state is the game
@@ -162,23 +173,40 @@ class game
 
   protected:
     // begin [SAVE]
-    std::unordered_map<sea_object_id, ship> ships;
-    std::unordered_map<sea_object_id, submarine> submarines;
-    std::unordered_map<sea_object_id, airplane> airplanes;
-    std::vector<torpedo> torpedoes;
-    std::vector<depth_charge> depth_charges;
-    std::vector<gun_shell> gun_shells;
-    std::vector<water_splash> water_splashes;
-    std::unordered_map<sea_object_id, convoy> convoys;
+    slot_map<sea_object_id, ship> ships;
+    slot_map<sea_object_id, submarine> submarines;
+    slot_map<sea_object_id, airplane> airplanes;
+    // projectiles are created and destroyed often, so they are pooled with
+    // space for typical battles preallocated.
+    object_pool<torpedo> torpedoes{64};
+    object_pool<depth_charge> depth_charges{256};
+    object_pool<gun_shell> gun_shells{1024};
+    object_pool<water_splash> water_splashes{1024};
+    slot_map<sea_object_id, convoy> convoys;
     std::vector<std::unique_ptr<particle>> particles;
 
-    sea_object_id next_id;
-    sea_object_id generate_id()
-    {
-        ++next_id.id;
-        return next_id;
-    }
+    // ids of ships, submarines, airplanes and convoys, unique over all of them
+    slot_allocator object_ids;
+    sea_object_id generate_id() { return sea_object_id(object_ids.allocate()); }
     // end [SAVE]
+    // objects in the slot maps and pools can move in memory when others are
+    // added or removed, renew pointers to them.
+    void check_object_relocation();
+    // noise of all sources as received by the last sonar listener. It does not
+    // depend on the listening direction, so it is computed once per simulation
+    // step and reused for all directions a sonar sweeps over.
+    struct sonar_listen_cache
+    {
+        const ship* listener{nullptr};
+        noise own_noise; // ambient noise and noise of listener
+        std::vector<received_noise> sources;
+        sonar_spectrum spectrum; // computed on demand
+        bool spectrum_valid{false};
+    };
+    mutable sonar_listen_cache listen_cache;
+    void compute_received_noise(const ship* listener) const;
+    // decides which ship AIs think in a simulation step
+    ai_scheduler ai_sched;
     run_state my_run_state;
 
     std::vector<std::unique_ptr<event>> events;
@@ -210,6 +238,24 @@ class game
 
     std::list<ping> pings; // [SAVE]
 
+    // number of simulation steps done since game creation, used to timestamp
+    // recorded player commands.
+    uint64_t tick{0};
+
+    // recorder for player commands, if recording is active
+    std::unique_ptr<game_recorder> recorder;
+
+    // rand() is also used outside of the simulation, e.g. by rendering. After
+    // reseed() it is seeded again before every simulation step from this seed
+    // and the number of steps since reseeding, so replays get the same values.
+    bool seed_every_step{false};
+    unsigned step_seed{0};
+    uint64_t step_seed_tick{0};
+
+    // interpolation factor between the last two simulation steps that
+    // rendering uses for object transforms, set by the main loop.
+    double render_alpha{1.0};
+
     // time in milliseconds that game is paused between simulation steps.
     // for small pauses to compensate long image loading times
     unsigned freezetime{}, freezetime_start{};
@@ -220,8 +266,13 @@ class game
     // terrain height data
     std::unique_ptr<height_generator> myheightgen;
 
+    // distance to the coast for land proximity queries, created on first use
+    mutable std::unique_ptr<coast_distance_field> mycoastdist;
+
     // helper for simulation
     void simulate_objects(double delta_t, bool record, double& nearest_contact);
+    // let the AIs that are due think, within the time budget
+    void run_ai(double delta_t);
 
     player_info playerinfo;
 
@@ -233,6 +284,9 @@ class game
 
     object_store<model> model_store;
 
+    /// load state from binary savegame, see save_binary
+    void load_binary(std::istream& in);
+
     game();
     game& operator=(const game& other);
     game(const game& other);
@@ -250,13 +304,21 @@ class game
         player_info pi         = player_info() /*fixme - must be always given*/,
         unsigned nr_of_players = 1);
 
-    // create from mission file or savegame (xml file)
+    // create from mission file or savegame (xml or binary file)
     game(const std::string& filename);
+    /// create from binary savegame in memory, see save_binary
+    explicit game(std::istream& in);
 
     virtual ~game();
 
     virtual void save(const std::string& savefilename, const std::string& description) const;
+    /// save game in binary format. Written as a stream without building a
+    /// document tree first, so it is faster and smaller than the XML format.
+    void save_binary(const std::string& savefilename, const std::string& description) const;
+    void save_binary(std::ostream& out, const std::string& description) const;
     static std::string read_description_of_savegame(const std::string& filename);
+    /// check if file is a savegame in binary format
+    static bool is_binary_savegame(const std::string& filename);
 
     void compute_max_view_dist(); // fixme - public?
     virtual void simulate(double delta_t);
@@ -338,6 +400,13 @@ class game
     */
     std::pair<double, noise> sonar_listen_ships(const ship* listener, angle rel_listening_dir) const;
 
+    ///\brief compute sound strengths caused by all ships for all listening directions at once
+    /** Use this when sampling many directions, e.g. for a sweep of the sonar.
+        @param	listener		object that listens via passive sonar
+        @return	spectrum of received noise, valid until next simulation step
+    */
+    const sonar_spectrum& sonar_listen_all_directions(const ship* listener) const;
+
     // append objects to vector
     template<class T>
     static void append_vec(std::vector<const sea_object*>& vec, const std::vector<T*>& vec2)
@@ -350,16 +419,16 @@ class game
 
     // when submarine no longer inherits from ship use names spawn() directly
     // and determine via type only.
-    std::pair<const sea_object_id, ship>& spawn_ship(ship&& obj);
-    std::pair<const sea_object_id, submarine>& spawn_submarine(submarine&& obj);
-    std::pair<const sea_object_id, airplane>& spawn_airplane(airplane&& obj);
-    torpedo& spawn(torpedo&& obj);
-    gun_shell& spawn(gun_shell&& obj);
-    depth_charge& spawn(depth_charge&& obj);
-    water_splash& spawn(water_splash&& obj);
+    std::pair<sea_object_id, ship>& spawn_ship(ship&& obj);
+    std::pair<sea_object_id, submarine>& spawn_submarine(submarine&& obj);
+    std::pair<sea_object_id, airplane>& spawn_airplane(airplane&& obj);
+    std::pair<object_pool<torpedo>::handle, torpedo&> spawn(torpedo&& obj);
+    std::pair<object_pool<gun_shell>::handle, gun_shell&> spawn(gun_shell&& obj);
+    std::pair<object_pool<depth_charge>::handle, depth_charge&> spawn(depth_charge&& obj);
+    std::pair<object_pool<water_splash>::handle, water_splash&> spawn(water_splash&& obj);
 
     void spawn(std::unique_ptr<particle>&& p);
-    std::pair<const sea_object_id, convoy>& spawn(convoy&& cv);
+    std::pair<sea_object_id, convoy>& spawn(convoy&& cv);
 
     // simulation events
     void dc_explosion(const depth_charge& dc); // depth charge exploding
@@ -381,7 +450,10 @@ class game
     sea_object_id ship_in_direction_from_pos(const sea_object* o, const angle& direction) const;
     sea_object_id sub_in_direction_from_pos(const sea_object* o, const angle& direction) const;
 
-    const torpedo* get_torpedo_for_camera_track(unsigned nr) const;
+    /// get torpedo by handle or nullptr if it is gone
+    const torpedo* get_torpedo(object_pool<torpedo>::handle h) const { return torpedoes.get(h); }
+    /// handle of the next running torpedo after h, empty handle if there is none
+    object_pool<torpedo>::handle get_torpedo_for_camera_track(object_pool<torpedo>::handle h) const;
 
     // old code, to be removed later, fixme.
     // bool is_collision(const sea_object* s1, const sea_object* s2) const;
@@ -402,6 +474,23 @@ class game
     void freeze_time();
     void unfreeze_time();
 
+    /// set interpolation factor [0...1] between last two simulation steps for rendering
+    void set_render_interpolation(double alpha) { render_alpha = alpha; }
+    double get_render_interpolation() const { return render_alpha; }
+
+    /// execute a command of the player and record it if recording is active
+    ///@returns result of the command, true/false for torpedo launches, ship::gun_status for deck gun, else 0
+    int execute_command(const player_command& cmd);
+    /// start recording player commands for replay, see game_recorder
+    void start_recording(const std::string& filename, double step_time);
+    /// stop recording player commands
+    void stop_recording();
+    /// number of simulation steps done
+    uint64_t get_tick() const { return tick; }
+    /// set seed of all random generators that influence the simulation, rand()
+    /// is seeded again before every following simulation step.
+    void reseed(unsigned seed);
+
     void add_event(std::unique_ptr<event>&& e) { events.push_back(std::move(e)); }
     const auto& get_events() const { return events; }
     run_state get_run_state() const { return my_run_state; }
@@ -420,6 +509,8 @@ class game
     height_generator& get_height_gen() { return *myheightgen.get(); }
     const height_generator& get_height_gen() const { return *myheightgen.get(); }
 
+    const coast_distance_field& get_coast_distance() const;
+
     /// get pointers to all ships for collision tests.
     std::vector<const ship*> get_all_ships() const;
 
@@ -434,6 +525,9 @@ class game
     /// Check if sea_object_id is valid
     bool is_valid(sea_object_id id) const;
 
+    /// Get scheduler of AI thinking, for its budget and statistics
+    auto& get_ai_scheduler() { return ai_sched; }
+
     /// Get store for models
     auto& get_model_store() { return model_store; }
 };
@@ -0,0 +1,192 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// recording and replay of player commands
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "game_recorder.hpp"
+
+#include "binstream.hpp"
+#include "error.hpp"
+#include "game.hpp"
+#include "log.hpp"
+
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+/// write player command payload
+void write_command(std::ostream& out, const player_command& cmd)
+{
+    write_u8(out, cmd.type);
+    write_i32(out, cmd.ivalue);
+    write_vector3(out, cmd.vvalue);
+}
+
+/// read player command payload
+auto read_command(std::istream& in) -> player_command
+{
+    player_command cmd;
+    const auto t = read_u8(in);
+    if (t >= player_command::number_of_types) {
+        THROW(error, "invalid player command type in recording");
+    }
+    cmd.type   = player_command::type_t(t);
+    cmd.ivalue = read_i32(in);
+    cmd.vvalue = read_vector3(in);
+    return cmd;
+}
+} // namespace
+
+game_recorder::game_recorder(const std::string& filename, game& gm, double step_time)
+    : out(filename.c_str(), std::ios::binary)
+    , last_tick(gm.get_tick())
+{
+    if (!out.good()) {
+        THROW(file_context_error, "could not open file for recording", filename);
+    }
+
+    // store initial state as binary savegame, embedded into the recording.
+    // It keeps the object ids, so recorded commands refer to the same objects.
+    std::ostringstream initial;
+    gm.save_binary(initial, "recording");
+    const std::string savegame_data = initial.str();
+
+    write_u32(out, file_magic);
+    write_u32(out, file_version);
+    write_double(out, step_time);
+    write_string(out, savegame_data);
+
+    // start with a known random seed, recorded like any other seed change
+    const auto seed = unsigned(std::chrono::steady_clock::now().time_since_epoch().count());
+    gm.reseed(seed);
+    record_seed(gm.get_tick(), seed);
+    log_info("recording game to " << filename << ", initial state " << savegame_data.size() << " bytes");
+}
+
+game_recorder::~game_recorder()
+{
+    if (!finished) {
+        finish(last_tick);
+    }
+}
+
+void game_recorder::record(uint64_t tick, const player_command& cmd)
+{
+    write_u8(out, entry_command);
+    write_u64(out, tick);
+    write_command(out, cmd);
+    last_tick = tick;
+    ++nr_of_commands;
+}
+
+void game_recorder::record_seed(uint64_t tick, unsigned seed)
+{
+    write_u8(out, entry_seed);
+    write_u64(out, tick);
+    write_u32(out, seed);
+    last_tick = tick;
+}
+
+void game_recorder::finish(uint64_t tick)
+{
+    write_u8(out, entry_end);
+    write_u64(out, tick);
+    out.close();
+    finished = true;
+    log_info("recording finished, " << nr_of_commands << " commands");
+}
+
+game_replay::game_replay(const std::string& filename_)
+    : filename(filename_)
+{
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in.good()) {
+        THROW(file_read_error, filename);
+    }
+    if (read_u32(in) != game_recorder::file_magic) {
+        THROW(file_context_error, "file is no game recording", filename);
+    }
+    if (read_u32(in) != game_recorder::file_version) {
+        THROW(file_context_error, "unsupported version of game recording", filename);
+    }
+    step_time     = read_double(in);
+    savegame_data = read_string(in);
+
+    // ticks in the file are absolute simulation steps of the recorded game,
+    // make them relative to the start of the recording.
+    bool first          = true;
+    uint64_t first_tick = 0;
+    while (true) {
+        const auto type = game_recorder::entry_type(read_u8(in));
+        uint64_t tick   = read_u64(in);
+        if (!in.good()) {
+            THROW(file_context_error, "game recording is truncated", filename);
+        }
+        if (first) {
+            first_tick = tick;
+            first      = false;
+        }
+        tick -= first_tick;
+        if (type == game_recorder::entry_end) {
+            nr_of_ticks = tick;
+            break;
+        }
+        entry e{tick, type, 0, player_command()};
+        if (type == game_recorder::entry_seed) {
+            e.seed = read_u32(in);
+        } else if (type == game_recorder::entry_command) {
+            e.cmd = read_command(in);
+        } else {
+            THROW(file_context_error, "invalid entry in game recording", filename);
+        }
+        entries.push_back(e);
+    }
+}
+
+auto game_replay::create_game() const -> std::unique_ptr<game>
+{
+    std::istringstream in(savegame_data);
+    return std::make_unique<game>(in);
+}
+
+void game_replay::apply(uint64_t tick, game& gm)
+{
+    while (next_entry < entries.size() && entries[next_entry].tick <= tick) {
+        const auto& e = entries[next_entry];
+        if (e.type == game_recorder::entry_seed) {
+            gm.reseed(e.seed);
+        } else {
+            gm.execute_command(e.cmd);
+        }
+        ++next_entry;
+    }
+}
+
+auto game_replay::get_nr_of_commands() const -> unsigned
+{
+    unsigned n = 0;
+    for (const auto& e : entries) {
+        if (e.type == game_recorder::entry_command) {
+            ++n;
+        }
+    }
+    return n;
+}
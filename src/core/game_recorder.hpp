@@ -0,0 +1,110 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// recording and replay of player commands
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "player_command.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class game;
+
+///\brief Records a game session for deterministic replay.
+/** The file stores the initial binary savegame and a stream of player commands and
+    random seeds, each stamped with the index of the simulation step they were
+    given before. Because the simulation runs with a fixed step time, replaying
+    the stream on the initial state reproduces the session, which makes it
+    possible to profile the simulation with identical workload.
+*/
+class game_recorder
+{
+  public:
+    /// start recording, writes initial state of the game and reseeds its random generators
+    ///@param filename - file to write
+    ///@param gm - the game to record
+    ///@param step_time - fixed simulation step time in seconds
+    game_recorder(const std::string& filename, game& gm, double step_time);
+    ~game_recorder();
+
+    /// record command given before simulation step "tick"
+    void record(uint64_t tick, const player_command& cmd);
+    /// record seed that is set before simulation step "tick"
+    void record_seed(uint64_t tick, unsigned seed);
+    /// write end marker and close file, called by destructor
+    void finish(uint64_t tick);
+    /// number of recorded commands
+    [[nodiscard]] unsigned get_nr_of_commands() const { return nr_of_commands; }
+
+    /// entry types in stream
+    enum entry_type : uint8_t
+    {
+        entry_command,
+        entry_seed,
+        entry_end
+    };
+    static constexpr uint32_t file_magic   = 0x44524344; // "DCRD"
+    static constexpr uint32_t file_version = 2;
+
+  protected:
+    std::ofstream out;
+    unsigned nr_of_commands{0};
+    uint64_t last_tick{0};
+    bool finished{false};
+};
+
+///\brief Replays a recorded game session.
+class game_replay
+{
+  public:
+    /// read recording from file
+    game_replay(const std::string& filename);
+
+    /// create game in recorded initial state, needs a valid system context
+    [[nodiscard]] std::unique_ptr<game> create_game() const;
+    /// apply all entries recorded for the simulation step "tick"
+    void apply(uint64_t tick, game& gm);
+    /// fixed simulation step time
+    [[nodiscard]] double get_step_time() const { return step_time; }
+    /// number of recorded simulation steps
+    [[nodiscard]] uint64_t get_nr_of_ticks() const { return nr_of_ticks; }
+    /// number of recorded commands
+    [[nodiscard]] unsigned get_nr_of_commands() const;
+
+  protected:
+    struct entry
+    {
+        uint64_t tick;
+        game_recorder::entry_type type;
+        unsigned seed;
+        player_command cmd;
+    };
+    std::string filename;
+    std::string savegame_data;
+    double step_time{0.0};
+    uint64_t nr_of_ticks{0};
+    std::vector<entry> entries;
+    unsigned next_entry{0};
+};
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "gun_shell.hpp"
 
+#include "binstream.hpp"
 #include "event.hpp"
 #include "game.hpp"
 #include "log.hpp"
@@ -52,18 +53,18 @@ gun_shell::gun_shell(
     : sea_object("gun_shell.ddxml", model_store)
     , caliber(caliber_)
 {
-    orientation = quaternion::rot(-direction.value(), 0, 0, 1);
+    hot->orientation = quaternion::rot(-direction.value(), 0, 0, 1);
     mass        = 20;
     mass_inv    = 1.0 / mass;
-    linear_momentum =
-        mass * orientation.rotate(vector3(0, elevation.cos() * initial_velocity, elevation.sin() * initial_velocity));
+    hot->linear_momentum =
+        mass * hot->orientation.rotate(vector3(0, elevation.cos() * initial_velocity, elevation.sin() * initial_velocity));
 
     // set off initial pos. like 0.5 seconds after firing, to avoid
     // collision with parent
-    position         = pos + linear_momentum * (mass_inv * 0.5);
-    angular_momentum = vector3();
+    hot->position         = pos + hot->linear_momentum * (mass_inv * 0.5);
+    hot->angular_momentum = vector3();
     compute_helper_values();
-    oldpos        = position;
+    oldpos        = hot->position;
     damage_amount = damage;
 
     log_info("shell created");
@@ -83,6 +84,20 @@ void gun_shell::save(xml_elem& parent) const
     parent.add_child("damage_amount").set_attr(damage_amount);
 }
 
+void gun_shell::load(std::istream& in)
+{
+    sea_object::load(in);
+    oldpos        = read_vector3(in);
+    damage_amount = read_double(in);
+}
+
+void gun_shell::save(std::ostream& out) const
+{
+    sea_object::save(out);
+    write_vector3(out, oldpos);
+    write_double(out, damage_amount);
+}
+
 void gun_shell::check_collision(game& gm)
 {
     // fixme use bv trees for this: tree/sphere with ray intersection
@@ -120,7 +135,7 @@ void gun_shell::check_collision(game& gm)
        not exactly at the surface, but this doesn't matter and is in fact
        realistic.
     */
-    vector3 dv2 = position - oldpos;
+    vector3 dv2 = hot->position - oldpos;
 
     // avoid NaN on first round
     double dvl = dv2.square_length();
@@ -151,7 +166,7 @@ void gun_shell::check_collision(game& gm)
         if (t0 * t1 < 0.0 || (t0 >= 0.0 && t0 <= dvl) || (t1 >= 0.0 && t1 <= dvl)) {
             // log_debug("gun_shell "<<this<<" intersects bsphere of "<<s);
             check_collision_precise(gm, *s, -k, dv2 - k);
-            if (alive_stat == dead) {
+            if (hot->alive_stat == dead) {
                 return; // no more checks after hit
             }
         }
@@ -160,13 +175,13 @@ void gun_shell::check_collision(game& gm)
     // now check for water impact if not dead yet (when impact to object was
     // found) we check agains maximum water z, or a rather crude, but satisfying
     // replacement (10m)
-    if (alive_stat != dead && position.z < 10.0) {
+    if (hot->alive_stat != dead && hot->position.z < 10.0) {
         // we only check if position.z is below water surface, accurate enough
         // for us
-        double wh = gm.compute_water_height(position.xy());
-        if (position.z < wh) {
-            vector3 p  = position;
-            position.z = wh;
+        double wh = gm.compute_water_height(hot->position.xy());
+        if (hot->position.z < wh) {
+            vector3 p  = hot->position;
+            hot->position.z = wh;
             gm.spawn(water_splash::gun_shell(p, gm.get_model_store()));
             gm.add_event(std::make_unique<event_shell_splash>(get_pos()));
             kill();
@@ -225,7 +240,7 @@ void gun_shell::check_collision_precise(game& gm, const ship& s, const vector3&
         vector3f dd = newrelbbox - oldrelbbox;
 
         check_collision_voxel(gm, s, oldrelbbox + dd * tmin, oldrelbbox + dd * tmax);
-        if (alive_stat == dead) {
+        if (hot->alive_stat == dead) {
             return; // no more checks after hit
         }
     }
@@ -277,7 +292,7 @@ void gun_shell::check_collision_voxel(game& gm, const ship& s, const vector3f& o
 
                 // move gun shell pos to hit position to
                 // let the explosion be at right position
-                position = impactpos;
+                hot->position = impactpos;
                 log_debug("Hit object at real world pos " << impactpos);
                 log_debug("that is relative: " << s.get_pos() - impactpos);
 
@@ -309,7 +324,7 @@ void gun_shell::simulate(double delta_time, game& gm)
     }
 
     check_collision(gm);
-    oldpos = position;
+    oldpos = hot->position;
     sea_object::simulate(delta_time, gm);
 }
 
@@ -319,7 +334,7 @@ void gun_shell::display() const
     // so compute a rotation matrix from velocity and multiply it
     // onto the current modelview matrix.
     // fixme: using orientation should do the trick!
-    vector3 vn   = velocity.normal();
+    vector3 vn   = hot->velocity.normal();
     vector3 up   = vector3(0, 0, 1);
     vector3 side = vn.orthogonal(up);
     up           = side.orthogonal(vn);
@@ -41,6 +41,8 @@ class gun_shell : public sea_object
 
     void load(const xml_elem& parent) override;
     void save(xml_elem& parent) const override;
+    void load(std::istream& in) override;
+    void save(std::ostream& out) const override;
     [[nodiscard]] auto get_caliber() const { return caliber; }
 
     void simulate(double delta_time, game& gm) override;
@@ -0,0 +1,66 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// commands of the player that change the game state
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "vector3.hpp"
+
+#include <cstdint>
+
+///\brief A command the player gives to his vessel.
+/** All user interface actions that change the simulation are expressed as
+    commands and executed by game::execute_command, so they can be recorded
+    and replayed deterministically. Commands store plain values only, never
+    pointers, e.g. torpedo target positions are stored as computed when
+    the command was given.
+*/
+struct player_command
+{
+    enum type_t : uint8_t
+    {
+        set_rudder,     ///< vvalue.x rudder position -2...2
+        set_planes,     ///< vvalue.x plane amount -1...1
+        set_throttle,   ///< ivalue throttle status
+        launch_torpedo, ///< ivalue tube number (-1 = any), vvalue target position
+        set_target,     ///< ivalue sea_object_id of target
+        scope,          ///< ivalue 1 = up, 0 = down
+        snorkel,        ///< ivalue 1 = up, 0 = down
+        crash_dive,     ///< no parameters
+        dive_to_depth,  ///< ivalue depth in meters
+        head_to_course, ///< vvalue.x course in degrees
+        fire_deck_gun,  ///< vvalue.xy target position
+        man_guns,       ///< ivalue 1 = man, 0 = unman
+        number_of_types
+    };
+
+    type_t type{set_rudder};
+    int32_t ivalue{0};
+    vector3 vvalue;
+
+    player_command() = default;
+    player_command(type_t t, int32_t i = 0, const vector3& v = vector3())
+        : type(t)
+        , ivalue(i)
+        , vvalue(v)
+    {
+    }
+};
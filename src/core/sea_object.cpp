@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "sea_object.hpp"
 
 #include "ai.hpp"
+#include "binstream.hpp"
 #include "constant.hpp"
 #include "datadirs.hpp"
 #include "game.hpp"
@@ -32,6 +33,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "sensors.hpp"
 #include "texts.hpp"
 #include "vector2.hpp"
+
+#include <array>
+#include <mutex>
 using std::string;
 
 auto string_split(const std::string& src, char splitter = ',') -> std::vector<std::string>
@@ -52,6 +56,60 @@ auto string_split(const std::string& src, char splitter = ',') -> std::vector<st
     return result;
 }
 
+/// Storage for the hot states of all sea objects.
+/** States are allocated in blocks, objects created one after another get
+    neighbouring states. Freed states are reused first, so the blocks stay
+    densely filled while objects come and go.
+*/
+class sea_object::hot_state_pool
+{
+  public:
+    static constexpr unsigned block_size = 64;
+
+    static auto instance() -> hot_state_pool&
+    {
+        static hot_state_pool pool;
+        return pool;
+    }
+
+    auto allocate() -> hot_state*
+    {
+        std::unique_lock<std::mutex> ml(mtx);
+        if (free_states.empty()) {
+            blocks.push_back(std::make_unique<std::array<hot_state, block_size>>());
+            // reverse order, so states are handed out in ascending addresses
+            for (auto it = blocks.back()->rbegin(); it != blocks.back()->rend(); ++it) {
+                free_states.push_back(&*it);
+            }
+        }
+        auto* s = free_states.back();
+        free_states.pop_back();
+        *s = hot_state{};
+        return s;
+    }
+
+    void release(hot_state* s)
+    {
+        std::unique_lock<std::mutex> ml(mtx);
+        free_states.push_back(s);
+    }
+
+  protected:
+    std::mutex mtx; // objects may be created by loading threads
+    std::vector<std::unique_ptr<std::array<hot_state, block_size>>> blocks;
+    std::vector<hot_state*> free_states;
+};
+
+void sea_object::hot_state_deleter::operator()(hot_state* s) const
+{
+    hot_state_pool::instance().release(s);
+}
+
+auto sea_object::allocate_hot_state() -> hot_state*
+{
+    return hot_state_pool::instance().allocate();
+}
+
 void sea_object::degrees2meters(
     bool west,
     unsigned degx,
@@ -108,10 +166,10 @@ void sea_object::compute_force_and_torque(vector3& F, vector3& /*T*/, game& /*gm
 
 void sea_object::compute_helper_values()
 {
-    velocity       = linear_momentum * mass_inv;
-    local_velocity = orientation.conj().rotate(velocity);
+    hot->velocity       = hot->linear_momentum * mass_inv;
+    hot->local_velocity = hot->orientation.conj().rotate(hot->velocity);
 
-    heading = angle(orientation.rotate(0.0, 1.0, 0.0).xy());
+    hot->heading = angle(hot->orientation.rotate(0.0, 1.0, 0.0).xy());
     // w is _old_ spin vector, but we need the new one...
     // does it make a large difference?
     // |w| is revolutions per time, thus 2*Pi/second for |w|=1.
@@ -124,12 +182,12 @@ void sea_object::compute_helper_values()
     // unit of |w| is revolutions per time, that is 2*Pi/second.
     // Note! here w is local. Get global w by rotating it with
     // orientation.rotate(w)
-    vector3 w = inertia_tensor_inv * orientation.conj().rotate(angular_momentum);
+    vector3 w = inertia_tensor_inv * hot->orientation.conj().rotate(hot->angular_momentum);
     // turn velocity around z-axis is projection of w to z-axis, that is
     // simply w.z. Transform to angles per second. same for x/y.
-    turn_velocity  = w.z * (180.0 / M_PI); // could also be named yaw_velocity.
-    pitch_velocity = w.x * (180.0 / M_PI);
-    roll_velocity  = w.y * (180.0 / M_PI);
+    hot->turn_velocity  = w.z * (180.0 / M_PI); // could also be named yaw_velocity.
+    hot->pitch_velocity = w.x * (180.0 / M_PI);
+    hot->roll_velocity  = w.y * (180.0 / M_PI);
     // std::cout << "velocities(deg) turn=" << turn_velocity << " pitch=" <<
     // pitch_velocity << " roll=" << roll_velocity << "\n";
 }
@@ -297,10 +355,6 @@ sea_object::sea_object(std::string modelname_, object_store<model>& model_store)
     , mass(1.0)
     , // fixme
     mass_inv(1.0 / mass)
-    , turn_velocity(0)
-    , pitch_velocity(0)
-    , roll_velocity(0)
-    , alive_stat(alive)
     , sensors(last_sensor_system)
     , invulnerable(false)
     , country(UNKNOWNCOUNTRY)
@@ -338,10 +392,6 @@ sea_object::sea_object(date game_date, object_store<model>& model_store, const x
     , mass(1.0)
     , // fixme
     mass_inv(1.0 / mass)
-    , turn_velocity(0)
-    , pitch_velocity(0)
-    , roll_velocity(0)
-    , alive_stat(alive)
     , sensors(last_sensor_system)
     , invulnerable(false)
     , country(UNKNOWNCOUNTRY)
@@ -492,10 +542,10 @@ void sea_object::load(const xml_elem& parent)
                 + specfilename + std::string(" from spec file"));
     }
     xml_elem st      = parent.child("state");
-    position         = st.child("position").attrv3();
-    orientation      = st.child("orientation").attrq();
-    linear_momentum  = st.child("linear_momentum").attrv3();
-    angular_momentum = st.child("angular_momentum").attrv3();
+    hot->position         = st.child("position").attrv3();
+    hot->orientation      = st.child("orientation").attrq();
+    hot->linear_momentum  = st.child("linear_momentum").attrv3();
+    hot->angular_momentum = st.child("angular_momentum").attrv3();
     compute_helper_values();
 
     // read skin info
@@ -540,11 +590,11 @@ void sea_object::save(xml_elem& parent) const
 {
     // specfilename is requested and stored by game or callers of this function
     xml_elem st = parent.add_child("state");
-    st.add_child("position").set_attr(position);
-    st.add_child("orientation").set_attr(orientation);
-    st.add_child("linear_momentum").set_attr(linear_momentum);
-    st.add_child("angular_momentum").set_attr(angular_momentum);
-    parent.add_child("alive_stat").set_attr(unsigned(alive_stat));
+    st.add_child("position").set_attr(hot->position);
+    st.add_child("orientation").set_attr(hot->orientation);
+    st.add_child("linear_momentum").set_attr(hot->linear_momentum);
+    st.add_child("angular_momentum").set_attr(hot->angular_momentum);
+    parent.add_child("alive_stat").set_attr(unsigned(hot->alive_stat));
     // write skin info
     xml_elem sk = parent.add_child("skin");
     sk.set_attr(skin_regioncode, "region");
@@ -559,6 +609,47 @@ void sea_object::save(xml_elem& parent) const
     parent.add_child("target").set_attr(target.id);
 }
 
+void sea_object::load(std::istream& in)
+{
+    // specfilename is read and checked by game, it is needed for construction
+    hot->position         = read_vector3(in);
+    hot->orientation      = read_quaternion(in);
+    hot->linear_momentum  = read_vector3(in);
+    hot->angular_momentum = read_vector3(in);
+    compute_helper_values();
+
+    skin_regioncode = read_string(in);
+    unsigned sc     = read_u8(in);
+    skin_country    = (sc < NR_OF_COUNTRIES) ? countrycode(sc) : UNKNOWNCOUNTRY;
+    skin_date       = date(read_u32(in));
+    skin_name       = compute_skin_name();
+    mymodel->register_layout(skin_name);
+
+    if (read_bool(in)) {
+        if (myai == nullptr) {
+            THROW(error, std::string("stored AI data for object without AI, type=") + specfilename);
+        }
+        myai->load(in);
+    }
+    target.id = read_u32(in);
+}
+
+void sea_object::save(std::ostream& out) const
+{
+    write_vector3(out, hot->position);
+    write_quaternion(out, hot->orientation);
+    write_vector3(out, hot->linear_momentum);
+    write_vector3(out, hot->angular_momentum);
+    write_string(out, skin_regioncode);
+    write_u8(out, uint8_t(skin_country));
+    write_u32(out, skin_date.get_time());
+    write_bool(out, myai != nullptr);
+    if (myai != nullptr) {
+        myai->save(out);
+    }
+    write_u32(out, target.id);
+}
+
 auto sea_object::get_description(unsigned detail) const -> string
 {
     // fixme use enum class for detail
@@ -588,6 +679,11 @@ void sea_object::simulate(double delta_time, game& gm)
     compress(visible_objects);
     compress(radar_objects);
 
+    // remember state before this step for interpolated rendering
+    hot->previous_position    = hot->position;
+    hot->previous_orientation = hot->orientation;
+    hot->previous_state_valid = true;
+
     // check for redection jobs and eventually (re)create list of detected
     // objects
     if (detect_other_sea_objects()) {
@@ -620,7 +716,7 @@ void sea_object::simulate(double delta_time, game& gm)
 
     // compute new position by integrating linear_momentum
     // M^-1 * P = v, linear_momentum is in world space!
-    position += linear_momentum * mass_inv * delta_time;
+    hot->position += hot->linear_momentum * mass_inv * delta_time;
 
     // compute new linear_momentum by integrating force
     // fixme: linear_momentum was object_local, so direction of linear_momentum
@@ -639,7 +735,7 @@ void sea_object::simulate(double delta_time, game& gm)
     // the combination is a new direction that points a bit sidewards - this is
     // how objects in a medium turn with their inertia. We have to program that
     // correctly
-    linear_momentum += delta_time * force;
+    hot->linear_momentum += delta_time * force;
 
     // compute new orientation by integrating angular momentum
     // L = I * w = R * I_k * R^T * w =>
@@ -662,7 +758,7 @@ void sea_object::simulate(double delta_time, game& gm)
     // 	std::cout << "torque=" << torque << " angular momentum=" <<
     // angular_momentum << "\n"; 	std::cout << "compute w, angular_momentum="
     // << angular_momentum << " inertiainv:\n";
-    vector3 w  = orientation.rotate(inertia_tensor_inv * orientation.conj().rotate(angular_momentum));
+    vector3 w  = hot->orientation.rotate(inertia_tensor_inv * hot->orientation.conj().rotate(hot->angular_momentum));
     vector3 w2 = w * delta_time;
     // 	std::cout << "update orientation, dt=" << delta_time << " w=" << w << "
     // w2=" << w2 << "\n"; unit of |w| is revolutions per time, that is
@@ -674,16 +770,16 @@ void sea_object::simulate(double delta_time, game& gm)
         // multiply orientation with q: combined rotation.
         // 		std::cout << "q=" << q << " orientation old=" << orientation << "
         // new=" << q * orientation << "\n";
-        orientation = q * orientation;
+        hot->orientation = q * hot->orientation;
         // we should renormalize orientation regularly, to avoid that
         // orientation isn't a valid rotation after many changes.
-        if (fabs(orientation.square_length() - 1.0) > 1e-8) {
-            orientation.normalize();
+        if (fabs(hot->orientation.square_length() - 1.0) > 1e-8) {
+            hot->orientation.normalize();
         }
     }
 
     // compute new angular momentum by integrating torque (both in world space)
-    angular_momentum += delta_time * torque;
+    hot->angular_momentum += delta_time * torque;
 
     // update helper variables
     compute_helper_values();
@@ -749,23 +845,23 @@ auto sea_object::calc_damage() const -> unsigned
 
 void sea_object::set_inactive()
 {
-    if (alive_stat == dead) {
+    if (hot->alive_stat == dead) {
         THROW(error, "illegal alive_stat switch (dead to inactive)");
     }
-    alive_stat = inactive;
+    hot->alive_stat = inactive;
 }
 
 #ifdef COD_MODE /* heehee */
 void sea_object::reanimate()
 {
     log_info("Cheater!");
-    alive_stat = alive;
+    hot->alive_stat = alive;
 }
 #endif // COD_MODE
 
 void sea_object::kill()
 {
-    alive_stat = dead;
+    hot->alive_stat = dead;
     // avoid that the AI accesses this object, so delete it
     myai = nullptr;
 }
@@ -777,21 +873,23 @@ auto sea_object::surface_visibility(const vector2& watcher) const -> float
 
 void sea_object::manipulate_position(const vector3& newpos)
 {
-    position = newpos;
+    hot->position             = newpos;
+    hot->previous_state_valid = false;
 }
 
 void sea_object::manipulate_speed(double localforwardspeed)
 {
-    local_velocity.y = localforwardspeed;
-    linear_momentum  = orientation.rotate(local_velocity * mass);
+    hot->local_velocity.y = localforwardspeed;
+    hot->linear_momentum  = hot->orientation.rotate(hot->local_velocity * mass);
     compute_helper_values();
 }
 
 void sea_object::manipulate_heading(angle hdg)
 {
-    orientation     = quaternion::rot(-hdg.value(), 0, 0, 1);
-    linear_momentum = orientation.rotate(local_velocity) * mass;
+    hot->orientation     = quaternion::rot(-hdg.value(), 0, 0, 1);
+    hot->linear_momentum = hot->orientation.rotate(hot->local_velocity) * mass;
     compute_helper_values();
+    hot->previous_state_valid = false;
 }
 
 // fixme: should move to ship or maybe return pos. airplanes have engines, but
@@ -801,24 +899,45 @@ auto sea_object::get_engine_noise_source() const -> vector2
     return get_pos().xy() - get_heading().direction() * 0.3F * get_length();
 }
 
-void sea_object::display(const texture* caustic_map) const
+auto sea_object::get_render_pos(double alpha) const -> vector3
+{
+    if (!hot->previous_state_valid) {
+        return hot->position;
+    }
+    return hot->previous_position + (hot->position - hot->previous_position) * alpha;
+}
+
+auto sea_object::get_render_orientation(double alpha) const -> quaternion
+{
+    if (!hot->previous_state_valid) {
+        return hot->orientation;
+    }
+    return quaternion::nlerp(hot->previous_orientation, hot->orientation, alpha);
+}
+
+void sea_object::display(const texture* caustic_map, unsigned lod) const
 {
     if (mymodel != nullptr) {
         //		cout << "render with skin layout = " << skin_name << "\n";
         mymodel->set_layout(skin_name); // hack, replace by new gpu stuff
-        mymodel->display(caustic_map);
+        mymodel->display(caustic_map, lod);
     }
 }
 
-void sea_object::display_mirror_clip() const
+void sea_object::display_mirror_clip(unsigned lod) const
 {
     if (mymodel != nullptr) {
         //		cout << "renderMC with skin layout = " << skin_name << "\n";
         mymodel->set_layout(skin_name); // hack, replace by new gpu stuff
-        mymodel->display_mirror_clip();
+        mymodel->display_mirror_clip(lod);
     }
 }
 
+auto sea_object::select_lod(double pixels_per_meter) const -> unsigned
+{
+    return (mymodel != nullptr) ? mymodel->select_lod(pixels_per_meter) : 0;
+}
+
 auto sea_object::get_sensor(sensor_system ss) -> sensor*
 {
     if (ss >= 0 && ss < last_sensor_system) {
@@ -837,6 +956,24 @@ auto sea_object::get_sensor(sensor_system ss) const -> const sensor*
     return nullptr;
 }
 
+auto sea_object::update_address() -> const sea_object*
+{
+    const sea_object* previous = checked_address;
+    checked_address            = this;
+    return previous != this ? previous : nullptr;
+}
+
+void sea_object::remap_detected_objects(const std::unordered_map<const sea_object*, const sea_object*>& moved)
+{
+    for (auto* objects : {&visible_objects, &radar_objects}) {
+        for (auto& obj : *objects) {
+            if (auto it = moved.find(obj); it != moved.end()) {
+                obj = it->second;
+            }
+        }
+    }
+}
+
 void sea_object::compress(std::vector<const sea_object*>& vec)
 {
     // this algorithm keeps the order of objects.
@@ -865,7 +1002,7 @@ auto sea_object::get_min_max_voxel_index_for_polyset(
     vector3i& vxmin,
     vector3i& vxmax) const -> unsigned
 {
-    quaternion cjq           = orientation.conj();
+    quaternion cjq           = hot->orientation.conj();
     matrix4f obj2voxel       = get_model().get_base_mesh_transformation().inverse();
     const vector3i& vres     = get_model().get_voxel_resolution();
     vector3i vidxmax         = vres - vector3i(1, 1, 1);
@@ -878,7 +1015,7 @@ auto sea_object::get_min_max_voxel_index_for_polyset(
         if (!p.empty()) {
             for (const auto& point : p.points) {
                 // transform point to voxel space
-                vector3f ptvx = obj2voxel * vector3f(cjq.rotate(point - position));
+                vector3f ptvx = obj2voxel * vector3f(cjq.rotate(point - hot->position));
 
                 // transform to voxel coordinate
                 vector3i v = vector3i(ptvx.coeff_mul(voxel_size_rcp) + voxel_pos_trans);
@@ -899,20 +1036,20 @@ auto sea_object::compute_linear_velocity(const vector3& p) const -> vector3
 {
     // result is v(t) + w(t) x r(t)  (linear velocity + omega cross relative
     // vector)
-    vector3 w = orientation.rotate(inertia_tensor_inv * orientation.conj().rotate(angular_momentum));
-    return velocity + w.cross(p - position);
+    vector3 w = hot->orientation.rotate(inertia_tensor_inv * hot->orientation.conj().rotate(hot->angular_momentum));
+    return hot->velocity + w.cross(p - hot->position);
 }
 
 auto sea_object::compute_collision_response_value(const vector3& collision_pos, const vector3& N) const -> double
 {
-    vector3 r = collision_pos - position;
-    return mass_inv + N * orientation.rotate(inertia_tensor_inv * orientation.conj().rotate(r.cross(N))).cross(r);
+    vector3 r = collision_pos - hot->position;
+    return mass_inv + N * hot->orientation.rotate(inertia_tensor_inv * hot->orientation.conj().rotate(r.cross(N))).cross(r);
 }
 
 void sea_object::apply_collision_impulse(const vector3& collision_pos, const vector3& J)
 {
-    vector3 r = collision_pos - position;
-    linear_momentum += J;
-    angular_momentum += r.cross(J);
+    vector3 r = collision_pos - hot->position;
+    hot->linear_momentum += J;
+    hot->angular_momentum += r.cross(J);
     compute_helper_values();
 }
@@ -34,9 +34,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "vector3.hpp"
 #include "xml.hpp"
 
+#include <iosfwd>
+#include <memory>
 #include <new>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 
 /*
 fixme: global todo (2004/06/26):
@@ -228,27 +231,60 @@ class sea_object
     // ---------------- rigid body variables, maybe group in extra class
     // ----------------
     //
-    vector3 position;           // position, [SAVE]
-    vector3 linear_momentum;    // l.m./impulse ("P") P = M * v [SAVE], world space!
-    quaternion orientation;     // orientation, [SAVE]
-    vector3 angular_momentum;   // angular momentum ("L") L = I * w = R * I_k *
-                                // R^T * w [SAVE], world space!
+    // position, orientation and momentum are part of the hot state, see below.
     double mass;                // total weight, later read from spec file (kg)
     double mass_inv;            // inverse of mass
     matrix3 inertia_tensor;     // object local (I_k). [could be a reference into a
                                 // model object...]
     matrix3 inertia_tensor_inv; // object local (I_k), inverse of inertia tensor.
 
-    // ------------- computed from rigid body variables ----------------
-    vector3 velocity;       // world space velocity
-    double turn_velocity;   // angular velocity around local z-axis (mathematical
-                            // CCW)
-    double pitch_velocity;  // angular velocity around local x-axis (mathematical
-                            // CCW)
-    double roll_velocity;   // angular velocity around local y-axis (mathematical
-                            // CCW)
-    angle heading;          // global z-orientation is stored additionally
-    vector3 local_velocity; // recomputed every frame by simulate() method
+    /// Simulation state that is read or written every step.
+    /** The hot states of all objects are allocated in blocks from one pool,
+        neighbouring objects get neighbouring states. Note that loops over the
+        objects still read the object itself for the virtual function table and
+        the hot pointer, so the split alone does not make sensor sweeps faster,
+        see tools/simbench.
+    */
+    struct hot_state
+    {
+        vector3 position;        // position, [SAVE]
+        vector3 velocity;        // world space velocity
+        vector3 local_velocity;  // recomputed every frame by simulate() method
+        quaternion orientation;  // orientation, [SAVE]
+        vector3 linear_momentum; // l.m./impulse ("P") P = M * v [SAVE], world space!
+        vector3 angular_momentum; // angular momentum ("L") L = I * w = R * I_k *
+                                  // R^T * w [SAVE], world space!
+
+        // ------------- computed from rigid body variables ----------------
+        double turn_velocity{0};  // angular velocity around local z-axis (mathematical
+                                  // CCW)
+        double pitch_velocity{0}; // angular velocity around local x-axis (mathematical
+                                  // CCW)
+        double roll_velocity{0};  // angular velocity around local y-axis (mathematical
+                                  // CCW)
+        angle heading;            // global z-orientation is stored additionally
+
+        /// Activity state of an object.
+        /// an object is alive until it is killed or inactive.
+        /// killed (dead) objects exists at least one simulation step. All other
+        /// objects must remove their pointers to an object, if it is dead. The next
+        /// step it is set to disfunctional status (defunct) and removed the next
+        /// step.
+        alive_status alive_stat{alive}; // [SAVE]
+
+        // ------------- state before last simulation step, for rendering ----------
+        bool previous_state_valid{false}; // false until first step or after teleport
+        vector3 previous_position;
+        quaternion previous_orientation;
+    };
+    class hot_state_pool;
+    struct hot_state_deleter
+    {
+        void operator()(hot_state* s) const;
+    };
+    static hot_state* allocate_hot_state();
+    /// hot state of this object, allocated from the pool
+    std::unique_ptr<hot_state, hot_state_deleter> hot{allocate_hot_state()};
 
     /// called in every simulation step. overload to specify force and torque,
     /// with drag already included.
@@ -262,14 +298,6 @@ class sea_object
     vector3f size3d; // computed from model, indirect read from spec file,
                      // width, length, height
 
-    /// Activity state of an object.
-    /// an object is alive until it is killed or inactive.
-    /// killed (dead) objects exists at least one simulation step. All other
-    /// objects must remove their pointers to an object, if it is dead. The next
-    /// step it is set to disfunctional status (defunct) and removed the next
-    /// step.
-    alive_status alive_stat; // [SAVE]
-
     /// Sensor systems, created after data in spec file
     std::vector<std::unique_ptr<sensor>> sensors;
 
@@ -307,6 +335,9 @@ class sea_object
     std::vector<const sea_object*> radar_objects;
     /// list of heared/sonar detected objects, recreated regularly
     std::vector<sonar_contact> sonar_objects;
+    /// address of the object at the last relocation check by class game. It is
+    /// moved along with the object, so it tells where the object was before.
+    const sea_object* checked_address{nullptr};
 
     virtual void set_sensor(sensor_system ss, std::unique_ptr<sensor>&& s);
 
@@ -334,6 +365,9 @@ class sea_object
 
     virtual void load(const xml_elem& parent);
     virtual void save(xml_elem& parent) const;
+    /// load/save state from/to binary savegame, see game::save_binary
+    virtual void load(std::istream& in);
+    virtual void save(std::ostream& out) const;
 
     // detail: 0 - category, 1 - finer category, >=2 - exact category
     [[nodiscard]] virtual std::string get_description(unsigned detail) const;
@@ -371,34 +405,34 @@ class sea_object
 
     [[nodiscard]] virtual bool is_dead() const
     {
-        return alive_stat == dead;
+        return hot->alive_stat == dead;
     }
     [[nodiscard]] virtual bool is_inactive() const
     {
-        return alive_stat == inactive;
+        return hot->alive_stat == inactive;
     }
     [[nodiscard]] virtual bool is_alive() const
     {
-        return alive_stat == alive;
+        return hot->alive_stat == alive;
     }
     [[nodiscard]] virtual bool is_reference_ok() const
     {
-        return alive_stat == alive || alive_stat == inactive;
+        return hot->alive_stat == alive || hot->alive_stat == inactive;
     }
 
     // command interface - no special commands for a generic sea_object
 
     [[nodiscard]] virtual const vector3& get_pos() const
     {
-        return position;
+        return hot->position;
     }
     [[nodiscard]] virtual const vector3& get_velocity() const
     {
-        return velocity;
+        return hot->velocity;
     }
     [[nodiscard]] virtual const vector3& get_local_velocity() const
     {
-        return local_velocity;
+        return hot->local_velocity;
     }
     [[nodiscard]] virtual double get_speed() const
     {
@@ -406,23 +440,23 @@ class sea_object
     }
     [[nodiscard]] virtual const quaternion& get_orientation() const
     {
-        return orientation;
+        return hot->orientation;
     }
     [[nodiscard]] virtual double get_turn_velocity() const
     {
-        return turn_velocity;
+        return hot->turn_velocity;
     }
     [[nodiscard]] virtual double get_pitch_velocity() const
     {
-        return pitch_velocity;
+        return hot->pitch_velocity;
     }
     [[nodiscard]] virtual double get_roll_velocity() const
     {
-        return roll_velocity;
+        return hot->roll_velocity;
     }
     [[nodiscard]] virtual double get_depth() const
     {
-        return -position.z;
+        return -hot->position.z;
     }
     [[nodiscard]] virtual float get_width() const
     {
@@ -439,7 +473,7 @@ class sea_object
     [[nodiscard]] virtual float surface_visibility(const vector2& watcher) const;
     [[nodiscard]] virtual angle get_heading() const
     {
-        return heading;
+        return hot->heading;
     }
     virtual class ai* get_ai()
     {
@@ -490,8 +524,17 @@ class sea_object
     }
     [[nodiscard]] virtual vector2 get_engine_noise_source() const;
 
-    virtual void display(const texture* caustic_map = nullptr) const;
-    virtual void display_mirror_clip() const;
+    /// position interpolated between last two simulation steps
+    ///@param alpha - interpolation factor, 0 = previous step, 1 = current
+    [[nodiscard]] vector3 get_render_pos(double alpha) const;
+    /// orientation interpolated between last two simulation steps
+    [[nodiscard]] quaternion get_render_orientation(double alpha) const;
+
+    virtual void display(const texture* caustic_map = nullptr, unsigned lod = 0) const;
+    virtual void display_mirror_clip(unsigned lod = 0) const;
+    /// select level of detail of the model by its screen size
+    ///@param pixels_per_meter - screen size of one meter at the object's distance
+    [[nodiscard]] unsigned select_lod(double pixels_per_meter) const;
     [[nodiscard]] double get_bounding_radius() const
     {
         return size3d.x + size3d.y;
@@ -514,6 +557,15 @@ class sea_object
         return sonar_objects;
     }
 
+    /// remember the current address of the object.
+    ///@returns the previous address if the object moved since the last call,
+    ///         nullptr otherwise or on the first call
+    const sea_object* update_address();
+    /// renew pointers in the lists of detected objects after class game moved
+    /// objects in memory
+    ///@param moved new address of moved objects by old address
+    void remap_detected_objects(const std::unordered_map<const sea_object*, const sea_object*>& moved);
+
     // check for a vector of pointers if the objects are still alive
     // and remove entries of dead objects (do not delete the objects itself!)
     // and compress the vector afterwars.
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "ship.hpp"
 
 #include "ai.hpp"
+#include "binstream.hpp"
 #include "constant.hpp"
 #include "date.hpp"
 #include "game.hpp"
@@ -78,6 +79,18 @@ void ship::generic_rudder::save(xml_elem& parent) const
     parent.set_attr(to_angle, "to_angle");
 }
 
+void ship::generic_rudder::load(std::istream& in)
+{
+    angle    = read_double(in);
+    to_angle = read_double(in);
+}
+
+void ship::generic_rudder::save(std::ostream& out) const
+{
+    write_double(out, angle);
+    write_double(out, to_angle);
+}
+
 auto ship::generic_rudder::compute_force_and_torque(
     vector3& F,
     vector3& T,
@@ -338,12 +351,40 @@ void ship::remember_position(double t)
     vector2 p = get_pos().xy();
     if (previous_positions.empty() || previous_positions.front().pos.square_distance(p) >= 25.0) {
         previous_positions.push_front(prev_pos(p, get_heading().direction(), t, get_speed()));
-        if (previous_positions.size() > TRAIL_LENGTH) {
-            previous_positions.pop_back();
-        }
     }
 }
 
+void ship::append_trail_strip(
+    const vector2& current_pos,
+    const ring_buffer<prev_pos>& trail,
+    const vector2& origin,
+    const vector2& scale,
+    std::vector<vector3f>& vertices,
+    std::vector<color>& colors)
+{
+    if (trail.empty()) {
+        return;
+    }
+    const auto n = unsigned(trail.size());
+    const vector3f start(origin.x + current_pos.x * scale.x, origin.y + current_pos.y * scale.y, 0);
+    if (!vertices.empty()) {
+        // invisible connection from the end of the previous trail
+        vertices.push_back(start);
+        colors.emplace_back(255, 255, 255, 0);
+    }
+    vertices.push_back(start);
+    colors.emplace_back(255, 255, 255, 255);
+    // alpha in 8.8 fixed point, fading to zero at the oldest position
+    const unsigned alpha_d = (255U << 8U) / n;
+    unsigned alpha         = 255U << 8U;
+    trail.for_each([&](const prev_pos& pp) {
+        alpha -= alpha_d;
+        vertices.emplace_back(origin.x + pp.pos.x * scale.x, origin.y + pp.pos.y * scale.y, 0);
+        colors.emplace_back(255, 255, 255, uint8_t(alpha >> 8U));
+    });
+    colors.back().a = 0;
+}
+
 auto ship::get_throttle_speed() const -> double
 {
     double ms = get_max_speed();
@@ -405,7 +446,7 @@ auto ship::screw_cavitation() const -> bool
 
 auto ship::bearing_and_range_to(const sea_object* other) const -> pair<angle, double>
 {
-    vector2 diff = other->get_pos().xy() - position.xy();
+    vector2 diff = other->get_pos().xy() - hot->position.xy();
     return make_pair(angle(diff), diff.length());
 }
 
@@ -436,7 +477,7 @@ void ship::load(const xml_elem& parent)
     }
 
     // fixme load that
-    // list<prev_pos> previous_positions;
+    // ring_buffer<prev_pos> previous_positions;
     // class particle* myfire;
 
     // fixme: load per gun data
@@ -512,7 +553,7 @@ void ship::save(xml_elem& parent) const
     esink.add_child_text(foss.str());
 
     // fixme save that
-    // list<prev_pos> previous_positions;
+    // ring_buffer<prev_pos> previous_positions;
     // class particle* myfire;
 
     // fixme: save per gun data
@@ -556,6 +597,46 @@ void ship::save(xml_elem& parent) const
 #endif
 }
 
+void ship::load(std::istream& in)
+{
+    sea_object::load(in);
+    tonnage  = read_u32(in);
+    throttle = read_i32(in);
+    rudder.load(in);
+    head_to_fixed  = head_to_param(read_u8(in));
+    head_to        = angle(read_double(in));
+    bow_damage     = damage_status(read_u8(in));
+    midship_damage = damage_status(read_u8(in));
+    stern_damage   = damage_status(read_u8(in));
+    fuel_level     = read_double(in);
+    flooding_speed = read_double(in);
+    if (read_u32(in) != flooded_mass.size()) {
+        THROW(error, std::string("number of compartments does not match, type=") + specfilename);
+    }
+    for (float& flooded_mas : flooded_mass) {
+        flooded_mas = read_float(in);
+    }
+}
+
+void ship::save(std::ostream& out) const
+{
+    sea_object::save(out);
+    write_u32(out, tonnage);
+    write_i32(out, throttle);
+    rudder.save(out);
+    write_u8(out, uint8_t(head_to_fixed));
+    write_double(out, head_to.value());
+    write_u8(out, uint8_t(bow_damage));
+    write_u8(out, uint8_t(midship_damage));
+    write_u8(out, uint8_t(stern_damage));
+    write_double(out, fuel_level);
+    write_double(out, flooding_speed);
+    write_u32(out, unsigned(flooded_mass.size()));
+    for (float flooded_mas : flooded_mass) {
+        write_float(out, flooded_mas);
+    }
+}
+
 void ship::simulate(double delta_time, game& gm)
 {
     if (!is_reference_ok()) {
@@ -631,7 +712,7 @@ void ship::simulate(double delta_time, game& gm)
             flooded_mass[i] += delta_time * flooding_speed * voxdat[i].relative_volume * flooding_volume_rcp;
             totally_flooded += flooded_mass[i];
         }
-        if (position.z < -200) { // used for ships.
+        if (hot->position.z < -200) { // used for ships.
             kill();
         }
         throttle = stop;
@@ -647,12 +728,12 @@ void ship::simulate(double delta_time, game& gm)
     }
 
     if (causes_spray()) {
-        double v = velocity.length();
+        double v = hot->velocity.length();
         if (v > 0.1) {
             double produce_time = 2.0 / v;
             double t            = helper::mod(gm.get_time(), produce_time);
             if (t + delta_time >= produce_time) {
-                vector3 forward  = velocity.normal();
+                vector3 forward  = hot->velocity.normal();
                 vector3 sideward = forward.cross(vector3(0, 0, 1)).normal() * 2.0; // speed 2.0 m/s
                 vector3 spawnpos = get_pos() + forward * (get_length() * 0.5);
                 gm.spawn(std::make_unique<spray_particle>(spawnpos, sideward));
@@ -678,7 +759,7 @@ void ship::simulate(double delta_time, game& gm)
                 std::unique_ptr<particle> p = nullptr;
                 // handle orientation here!
                 // maybe add some random offset, but it don't seems necessary
-                vector3 ppos = position + orientation.rotate(it.second);
+                vector3 ppos = hot->position + hot->orientation.rotate(it.second);
                 switch (it.first) {
                     case 1:
                         p = std::make_unique<smoke_particle>(ppos);
@@ -737,7 +818,7 @@ void ship::steering_logic()
     // rudder to full angle and turn. But only if demanded by special
     // head_to_fixed value.
     if ((head_to_fixed & HEAD_TO_FORCE_DIRECTION) != 0) {
-        if (heading.diff_in_direction((head_to_fixed & HEAD_TO_LEFT) != 0, head_to) >= 180.0) {
+        if (hot->heading.diff_in_direction((head_to_fixed & HEAD_TO_LEFT) != 0, head_to) >= 180.0) {
             double rudderval = (head_to_fixed & HEAD_TO_ALLOW_HARD_RUDDER) != 0 ? 1.0 : 0.5;
             rudder.set_to((head_to_fixed & HEAD_TO_LEFT) != 0 ? -rudderval : rudderval);
             return;
@@ -760,10 +841,10 @@ void ship::steering_logic()
        tuning of a, b, c. Their values depend on maximum turn speed.
        The following (experimentally gained) formulas give good results.
     */
-    double anglediff = (head_to - heading).value_pm180();
+    double anglediff = (head_to - hot->heading).value_pm180();
     double error0    = anglediff;
-    double error1    = (rudder.max_angle / rudder.max_turn_speed) * turn_velocity * 1.0;
-    double error2    = rudder.angle / rudder.max_turn_speed * turn_velocity * 0.1;
+    double error1    = (rudder.max_angle / rudder.max_turn_speed) * hot->turn_velocity * 1.0;
+    double error2    = rudder.angle / rudder.max_turn_speed * hot->turn_velocity * 0.1;
     double error     = error0 + error1 + error2;
     // DBGOUT7(anglediff, turn_velocity, rudder_pos, error0, error1, error2,
     // error);
@@ -821,7 +902,7 @@ auto ship::damage(const vector3& fromwhere, unsigned strength, game& gm) -> bool
     // use a 10m radius, and torps have atm 100 hitpoints, so radius=strength/10
     vector3 relpos = fromwhere - get_pos();
     // rotate relative position to object space
-    vector3f objrelpos = orientation.conj().rotate(relpos);
+    vector3f objrelpos = hot->orientation.conj().rotate(relpos);
     // log_debug("DAMAGE! relpos="<<relpos << " objrelpos="<<objrelpos);
     vector<unsigned> voxlist = mymodel->get_voxels_within_sphere(objrelpos, strength / 10.0);
     for (unsigned int i : voxlist) {
@@ -921,7 +1002,7 @@ void ship::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
     const float voxel_vol        = voxel_size.x * voxel_size.y * voxel_size.z * volume_scale;
     const double voxel_vol_force = voxel_vol * constant::GRAVITY * 1000.0; // 1000kg per cubic meter
     const matrix4f transmat =
-        orientation.rotmat4() * mymodel->get_base_mesh_transformation() * matrix4f::diagonal(voxel_size);
+        hot->orientation.rotmat4() * mymodel->get_base_mesh_transformation() * matrix4f::diagonal(voxel_size);
     double vol_below_water     = 0;
     const double gravity_force = mass * -constant::GRAVITY;
     // fixme: split loop to two cores to speed up physics a tiny bit
@@ -941,9 +1022,9 @@ void ship::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
         vector3f p = transmat.mul4vec3xlat(voxel_data[i].relative_position);
         // std::cout << "i=" << i << " voxeldata " <<
         // voxel_data[i].relative_position << " p=" << p << "\n";
-        float wh = gm.compute_water_height(vector2(position.x + p.x, position.y + p.y));
+        float wh = gm.compute_water_height(vector2(hot->position.x + p.x, hot->position.y + p.y));
         // std::cout << "i=" << i << " p=" << p << " wh=" << wh << "\n";
-        double voxel_below_water = std::max(std::min((p.z + position.z - wh) / voxel_radius, 1.0), -1.0);
+        double voxel_below_water = std::max(std::min((p.z + hot->position.z - wh) / voxel_radius, 1.0), -1.0);
         if (voxel_below_water < 1.0 /*p.z + position.z < wh*/) {
             // voxels partly below water must be computed or torque is severely
             // wrong
@@ -991,25 +1072,25 @@ void ship::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
     // mass) = accel Power: engine Power (kWatts), rpm (screw turns per second),
     // mass (ship's mass) SubVIIc: ~3500kW, rad=0.5m, rpm=2 (?), mass=750000kg
     // -> acc=4,666. a bit much...
-    vector3 local_velocity2 = local_velocity.coeff_mul(local_velocity.abs());
+    vector3 local_velocity2 = hot->local_velocity.coeff_mul(hot->local_velocity.abs());
 
     // fixme: add linear drag caused by hull skin friction here!
-    if (fabs(local_velocity.y) < 1.0) {
-        local_velocity2.y = local_velocity.y * max_speed_forward;
+    if (fabs(hot->local_velocity.y) < 1.0) {
+        local_velocity2.y = hot->local_velocity.y * max_speed_forward;
     }
 
     vector3 Fr;
     vector3 Tr;
     double flowforce = get_throttle_accel() * mass;
     double finalflowforce =
-        rudder.compute_force_and_torque(Fr, Tr, local_velocity, constant::SEA_WATER_DENSITY, flowforce);
+        rudder.compute_force_and_torque(Fr, Tr, hot->local_velocity, constant::SEA_WATER_DENSITY, flowforce);
     Fr.y += finalflowforce;
 
     const vector3 drag_factors(1.0, max_accel_forward / (max_speed_forward * max_speed_forward), 0.2);
     Fr -= local_velocity2.coeff_mul(drag_factors) * mass;
 
     // force is in world space
-    F = orientation.rotate(Fr);
+    F = hot->orientation.rotate(Fr);
 
     // Note! drag should be computed for all three dimensions, each with area,
     // to limit sideward/downward movement as well. We need to know the area
@@ -1057,7 +1138,7 @@ void ship::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
     const double drag_coefficient = get_turn_drag_coeff();
     // compute turn velocities around the 3 axes (local)
     // w.xyz is turn velocity around xyz axis.
-    vector3 w = inertia_tensor_inv * orientation.conj().rotate(angular_momentum);
+    vector3 w = inertia_tensor_inv * hot->orientation.conj().rotate(hot->angular_momentum);
     vector3 tvr(fabs(w.x), fabs(w.y), fabs(w.z));
     vector3 tvr2 = tvr.coeff_mul(tvr);
     /*
@@ -1086,7 +1167,7 @@ void ship::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
     }
 
     // positive torque turns counter clockwise! torque is in world space!
-    T = orientation.rotate(local_torque + Tr) + dr_torque;
+    T = hot->orientation.rotate(local_torque + Tr) + dr_torque;
     // log_debug("Torque, local="<<local_torque<<"  Tr="<<Tr<<"
     // dr_tq="<<dr_torque);
 
@@ -1135,7 +1216,7 @@ auto ship::fire_shell_at(const vector2& pos, game& gm) -> ship::gun_status
                         }
 
                         if (GUN_FIRED == res) {
-                            if (!is_target_in_blindspot(gun, heading - direction)) {
+                            if (!is_target_in_blindspot(gun, hot->heading - direction)) {
                                 // initial angle: estimate distance and fire,
                                 // remember angle next shots: adjust angle after
                                 // distance fault:
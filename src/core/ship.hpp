@@ -23,9 +23,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include "bv_tree.hpp"
+#include "color.hpp"
+#include "ring_buffer.hpp"
 #include "sea_object.hpp"
 
 #include <map>
+#include <vector>
 
 class game;
 
@@ -89,10 +92,11 @@ class ship : public sea_object
     // all data for a previous position
     struct prev_pos
     {
-        vector2 pos;  // (center) pos of ship
-        vector2 dir;  // direction (heading) of ship
-        double time;  // absolute time when position was recorded
-        double speed; // speed of ship when position was recorded
+        vector2 pos;     // (center) pos of ship
+        vector2 dir;     // direction (heading) of ship
+        double time{0};  // absolute time when position was recorded
+        double speed{0}; // speed of ship when position was recorded
+        prev_pos() = default;
         prev_pos(const vector2& p, const vector2& d, double t, double s)
             : pos(p)
             , dir(d)
@@ -138,6 +142,8 @@ class ship : public sea_object
         void simulate(double delta_time);
         void load(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        void load(std::istream& in);
+        void save(std::ostream& out) const;
         void set_to(double p) { to_angle = max_angle * p; } ///< -1 ... 1
         void midships() { to_angle = 0; }
         [[nodiscard]] double deflect_factor() const; ///< sin(angle)
@@ -186,7 +192,8 @@ class ship : public sea_object
     // sonar / underwater sound specific constants, read from spec file
     noise_signature noise_sign;
 
-    std::list<prev_pos> previous_positions;
+    /// trail, newest position first, no allocations after creation
+    ring_buffer<prev_pos> previous_positions{TRAIL_LENGTH};
 
     shipclass myclass; // read from spec file, e.g. warship/merchant/escort/...
 
@@ -322,6 +329,8 @@ class ship : public sea_object
 
     void load(const xml_elem& parent) override;
     void save(xml_elem& parent) const override;
+    void load(std::istream& in) override;
+    void save(std::ostream& out) const override;
 
     [[nodiscard]] virtual shipclass get_class() const { return myclass; }
 
@@ -348,7 +357,20 @@ class ship : public sea_object
     virtual void set_throttle(int thr);
 
     virtual void remember_position(double t);
-    [[nodiscard]] virtual const std::list<prev_pos>& get_previous_positions() const { return previous_positions; }
+    [[nodiscard]] virtual const ring_buffer<prev_pos>& get_previous_positions() const { return previous_positions; }
+
+    /// Append the trail to a line strip, to draw trails of many ships at once.
+    /// Vertices go from the current position over the recorded ones, placed at
+    /// origin + p * scale (per component), with alpha fading to zero towards
+    /// the oldest position. Trails are joined by invisible lines, so blending
+    /// must be enabled.
+    static void append_trail_strip(
+        const vector2& current_pos,
+        const ring_buffer<prev_pos>& trail,
+        const vector2& origin,
+        const vector2& scale,
+        std::vector<vector3f>& vertices,
+        std::vector<color>& colors);
 
     [[nodiscard]] virtual bool has_smoke() const { return !smoke.empty(); }
 
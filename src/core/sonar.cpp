@@ -234,6 +234,158 @@ auto noise::determine_shipclass() const -> shipclass
     return myclass;
 }
 
+auto get_GHG_response_tables() -> const std::array<angular_table<double>, noise::NR_OF_FREQUENCY_BANDS>&
+{
+    // the response peak is narrow for high frequencies (half width 4 degrees at
+    // band 3), so use 0.1 degree steps to keep the interpolation error small.
+    static const unsigned nr_of_angles = 3600;
+    static const auto tables           = []() {
+        std::array<angular_table<double>, noise::NR_OF_FREQUENCY_BANDS> result;
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+            std::vector<double> values(nr_of_angles);
+            for (unsigned i = 0; i < nr_of_angles; ++i) {
+                values[i] = compute_signal_strength_GHG(
+                    angle(360.0 * i / nr_of_angles), noise::typical_frequency[b], angle(0.0));
+            }
+            result[b] = angular_table<double>(std::move(values));
+        }
+        return result;
+    }();
+    return tables;
+}
+
+void add_GHG_signals(noise& n, const std::vector<received_noise>& sources, angle rel_listening_dir)
+{
+    const auto& response     = get_GHG_response_tables();
+    bool listen_to_starboard = (rel_listening_dir.value_pm180() >= 0);
+    for (const auto& src : sources) {
+        // check if noise is on active side of phones
+        if (src.starboard == listen_to_starboard) {
+            const angle rel_angle = src.rel_direction - rel_listening_dir;
+            for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+                n.frequencies[b] += src.strength.frequencies[b] * response[b].get(rel_angle);
+            }
+        }
+    }
+}
+
+auto compute_GHG_signal(const noise& n) -> std::pair<double, noise>
+{
+    // now compute back to dB, quantize to integer dB values, to
+    // simulate shadowing of weak signals by background noise
+    // divide by receiver sensitivity before doing so, to avoid cutting off weak
+    // signals.
+    const double GHG_receiver_sensitivity_dB = -3; // weakest signal strength to be detectable
+    double abs_strength = floor(std::max(n.compute_total_noise_strength_dB() - GHG_receiver_sensitivity_dB, 0.0))
+                          + GHG_receiver_sensitivity_dB;
+    return std::make_pair(abs_strength, n.to_dB());
+}
+
+namespace {
+/// GHG response of a band sampled at the spectrum's bearings, centered
+struct GHG_response_kernel
+{
+    unsigned half_width{0};
+    std::vector<double> values; // 2 * half_width + 1 values
+};
+
+auto get_GHG_response_kernels() -> const std::array<GHG_response_kernel, noise::NR_OF_FREQUENCY_BANDS>&
+{
+    // The response falls off quickly with higher frequencies, so cut off the
+    // kernel where it drops below 1e-30. Even the loudest sources (200 dB =
+    // 1e20) then give less than the noise floor of 1e-10.
+    static const double min_response = 1e-30;
+    static const auto kernels        = []() {
+        std::array<GHG_response_kernel, noise::NR_OF_FREQUENCY_BANDS> result;
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+            auto& k = result[b];
+            while (k.half_width < sonar_spectrum::nr_of_bearings / 4) {
+                const angle a(360.0 * (k.half_width + 1) / sonar_spectrum::nr_of_bearings);
+                if (compute_signal_strength_GHG(a, noise::typical_frequency[b], angle(0.0)) < min_response) {
+                    break;
+                }
+                ++k.half_width;
+            }
+            k.values.resize(2 * k.half_width + 1);
+            for (unsigned i = 0; i < k.values.size(); ++i) {
+                const angle a(360.0 * (double(i) - k.half_width) / sonar_spectrum::nr_of_bearings);
+                k.values[i] = compute_signal_strength_GHG(a, noise::typical_frequency[b], angle(0.0));
+            }
+        }
+        return result;
+    }();
+    return kernels;
+}
+} // namespace
+
+void sonar_spectrum::compute(const noise& own_noise, const std::vector<received_noise>& sources)
+{
+    const unsigned n = nr_of_bearings;
+    // distribute sources linearly to the two nearest bins of their side
+    for (auto& side : bins) {
+        for (auto& b : side) {
+            b.assign(n, 0.0);
+        }
+    }
+    for (const auto& src : sources) {
+        auto& side              = bins[src.starboard ? 0 : 1];
+        const double exact_bin  = src.rel_direction.value() * n / 360.0;
+        const auto i0           = unsigned(exact_bin) % n;
+        const auto i1           = (i0 + 1) % n;
+        const double f          = helper::frac(exact_bin);
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+            side[b][i0] += src.strength.frequencies[b] * (1.0 - f);
+            side[b][i1] += src.strength.frequencies[b] * f;
+        }
+    }
+    // convolve bins with response, only a listening direction on the same
+    // side as the source receives its noise
+    const auto& kernels = get_GHG_response_kernels();
+    for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+        const auto& k = kernels[b];
+        spectrum[b].resize(n);
+        for (unsigned s = 0; s < 2; ++s) {
+            auto& c = convolved[s];
+            c.assign(n + 2 * k.half_width, 0.0);
+            const auto& side_bins = bins[s][b];
+            // scatter each non-empty bin, so few sources are cheap
+            for (unsigned j = 0; j < n; ++j) {
+                const double w = side_bins[j];
+                if (w != 0.0) {
+                    double* dst = &c[j];
+                    for (unsigned i = 0; i < k.values.size(); ++i) {
+                        dst[i] += w * k.values[i];
+                    }
+                }
+            }
+            // wrap around both ends
+            for (unsigned i = 0; i < k.half_width; ++i) {
+                c[n + i] += c[i];
+                c[k.half_width + i] += c[n + k.half_width + i];
+            }
+        }
+        for (unsigned i = 0; i < n; ++i) {
+            // bearings up to 180 degrees are starboard
+            const unsigned s = (2 * i <= n) ? 0 : 1;
+            spectrum[b][i]   = own_noise.frequencies[b] + convolved[s][k.half_width + i];
+        }
+    }
+}
+
+auto sonar_spectrum::get_noise(angle rel_listening_dir) const -> noise
+{
+    const unsigned n       = nr_of_bearings;
+    const double exact_bin = rel_listening_dir.value() * n / 360.0;
+    const auto i0          = unsigned(exact_bin) % n;
+    const auto i1          = (i0 + 1) % n;
+    const double f         = helper::frac(exact_bin);
+    noise result;
+    for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+        result.frequencies[b] = helper::interpolate(spectrum[b][i0], spectrum[b][i1], f);
+    }
+    return result;
+}
+
 // translated from python script, refine later
 auto compute_signal_strength_GHG(angle signal_angle, double frequency, angle apparatus_angle) -> double
 {
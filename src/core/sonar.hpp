@@ -21,8 +21,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 // subsim (C) + (W). See LICENSE
 
 #include "angle.hpp"
+#include "angular_table.hpp"
 #include "vector3.hpp"
 
+#include <array>
+#include <utility>
 #include <vector>
 
 #pragma once
@@ -198,3 +201,58 @@ struct noise_signature
 
 // move to a GHG class later, fixme
 double compute_signal_strength_GHG(angle signal_angle, double frequency, angle apparatus_angle);
+
+///\brief Directional response of the GHG for the typical frequency of each band
+/** Tables are indexed by signal angle minus apparatus angle and computed once
+    with compute_signal_strength_GHG, so evaluating them is a lookup instead of a pow.
+*/
+const std::array<angular_table<double>, noise::NR_OF_FREQUENCY_BANDS>& get_GHG_response_tables();
+
+///\brief Noise of one source as received by a listener, independent of listening direction
+struct received_noise
+{
+    angle rel_direction; // direction to source relative to listener's heading
+    bool starboard;      // wether source is on starboard side of listener
+    noise strength;      // propagated noise strength, flat, not in dB
+};
+
+///\brief add noise of all sources on the listening side weighted by GHG response
+void add_GHG_signals(noise& n, const std::vector<received_noise>& sources, angle rel_listening_dir);
+
+///\brief compute signal strength in dB as heard by the GHG and received noise in dB
+/** @param	n	received noise, flat, not in dB
+    @return	absolute strength in dB, quantized by receiver sensitivity, and noise in dB
+*/
+std::pair<double, noise> compute_GHG_signal(const noise& n);
+
+///\brief Noise received by a listener for all bearings of the GHG at once
+/** Sources are distributed to bearing bins per side of the listener, and the
+    bins are convolved with the GHG response of each band. A full sweep thus
+    costs O(sources + bins * response width) instead of O(sources * bearings).
+*/
+class sonar_spectrum
+{
+  public:
+    /// number of bearings in the spectrum, 0.5 degree steps
+    static const unsigned nr_of_bearings = 720;
+
+    ///\brief compute spectrum from listener's own noise and received noise of sources
+    void compute(const noise& own_noise, const std::vector<received_noise>& sources);
+
+    ///\brief get received noise for a listening direction, flat, not in dB
+    [[nodiscard]] noise get_noise(angle rel_listening_dir) const;
+
+    ///\brief get signal strength and noise in dB for a listening direction, like game::sonar_listen_ships
+    [[nodiscard]] std::pair<double, noise> get_signal(angle rel_listening_dir) const
+    {
+        return compute_GHG_signal(get_noise(rel_listening_dir));
+    }
+
+  protected:
+    // received noise per band and bearing, relative to listener's heading
+    std::array<std::vector<double>, noise::NR_OF_FREQUENCY_BANDS> spectrum;
+    // source noise per side (starboard, port), band and bearing bin
+    std::array<std::array<std::vector<double>, noise::NR_OF_FREQUENCY_BANDS>, 2> bins;
+    // convolution result per side, with room for the response width on both ends
+    std::array<std::vector<double>, 2> convolved;
+};
@@ -84,7 +84,8 @@ void sonar_operator::simulate(game& gm, double delta_t)
     auto* player               = dynamic_cast<submarine*>(gm.get_player());
     angle sub_heading          = player->get_heading();
     double sub_turn_velocity   = -player->get_turn_velocity();
-    pair<double, noise> signal = gm.sonar_listen_ships(player, current_angle);
+    // the spectrum is shared with the sonar displays, so sampling it is cheap
+    pair<double, noise> signal = gm.sonar_listen_all_directions(player).get_signal(current_angle);
 
     // fixme: use integer dB values for simulation? we round to dB anyway!
     // 	printf("sonar man sim, angle=%f str=%f stat=%i\n",
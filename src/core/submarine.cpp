@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "submarine.hpp"
 
+#include "binstream.hpp"
 #include "constant.hpp"
 #include "date.hpp"
 #include "depth_charge.hpp"
@@ -151,6 +152,35 @@ void submarine::stored_torpedo::save(xml_elem& parent) const
     parent.set_attr(addleadangle.value(), "addleadangle");
 }
 
+void submarine::stored_torpedo::load(std::istream& in)
+{
+    specfilename = read_string(in);
+    if (read_bool(in)) {
+        setup.load(in);
+    } else {
+        setup = torpedo::setup_data();
+    }
+    temperature    = read_double(in);
+    status         = st_status(read_u8(in));
+    associated     = read_u32(in);
+    remaining_time = read_double(in);
+    addleadangle   = angle(read_double(in));
+}
+
+void submarine::stored_torpedo::save(std::ostream& out) const
+{
+    write_string(out, specfilename);
+    write_bool(out, status != st_empty);
+    if (status != st_empty) {
+        setup.save(out);
+    }
+    write_double(out, temperature);
+    write_u8(out, uint8_t(status));
+    write_u32(out, associated);
+    write_double(out, remaining_time);
+    write_double(out, addleadangle.value());
+}
+
 submarine::tank::tank(xml_elem e)
     : type(ballast)
     , volume(e.attrf("volume"))
@@ -201,6 +231,18 @@ void submarine::tank::save(xml_elem& parent) const
     parent.set_attr(flood_valve_open, "flood_valve_open");
 }
 
+void submarine::tank::load(std::istream& in)
+{
+    fill             = read_double(in);
+    flood_valve_open = read_bool(in);
+}
+
+void submarine::tank::save(std::ostream& out) const
+{
+    write_double(out, fill);
+    write_bool(out, flood_valve_open);
+}
+
 submarine::submarine(date game_date, object_store<model>& model_store, const xml_elem& parent)
     : ship(game_date, model_store, parent)
     , max_depth(0)
@@ -406,6 +448,65 @@ void submarine::save(xml_elem& parent) const
     sonar_operator::save(parent);
 }
 
+void submarine::load(std::istream& in)
+{
+    ship::load(in);
+    max_depth      = read_double(in);
+    dive_to        = read_double(in);
+    permanent_dive = read_bool(in);
+    dive_state     = dive_states(read_u8(in));
+    bow_depth_rudder.load(in);
+    stern_depth_rudder.load(in);
+
+    torpedoes.clear();
+    torpedoes.resize(read_u32(in));
+    for (auto& torpedoe : torpedoes) {
+        torpedoe.load(in);
+    }
+
+    scope_raise_level = scope_raise_to_level = read_float(in);
+    electric_engine                          = read_bool(in);
+    snorkelup                                = read_bool(in);
+    battery_level                            = read_double(in);
+
+    if (read_u32(in) != tanks.size()) {
+        THROW(error, std::string("number of tanks does not match, type=") + specfilename);
+    }
+    for (auto& tank : tanks) {
+        tank.load(in);
+    }
+
+    TDC.load(in);
+}
+
+void submarine::save(std::ostream& out) const
+{
+    ship::save(out);
+    write_double(out, max_depth);
+    write_double(out, dive_to);
+    write_bool(out, permanent_dive);
+    write_u8(out, uint8_t(dive_state));
+    bow_depth_rudder.save(out);
+    stern_depth_rudder.save(out);
+
+    write_u32(out, unsigned(torpedoes.size()));
+    for (const auto& torpedoe : torpedoes) {
+        torpedoe.save(out);
+    }
+
+    write_float(out, scope_raise_level);
+    write_bool(out, electric_engine);
+    write_bool(out, snorkelup);
+    write_double(out, battery_level);
+
+    write_u32(out, unsigned(tanks.size()));
+    for (const auto& tank : tanks) {
+        tank.save(out);
+    }
+
+    TDC.save(out);
+}
+
 void submarine::transfer_torpedo(unsigned from, unsigned to)
 {
     // fixme: it once crashed here... check from/to for limits?
@@ -487,7 +588,7 @@ void submarine::simulate(double delta_time, game& gm)
     bow_depth_rudder.simulate(delta_time);
     stern_depth_rudder.simulate(delta_time);
 
-    if (-position.z > max_depth) {
+    if (-hot->position.z > max_depth) {
         kill();
     }
 
@@ -510,13 +611,13 @@ void submarine::simulate(double delta_time, game& gm)
             }
             break;
         case dive_state_diving:
-            if (dive_to > -1.0 && position.z > -2.0) {
+            if (dive_to > -1.0 && hot->position.z > -2.0) {
                 electric_engine = false;
                 dive_state      = dive_state_surfaced;
             }
             break;
         case dive_state_crashdive:
-            if (position.z < -alarm_depth * 0.8) {
+            if (hot->position.z < -alarm_depth * 0.8) {
                 dive_state = dive_state_diving;
             }
             break;
@@ -985,7 +1086,7 @@ void submarine::set_planes_to(double amount, game& gm)
     } else if (fabs(amount) < 0.001) {
         // planes at midships, stop depth change
         permanent_dive = false;
-        dive_to        = position.z;
+        dive_to        = hot->position.z;
     }
 
     if (dive_state == dive_state_crashdive) {
@@ -1058,14 +1159,14 @@ void submarine::depth_steering_logic()
         default:
             break;
     }
-    double depthdiff = position.z - target_depth;
+    double depthdiff = hot->position.z - target_depth;
     double error0    = depthdiff;
     double error1    = (bow_depth_rudder.max_angle / bow_depth_rudder.max_turn_speed
                      + stern_depth_rudder.max_angle / stern_depth_rudder.max_turn_speed)
-                    * local_velocity.z * 1.0;
+                    * hot->local_velocity.z * 1.0;
     double error2 = (bow_depth_rudder.angle / bow_depth_rudder.max_turn_speed
                      + stern_depth_rudder.angle / stern_depth_rudder.max_turn_speed)
-                    * local_velocity.z * 0.1;
+                    * hot->local_velocity.z * 0.1;
     double error = error0 + error1 + error2;
     // DBGOUT7(anglediff, turn_velocity, rudder_pos, error0, error1, error2,
     // error);
@@ -1292,7 +1393,7 @@ auto submarine::launch_torpedo(int tubenr, const vector3& targetpos, game& gm) -
     // check if torpedo can be fired with that tube, if yes, then fire it
     // cout << "sol valid? " << TDC.solution_valid() << "\n";
     if (TDC.solution_valid()) {
-        angle fired_at_angle = usebowtubes ? heading : heading + angle(180);
+        angle fired_at_angle = usebowtubes ? hot->heading : hot->heading + angle(180);
         angle torp_head_to   = TDC.get_lead_angle() + TDC.get_parallax_angle();
         // cout << "fired at " << fired_at_angle.value() << ", head to " <<
         // torp_head_to.value() << ", is cw nearer " <<
@@ -1304,7 +1405,7 @@ auto submarine::launch_torpedo(int tubenr, const vector3& targetpos, game& gm) -
         torp.head_to_course(torp_head_to, fired_at_angle.is_clockwise_nearer(torp_head_to) ? 1 : -1);
         // just hand the torpedo object over to class game. tube is empty after
         // that...
-        vector3 torppos = position + (fired_at_angle.direction() * (get_length() / 2 + 5 /*5m extra*/)).xy0();
+        vector3 torppos = hot->position + (fired_at_angle.direction() * (get_length() / 2 + 5 /*5m extra*/)).xy0();
         torp.launch(torppos, fired_at_angle);
         gm.spawn(std::move(torp));
         torpedoes[tubenr].status = stored_torpedo::st_empty;
@@ -1346,14 +1447,14 @@ void submarine::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
     // log_debug("Fdr=" << Fdr << " Tdr=" << Tdr);
     Fdr.y += finalflowforce - flowforce;
 
-    F += orientation.rotate(Fdr);
-    T += orientation.rotate(Tdr);
+    F += hot->orientation.rotate(Fdr);
+    T += hot->orientation.rotate(Tdr);
 
     // add torque caused from tanks here, force is computed by modifying mass
     // in simulate()
     for (const auto& it : tanks) {
         double grav_force = it.get_fill() * constant::SEA_WATER_DENSITY * -constant::GRAVITY;
-        T += orientation.rotate(it.get_pos().cross(vector3(0, 0, grav_force)));
+        T += hot->orientation.rotate(it.get_pos().cross(vector3(0, 0, grav_force)));
     }
 }
 
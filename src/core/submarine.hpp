@@ -67,6 +67,8 @@ class submarine : public ship
         stored_torpedo(std::string type);
         void load(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        void load(std::istream& in);
+        void save(std::ostream& out) const;
     };
 
     enum hearing_device_type
@@ -214,6 +216,8 @@ class submarine : public ship
         tank(xml_elem e);
         void load(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        void load(std::istream& in);
+        void save(std::ostream& out) const;
         void simulate(double delta_time);
         void set_flood_valve(bool flood = true);
         /// put some air into the tank
@@ -264,6 +268,8 @@ class submarine : public ship
 
     void load(const xml_elem& parent) override;
     void save(xml_elem& parent) const override;
+    void load(std::istream& in) override;
+    void save(std::ostream& out) const override;
 
     void simulate(double delta_time, game& gm) override;
 
@@ -22,6 +22,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "tdc.hpp"
 
+#include "binstream.hpp"
+
 tdc::tdc()
 
     = default;
@@ -74,6 +76,52 @@ void tdc::save(xml_elem& parent) const
     t.set_attr(valid_solution, "valid_solution");
 }
 
+void tdc::load(std::istream& in)
+{
+    bearing_tracking         = read_bool(in);
+    angleonthebow_tracking   = read_bool(in);
+    auto_mode                = read_bool(in);
+    target_speed             = read_double(in);
+    target_distance          = read_double(in);
+    target_course            = angle(read_double(in));
+    target_bow_is_left       = read_bool(in);
+    angleonthebow            = angle(read_double(in));
+    torpedo_speed            = read_double(in);
+    torpedo_runlength        = read_double(in);
+    bearing                  = angle(read_double(in));
+    bearing_dial             = angle(read_double(in));
+    heading                  = angle(read_double(in));
+    parallaxangle            = angle(read_double(in));
+    additional_parallaxangle = angle(read_double(in));
+    lead_angle               = angle(read_double(in));
+    torpedo_runtime          = read_double(in);
+    compute_stern_tube       = read_bool(in);
+    valid_solution           = read_bool(in);
+}
+
+void tdc::save(std::ostream& out) const
+{
+    write_bool(out, bearing_tracking);
+    write_bool(out, angleonthebow_tracking);
+    write_bool(out, auto_mode);
+    write_double(out, target_speed);
+    write_double(out, target_distance);
+    write_double(out, target_course.value());
+    write_bool(out, target_bow_is_left);
+    write_double(out, angleonthebow.value());
+    write_double(out, torpedo_speed);
+    write_double(out, torpedo_runlength);
+    write_double(out, bearing.value());
+    write_double(out, bearing_dial.value());
+    write_double(out, heading.value());
+    write_double(out, parallaxangle.value());
+    write_double(out, additional_parallaxangle.value());
+    write_double(out, lead_angle.value());
+    write_double(out, torpedo_runtime);
+    write_bool(out, compute_stern_tube);
+    write_bool(out, valid_solution);
+}
+
 void tdc::simulate(double delta_t)
 {
     // turn bearing dial to set bearing, with max. 2.5 degrees per second
@@ -24,6 +24,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "xml.hpp"
 
+#include <iosfwd>
+
 ///\brief Simulation of the Torpedo Data Computer.
 class tdc
 {
@@ -31,7 +33,6 @@ class tdc
   private:
     tdc& operator=(const tdc& other) = delete;
     tdc(const tdc& other)            = delete;
-    tdc& operator=(tdc&&)            = delete;
 
   protected:
     // tracker switches
@@ -72,9 +73,12 @@ class tdc
 
   public:
     tdc();
-    tdc(tdc&&) = default;
+    tdc(tdc&&)            = default;
+    tdc& operator=(tdc&&) = default;
     void load(const xml_elem& parent);
     void save(xml_elem& parent) const;
+    void load(std::istream& in);
+    void save(std::ostream& out) const;
 
     void simulate(double delta_time);
 
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "torpedo.hpp"
 
+#include "binstream.hpp"
 #include "datadirs.hpp"
 #include "game.hpp"
 #include "global_data.hpp"
@@ -91,6 +92,30 @@ void torpedo::setup_data::save(xml_elem& parent) const
     parent.set_attr(preheating, "preheating");
 }
 
+void torpedo::setup_data::load(std::istream& in)
+{
+    primaryrange        = read_u32(in);
+    short_secondary_run = read_bool(in);
+    initialturn_left    = read_bool(in);
+    turnangle           = angle(read_double(in));
+    lut_angle           = angle(read_double(in));
+    torpspeed           = read_u32(in);
+    rundepth            = read_double(in);
+    preheating          = read_bool(in);
+}
+
+void torpedo::setup_data::save(std::ostream& out) const
+{
+    write_u32(out, primaryrange);
+    write_bool(out, short_secondary_run);
+    write_bool(out, initialturn_left);
+    write_double(out, turnangle.value());
+    write_double(out, lut_angle.value());
+    write_u32(out, torpspeed);
+    write_double(out, rundepth);
+    write_bool(out, preheating);
+}
+
 torpedo::torpedo(
     date game_date,
     date equipment_date,
@@ -319,6 +344,28 @@ void torpedo::save(xml_elem& parent) const
     rudder.save(ed);
 }
 
+void torpedo::load(std::istream& in)
+{
+    ship::load(in);
+    setup.load(in);
+    temperature                     = read_double(in);
+    probability_of_rundepth_failure = read_double(in);
+    run_length                      = read_double(in);
+    steering_device_phase           = read_u32(in);
+    dive_planes.load(in);
+}
+
+void torpedo::save(std::ostream& out) const
+{
+    ship::save(out);
+    setup.save(out);
+    write_double(out, temperature);
+    write_double(out, probability_of_rundepth_failure);
+    write_double(out, run_length);
+    write_u32(out, steering_device_phase);
+    dive_planes.save(out);
+}
+
 void torpedo::simulate(double delta_time, game& gm)
 {
     if (!is_reference_ok()) {
@@ -458,15 +505,15 @@ void torpedo::compute_force_and_torque(vector3& F, vector3& T, game& gm) const
     // log_debug("Fdr=" << Fdr << " Tdr=" << Tdr);
     Fdr.y += finalflowforce - flowforce;
 
-    F += orientation.rotate(Fdr);
-    T += orientation.rotate(Tdr);
+    F += hot->orientation.rotate(Fdr);
+    T += hot->orientation.rotate(Tdr);
 }
 
 void torpedo::depth_steering_logic()
 {
-    double depthdiff = position.z - (-setup.rundepth);
+    double depthdiff = hot->position.z - (-setup.rundepth);
     double error0    = depthdiff;
-    double error1    = dive_planes.max_angle / dive_planes.max_turn_speed * local_velocity.z * 1.0;
+    double error1    = dive_planes.max_angle / dive_planes.max_turn_speed * hot->local_velocity.z * 1.0;
     double error2    = 0; //-rudder_pos/max_rudder_turn_speed * turn_velocity;
     double error     = error0 + error1 + error2;
     // DBGOUT8(position.z,depthdiff, local_velocity.z, dive_planes.angle,
@@ -516,14 +563,14 @@ auto torpedo::get_turn_drag_area() const -> double
 
 void torpedo::launch(const vector3& launchpos, angle parenthdg)
 {
-    position          = launchpos;
-    orientation       = quaternion::rot(-parenthdg.value(), 0, 0, 1);
+    hot->position          = launchpos;
+    hot->orientation       = quaternion::rot(-parenthdg.value(), 0, 0, 1);
     max_speed_forward = get_torp_speed();
-    linear_momentum   = orientation.rotate(vector3(0, max_speed_forward * mass, 0)); // fixme: get from parent
-    angular_momentum  = vector3();                                                   // fixme: get from parent
+    hot->linear_momentum   = hot->orientation.rotate(vector3(0, max_speed_forward * mass, 0)); // fixme: get from parent
+    hot->angular_momentum  = vector3();                                                   // fixme: get from parent
     compute_helper_values();
     run_length    = 0;
-    turn_velocity = 0;
+    hot->turn_velocity = 0;
 }
 
 #if 0
@@ -114,6 +114,8 @@ class torpedo : public ship
 
         void load(const xml_elem& parent);
         void save(xml_elem& parent) const;
+        void load(std::istream& in);
+        void save(std::ostream& out) const;
     };
 
     enum warhead_types
@@ -217,6 +219,8 @@ class torpedo : public ship
 
     void load(const xml_elem& parent) override;
     void save(xml_elem& parent) const override;
+    void load(std::istream& in) override;
+    void save(std::ostream& out) const override;
 
     void simulate(double delta_time, game& gm) override;
 
@@ -62,7 +62,7 @@ water_splash::water_splash(const vector3& pos, object_store<model>& model_store,
     double falltime = sqrt(riseheight * 2.0 / constant::GRAVITY);
     lifetime        = risetime + falltime;
     resttime        = lifetime;
-    position        = pos;
+    hot->position        = pos;
     std::vector<double> p(6);
     double fac     = riseheight / 25.0;
     p[0]           = fac * 5.0;
@@ -122,7 +122,7 @@ void water_splash::display() const
     }
 }
 
-void water_splash::display_mirror_clip() const
+void water_splash::display_mirror_clip(unsigned /*lod*/) const
 {
     display();
 }
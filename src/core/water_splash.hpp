@@ -54,7 +54,7 @@ class water_splash : public sea_object
     water_splash(const vector3& pos, object_store<model>& model_store, double risetime = 0.4, double riseheight = 25.0);
     void simulate(double delta_time, game& gm) override;
     void display() const;
-    void display_mirror_clip() const override;
+    void display_mirror_clip(unsigned lod = 0) const override;
     void compute_force_and_torque(vector3& F, vector3& T, game& gm) const override { } // static object, no acceleration
     static auto torpedo(const vector3& pos, object_store<model>& model_store)
     {
@@ -0,0 +1,181 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// cloud map synthesis
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "cloud_generator.hpp"
+
+#include "error.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+cloud_generator::cloud_generator(uint32_t seed, unsigned levels_)
+    : levels(levels_)
+    , mapshift(9 - levels_)
+    , generator(seed)
+    , interpolate_func(256)
+    , column_index(levels_)
+    , column_weight(levels_)
+    , blended(levels_)
+    , scaled_rows(levels_)
+{
+    if (levels < 1 || levels > 8) {
+        THROW(error, "invalid number of cloud levels");
+    }
+    for (unsigned n = 0; n < 256; ++n) {
+        interpolate_func[n] = unsigned(128 - cos(n * M_PI / 256) * 128);
+    }
+    // level k is scaled by 2^shift, shift = levels - 1 - k, so the position of
+    // every map column in the noise map is the same for all rows
+    const unsigned mapmask = (1U << mapshift) - 1;
+    for (unsigned k = 0; k < levels; ++k) {
+        const unsigned shift  = levels - 1 - k;
+        const unsigned rshift = 8 - shift;
+        column_index[k].resize(map_resolution);
+        column_weight[k].resize(map_resolution);
+        for (unsigned x = 0; x < map_resolution; ++x) {
+            column_index[k][x]  = (x >> shift) & mapmask;
+            column_weight[k][x] = interpolate_func[(x << rshift) & 255];
+        }
+        blended[k].resize(1U << (2 * mapshift));
+        scaled_rows[k].resize((1U << mapshift) * map_resolution);
+    }
+    noisemaps_0 = compute_noisemaps();
+    noisemaps_1 = compute_noisemaps();
+}
+
+void cloud_generator::next_cycle()
+{
+    noisemaps_0.swap(noisemaps_1);
+    noisemaps_1 = compute_noisemaps();
+}
+
+void cloud_generator::compute(float phase, std::vector<uint8_t>& result)
+{
+    const unsigned mapsize = 1U << mapshift;
+    const unsigned mapmask = mapsize - 1;
+    result.resize(map_resolution * map_resolution);
+
+    // interpolate noise maps of all levels for the animation phase.
+    // Interpolating accumulated maps would be cheaper, but different noise
+    // levels must get animated with different speeds for realistic cloud
+    // form change (isn't done yet)...
+    for (unsigned k = 0; k < levels; ++k) {
+        const uint8_t* n0 = noisemaps_0[k].data();
+        const uint8_t* n1 = noisemaps_1[k].data();
+        uint8_t* b        = blended[k].data();
+        for (unsigned j = 0; j < mapsize * mapsize; ++j) {
+            b[j] = uint8_t(n0[j] * (1 - phase) + n1[j] * phase);
+        }
+    }
+
+    // scale every noise map row to full width, that is the horizontal part of
+    // the bilinear interpolation. There are only a few rows per level.
+    for (unsigned k = 0; k < levels; ++k) {
+        const unsigned* xi = column_index[k].data();
+        const unsigned* xw = column_weight[k].data();
+        for (unsigned my = 0; my < mapsize; ++my) {
+            const uint8_t* row = &blended[k][my << mapshift];
+            uint32_t* dst      = &scaled_rows[k][my * map_resolution];
+            for (unsigned x = 0; x < map_resolution; ++x) {
+                const unsigned x0 = xi[x];
+                const unsigned x1 = (x0 + 1) & mapmask;
+                dst[x]            = row[x0] * (256 - xw[x]) + row[x1] * xw[x];
+            }
+        }
+    }
+
+    // vertical interpolation and accumulation of all levels, row by row over
+    // contiguous data, then clamp to alpha value
+    uint32_t acc[map_resolution];
+    for (unsigned y = 0; y < map_resolution; ++y) {
+        std::fill(acc, acc + map_resolution, 0U);
+        for (unsigned k = 0; k < levels; ++k) {
+            const unsigned shift  = levels - 1 - k;
+            const unsigned rshift = 8 - shift;
+            const unsigned y0     = (y >> shift) & mapmask;
+            const unsigned y1     = (y0 + 1) & mapmask;
+            const uint32_t w1     = interpolate_func[(y << rshift) & 255];
+            const uint32_t w0     = 256 - w1;
+            const uint32_t* r0    = &scaled_rows[k][y0 * map_resolution];
+            const uint32_t* r1    = &scaled_rows[k][y1 * map_resolution];
+            // values are < 2^24, the upper byte is the level's value
+            for (unsigned x = 0; x < map_resolution; ++x) {
+                acc[x] += (r0[x] * w0 + r1[x] * w1) >> (16 + k);
+            }
+        }
+        // FIXME generate a lookup table for this function, depending on
+        // coverage/sharpness
+        uint8_t* dst = &result[y * map_resolution];
+        for (unsigned x = 0; x < map_resolution; ++x) {
+            dst[x] = uint8_t(std::min(std::max(acc[x], 96U) - 96U, 255U));
+        }
+    }
+}
+
+auto cloud_generator::compute_noisemaps() -> std::vector<std::vector<uint8_t>>
+{
+    const unsigned mapsize = 1U << mapshift;
+    std::vector<std::vector<uint8_t>> noisemaps(levels);
+    for (unsigned i = 0; i < levels; ++i) {
+        noisemaps[i].resize(mapsize * mapsize);
+        for (unsigned j = 0; j < mapsize * mapsize; ++j) {
+            noisemaps[i][j] = static_cast<unsigned char>(255 * generator.get());
+        }
+        smooth_and_equalize_bytemap(mapsize, noisemaps[i]);
+    }
+    return noisemaps;
+}
+
+void cloud_generator::smooth_and_equalize_bytemap(unsigned s, std::vector<uint8_t>& map1)
+{
+    std::vector<uint8_t> map2 = map1;
+    unsigned maxv        = 0;
+    unsigned minv        = 255;
+    for (unsigned y = 0; y < s; ++y) {
+        unsigned y1 = (y + s - 1) % s;
+        unsigned y2 = (y + 1) % s;
+        for (unsigned x = 0; x < s; ++x) {
+            unsigned x1 = (x + s - 1) % s;
+            unsigned x2 = (x + 1) % s;
+            unsigned v  = (unsigned(map2[y1 * s + x1]) + unsigned(map2[y1 * s + x2]) + unsigned(map2[y2 * s + x1])
+                          + unsigned(map2[y2 * s + x2]))
+                             / 16
+                         + (unsigned(map2[y * s + x1]) + unsigned(map2[y * s + x2]) + unsigned(map2[y1 * s + x])
+                            + unsigned(map2[y2 * s + x]))
+                               / 8
+                         + (unsigned(map2[y * s + x])) / 4;
+            map1[y * s + x] = uint8_t(v);
+            if (v < minv) {
+                minv = v;
+            }
+            if (v > maxv) {
+                maxv = v;
+            }
+        }
+    }
+    for (unsigned y = 0; y < s; ++y) {
+        for (unsigned x = 0; x < s; ++x) {
+            unsigned v      = map1[y * s + x];
+            map1[y * s + x] = uint8_t((v - minv) * 255 / (maxv - minv));
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// cloud map synthesis
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "random_generator.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/// Computes the animated cloud map of the sky.
+/** We generate m levels of noise maps, level k is scaled by 2^(m-1-k) to the
+    size of the cloud map and added with factor 1/2^k. To animate clouds each
+    level's noise map is interpolated between two random noise maps, at the
+    end of an animation cycle new noise maps are generated. The sum is
+    clamped to give the alpha value of the cloud texture.
+    No OpenGL is involved, so this can run in a worker thread.
+*/
+class cloud_generator
+{
+  public:
+    /// width and height of the cloud map
+    static const unsigned map_resolution = 256;
+
+    /// create generator and noise maps for the first animation cycle
+    ///@param seed - seed for noise map generation
+    ///@param levels - number of noise levels, 1...8
+    cloud_generator(uint32_t seed, unsigned levels = 5);
+
+    /// begin next animation cycle, the target noise maps of the last cycle
+    /// become the start of the new cycle
+    void next_cycle();
+
+    /// compute cloud map
+    ///@param phase - animation phase in [0...1]
+    ///@param result - map_resolution^2 values
+    void compute(float phase, std::vector<uint8_t>& result);
+
+    /// number of noise levels
+    [[nodiscard]] unsigned get_levels() const { return levels; }
+    /// width and height of the noise maps
+    [[nodiscard]] unsigned get_noisemap_size() const { return 1U << mapshift; }
+    /// noise map of a level at start (0) or end (1) of the animation cycle
+    [[nodiscard]] const std::vector<uint8_t>& get_noisemap(unsigned cycle_end, unsigned level) const
+    {
+        return cycle_end != 0 ? noisemaps_1[level] : noisemaps_0[level];
+    }
+    /// interpolation weight of a fraction 0...255, scaled to 256
+    [[nodiscard]] unsigned get_interpolation_weight(unsigned frac) const { return interpolate_func[frac]; }
+
+    /// smooth a noise map with a 3x3 filter and stretch it to full range
+    static void smooth_and_equalize_bytemap(unsigned s, std::vector<uint8_t>& map1);
+
+  protected:
+    const unsigned levels;
+    const unsigned mapshift; // log2 of noise map size
+    random_generator generator;
+    std::vector<unsigned> interpolate_func; // give fraction as uint8_t
+    std::vector<std::vector<uint8_t>> noisemaps_0, noisemaps_1;
+
+    // per level: noise map column and interpolation weight of each map column
+    std::vector<std::vector<unsigned>> column_index, column_weight;
+    // scratch buffers: blended noise maps and their rows scaled to full width
+    std::vector<std::vector<uint8_t>> blended;
+    std::vector<std::vector<uint32_t>> scaled_rows;
+
+    std::vector<std::vector<uint8_t>> compute_noisemaps();
+};
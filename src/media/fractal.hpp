@@ -22,6 +22,7 @@
 #include "vector2.hpp"
 #include "vector3.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -33,6 +34,40 @@ class fractal_noise
     int octaves;
     std::vector<double> exponent_array;
 
+    /// points of batch evaluation are processed in chunks of this size
+    static const unsigned chunk_size = 64;
+
+    /// call func for chunks of points with a modifiable copy of their coordinates
+    template<typename T, typename F>
+    static void for_each_chunk(unsigned n, const T* x, const T* y, const T* z, T* result, F&& func)
+    {
+        T px[chunk_size], py[chunk_size], pz[chunk_size];
+        for (unsigned b = 0; b < n; b += chunk_size) {
+            const unsigned m = std::min(chunk_size, n - b);
+            std::copy_n(x + b, m, px);
+            std::copy_n(y + b, m, py);
+            if (z != nullptr) {
+                std::copy_n(z + b, m, pz);
+            }
+            func(m, px, py, pz, result + b);
+        }
+    }
+
+    /// increase frequency of chunk coordinates
+    template<typename T>
+    void scale(unsigned m, T* px, T* py, T* pz) const
+    {
+        for (unsigned k = 0; k < m; ++k) {
+            px[k] *= T(lacunarity);
+            py[k] *= T(lacunarity);
+        }
+        if (pz != nullptr) {
+            for (unsigned k = 0; k < m; ++k) {
+                pz[k] *= T(lacunarity);
+            }
+        }
+    }
+
   public:
     fractal_noise(double _H, double _lacunarity, int _octaves, double _offset, double _gain)
         : H(_H)
@@ -176,6 +211,96 @@ class fractal_noise
         return result;
     }
 
+    /// Batch versions of get_value_* for a row of n points given as coordinate arrays.
+    /** Double results are identical to the single point versions, float ones
+        are less exact, see simplex_noise::noise_row.
+    */
+    template<typename T>
+    void get_values_hybrid(unsigned n, const T* x, const T* y, const T* z, T* result, int octave) const
+    {
+        for_each_chunk(n, x, y, z, result, [&](unsigned m, T* px, T* py, T* pz, T* res) {
+            T signal[chunk_size], weight[chunk_size];
+            /* get first octave of function */
+            simplex_noise::noise_row(m, px, py, pz, signal);
+            for (unsigned k = 0; k < m; ++k) {
+                res[k]    = (signal[k] + T(offset)) * T(exponent_array[0]);
+                weight[k] = res[k];
+            }
+            /* spectral construction inner loop, where the fractal is built */
+            for (int i = 1; i < octave; i++) {
+                scale(m, px, py, pz);
+                simplex_noise::noise_row(m, px, py, pz, signal);
+                for (unsigned k = 0; k < m; ++k) {
+                    /* prevent divergence */
+                    const T w = (weight[k] > T(1.0)) ? T(1.0) : weight[k];
+                    const T s = (signal[k] + T(offset)) * T(exponent_array[i]);
+                    res[k] += w * s;
+                    weight[k] = w * s;
+                }
+            }
+            /* octaves is integral, so there is no remainder */
+        });
+    }
+
+    template<typename T>
+    void get_values_ridged(unsigned n, const T* x, const T* y, const T* z, T* result, int octave) const
+    {
+        for_each_chunk(n, x, y, z, result, [&](unsigned m, T* px, T* py, T* pz, T* res) {
+            T signal[chunk_size], s[chunk_size];
+            simplex_noise::noise_row(m, px, py, pz, signal);
+            for (unsigned k = 0; k < m; ++k) {
+                /* get absolute value of signal (this creates the ridges), invert, translate and square it */
+                const T a = T(offset) - std::abs(signal[k]);
+                signal[k] = a * a;
+                res[k]    = signal[k];
+            }
+            for (int i = 1; i < octave; i++) {
+                scale(m, px, py, pz);
+                simplex_noise::noise_row(m, px, py, pz, s);
+                for (unsigned k = 0; k < m; ++k) {
+                    /* weight successive contributions by previous signal */
+                    const T weight = std::clamp(signal[k] * T(gain), T(0.0), T(1.0));
+                    const T a      = T(offset) - std::abs(s[k]);
+                    signal[k]      = a * a * weight;
+                    res[k] += signal[k] * T(exponent_array[i]);
+                }
+            }
+        });
+    }
+
+    template<typename T>
+    void get_values_fbm(unsigned n, const T* x, const T* y, T* result, int octave) const
+    {
+        const T* no_z = nullptr;
+        for_each_chunk(n, x, y, no_z, result, [&](unsigned m, T* px, T* py, T* /*pz*/, T* res) {
+            T signal[chunk_size];
+            std::fill(res, res + m, T(0.0));
+            for (int i = 0; i < octave; i++) {
+                simplex_noise::noise_row(m, px, py, signal);
+                for (unsigned k = 0; k < m; ++k) {
+                    res[k] += signal[k] * T(exponent_array[i]);
+                }
+                scale<T>(m, px, py, nullptr);
+            }
+        });
+    }
+
+    template<typename T>
+    void get_values_fbm(unsigned n, const T* x, const T* y, const T* z, T* result, int octave) const
+    {
+        for_each_chunk(n, x, y, z, result, [&](unsigned m, T* px, T* py, T* pz, T* res) {
+            T signal[chunk_size];
+            std::fill(res, res + m, T(0.0));
+            for (int i = 0; i < octave; i++) {
+                simplex_noise::noise_row(m, px, py, pz, signal);
+                for (unsigned k = 0; k < m; ++k) {
+                    res[k] += signal[k] * T(exponent_array[i]);
+                }
+                scale(m, px, py, pz);
+            }
+        });
+    }
+
     std::vector<uint8_t> get_map_fbm(const vector2i& sz)
     {
 
@@ -184,9 +309,13 @@ class fractal_noise
         std::vector<double> values(sz.x * sz.y);
         std::vector<uint8_t> map(sz.x * sz.y);
 
+        std::vector<double> xs(sz.x), ys(sz.x);
+        for (int x = 0; x < sz.x; x++)
+            xs[x] = x * 0.001;
         for (int y = 0; y < sz.y; y++) {
+            std::fill(ys.begin(), ys.end(), y * 0.001);
+            get_values_fbm(sz.x, xs.data(), ys.data(), &values[y * sz.x], octaves);
             for (int x = 0; x < sz.x; x++) {
-                values[y * sz.x + x] = get_value_fbm(vector2(x * 0.001, y * 0.001), octaves);
                 if (values[y * sz.x + x] > max)
                     max = values[y * sz.x + x];
                 if (values[y * sz.x + x] < min)
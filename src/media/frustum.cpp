@@ -49,6 +49,17 @@ auto frustum::clip(const polygon& p) const -> polygon
     return result;
 }
 
+auto frustum::is_sphere_visible(const vector3& center, double radius) const -> bool
+{
+    // the inner side of all planes is the front side
+    for (const auto& plane : planes) {
+        if (plane.distance(center) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*
 void frustum::draw() const
 {
@@ -64,8 +75,11 @@ void frustum::print() const
 
 auto frustum::from_opengl() -> frustum
 {
-    matrix4 mv     = matrix4::get_gl(GL_MODELVIEW_MATRIX);
-    matrix4 prj    = matrix4::get_gl(GL_PROJECTION_MATRIX);
+    return from_matrices(matrix4::get_gl(GL_MODELVIEW_MATRIX), matrix4::get_gl(GL_PROJECTION_MATRIX));
+}
+
+auto frustum::from_matrices(const matrix4& mv, const matrix4& prj) -> frustum
+{
     matrix4 mvp    = prj * mv;
     matrix4 invmv  = mv.inverse();
     matrix4 invmvp = mvp.inverse();
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
+#include "matrix4.hpp"
 #include "polygon.hpp"
 
 #include <vector>
@@ -41,8 +42,12 @@ class frustum
     /// print frumstum values for debugging
     void print() const;
     */
+    /// check if a sphere is at least partly inside the frustum (conservative)
+    [[nodiscard]] bool is_sphere_visible(const vector3& center, double radius) const;
     /// construct frustum from current OpenGL matrices.
     static frustum from_opengl();
+    /// construct frustum from modelview and projection matrix.
+    static frustum from_matrices(const matrix4& mv, const matrix4& prj);
     /// translate all points
     void translate(const vector3& delta);
     /// generate mirrored frustum (at z=0 plane)
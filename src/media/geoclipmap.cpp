@@ -20,7 +20,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "geoclipmap.hpp"
 
 #include "helper.hpp"
+#include "log.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 
@@ -53,11 +55,7 @@ geoclipmap::geoclipmap(unsigned nr_levels, unsigned resolution_exp, height_gener
     , L(hg.get_sample_spacing())
     , color_res_fac(1 << hg.get_log2_color_res_factor())
     , log2_color_res_fac(hg.get_log2_color_res_factor())
-    , vboscratchbuf((resolution_vbo + 2) * (resolution_vbo + 2) * geoclipmap_fperv)
-    , // 4 floats per VBO sample (x,y,z,zc)
-    // ^ extra space for normals
-    texnormalscratchbuf_3f(resolution_vbo * 2 * resolution_vbo * 2 * 3)
-    , texnormalscratchbuf(resolution_vbo * 2 * resolution_vbo * 2 * 3)
+    , vboscratchbuf(8 * geoclipmap_fperv) // 4 floats per VBO sample (x,y,z,zc)
     , idxscratchbuf(
           2 * (resolution_vbo + 4) * (resolution_vbo + 4) // patch triangles
           + 2 * 4 * resolution_vbo                        // T-junction triangles
@@ -76,6 +74,13 @@ geoclipmap::geoclipmap(unsigned nr_levels, unsigned resolution_exp, height_gener
         levels[lvl] = std::make_unique<level>(*this, lvl, lvl + 1 == levels.size());
     }
 
+    // levels are updated in parallel, leave one core for the render thread
+    const unsigned nr_workers =
+        std::clamp(std::thread::hardware_concurrency(), 2U, unsigned(levels.size()) + 1) - 1;
+    for (unsigned i = 0; i < nr_workers; ++i) {
+        workers.push_back(std::make_unique<::thread>("geoclipmap-worker", [this]() { worker_loop(); }));
+    }
+
     myshader[0] = std::make_unique<glsl_shader_setup>(
         get_shader_dir() + "geoclipmap.vshader", get_shader_dir() + "geoclipmap.fshader");
     glsl_shader::defines_list defines;
@@ -126,10 +131,88 @@ geoclipmap::geoclipmap(unsigned nr_levels, unsigned resolution_exp, height_gener
     horizon_normal = std::make_unique<texture>(pxl, 1, 1, GL_RGB, texture::LINEAR, texture::REPEAT);
 }
 
-geoclipmap::~geoclipmap() = default;
+geoclipmap::~geoclipmap()
+{
+    log_update_statistics();
+    {
+        std::unique_lock<std::mutex> ml(update_mutex);
+        stop_workers = true;
+        update_queue.clear();
+    }
+    update_cond.notify_all();
+    workers.clear();
+}
+
+void geoclipmap::worker_loop()
+{
+    std::unique_lock<std::mutex> ml(update_mutex);
+    while (true) {
+        update_cond.wait(ml, [this]() { return stop_workers || !update_queue.empty(); });
+        if (stop_workers) {
+            return;
+        }
+        auto upd = std::move(update_queue.front());
+        update_queue.pop_front();
+        ml.unlock();
+        const auto& lvl = *levels[upd->level_index];
+        try {
+            for (unsigned i = 0; i < upd->nr_regions; ++i) {
+                lvl.compute_region(upd->base_viewpos, upd->regions[i]);
+            }
+        }
+        catch (std::exception& e) {
+            // report to render thread, the worker must go on
+            upd->error = e.what();
+        }
+        ml.lock();
+        upd->done = true;
+        // drop our reference while locked, so the level can reuse the buffers
+        upd.reset();
+        done_cond.notify_all();
+    }
+}
+
+void geoclipmap::request_update(std::shared_ptr<level_update> upd)
+{
+    upd->done         = false;
+    upd->error.clear();
+    upd->base_viewpos = base_viewpos;
+    upd->request_time = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> ml(update_mutex);
+        update_queue.push_back(std::move(upd));
+    }
+    update_cond.notify_one();
+}
+
+auto geoclipmap::is_done(const level_update& upd) -> bool
+{
+    std::unique_lock<std::mutex> ml(update_mutex);
+    return upd.done;
+}
+
+void geoclipmap::wait_for(const level_update& upd)
+{
+    std::unique_lock<std::mutex> ml(update_mutex);
+    if (!upd.done) {
+        ++stats.waits;
+        done_cond.wait(ml, [&upd]() { return upd.done; });
+    }
+}
+
+void geoclipmap::log_update_statistics() const
+{
+    log_info(
+        "terrain updates: " << stats.updates << " in " << stats.frames << " frames, avg/max frame time "
+                            << stats.get_avg_frame_time() << "/" << stats.max_frame_time << " ms, avg/max latency "
+                            << stats.get_avg_latency() << "/" << stats.max_latency << " ms, deferred "
+                            << stats.frames_deferred << ", waited " << stats.waits);
+}
 
 void geoclipmap::set_viewerpos(const vector3& new_viewpos)
 {
+    const auto frame_start = std::chrono::steady_clock::now();
+
     // check for a total reset of base_viewpos
     if (new_viewpos.xy().distance(base_viewpos) > 10000.0) {
         for (auto& level : levels) {
@@ -138,8 +221,17 @@ void geoclipmap::set_viewerpos(const vector3& new_viewpos)
         base_viewpos = new_viewpos.xy();
     }
 
-    // for each level compute clip area for that new viewerpos
-    // for each level compute area that needs to get updated and do that
+    // for each level upload finished data and request computation of the area
+    // that needs to get updated for the new viewerpos, all levels are computed
+    // in parallel by the workers, then upload what is needed for this frame
+    for (auto& level : levels) {
+        level->update(new_viewpos);
+    }
+    for (auto& level : levels) {
+        level->finish_update();
+    }
+
+    // for each level compute clip area from the data that is available
 
     // empty area for innermost level
     area levelborder;
@@ -173,6 +265,12 @@ void geoclipmap::set_viewerpos(const vector3& new_viewpos)
     myshader[1]->use();
     myshader[1]->set_uniform(loc_viewpos[1], new_viewpos - base_viewpos.xy0());
     myshader[1]->set_uniform(loc_viewpos_offset[1], new_viewpos);
+
+    const double frame_time =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+    ++stats.frames;
+    stats.frame_time += frame_time;
+    stats.max_frame_time = std::max(stats.max_frame_time, frame_time);
 }
 
 void geoclipmap::display(const frustum& f, const vector3& view_delta, bool is_mirror, int above_water) const
@@ -266,8 +364,14 @@ geoclipmap::level::level(geoclipmap& gcm_, unsigned idx, bool outmost_level)
     }
 }
 
-auto geoclipmap::level::set_viewerpos(const vector3& new_viewpos, const geoclipmap::area& inner) -> geoclipmap::area
+void geoclipmap::level::update(const vector3& new_viewpos)
 {
+    if (pending) {
+        if (!gcm.is_done(*pending)) {
+            return;
+        }
+        upload_update();
+    }
     // x_base/y_base tells offset in sample data according to level and
     // viewer position (new_viewpos)
     // this multiply with 0.5 then round then *2 lets the patches map to
@@ -284,49 +388,110 @@ auto geoclipmap::level::set_viewerpos(const vector3& new_viewpos, const geoclipm
         vector2i(
             int(floor(0.5 * new_viewpos.x / L_l + 0.25 * gcm.resolution + 0.5)) * 2,
             int(floor(0.5 * new_viewpos.y / L_l + 0.25 * gcm.resolution + 0.5)) * 2));
-    tmp_inner = inner;
-    tmp_outer = outer;
-    // log_debug("index="<<index<<" area inner="<<inner.bl<<"|"<<inner.tr<<"
-    // outer="<<outer.bl<<"|"<<outer.tr);
+    if (outer == vboarea) {
+        return;
+    }
+    // reuse buffers of the last update if no worker references them anymore
+    std::shared_ptr<level_update> upd;
+    if (spare && spare.use_count() == 1) {
+        upd = std::move(spare);
+    } else {
+        upd = std::make_shared<level_update>();
+    }
+    upd->level_index = index;
+    upd->outer       = outer;
+    upd->nr_regions  = 0;
     // for vertex updates we only need to know the outer area...
     // compute part of "outer" that is NOT covered by old outer area,
     // this gives a rectangular or L-shaped form, but this can not be expressed
     // as area, only with at least 2 areas...
-    if (vboarea.empty() || vboarea.intersection(outer).empty()) {
-        vboarea    = outer; // set this to make the update work correctly
-        dataoffset = gcm.clamp(outer.bl);
-        update_region(outer);
+    upd->reset = vboarea.empty() || vboarea.intersection(outer).empty();
+    auto add_region = [&upd](const area& upar) {
+        if (upar.empty()) {
+            THROW(error, "update area empty?! BUG!");
+        }
+        if (upd->nr_regions == upd->regions.size()) {
+            THROW(error, "got more than 2 update regions?! BUG!");
+        }
+        upd->regions[upd->nr_regions++].upar = upar;
+    };
+    if (upd->reset) {
+        add_region(outer);
     } else {
-        area outercmp       = outer;
-        unsigned nr_updates = 0;
+        area outercmp = outer;
         if (outercmp.bl.y < vboarea.bl.y) {
-            update_region(area(outercmp.bl, vector2i(outercmp.tr.x, vboarea.bl.y - 1)));
+            add_region(area(outercmp.bl, vector2i(outercmp.tr.x, vboarea.bl.y - 1)));
             outercmp.bl.y = vboarea.bl.y;
-            ++nr_updates;
         }
         if (vboarea.tr.y < outercmp.tr.y) {
-            update_region(area(vector2i(outercmp.bl.x, vboarea.tr.y + 1), outercmp.tr));
+            add_region(area(vector2i(outercmp.bl.x, vboarea.tr.y + 1), outercmp.tr));
             outercmp.tr.y = vboarea.tr.y;
-            ++nr_updates;
         }
         if (outercmp.bl.x < vboarea.bl.x) {
-            update_region(area(outercmp.bl, vector2i(vboarea.bl.x - 1, outercmp.tr.y)));
+            add_region(area(outercmp.bl, vector2i(vboarea.bl.x - 1, outercmp.tr.y)));
             outercmp.bl.x = vboarea.bl.x;
-            ++nr_updates;
         }
         if (vboarea.tr.x < outercmp.tr.x) {
-            update_region(area(vector2i(vboarea.tr.x + 1, outercmp.bl.y), outercmp.tr));
+            add_region(area(vector2i(vboarea.tr.x + 1, outercmp.bl.y), outercmp.tr));
             outercmp.tr.x = vboarea.tr.x;
-            ++nr_updates;
         }
-        if (nr_updates > 2) {
-            THROW(error, "got more than 2 update regions?! BUG!");
+    }
+    frames_waited = 0;
+    pending       = upd;
+    gcm.request_update(std::move(upd));
+}
+
+void geoclipmap::level::finish_update()
+{
+    if (!pending) {
+        return;
+    }
+    // without data there is nothing to fall back to, and previous data is
+    // used for one frame only
+    if (!gcm.is_done(*pending)) {
+        if (!vboarea.empty() && frames_waited == 0) {
+            ++frames_waited;
+            ++gcm.stats.frames_deferred;
+            return;
         }
+        gcm.wait_for(*pending);
+    }
+    upload_update();
+}
+
+void geoclipmap::level::upload_update()
+{
+    const level_update& upd = *pending;
+    if (!upd.error.empty()) {
+        const std::string msg = upd.error;
+        pending.reset();
+        THROW(error, std::string("computing terrain level failed: ") + msg);
+    }
+    if (upd.reset) {
+        vboarea    = upd.outer; // set this to make the update work correctly
+        dataoffset = gcm.clamp(upd.outer.bl);
+    }
+    for (unsigned i = 0; i < upd.nr_regions; ++i) {
+        upload_region(upd.regions[i]);
     }
     // we updated the vertices, so update area/offset
-    dataoffset = gcm.clamp(outer.bl - vboarea.bl + dataoffset);
-    vboarea    = outer;
+    dataoffset = gcm.clamp(upd.outer.bl - vboarea.bl + dataoffset);
+    vboarea    = upd.outer;
 
+    const double latency =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upd.request_time).count();
+    ++gcm.stats.updates;
+    gcm.stats.latency += latency;
+    gcm.stats.max_latency = std::max(gcm.stats.max_latency, latency);
+    spare = std::move(pending);
+}
+
+auto geoclipmap::level::set_viewerpos(const vector3& new_viewpos, const geoclipmap::area& inner) -> geoclipmap::area
+{
+    // the clip area is the one of the data in the VBO, which may lag behind
+    // the viewer for a frame
+    tmp_inner = inner;
+    tmp_outer = vboarea;
     if (outmost) {
         // give 8 vertices to fill horizon gap
         static const int dx[8] = {-1, 0, 1, 1, 1, 0, -1, -1};
@@ -344,16 +509,13 @@ auto geoclipmap::level::set_viewerpos(const vector3& new_viewpos, const geoclipm
             (gcm.vboscratchbuf).data());
     }
 
-    return outer;
+    return vboarea;
 }
 
-void geoclipmap::level::update_region(const geoclipmap::area& upar)
+void geoclipmap::level::compute_region(const vector2& base_viewpos, level_update::region& r) const
 {
-    if (upar.empty()) {
-        THROW(error, "update area empty?! BUG!"); // continue; // can happen on
-    }
-    // initial update
-    vector2i sz = upar.size();
+    const area& upar = r.upar;
+    vector2i sz      = upar.size();
     // height data coordinates upar.bl ... upar.tr need to be updated, but what
     // VBO offset? since data is stored toroidically in VBO, a rectangle can be
     // split into up to 4 rectangles... we need to call get_height function with
@@ -373,6 +535,9 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
     // update VBO toroidically
 
     // compute the heights first (+1 in every direction to compute normals too)
+    r.vertices.resize((sz.x + 2) * (sz.y + 2) * geoclipmap_fperv);
+    r.normals_3f.resize(sz.x * 2 * sz.y * 2);
+    r.normals.resize(sz.x * 2 * sz.y * 2 * 3);
     vector2i upcrd = upar.bl + vector2i(-1, -1);
     // idea: fill in height here only from current level
     // fill in every 2nd x/y value by height of coarser level (we need m/2+1
@@ -384,13 +549,13 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
     // sometimes, as -1 / 2 gives 0 and not -1 as the shift method does, when we
     // want to round down...
     gcm.height_gen.compute_heights(
-        index, upcrd, sz + vector2i(2, 2), &gcm.vboscratchbuf[2], geoclipmap_fperv, geoclipmap_fperv * (sz.x + 2));
+        index, upcrd, sz + vector2i(2, 2), &r.vertices[2], geoclipmap_fperv, geoclipmap_fperv * (sz.x + 2));
     unsigned ptr = 0;
     for (int y = 0; y < sz.y + 2; ++y) {
         vector2i upcrd2 = upcrd;
         for (int x = 0; x < sz.x + 2; ++x) {
-            gcm.vboscratchbuf[ptr + 0] = upcrd2.x * L_l - gcm.base_viewpos.x;
-            gcm.vboscratchbuf[ptr + 1] = upcrd2.y * L_l - gcm.base_viewpos.y;
+            r.vertices[ptr + 0] = upcrd2.x * L_l - base_viewpos.x;
+            r.vertices[ptr + 1] = upcrd2.y * L_l - base_viewpos.y;
             ptr += geoclipmap_fperv;
             ++upcrd2.x;
         }
@@ -407,15 +572,15 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
     const vector2i szc(((upar.tr.x + 1) >> 1) - upcrd.x + 1, ((upar.tr.y + 1) >> 1) - upcrd.y + 1);
     unsigned ptr3 = ptr = ((sz.x + 2) * (1 - (upar.bl.y & 1)) + (1 - (upar.bl.x & 1))) * geoclipmap_fperv;
     gcm.height_gen.compute_heights(
-        index + 1, upcrd, szc, &gcm.vboscratchbuf[ptr + 3], 2 * geoclipmap_fperv, geoclipmap_fperv * (sz.x + 2) * 2);
+        index + 1, upcrd, szc, &r.vertices[ptr + 3], 2 * geoclipmap_fperv, geoclipmap_fperv * (sz.x + 2) * 2);
 
     // interpolate z_c, first fill in missing columns on even rows
     for (int y = 0; y < szc.y; ++y) {
         unsigned ptr2 = ptr;
         for (int x = 0; x < szc.x - 1; ++x) {
-            float f0                                       = gcm.vboscratchbuf[ptr2 + 3];
-            float f1                                       = gcm.vboscratchbuf[ptr2 + 2 * geoclipmap_fperv + 3];
-            gcm.vboscratchbuf[ptr2 + geoclipmap_fperv + 3] = (f0 + f1) * 0.5F;
+            float f0                                = r.vertices[ptr2 + 3];
+            float f1                                = r.vertices[ptr2 + 2 * geoclipmap_fperv + 3];
+            r.vertices[ptr2 + geoclipmap_fperv + 3] = (f0 + f1) * 0.5F;
             ptr2 += 2 * geoclipmap_fperv;
         }
         ptr += 2 * (sz.x + 2) * geoclipmap_fperv;
@@ -442,9 +607,9 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
     for (int y = 0; y < szc.y - 1; ++y) {
         unsigned ptr2 = ptr;
         for (int x = 0; x < szc.x * 2 - 1; ++x) { // here we could spare 1 column
-            float f0                    = gcm.vboscratchbuf[ptr2 - (sz.x + 2) * geoclipmap_fperv + 3];
-            float f1                    = gcm.vboscratchbuf[ptr2 + (sz.x + 2) * geoclipmap_fperv + 3];
-            gcm.vboscratchbuf[ptr2 + 3] = (f0 + f1) * 0.5F;
+            float f0             = r.vertices[ptr2 - (sz.x + 2) * geoclipmap_fperv + 3];
+            float f1             = r.vertices[ptr2 + (sz.x + 2) * geoclipmap_fperv + 3];
+            r.vertices[ptr2 + 3] = (f0 + f1) * 0.5F;
             ptr2 += geoclipmap_fperv;
         }
         ptr += 2 * (sz.x + 2) * geoclipmap_fperv;
@@ -456,18 +621,22 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
     // log_debug("tex scratch sz="<<sz);
     // first retrieve vector3f normals, then transform them to RGB normals
     // index-1 because normals have double resolution as geometry
-    gcm.height_gen.compute_normals(int(index) - 1, upar.bl * 2, sz * 2, (gcm.texnormalscratchbuf_3f).data());
+    gcm.height_gen.compute_normals(int(index) - 1, upar.bl * 2, sz * 2, r.normals_3f.data());
     for (int y = 0; y < sz.y * 2; ++y) {
         for (int x = 0; x < sz.x * 2; ++x) {
-            const vector3f& nm                = gcm.texnormalscratchbuf_3f[tptr2++];
-            gcm.texnormalscratchbuf[tptr + 0] = uint8_t(nm.x * 127 + 128);
-            gcm.texnormalscratchbuf[tptr + 1] = uint8_t(nm.y * 127 + 128);
-            gcm.texnormalscratchbuf[tptr + 2] = uint8_t(nm.z * 127 + 128);
+            const vector3f& nm  = r.normals_3f[tptr2++];
+            r.normals[tptr + 0] = uint8_t(nm.x * 127 + 128);
+            r.normals[tptr + 1] = uint8_t(nm.y * 127 + 128);
+            r.normals[tptr + 2] = uint8_t(nm.z * 127 + 128);
             tptr += 3;
         }
     }
+}
 
-    ptr = 0;
+void geoclipmap::level::upload_region(const level_update::region& r)
+{
+    const area& upar  = r.upar;
+    const vector2i sz = upar.size();
     geoclipmap::area vboupdate(
         gcm.clamp(upar.bl - vboarea.bl + dataoffset), gcm.clamp(upar.tr - vboarea.bl + dataoffset));
     // check for continuous update areas
@@ -483,19 +652,20 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
             // area crosses VBO border horizontally and vertically
             int szx = gcm.resolution_vbo - vboupdate.bl.x;
             int szy = gcm.resolution_vbo - vboupdate.bl.y;
-            update_VBO_and_tex(vector2i(0, 0), sz.x, vector2i(szx, szy), vboupdate.bl);
-            update_VBO_and_tex(vector2i(szx, 0), sz.x, vector2i(vboupdate.tr.x + 1, szy),
+            update_VBO_and_tex(r, vector2i(0, 0), sz.x, vector2i(szx, szy), vboupdate.bl);
+            update_VBO_and_tex(r, vector2i(szx, 0), sz.x, vector2i(vboupdate.tr.x + 1, szy),
                        vector2i(gcm.mod(vboupdate.bl.x + szx), vboupdate.bl.y));
-            update_VBO_and_tex(vector2i(0, szy), sz.x, vector2i(szx, vboupdate.tr.y + 1),
+            update_VBO_and_tex(r, vector2i(0, szy), sz.x, vector2i(szx, vboupdate.tr.y + 1),
                        vector2i(vboupdate.bl.x, gcm.mod(vboupdate.bl.y + szy)));
-            update_VBO_and_tex(vector2i(szx, szy), sz.x, vector2i(vboupdate.tr.x + 1, vboupdate.tr.y + 1),
+            update_VBO_and_tex(r, vector2i(szx, szy), sz.x, vector2i(vboupdate.tr.x + 1, vboupdate.tr.y + 1),
                        vector2i(gcm.mod(vboupdate.bl.x + szx), gcm.mod(vboupdate.bl.y + szy)));
         } else {
 #endif
         // area crosses VBO border horizontally
         int szx = gcm.resolution_vbo - vboupdate.bl.x;
-        update_VBO_and_tex(vector2i(0, 0), sz.x, vector2i(szx, sz.y), vboupdate.bl);
+        update_VBO_and_tex(r, vector2i(0, 0), sz.x, vector2i(szx, sz.y), vboupdate.bl);
         update_VBO_and_tex(
+            r,
             vector2i(szx, 0),
             sz.x,
             vector2i(vboupdate.tr.x + 1, sz.y),
@@ -505,17 +675,18 @@ void geoclipmap::level::update_region(const geoclipmap::area& upar)
     } else if (vboupdate.tr.y < vboupdate.bl.y) {
         // area crosses VBO border vertically
         int szy = gcm.resolution_vbo - vboupdate.bl.y;
-        update_VBO_and_tex(vector2i(0, 0), sz.x, vector2i(sz.x, szy), vboupdate.bl);
-        update_VBO_and_tex(vector2i(0, szy), sz.x, vector2i(sz.x, vboupdate.tr.y + 1),
+        update_VBO_and_tex(r, vector2i(0, 0), sz.x, vector2i(sz.x, szy), vboupdate.bl);
+        update_VBO_and_tex(r, vector2i(0, szy), sz.x, vector2i(sz.x, vboupdate.tr.y + 1),
                    vector2i(vboupdate.bl.x, gcm.mod(vboupdate.bl.y + szy)));
 #endif
     } else {
         // no border crossed
-        update_VBO_and_tex(vector2i(0, 0), sz.x, sz, vboupdate.bl);
+        update_VBO_and_tex(r, vector2i(0, 0), sz.x, sz, vboupdate.bl);
     }
 }
 
 void geoclipmap::level::update_VBO_and_tex(
+    const level_update::region& r,
     const vector2i& scratchoff,
     int scratchmod,
     const vector2i& sz,
@@ -548,7 +719,7 @@ void geoclipmap::level::update_VBO_and_tex(
             1,
             GL_RGB,
             GL_UNSIGNED_BYTE,
-            &gcm.texnormalscratchbuf[((scratchoff.y * 2 + y) * scratchmod * 2 + scratchoff.x * 2) * 3]);
+            &r.normals[((scratchoff.y * 2 + y) * scratchmod * 2 + scratchoff.x * 2) * 3]);
     }
     // copy data to real VBO.
     // we need to do it line by line anyway.
@@ -556,7 +727,7 @@ void geoclipmap::level::update_VBO_and_tex(
         vertices.init_sub_data(
             (vbooff.x + gcm.mod(vbooff.y + y) * gcm.resolution_vbo) * geoclipmap_fperv * 4,
             sz.x * geoclipmap_fperv * 4,
-            &gcm.vboscratchbuf[((scratchoff.y + y + 1) * (scratchmod + 2) + 1 + scratchoff.x) * geoclipmap_fperv]);
+            &r.vertices[((scratchoff.y + y + 1) * (scratchmod + 2) + 1 + scratchoff.x) * geoclipmap_fperv]);
     }
 }
 
@@ -965,6 +1136,9 @@ void geoclipmap::level::display(const frustum& f, bool is_mirror) const
 
 void geoclipmap::level::clear_area()
 {
+    // data of a pending update is for the old base position, a worker may
+    // still compute it, but it is not used anymore
+    pending.reset();
     vboarea    = area();
     dataoffset = vector2i(0, 0);
 }
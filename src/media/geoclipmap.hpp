@@ -29,8 +29,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "shader.hpp"
 #include "simplex_noise.hpp"
 #include "texture.hpp"
+#include "thread.hpp"
 #include "vertexbufferobject.hpp"
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <sstream>
 
 class geoclipmap
@@ -46,8 +52,38 @@ class geoclipmap
     ~geoclipmap();
 
     /// set/change viewer position
+    /** Heights and normals of the levels are computed by worker threads, this
+        only uploads finished data. A level whose update is not ready yet is
+        rendered with its previous data for one frame, after that (or when it
+        has no data at all) the render thread waits for it.
+    */
     void set_viewerpos(const vector3& viewpos);
 
+    /// timing of level updates, for profiling
+    struct update_statistics
+    {
+        unsigned frames{0};           ///< calls of set_viewerpos
+        double frame_time{0.0};       ///< render thread time in set_viewerpos, ms
+        double max_frame_time{0.0};   ///< maximum of that per frame, ms
+        unsigned updates{0};          ///< level updates uploaded
+        double latency{0.0};          ///< time from request to upload of updates, ms
+        double max_latency{0.0};      ///< maximum latency of an update, ms
+        unsigned frames_deferred{0};  ///< number of times a level was rendered with previous data
+        unsigned waits{0};            ///< number of times the render thread waited for a worker
+
+        [[nodiscard]] double get_avg_frame_time() const { return frames > 0 ? frame_time / frames : 0.0; }
+        [[nodiscard]] double get_avg_latency() const { return updates > 0 ? latency / updates : 0.0; }
+    };
+
+    /// get statistics of level updates
+    [[nodiscard]] const update_statistics& get_update_statistics() const { return stats; }
+
+    /// reset statistics of level updates
+    void reset_update_statistics() { stats = update_statistics(); }
+
+    /// write statistics of level updates to the log
+    void log_update_statistics() const;
+
     /// render the view (will only fetch the vertex/index data, no texture
     /// setup)
     void
@@ -69,13 +105,9 @@ class geoclipmap
     // base viewerpos in 2d
     vector2 base_viewpos;
 
-    // scratch buffer for VBO data, for transmission
+    // scratch buffer for VBO data of horizon vertices, for transmission
     std::vector<float> vboscratchbuf;
 
-    // scratch buffer for texture data, for transmission
-    std::vector<vector3f> texnormalscratchbuf_3f;
-    std::vector<uint8_t> texnormalscratchbuf;
-
     // scratch buffer for index generation, for transmission
     std::vector<uint32_t> idxscratchbuf;
 
@@ -102,6 +134,30 @@ class geoclipmap
             vector2i sz = size();
             return sz.x <= 0 || sz.y <= 0;
         }
+        bool operator==(const area& other) const { return bl == other.bl && tr == other.tr; }
+        bool operator!=(const area& other) const { return !(*this == other); }
+    };
+
+    /// data of one update of a level, computed by a worker thread
+    struct level_update
+    {
+        /// heights and normals of one rectangular region
+        struct region
+        {
+            area upar;
+            std::vector<float> vertices;  // x,y,z,z_c with one sample border
+            std::vector<vector3f> normals_3f;
+            std::vector<uint8_t> normals; // RGB, twice the resolution
+        };
+        unsigned level_index{0};
+        area outer;         // area of level after update
+        bool reset{false};  // whole area is new
+        vector2 base_viewpos;
+        std::array<region, 2> regions;
+        unsigned nr_regions{0};
+        std::chrono::steady_clock::time_point request_time;
+        std::string error;  // exception text if computation failed
+        bool done{false};   // guarded by update_mutex
     };
 
     /// per-level data
@@ -141,14 +197,31 @@ class geoclipmap
         generate_indices2(uint32_t* buffer, unsigned idxbase, const vector2i& size, const vector2i& vbooff) const;
         unsigned generate_indices_T(uint32_t* buffer, unsigned idxbase) const;
         unsigned generate_indices_horizgap(uint32_t* buffer, unsigned idxbase) const;
-        void update_region(const geoclipmap::area& upar);
-        void update_VBO_and_tex(const vector2i& scratchoff, int scratchmod, const vector2i& sz, const vector2i& vbooff);
+        /// update currently computed by a worker and a finished one for reuse
+        std::shared_ptr<level_update> pending, spare;
+        /// number of frames the pending update was not ready
+        unsigned frames_waited{0};
+
+        void upload_update();
+        void upload_region(const level_update::region& r);
+        void update_VBO_and_tex(
+            const level_update::region& r,
+            const vector2i& scratchoff,
+            int scratchmod,
+            const vector2i& sz,
+            const vector2i& vbooff);
 
         texture::ptr normals;
         texture::ptr colors;
 
       public:
         level(geoclipmap& gcm_, unsigned idx, bool outmost_level);
+        /// upload finished update and request a new one if the area changed
+        void update(const vector3& new_viewpos);
+        /// upload pending update if it is ready or previous data can't be used any longer
+        void finish_update();
+        /// compute heights and normals of a region, called by worker threads
+        void compute_region(const vector2& base_viewpos, level_update::region& r) const;
         area set_viewerpos(const vector3& new_viewpos, const geoclipmap::area& inner);
         void display(const frustum& f, bool is_mirror = false) const;
         texture& normals_tex() const { return *normals; }
@@ -159,6 +232,20 @@ class geoclipmap
     std::vector<std::unique_ptr<level>> levels;
     height_generator& height_gen;
 
+    // background computation of level updates
+    std::mutex update_mutex;
+    std::condition_variable update_cond; // new update or stop request
+    std::condition_variable done_cond;   // an update was finished
+    std::deque<std::shared_ptr<level_update>> update_queue;
+    bool stop_workers{false};
+    std::vector<std::unique_ptr<::thread>> workers;
+    update_statistics stats;
+
+    void worker_loop();
+    void request_update(std::shared_ptr<level_update> upd);
+    bool is_done(const level_update& upd);
+    void wait_for(const level_update& upd);
+
     [[nodiscard]] int mod(int n) const { return n & resolution_vbo_mod; }
 
     [[nodiscard]] vector2i clamp(const vector2i& v) const { return {mod(v.x), mod(v.y)}; }
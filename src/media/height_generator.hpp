@@ -49,6 +49,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 /// interface class to generate heights, normals and texture data for the
 /// geoclipmap renderer
+///@note compute_heights and compute_normals are called by several worker
+/// threads of the renderer at the same time, so they must be thread safe
 class height_generator
 {
   public:
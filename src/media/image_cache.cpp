@@ -0,0 +1,158 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// cache of decoded images
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "image_cache.hpp"
+
+#include "log.hpp"
+
+namespace {
+/// decoded daylight images of all displays in data/displays take about
+/// 150 MB, so they all fit in
+const std::size_t default_budget = std::size_t(256) << 20;
+} // namespace
+
+class image_cache::prefetch_request : public message
+{
+  public:
+    prefetch_request(image_cache& cache_, std::string filename_)
+        : cache(cache_)
+        , filename(std::move(filename_))
+    {
+    }
+
+  protected:
+    image_cache& cache;
+    const std::string filename;
+
+    void eval() const override { cache.prefetch_image(filename); }
+};
+
+image_cache::image_cache()
+    : images(default_budget)
+{
+    prefetcher = std::make_unique<::thread>("imgcache", [this]() { prefetch_loop(); });
+}
+
+image_cache::~image_cache()
+{
+    stop = true;
+    prefetch_requests.wakeup_receiver();
+    prefetcher.reset();
+}
+
+auto image_cache::get(const std::string& filename) -> image_ptr
+{
+    std::unique_lock<std::mutex> ml(mtx);
+    if (loading.find(filename) != loading.end()) {
+        // image is being prefetched, that is still faster than loading it
+        ++waits;
+        loaded_cond.wait(ml, [this, &filename]() { return loading.find(filename) == loading.end(); });
+    }
+    if (const auto* img = images.find(filename)) {
+        return *img;
+    }
+    // load and decode without holding the lock, this may throw
+    ml.unlock();
+    image_ptr img = std::make_shared<const sdl_image>(filename);
+    ml.lock();
+    insert_locked(filename, img);
+    return img;
+}
+
+void image_cache::prefetch(const std::vector<std::string>& filenames)
+{
+    std::unique_lock<std::mutex> ml(mtx);
+    for (const auto& fn : filenames) {
+        if (fn.empty() || images.contains(fn) || loading.find(fn) != loading.end()
+            || !prefetch_pending.insert(fn).second) {
+            continue;
+        }
+        prefetch_requests.send(std::make_unique<prefetch_request>(*this, fn), false);
+    }
+}
+
+void image_cache::set_budget(std::size_t bytes)
+{
+    std::unique_lock<std::mutex> ml(mtx);
+    images.set_budget(bytes);
+}
+
+void image_cache::clear()
+{
+    std::unique_lock<std::mutex> ml(mtx);
+    images.clear();
+    // queued requests find their file no longer pending and are skipped
+    prefetch_pending.clear();
+}
+
+auto image_cache::get_statistics() const -> statistics
+{
+    std::unique_lock<std::mutex> ml(mtx);
+    const auto& st = images.get_statistics();
+    statistics result;
+    result.hits       = st.hits;
+    result.misses     = st.misses;
+    result.waits      = waits;
+    result.prefetched = prefetched;
+    result.evictions  = st.evictions;
+    result.bytes      = st.bytes;
+    return result;
+}
+
+void image_cache::prefetch_loop()
+{
+    while (!stop) {
+        prefetch_requests.process_messages(true);
+    }
+}
+
+void image_cache::prefetch_image(const std::string& filename)
+{
+    std::unique_lock<std::mutex> ml(mtx);
+    if (stop || prefetch_pending.erase(filename) == 0 || images.contains(filename)) {
+        return;
+    }
+    // tells get() to wait for us
+    loading.insert(filename);
+    ml.unlock();
+    image_ptr img;
+    try {
+        img = std::make_shared<const sdl_image>(filename);
+    }
+    catch (std::exception& e) {
+        // get() will try again and report the error
+        log_warning("prefetching image failed: " << e.what());
+    }
+    ml.lock();
+    loading.erase(filename);
+    if (img != nullptr) {
+        insert_locked(filename, img);
+        ++prefetched;
+    }
+    loaded_cond.notify_all();
+}
+
+void image_cache::insert_locked(const std::string& filename, image_ptr img)
+{
+    const std::size_t bytes = img->get_byte_size();
+    images.insert(filename, std::move(img), bytes);
+}
@@ -0,0 +1,106 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// cache of decoded images
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "lru_cache.hpp"
+#include "message_queue.hpp"
+#include "singleton.hpp"
+#include "texture.hpp"
+#include "thread.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/// Process wide cache of decoded images, to create textures without disk reads and decoding.
+/** Images are kept up to a memory budget, the least recently used ones are
+    evicted first. Images that will probably be needed soon can be prefetched,
+    a background thread loads and decodes them, it gets its requests through a
+    message_queue. All methods are threadsafe.
+*/
+class image_cache : public singleton<image_cache>
+{
+    friend class singleton<image_cache>;
+
+  public:
+    using image_ptr = std::shared_ptr<const sdl_image>;
+
+    /// statistics of cache usage
+    struct statistics
+    {
+        unsigned hits{0};       ///< image was in cache
+        unsigned misses{0};     ///< image had to be loaded by caller
+        unsigned waits{0};      ///< image was being prefetched, caller waited
+        unsigned prefetched{0}; ///< images loaded in background
+        unsigned evictions{0};  ///< images removed because of budget
+        std::size_t bytes{0};   ///< memory used by cached images
+    };
+
+    /// stop prefetching and free images
+    ~image_cache();
+
+    /// get decoded image, load it if it is not cached
+    ///@param filename - name of image file
+    ///@return image, stays valid when evicted from cache
+    image_ptr get(const std::string& filename);
+
+    /// load images in background, so later get() calls find them in cache
+    ///@param filenames - names of image files, earlier ones are loaded first
+    void prefetch(const std::vector<std::string>& filenames);
+
+    /// set memory budget in bytes, evicts images if needed
+    void set_budget(std::size_t bytes);
+
+    /// remove all images from cache
+    void clear();
+
+    /// get statistics
+    [[nodiscard]] statistics get_statistics() const;
+
+  protected:
+    image_cache();
+
+    /// request to load an image in background
+    class prefetch_request;
+
+    mutable std::mutex mtx;
+    std::condition_variable loaded_cond; // a load has finished
+    lru_cache<std::string, image_ptr> images;
+    std::unordered_set<std::string> loading;          // being loaded by prefetch thread
+    std::unordered_set<std::string> prefetch_pending; // requested and not yet loaded
+    unsigned waits{0};
+    unsigned prefetched{0};
+    message_queue prefetch_requests;
+    std::atomic<bool> stop{false};
+    std::unique_ptr<::thread> prefetcher;
+
+    void prefetch_loop();
+    /// load image requested by prefetch(), called by prefetch thread
+    void prefetch_image(const std::string& filename);
+    /// insert loaded image, must hold lock
+    void insert_locked(const std::string& filename, image_ptr img);
+};
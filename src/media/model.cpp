@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "datadirs.hpp"
 #include "log.hpp"
 #include "matrix4.hpp"
+#include "mesh_simplifier.hpp"
 #include "plane.hpp"
 #include "system_interface.hpp"
 #include "triangle_intersection.hpp"
@@ -55,6 +56,10 @@ texture::mapping_mode model::mapping = texture::LINEAR_MIPMAP_LINEAR; // texture
 
 unsigned model::init_count = 0;
 
+unsigned model::lod_levels = 0;
+
+float model::lod_pixel_error = 1.0f;
+
 /*
 fixme: possible cleanup/simplification of rendering EVERYWHERE:
 0) maybe introduce a camera class that generates projection and camera modelview
@@ -189,21 +194,21 @@ auto model::object::find(const std::string& name_) const -> const model::object*
     return nullptr;
 }
 
-void model::object::display(const texture* caustic_map) const
+void model::object::display(const texture* caustic_map, unsigned lod) const
 {
     glPushMatrix();
     glTranslated(translation.x, translation.y, translation.z);
     glRotated(rotat_angle, rotat_axis.x, rotat_axis.y, rotat_axis.z);
     if (mymesh != nullptr) {
-        mymesh->display(caustic_map);
+        mymesh->display(caustic_map, lod);
     }
     for (const auto& it : children) {
-        it.display(caustic_map);
+        it.display(caustic_map, lod);
     }
     glPopMatrix();
 }
 
-void model::object::display_mirror_clip() const
+void model::object::display_mirror_clip(unsigned lod) const
 {
     // matrix mode is GL_MODELVIEW and active texture is GL_TEXTURE1 here
     glPushMatrix();
@@ -211,10 +216,10 @@ void model::object::display_mirror_clip() const
     glRotated(rotat_angle, rotat_axis.x, rotat_axis.y, rotat_axis.z);
 
     if (mymesh != nullptr) {
-        mymesh->display_mirror_clip();
+        mymesh->display_mirror_clip(lod);
     }
     for (const auto& it : children) {
-        it.display_mirror_clip();
+        it.display_mirror_clip(lod);
     }
 
     glPopMatrix();
@@ -359,6 +364,9 @@ model::model(string filename_, bool use_material)
 
     compute_bounds();
     compute_normals();
+    if (lod_levels > 0) {
+        compute_lods(lod_levels);
+    }
     compile();
 
     // try to read physical data file, needs min/max data etc., so call it after
@@ -784,6 +792,47 @@ auto model::mesh::get_nr_of_triangles() const -> unsigned
     }
 }
 
+auto model::mesh::get_nr_of_triangles(unsigned lod) const -> unsigned
+{
+    if (lod == 0 || lods.empty()) {
+        return get_nr_of_triangles();
+    }
+    return get_lod_indices(lod).first->size() / 3;
+}
+
+void model::mesh::compute_lods(unsigned nr_of_levels)
+{
+    lods.clear();
+    if (indices_type != pt_triangles) {
+        return;
+    }
+    auto levels = mesh_simplifier::compute_lod_chain(vertices, indices, normals, texcoords, nr_of_levels);
+    for (auto& level : levels) {
+        auto l     = std::make_unique<lod_level>();
+        l->indices = std::move(level.indices);
+        l->error   = level.error;
+        lods.push_back(std::move(l));
+    }
+}
+
+auto model::mesh::get_lod_error(unsigned lod) const -> float
+{
+    if (lod == 0 || lods.empty()) {
+        return 0.f;
+    }
+    return lods[std::min(lod, unsigned(lods.size())) - 1]->error;
+}
+
+auto model::mesh::get_lod_indices(unsigned lod) const
+    -> std::pair<const std::vector<uint32_t>*, const vertexbufferobject*>
+{
+    if (lod == 0 || lods.empty()) {
+        return {&indices, &index_data};
+    }
+    const auto& l = *lods[std::min(lod, unsigned(lods.size())) - 1];
+    return {&l.indices, &l.index_data};
+}
+
 void model::mesh::get_plain_triangle(unsigned triangle, uint32_t idx[3]) const
 {
     unsigned t = triangle * 3;
@@ -927,6 +976,9 @@ void model::mesh::compile()
     // performance. OpenGL can do it for use, when we use glDrawRangeElements()
     // later.
     index_data.init_data(indices.size() * 4 /* index type is uint32_t! */, (indices).data(), GL_STATIC_DRAW);
+    for (auto& l : lods) {
+        l->index_data.init_data(l->indices.size() * 4, l->indices.data(), GL_STATIC_DRAW);
+    }
 }
 
 void model::mesh::transform(const matrix4f& m)
@@ -1727,7 +1779,7 @@ void model::material_glsl::get_all_layout_names(std::set<std::string>& result) c
     }
 }
 
-void model::mesh::display(const texture* caustic_map) const
+void model::mesh::display(const texture* caustic_map, unsigned lod) const
 {
     // set up material
     if (mymaterial != nullptr) {
@@ -1786,9 +1838,10 @@ void model::mesh::display(const texture* caustic_map) const
     vbo_positions.unbind();
 
     // render geometry, glDrawRangeElements is faster than glDrawElements.
-    index_data.bind();
-    glDrawRangeElements(gl_primitive_type(), 0, vertices.size() - 1, indices.size(), GL_UNSIGNED_INT, nullptr);
-    index_data.unbind();
+    auto [lod_indices, lod_index_data] = get_lod_indices(lod);
+    lod_index_data->bind();
+    glDrawRangeElements(gl_primitive_type(), 0, vertices.size() - 1, lod_indices->size(), GL_UNSIGNED_INT, nullptr);
+    lod_index_data->unbind();
 
     // maybe: add code to show normals as Lines
 
@@ -1805,7 +1858,7 @@ void model::mesh::display(const texture* caustic_map) const
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void model::mesh::display_mirror_clip() const
+void model::mesh::display_mirror_clip(unsigned lod) const
 {
     // matrix mode is GL_MODELVIEW and active texture is GL_TEXTURE1 here
     bool has_texture_u0 = false;
@@ -1835,9 +1888,10 @@ void model::mesh::display_mirror_clip() const
     vbo_positions.unbind();
 
     // render geometry
-    index_data.bind();
-    glDrawRangeElements(gl_primitive_type(), 0, vertices.size() - 1, indices.size(), GL_UNSIGNED_INT, nullptr);
-    index_data.unbind();
+    auto [lod_indices, lod_index_data] = get_lod_indices(lod);
+    lod_index_data->bind();
+    glDrawRangeElements(gl_primitive_type(), 0, vertices.size() - 1, lod_indices->size(), GL_UNSIGNED_INT, nullptr);
+    lod_index_data->unbind();
 
     glDisableClientState(GL_NORMAL_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
@@ -1858,7 +1912,7 @@ void model::set_layout(const std::string& layout)
     current_layout = layout;
 }
 
-void model::display(const texture* caustic_map) const
+void model::display(const texture* caustic_map, unsigned lod) const
 {
     if (current_layout.length() == 0) {
         THROW(error, filename + ": trying to render model, but no layout was set yet");
@@ -1867,24 +1921,53 @@ void model::display(const texture* caustic_map) const
     // default scene: no objects, just draw all meshes.
     if (scene.children.empty()) {
         for (auto* meshe : meshes) {
-            meshe->display(caustic_map);
+            meshe->display(caustic_map, lod);
         }
     } else {
-        scene.display(caustic_map);
+        scene.display(caustic_map, lod);
     }
 }
 
-void model::display_mirror_clip() const
+void model::display_mirror_clip(unsigned lod) const
 {
     // set up a object->worldspace transformation matrix in tex unit#1 matrix.
     if (scene.children.empty()) {
         // default scene: no objects, just draw all meshes.
         for (auto* meshe : meshes) {
-            meshe->display_mirror_clip();
+            meshe->display_mirror_clip(lod);
         }
     } else {
-        scene.display_mirror_clip();
+        scene.display_mirror_clip(lod);
+    }
+}
+
+void model::compute_lods(unsigned nr_of_levels)
+{
+    unsigned max_lods = 0;
+    for (auto* meshe : meshes) {
+        meshe->compute_lods(nr_of_levels);
+        max_lods = std::max(max_lods, unsigned(meshe->lods.size()));
     }
+    // meshes with less levels use their coarsest level for the others
+    lod_errors.clear();
+    for (unsigned lod = 1; lod <= max_lods; ++lod) {
+        float err = 0.f;
+        for (auto* meshe : meshes) {
+            err = std::max(err, meshe->get_lod_error(lod));
+        }
+        lod_errors.push_back(err);
+    }
+    log_info("model " << filename << ": computed " << lod_errors.size() << " levels of detail");
+}
+
+auto model::select_lod(double pixels_per_meter) const -> unsigned
+{
+    for (auto lod = unsigned(lod_errors.size()); lod > 0; --lod) {
+        if (lod_errors[lod - 1] * pixels_per_meter <= lod_pixel_error) {
+            return lod;
+        }
+    }
+    return 0;
 }
 
 auto model::get_mesh(unsigned nr) -> model::mesh&
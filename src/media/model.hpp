@@ -226,13 +226,15 @@ class model
         double volume;
 
         unsigned get_nr_of_triangles() const;
+        /// number of triangles rendered for a level of detail
+        unsigned get_nr_of_triangles(unsigned lod) const;
         void get_triangle(unsigned triangle, uint32_t indices[3]) const
         {
             ((*this).*(get_triangle_ptr))(triangle, indices);
         }
 
-        void display(const texture* caustic_map = nullptr) const;
-        void display_mirror_clip() const;
+        void display(const texture* caustic_map = nullptr, unsigned lod = 0) const;
+        void display_mirror_clip(unsigned lod = 0) const;
         void compute_vertex_bounds();
         void compute_bounds(vector3f& totmin, vector3f& totmax, const matrix4f& transmat);
         void compute_normals();
@@ -291,6 +293,21 @@ class model
         bool has_bv_tree() const { return !bounding_volume_tree.empty(); }
         const bv_tree& get_bv_tree() const { return bounding_volume_tree; }
 
+        /// a simplified level of detail, uses the vertex data of the mesh
+        struct lod_level
+        {
+            std::vector<uint32_t> indices; // 3 indices per face
+            vertexbufferobject index_data{true};
+            float error{0.f}; // geometric error in model space
+        };
+        /// levels of detail 1...n, level 0 is the mesh itself
+        std::vector<std::unique_ptr<lod_level>> lods;
+
+        /// compute levels of detail by edge collapse, only for triangles
+        void compute_lods(unsigned nr_of_levels);
+        /// get geometric error of a level of detail
+        float get_lod_error(unsigned lod) const;
+
         void get_plain_triangle(unsigned triangle, uint32_t idx[3]) const;
         void get_strip_triangle(unsigned triangle, uint32_t idx[3]) const;
 
@@ -306,6 +323,8 @@ class model
       protected:
         primitive_type indices_type;
         bv_tree bounding_volume_tree;
+        /// get indices and index buffer to render for a level of detail
+        std::pair<const std::vector<uint32_t>*, const vertexbufferobject*> get_lod_indices(unsigned lod) const;
         void (model::mesh::*get_triangle_ptr)(unsigned triangle, uint32_t indices[3]) const;
 
       private:
@@ -373,8 +392,8 @@ class model
         object* find(const std::string& name);
         [[nodiscard]] const object* find(unsigned id) const;
         [[nodiscard]] const object* find(const std::string& name) const;
-        void display(const texture* caustic_map = nullptr) const;
-        void display_mirror_clip() const;
+        void display(const texture* caustic_map = nullptr, unsigned lod = 0) const;
+        void display_mirror_clip(unsigned lod = 0) const;
         void compute_bounds(vector3f& min, vector3f& max, const matrix4f& transmat) const;
         [[nodiscard]] matrix4f get_transformation() const;
     };
@@ -393,6 +412,9 @@ class model
     vector3f min, max;
     double boundsphere_radius;
 
+    /// geometric error per level of detail, maximum of all meshes
+    std::vector<float> lod_errors;
+
     std::string current_layout;
 
     // class-wide variables: shaders supported and enabled, shader number and
@@ -467,20 +489,34 @@ class model
 
     static texture::mapping_mode mapping; // GL_* mapping constants (default GL_LINEAR_MIPMAP_LINEAR)
 
+    /// number of levels of detail to compute when loading models, 0 for none
+    static unsigned lod_levels;
+    /// maximum geometric error on screen in pixels when selecting a level of detail
+    static float lod_pixel_error;
+
     model(std::string filename, bool use_material = true);
     ~model();
     static const std::string default_layout;
     void set_layout(const std::string& layout = default_layout);
     // extend method by matrix4(f) for additional transformation, to avoid
     // that the user has to du glPushMatrix/manipulate/glPopMatrix
-    void display(const texture* caustic_map = nullptr) const;
+    void display(const texture* caustic_map = nullptr, unsigned lod = 0) const;
     /** display model but clip away coords with z < 0 in world space.
         @note! set up texture matrix for unit 1 so that it contains
         object to world-space transformation, and set up modelview
         matrix so that it contains worldspace to viewer transformation
         with z-mirroring.
     */
-    void display_mirror_clip() const;
+    void display_mirror_clip(unsigned lod = 0) const;
+    /// compute levels of detail for all meshes, called on load if lod_levels > 0
+    void compute_lods(unsigned nr_of_levels);
+    /// get number of levels of detail including the full model (level 0)
+    [[nodiscard]] unsigned get_nr_of_lods() const { return unsigned(lod_errors.size()) + 1; }
+    /// get geometric error of a level of detail in model space
+    [[nodiscard]] float get_lod_error(unsigned lod) const { return lod == 0 ? 0.f : lod_errors.at(lod - 1); }
+    /// select the coarsest level of detail with a screen error below lod_pixel_error
+    ///@param pixels_per_meter - screen size of one meter at the model's distance
+    [[nodiscard]] unsigned select_lod(double pixels_per_meter) const;
     mesh& get_mesh(unsigned nr);
     [[nodiscard]] const mesh& get_mesh(unsigned nr) const;
     /// get mesh at root of object tree or first mesh if no tree defined
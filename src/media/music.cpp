@@ -37,7 +37,7 @@ using namespace std;
 #define SFX_CHANNELS_TOTAL  8
 #define SFX_CHANNEL_MACHINE 0
 
-bool music::use_music = true;
+std::atomic<bool> music::use_music{true};
 
 music::music(bool useit, unsigned sample_rate_)
     : sample_rate(sample_rate_)
@@ -50,8 +50,16 @@ music::music(bool useit, unsigned sample_rate_)
 
 music::~music()
 {
-    player->request_abort();
-    command_queue.wakeup_receiver();
+    if (player != nullptr) {
+        player->request_abort();
+        {
+            std::unique_lock<std::mutex> ml(wake_mutex);
+            wake_cond.notify_all();
+        }
+        player.reset();
+    }
+    log_info("Music command calls: " << call_latency);
+    log_info("Music commands dropped: " << nr_dropped_commands << ", failed: " << nr_failed_commands);
 }
 
 void music::start_play_track(unsigned nr, unsigned fadeintime)
@@ -79,16 +87,11 @@ void music::callback_track_finished()
     instance().track_finished();
 }
 
-void music::player_code()
+auto music::open_audio() -> bool
 {
-    if (!use_music) {
-        return;
-    }
-
     if (SDL_Init(SDL_INIT_AUDIO) != 0) {
         log_warning("Unable to to initialize SDL Audio: " << SDL_GetError());
-        use_music = false;
-        return;
+        return false;
     }
 
     int audio_rate        = int(sample_rate);
@@ -100,19 +103,20 @@ void music::player_code()
 
     if (Mix_OpenAudio(audio_rate, audio_format, audio_channels, audio_buffers) != 0) {
         log_warning("Unable to initialize audio: " << Mix_GetError());
-        use_music = false;
-        return;
+        return false;
     }
 
     Mix_HookMusicFinished(callback_track_finished);
 
     // allocate channels
     if (Mix_AllocateChannels(SFX_CHANNELS_TOTAL) < int(SFX_CHANNELS_TOTAL)) {
+        Mix_CloseAudio();
         THROW(error, "could not allocate enough channels");
     }
 
     // reserve sfx channels for environmental noises (engine, sonar)
     if (Mix_ReserveChannels(nr_reserved_channels) < int(nr_reserved_channels)) {
+        Mix_CloseAudio();
         THROW(error, "could not reserve enough channels");
     }
 
@@ -156,15 +160,11 @@ void music::player_code()
         throw;
     }
 #endif
+    return true;
+}
 
-    while (!player->abort_requested()) {
-        command_queue.process_messages();
-    }
-
-    if (!use_music) {
-        return;
-    }
-
+void music::close_audio()
+{
     // halt
     if (Mix_PlayingMusic() != 0) {
         Mix_HaltMusic();
@@ -180,89 +180,280 @@ void music::player_code()
     Mix_CloseAudio();
 }
 
+void music::player_code()
+{
+    try {
+        if (use_music && open_audio()) {
+            while (!player->abort_requested()) {
+                process_commands();
+                wait_for_commands();
+            }
+            discard_commands();
+            close_audio();
+            return;
+        }
+    }
+    catch (std::exception& e) {
+        log_warning("Music player failed: " << e.what());
+    }
+    // without audio, further commands are not sent, but commands may already
+    // be on their way. Answer them until the music object is destroyed, so
+    // no caller waits forever for a query.
+    use_music = false;
+    while (!player->abort_requested()) {
+        discard_commands();
+        wait_for_commands();
+    }
+    discard_commands();
+}
+
+void music::wait_for_commands()
+{
+    std::unique_lock<std::mutex> ml(wake_mutex);
+    player_waiting = true;
+    // pairs with the fence in wake_player, either we see the new command
+    // or the sender sees that we wait
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_cond.wait(ml, [this]() {
+        return !commands.empty() || track_finished_pending.load() || player->abort_requested();
+    });
+    player_waiting = false;
+}
+
 // -------------------- commands --------------------
 
+template<typename F>
+auto music::send(F&& func) -> bool
+{
+    if (!use_music || player == nullptr) {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const bool sent  = commands.push(std::forward<F>(func));
+    if (sent) {
+        wake_player();
+    } else {
+        ++nr_dropped_commands;
+    }
+    call_latency.add(std::chrono::steady_clock::now() - start);
+    return sent;
+}
+
+template<typename T, typename F>
+auto music::send_query(F&& func) -> std::future<T>
+{
+    auto result      = std::make_shared<std::promise<T>>();
+    auto result_fut  = result->get_future();
+    const bool sent  = send([&](command& c) {
+        c.type  = command_type::query;
+        c.query = [result, func](bool run) {
+            try {
+                result->set_value(run ? func() : T());
+            }
+            catch (...) {
+                result->set_exception(std::current_exception());
+            }
+        };
+    });
+    if (!sent) {
+        result->set_value(T());
+    }
+    return result_fut;
+}
+
+void music::wake_player()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (player_waiting.load(std::memory_order_relaxed)) {
+        // lock so the notification can't get lost between test and wait of the player
+        std::unique_lock<std::mutex> ml(wake_mutex);
+        wake_cond.notify_one();
+    }
+}
+
+void music::process_commands()
+{
+    commands.pop_all([this](command& c) {
+        try {
+            execute(c);
+        }
+        catch (std::exception& /*e*/) {
+            // avoid to spam the log, commands fail e.g. when there is no music to stop.
+            ++nr_failed_commands;
+        }
+        c.query = nullptr;
+    });
+    if (track_finished_pending.exchange(false)) {
+        try {
+            exec_track_finished();
+        }
+        catch (std::exception& /*e*/) {
+            ++nr_failed_commands;
+        }
+    }
+}
+
+void music::execute(command& c)
+{
+    switch (c.type) {
+        case command_type::append_track:
+            exec_append_track(c.name);
+            break;
+        case command_type::set_playback_mode:
+            exec_set_playback_mode(playback_mode(c.value1));
+            break;
+        case command_type::play:
+            exec_play(c.value1);
+            break;
+        case command_type::stop:
+            exec_stop(c.value1);
+            break;
+        case command_type::pause:
+            exec_pause();
+            break;
+        case command_type::resume:
+            exec_resume();
+            break;
+        case command_type::set_music_position:
+            exec_set_music_position(c.pos);
+            break;
+        case command_type::play_track:
+            exec_play_track(c.value1, c.value2, c.value3);
+            break;
+        case command_type::play_sfx:
+            exec_play_sfx(c.name, c.listener, c.listener_dir, c.noise_pos);
+            break;
+        case command_type::play_sfx_machine:
+            exec_play_sfx_machine(c.name, c.value1);
+            break;
+        case command_type::pause_sfx:
+            exec_pause_sfx(c.on);
+            break;
+        case command_type::query:
+            c.query(true);
+            break;
+    }
+}
+
+void music::discard_commands()
+{
+    commands.pop_all([](command& c) {
+        if (c.query) {
+            c.query(false);
+            c.query = nullptr;
+        }
+    });
+}
+
 auto music::append_track(const std::string& filename) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_append_track(*this, filename)));
+    return send([&](command& c) {
+        c.type = command_type::append_track;
+        c.name = filename;
+    });
 }
 
 auto music::set_playback_mode(playback_mode pbm) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_set_playback_mode(*this, pbm)));
+    return send([&](command& c) {
+        c.type   = command_type::set_playback_mode;
+        c.value1 = unsigned(pbm);
+    });
 }
 
 auto music::play(unsigned fadein) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_play(*this, fadein)));
+    return send([&](command& c) {
+        c.type   = command_type::play;
+        c.value1 = fadein;
+    });
 }
 
 auto music::stop(unsigned fadeout) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_stop(*this, fadeout)));
+    return send([&](command& c) {
+        c.type   = command_type::stop;
+        c.value1 = fadeout;
+    });
 }
 
 auto music::pause() -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_pause(*this)));
+    return send([](command& c) { c.type = command_type::pause; });
 }
 
 auto music::resume() -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_resume(*this)));
+    return send([](command& c) { c.type = command_type::resume; });
 }
 
 auto music::set_music_position(float pos) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_set_music_position(*this, pos)));
+    return send([&](command& c) {
+        c.type = command_type::set_music_position;
+        c.pos  = pos;
+    });
 }
 
 auto music::play_track(unsigned nr, unsigned fadeouttime, unsigned fadeintime) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_play_track(*this, nr, fadeouttime, fadeintime)));
+    return send([&](command& c) {
+        c.type   = command_type::play_track;
+        c.value1 = nr;
+        c.value2 = fadeouttime;
+        c.value3 = fadeintime;
+    });
 }
 
-auto music::track_finished() -> bool
+void music::track_finished()
 {
-    return command_queue.send(std::unique_ptr<message>(new command_track_finished(*this)), false);
+    // called from the SDL mixer thread, so it can't use the command queue
+    track_finished_pending = true;
+    wake_player();
 }
 
-auto music::get_playlist() -> std::vector<std::string>
+auto music::get_playlist() -> std::future<std::vector<std::string>>
 {
-    std::vector<std::string> myplaylist;
-    command_queue.send(std::unique_ptr<message>(new command_get_playlist(*this, myplaylist)));
-    return myplaylist;
+    return send_query<std::vector<std::string>>([this]() { return playlist; });
 }
 
-auto music::get_current_track() -> unsigned
+auto music::get_current_track() -> std::future<unsigned>
 {
-    unsigned track = 0;
-    command_queue.send(std::unique_ptr<message>(new command_get_current_track(*this, track)));
-    return track;
+    return send_query<unsigned>([this]() { return current_track; });
 }
 
-auto music::is_playing() -> bool
+auto music::is_playing() -> std::future<bool>
 {
-    bool isply = false;
-    command_queue.send(std::unique_ptr<message>(new command_is_playing(*this, isply)));
-    return isply;
+    return send_query<bool>([]() { return exec_is_playing(); });
 }
 
 auto music::play_sfx(const std::string& category, const vector3& listener, angle listener_dir, const vector3& noise_pos)
     -> bool
 {
-    return command_queue.send(
-        std::unique_ptr<message>(new command_play_sfx(*this, category, listener, listener_dir, noise_pos)));
+    return send([&](command& c) {
+        c.type         = command_type::play_sfx;
+        c.name         = category;
+        c.listener     = listener;
+        c.listener_dir = listener_dir;
+        c.noise_pos    = noise_pos;
+    });
 }
 
 auto music::play_sfx_machine(const std::string& name, unsigned throttle) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_play_sfx_machine(*this, name, throttle)));
+    return send([&](command& c) {
+        c.type   = command_type::play_sfx_machine;
+        c.name   = name;
+        c.value1 = throttle;
+    });
 }
 
 auto music::pause_sfx(bool on) -> bool
 {
-    return command_queue.send(std::unique_ptr<message>(new command_pause_sfx(*this, on)));
+    return send([&](command& c) {
+        c.type = command_type::pause_sfx;
+        c.on   = on;
+    });
 }
 
 // -------------------- command exec --------------------
@@ -394,21 +585,9 @@ void music::exec_track_finished()
     }
 }
 
-void music::exec_get_playlist(std::vector<std::string>& playlist_)
-{
-    playlist_ = playlist;
-}
-
-void music::exec_get_current_track(unsigned& track) const
+auto music::exec_is_playing() -> bool
 {
-    track = current_track;
-}
-
-void music::exec_is_playing(bool& /*isply*/)
-{
-    if ((Mix_PlayingMusic() == 0) || (Mix_PausedMusic() != 0)) {
-        THROW(error, "music not playing");
-    }
+    return (Mix_PlayingMusic() != 0) && (Mix_PausedMusic() == 0);
 }
 
 void music::exec_play_sfx(
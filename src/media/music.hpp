@@ -29,16 +29,22 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include "angle.hpp"
-#include "message_queue.hpp"
+#include "latency_histogram.hpp"
 #include "random_generator.hpp"
 #include "singleton.hpp"
+#include "spsc_queue.hpp"
 #include "thread.hpp"
 #include "vector3.hpp"
 
 //#include <SDL_mixer.h> // for Mix_Music/Mix_Chunk - forward declaration doesn't work
 typedef struct Mix_Chunk Mix_Chunk;
 typedef struct _Mix_Music Mix_Music;
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -58,6 +64,14 @@ typedef struct _Mix_Music Mix_Music;
 #define SFX_DEPTH_CHARGE_EXPLODE "depth-charge-explode"
 
 /// Handles music and background songs.
+/** All SDL mixer calls are done by the player thread. Commands are passed to
+    it through a lock free queue of preallocated commands and are not waited
+    for, so playing sounds doesn't block the caller. Calls that need a result
+    return a future instead. The player answers queries until the music object
+    is destroyed, with default values if audio is not available, so futures
+    are always fulfilled. Commands must be sent from one thread only (the
+    main thread).
+*/
 class music : public singleton<class music>
 {
   public:
@@ -76,33 +90,35 @@ class music : public singleton<class music>
     ~music();
 
     // ----------- command interface --------------------
+    // commands return true if they were queued, execution errors are only
+    // counted, as before sending a command never throws.
 
     /// append entry to play list
     ///@param filename - filename of track
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool append_track(const std::string& filename);
 
     /// set playback mode
     ///@param pbm - either loop list, loop track or shuffle tracks
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool set_playback_mode(playback_mode pbm);
 
     /// start playing music
     ///@param fadein - fadein time
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool play(unsigned fadein = 0);
 
     /// stop playing music
     ///@param fadeout - fadeout time
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool stop(unsigned fadeout = 0);
 
     /// pause music play
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool pause();
 
     /// resume music play
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool resume();
 
     /// set music position
@@ -112,48 +128,57 @@ class music : public singleton<class music>
     ///@param nr - number of track in playlist
     ///@param fadeouttime - time to fadeout current playback
     ///@param fadeintime - time to fadein new playback
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool play_track(unsigned nr, unsigned fadeouttime = 0, unsigned fadeintime = 0);
 
     /// get a copy of current playlist
-    ///@returns copy of playlist, empty list on error
-    std::vector<std::string> get_playlist();
+    ///@returns future of copy of playlist, empty list on error
+    std::future<std::vector<std::string>> get_playlist();
 
     /// get number of currently played track
-    ///@returns track or 0 on error
-    unsigned get_current_track();
+    ///@returns future of track or 0 on error
+    std::future<unsigned> get_current_track();
 
     /// request if music plays
-    ///@returns state or false on error
-    bool is_playing();
+    ///@returns future of state or false on error
+    std::future<bool> is_playing();
 
     /// play event sfx
     ///@param category - name of category (what event)
     ///@param listener - position of listener
     ///@param listener_dir - angle that listener is facing (around z-axis)
     ///@param noise_pos - position of noise source
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool play_sfx(const std::string& category, const vector3& listener, angle listener_dir, const vector3& noise_pos);
 
     /// play machine (environmental) sfx
     ///@param name - name of machine
     ///@param throttle - throttle level, can be 0...100, 0 stops play
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool play_sfx_machine(const std::string& name, unsigned throttle);
 
     /// Pause/Resume all sound effects
     ///@param on - true to pause, false to resume
-    ///@returns true if command was successful
+    ///@returns true if command was queued
     bool pause_sfx(bool on);
 
     // ---------------------------------------------
 
     /// set to false if you don't want music.  fixme - rather ugly approach!
-    static bool use_music;
+    static std::atomic<bool> use_music;
 
     /// Set sound directory
     void set_sound_dir(const std::string& sd) { sound_dir = sd; }
 
+    /// time the sending thread spent in command calls
+    [[nodiscard]] const latency_histogram& get_call_latency() const { return call_latency; }
+
+    /// number of commands dropped because the queue was full
+    [[nodiscard]] unsigned get_nr_dropped_commands() const { return nr_dropped_commands; }
+
+    /// number of commands whose execution failed
+    [[nodiscard]] unsigned get_nr_failed_commands() const { return nr_failed_commands; }
+
   protected:
     typedef std::unique_ptr<Mix_Music, std::function<void(Mix_Music*)>> mix_music_ptr;
     typedef std::unique_ptr<Mix_Chunk, std::function<void(Mix_Chunk*)>> mix_chunk_ptr;
@@ -166,21 +191,93 @@ class music : public singleton<class music>
     bool stopped{true};
     std::vector<std::string> playlist;
     std::vector<mix_music_ptr> musiclist;
-    message_queue command_queue;
     std::map<std::string, std::vector<mix_chunk_ptr>> sfx_events;
     std::map<std::string, std::vector<mix_chunk_ptr>> sfx_machines;
     Mix_Chunk* current_machine_sfx{nullptr};
     std::string sound_dir; ///< Set from outside
     random_generator rndgen;
+
+    /// what a command does
+    enum class command_type
+    {
+        append_track,
+        set_playback_mode,
+        play,
+        stop,
+        pause,
+        resume,
+        set_music_position,
+        play_track,
+        play_sfx,
+        play_sfx_machine,
+        pause_sfx,
+        query
+    };
+
+    /// a command for the player thread, preallocated in the command queue
+    struct command
+    {
+        static constexpr unsigned reserved_name_length = 64;
+
+        command_type type{command_type::play};
+        std::string name;                ///< track filename, sfx category or machine name
+        vector3 listener;                ///< for play_sfx
+        angle listener_dir;              ///< for play_sfx
+        vector3 noise_pos;               ///< for play_sfx
+        unsigned value1{0};              ///< fade time, track number, throttle or playback mode
+        unsigned value2{0};              ///< fade out time for play_track
+        unsigned value3{0};              ///< fade in time for play_track
+        float pos{0.0F};                 ///< for set_music_position
+        bool on{false};                  ///< for pause_sfx
+        std::function<void(bool)> query; ///< computes result of query, false to give default
+
+        // reserve space, so assigning the usual names doesn't allocate
+        command() { name.reserve(reserved_name_length); }
+    };
+
+    static constexpr unsigned command_queue_size = 256;
+    spsc_queue<command> commands{command_queue_size};
+    std::atomic<bool> track_finished_pending{false}; ///< set by SDL mixer callback
+    std::atomic<bool> player_waiting{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake_cond;
+
+    // statistics, sending side
+    latency_histogram call_latency;
+    unsigned nr_dropped_commands{0};
+    // statistics, player side
+    std::atomic<unsigned> nr_failed_commands{0};
+
+    // declared last, so the thread is ended before the queue is destroyed
     std::unique_ptr<::thread> player;
 
+    /// fill a command with func and queue it, never blocks
+    template<typename F>
+    bool send(F&& func);
+    /// queue a query, its future gets a default value if it can't be run
+    template<typename T, typename F>
+    std::future<T> send_query(F&& func);
+    /// wake up player thread if it waits for commands
+    void wake_player();
+    /// execute all queued commands, player side
+    void process_commands();
+    /// execute one command, player side
+    void execute(command& c);
+    /// fulfill pending queries with defaults, player side
+    void discard_commands();
+    /// sleep until commands are queued or abort is requested, player side
+    void wait_for_commands();
+
     void start_play_track(unsigned nr, unsigned fadeintime = 0);
     static void callback_track_finished();
 
+    /// initialize SDL mixer, false if there is no audio, throws on errors
+    bool open_audio();
+    void close_audio();
     void player_code();
 
     // internal command(s)
-    bool track_finished();
+    void track_finished();
 
     void exec_append_track(const std::string& filename);
     void exec_set_playback_mode(playback_mode pbm);
@@ -191,249 +288,9 @@ class music : public singleton<class music>
     static void exec_set_music_position(float pos);
     void exec_play_track(unsigned nr, unsigned fadeouttime, unsigned fadeintime);
     void exec_track_finished();
-    void exec_get_playlist(std::vector<std::string>& playlist);
-    void exec_get_current_track(unsigned& track) const;
-    static void exec_is_playing(bool& isply);
+    static bool exec_is_playing();
     void
     exec_play_sfx(const std::string& category, const vector3& listener, angle listener_dir, const vector3& noise_pos);
     void exec_play_sfx_machine(const std::string& name, unsigned throttle);
     static void exec_pause_sfx(bool on);
-
-    class command_append_track : public message
-    {
-        music& my_music;
-        std::string filename;
-        void eval() const override { my_music.exec_append_track(filename); }
-
-      public:
-        command_append_track(music& my_music_, std::string filename_)
-            : my_music(my_music_)
-            , filename(std::move(filename_))
-        {
-        }
-    };
-
-    class command_set_playback_mode : public message
-    {
-        music& my_music;
-        playback_mode pbm;
-        void eval() const override { my_music.exec_set_playback_mode(pbm); }
-
-      public:
-        command_set_playback_mode(music& my_music_, playback_mode pbm_)
-            : my_music(my_music_)
-            , pbm(pbm_)
-        {
-        }
-    };
-
-    class command_play : public message
-    {
-        music& my_music;
-        unsigned fadein;
-        void eval() const override { my_music.exec_play(fadein); }
-
-      public:
-        command_play(music& my_music_, unsigned fadein_)
-            : my_music(my_music_)
-            , fadein(fadein_)
-        {
-        }
-    };
-
-    class command_stop : public message
-    {
-        music& my_music;
-        unsigned fadeout;
-        void eval() const override { my_music.exec_stop(fadeout); }
-
-      public:
-        command_stop(music& my_music_, unsigned fadeout_)
-            : my_music(my_music_)
-            , fadeout(fadeout_)
-        {
-        }
-    };
-
-    class command_pause : public message
-    {
-        music& my_music;
-        void eval() const override { my_music.exec_pause(); }
-
-      public:
-        command_pause(music& my_music_)
-            : my_music(my_music_)
-        {
-        }
-    };
-
-    class command_resume : public message
-    {
-        music& my_music;
-        void eval() const override { my_music.exec_resume(); }
-
-      public:
-        command_resume(music& my_music_)
-            : my_music(my_music_)
-        {
-        }
-    };
-
-    class command_set_music_position : public message
-    {
-        music& my_music;
-        float pos;
-        void eval() const override { my_music.exec_set_music_position(pos); }
-
-      public:
-        command_set_music_position(music& my_music_, float pos_)
-            : my_music(my_music_)
-            , pos(pos_)
-        {
-        }
-    };
-
-    class command_play_track : public message
-    {
-        music& my_music;
-        unsigned nr;
-        unsigned fadeouttime;
-        unsigned fadeintime;
-        void eval() const override { my_music.exec_play_track(nr, fadeouttime, fadeintime); }
-
-      public:
-        command_play_track(music& my_music_, unsigned nr_, unsigned fadeouttime_, unsigned fadeintime_)
-            : my_music(my_music_)
-            , nr(nr_)
-            , fadeouttime(fadeouttime_)
-            , fadeintime(fadeintime_)
-        {
-        }
-    };
-
-    class command_track_finished : public message
-    {
-        music& my_music;
-        void eval() const override { my_music.exec_track_finished(); }
-
-      public:
-        command_track_finished(music& my_music_)
-            : my_music(my_music_)
-        {
-        }
-    };
-
-    class command_get_playlist : public message
-    {
-        music& my_music;
-        std::vector<std::string>& playlist;
-        void eval() const override { my_music.exec_get_playlist(playlist); }
-
-      public:
-        command_get_playlist(music& my_music_, std::vector<std::string>& playlist_)
-            : my_music(my_music_)
-            , playlist(playlist_)
-        {
-        }
-    };
-
-    class command_get_current_track : public message
-    {
-        music& my_music;
-        unsigned& track;
-        void eval() const override { my_music.exec_get_current_track(track); }
-
-      public:
-        command_get_current_track(music& my_music_, unsigned& track_)
-            : my_music(my_music_)
-            , track(track_)
-        {
-        }
-    };
-
-    class command_is_playing : public message
-    {
-        music& my_music;
-        bool& isply;
-        void eval() const override { my_music.exec_is_playing(isply); }
-
-      public:
-        command_is_playing(music& my_music_, bool& isply_)
-            : my_music(my_music_)
-            , isply(isply_)
-        {
-        }
-    };
-
-    class command_play_sfx : public message
-    {
-        music& my_music;
-        std::string category;
-        vector3 listener;
-        angle listener_dir;
-        vector3 noise_pos;
-        void eval() const override { my_music.exec_play_sfx(category, listener, listener_dir, noise_pos); }
-
-      public:
-        command_play_sfx(
-            music& my_music_,
-            std::string category_,
-            vector3 listener_,
-            angle listener_dir_,
-            vector3 noise_pos_)
-            : my_music(my_music_)
-            , category(std::move(category_))
-            , listener(std::move(listener_))
-            , listener_dir(std::move(listener_dir_))
-            , noise_pos(std::move(noise_pos_))
-        {
-        }
-    };
-
-    class command_play_sfx_machine : public message
-    {
-        music& my_music;
-        std::string name;
-        unsigned throttle;
-        void eval() const override { my_music.exec_play_sfx_machine(name, throttle); }
-
-      public:
-        command_play_sfx_machine(music& my_music_, std::string name_, unsigned throttle_)
-            : my_music(my_music_)
-            , name(std::move(name_))
-            , throttle(throttle_)
-        {
-        }
-    };
-
-    class command_pause_sfx : public message
-    {
-        music& my_music;
-        bool on;
-        void eval() const override { my_music.exec_pause_sfx(on); }
-
-      public:
-        command_pause_sfx(music& my_music_, bool on_)
-            : my_music(my_music_)
-            , on(on_)
-        {
-        }
-    };
 };
-
-/* data for command generator, save to file --- snip ---
-music
-append_track std::string filename
-set_playback_mode playback_mode pbm
-play unsigned fadein=0
-stop unsigned fadeout=0
-pause
-resume
-play_track unsigned nr unsigned fadeouttime=0 unsigned fadeintime=0
-track_finished
-get_playlist std::vector<std::string>& playlist
-get_current_track unsigned& track
-is_playing bool& isply
-play_sfx std::string category vector3 listener angle listener_dir vector3
-noise_pos play_sfx_machine std::string name unsigned throttle pause_sfx bool on
---- snap --- */
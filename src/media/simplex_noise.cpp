@@ -1,5 +1,6 @@
 #include "simplex_noise.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 auto simplex_noise::noise_map2D(vector2i size, unsigned ocatves, float persistence, float coord_factor)
@@ -10,9 +11,22 @@ auto simplex_noise::noise_map2D(vector2i size, unsigned ocatves, float persisten
     double scale = 0.0;
     std::vector<double> values(size.x * size.y);
     std::vector<uint8_t> map(size.x * size.y);
+    // evaluate noise row by row, same computation as noise() per point
+    std::vector<double> xs(size.x), ys(size.x), row(size.x);
     for (int y = 0; y < size.y; y++) {
+        for (unsigned i = 0; i < ocatves; i++) {
+            const double amplitude = std::pow(persistence, float(i));
+            const double frequency = 1 << i;
+            for (int x = 0; x < size.x; x++) {
+                xs[x] = double(x * coord_factor) * frequency;
+                ys[x] = double(y * coord_factor) * frequency;
+            }
+            noise_row(size.x, xs.data(), ys.data(), row.data());
+            for (int x = 0; x < size.x; x++) {
+                values[y * size.x + x] += row[x] * amplitude;
+            }
+        }
         for (int x = 0; x < size.x; x++) {
-            values[y * size.x + x] = noise(vector2(x * coord_factor, y * coord_factor), ocatves, persistence);
             if (values[y * size.x + x] > max) {
                 max = values[y * size.x + x];
             }
@@ -440,6 +454,201 @@ auto simplex_noise::interpolate4D(const vector4& coord) -> double
     return 27.0 * (n0 + n1 + n2 + n3 + n4);
 }
 
+/* Batch evaluation: points are processed in blocks, each block in stages.
+   Skewing, simplex selection and the corner contributions are branch free
+   loops over the block that the compiler vectorizes, only the hashing of the
+   corners (table lookups) stays scalar. The operations are the same as in
+   interpolate2D/3D in the same order, so double results are identical.
+*/
+namespace {
+constexpr unsigned noise_block_size = 16;
+
+/// same as fastfloor, written so it can be vectorized
+template<typename T>
+inline int fastfloor_branchfree(T x)
+{
+    const int f = int(x);
+    return (x > T(0)) ? f : f - 1;
+}
+
+/// corner contribution, zero outside of the corner's radius
+template<typename T>
+inline T corner_contribution(T t, T dot)
+{
+    // multiply by mask instead of selecting, so the loop can be vectorized
+    const T inside = (t < T(0)) ? T(0) : T(1);
+    t *= t;
+    return t * t * dot * inside;
+}
+} // namespace
+
+auto simplex_noise::get_gradient_index_table() -> std::array<uint8_t, 512>
+{
+    // avoid the modulo per corner, it can't be vectorized
+    std::array<uint8_t, 512> result;
+    for (unsigned i = 0; i < 512; ++i) {
+        result[i] = uint8_t(perm[i] % 12);
+    }
+    return result;
+}
+
+template<typename T>
+void simplex_noise::interpolate2D_row(unsigned n, const T* xs, const T* ys, T* result)
+{
+    constexpr unsigned B       = noise_block_size;
+    static const auto gradient = get_gradient_index_table();
+    for (unsigned b = 0; b < n; b += B) {
+        // all loops run over a full block, so they vectorize, the last block
+        // is padded
+        const unsigned m = std::min(B, n - b);
+        T px[B] = {}, py[B] = {};
+        std::copy_n(xs + b, m, px);
+        std::copy_n(ys + b, m, py);
+        T x0[B], y0[B], x1[B], y1[B], x2[B], y2[B];
+        int i[B], j[B], i1[B];
+        T gx0[B], gy0[B], gx1[B], gy1[B], gx2[B], gy2[B];
+        T res[B];
+        // skew, find cell and simplex
+        for (unsigned k = 0; k < B; ++k) {
+            const T s = (px[k] + py[k]) * T(F2);
+            i[k]      = fastfloor_branchfree(px[k] + s);
+            j[k]      = fastfloor_branchfree(py[k] + s);
+            const T t = (i[k] + j[k]) * T(G2);
+            x0[k]     = px[k] - (i[k] - t);
+            y0[k]     = py[k] - (j[k] - t);
+            i1[k]     = (x0[k] > y0[k]) ? 1 : 0;
+            x1[k]     = x0[k] - i1[k] + T(G2);
+            y1[k]     = y0[k] - (1 - i1[k]) + T(G2);
+            x2[k]     = x0[k] - T(1.0) + T(2.0 * G2);
+            y2[k]     = y0[k] - T(1.0) + T(2.0 * G2);
+        }
+        // hash gradients of the three corners
+        for (unsigned k = 0; k < B; ++k) {
+            const int ii  = i[k] & 255;
+            const int jj  = j[k] & 255;
+            const int gi0 = gradient[ii + perm[jj]];
+            const int gi1 = gradient[(ii + i1[k] + perm[jj + 1 - i1[k]])];
+            const int gi2 = gradient[(ii + 1 + perm[jj + 1])];
+            gx0[k]        = T(grad3[gi0][0]);
+            gy0[k]        = T(grad3[gi0][1]);
+            gx1[k]        = T(grad3[gi1][0]);
+            gy1[k]        = T(grad3[gi1][1]);
+            gx2[k]        = T(grad3[gi2][0]);
+            gy2[k]        = T(grad3[gi2][1]);
+        }
+        // sum up contributions
+        for (unsigned k = 0; k < B; ++k) {
+            const T n0 = corner_contribution(T(0.5) - x0[k] * x0[k] - y0[k] * y0[k], gx0[k] * x0[k] + gy0[k] * y0[k]);
+            const T n1 = corner_contribution(T(0.5) - x1[k] * x1[k] - y1[k] * y1[k], gx1[k] * x1[k] + gy1[k] * y1[k]);
+            const T n2 = corner_contribution(T(0.5) - x2[k] * x2[k] - y2[k] * y2[k], gx2[k] * x2[k] + gy2[k] * y2[k]);
+            res[k]     = T(70.0) * (n0 + n1 + n2);
+        }
+        std::copy_n(res, m, result + b);
+    }
+}
+
+template<typename T>
+void simplex_noise::interpolate3D_row(unsigned n, const T* xs, const T* ys, const T* zs, T* result)
+{
+    constexpr unsigned B       = noise_block_size;
+    static const auto gradient = get_gradient_index_table();
+    for (unsigned b = 0; b < n; b += B) {
+        // all loops run over a full block, so they vectorize, the last block
+        // is padded
+        const unsigned m = std::min(B, n - b);
+        T px[B] = {}, py[B] = {}, pz[B] = {};
+        std::copy_n(xs + b, m, px);
+        std::copy_n(ys + b, m, py);
+        std::copy_n(zs + b, m, pz);
+        T x0[B], y0[B], z0[B];
+        int i[B], j[B], k_[B], i1[B], j1[B], k1[B], i2[B], j2[B], k2[B];
+        T gx0[B], gy0[B], gz0[B], gx1[B], gy1[B], gz1[B], gx2[B], gy2[B], gz2[B], gx3[B], gy3[B], gz3[B];
+        T res[B];
+        // skew, find cell and simplex
+        for (unsigned k = 0; k < B; ++k) {
+            const T s = (px[k] + py[k] + pz[k]) * T(F3);
+            i[k]      = fastfloor_branchfree(px[k] + s);
+            j[k]      = fastfloor_branchfree(py[k] + s);
+            k_[k]     = fastfloor_branchfree(pz[k] + s);
+            const T t = (i[k] + j[k] + k_[k]) * T(G3);
+            x0[k]     = px[k] - (i[k] - t);
+            y0[k]     = py[k] - (j[k] - t);
+            z0[k]     = pz[k] - (k_[k] - t);
+            // offsets of second and third corner, see interpolate3D
+            const int xy = (x0[k] >= y0[k]) ? 1 : 0;
+            const int xz = (x0[k] >= z0[k]) ? 1 : 0;
+            const int yz = (y0[k] >= z0[k]) ? 1 : 0;
+            i1[k]        = xy & xz;
+            j1[k]        = (1 - xy) & yz;
+            k1[k]        = 1 - i1[k] - j1[k];
+            i2[k]        = xy | xz;
+            j2[k]        = (1 - xy) | yz;
+            k2[k]        = 2 - i2[k] - j2[k];
+        }
+        // hash gradients of the four corners
+        for (unsigned k = 0; k < B; ++k) {
+            const int ii  = i[k] & 255;
+            const int jj  = j[k] & 255;
+            const int kk  = k_[k] & 255;
+            const int gi0 = gradient[ii + perm[jj + perm[kk]]];
+            const int gi1 = gradient[ii + i1[k] + perm[jj + j1[k] + perm[kk + k1[k]]]];
+            const int gi2 = gradient[ii + i2[k] + perm[jj + j2[k] + perm[kk + k2[k]]]];
+            const int gi3 = gradient[ii + 1 + perm[jj + 1 + perm[kk + 1]]];
+            gx0[k]        = T(grad3[gi0][0]);
+            gy0[k]        = T(grad3[gi0][1]);
+            gz0[k]        = T(grad3[gi0][2]);
+            gx1[k]        = T(grad3[gi1][0]);
+            gy1[k]        = T(grad3[gi1][1]);
+            gz1[k]        = T(grad3[gi1][2]);
+            gx2[k]        = T(grad3[gi2][0]);
+            gy2[k]        = T(grad3[gi2][1]);
+            gz2[k]        = T(grad3[gi2][2]);
+            gx3[k]        = T(grad3[gi3][0]);
+            gy3[k]        = T(grad3[gi3][1]);
+            gz3[k]        = T(grad3[gi3][2]);
+        }
+        // sum up contributions
+        for (unsigned k = 0; k < B; ++k) {
+            const T x1 = x0[k] - i1[k] + T(G3);
+            const T y1 = y0[k] - j1[k] + T(G3);
+            const T z1 = z0[k] - k1[k] + T(G3);
+            const T x2 = x0[k] - i2[k] + T(2.0 * G3);
+            const T y2 = y0[k] - j2[k] + T(2.0 * G3);
+            const T z2 = z0[k] - k2[k] + T(2.0 * G3);
+            const T x3 = x0[k] - T(1.0) + T(3.0 * G3);
+            const T y3 = y0[k] - T(1.0) + T(3.0 * G3);
+            const T z3 = z0[k] - T(1.0) + T(3.0 * G3);
+            const T n0 = corner_contribution(T(0.6) - x0[k] * x0[k] - y0[k] * y0[k] - z0[k] * z0[k],
+                                             gx0[k] * x0[k] + gy0[k] * y0[k] + gz0[k] * z0[k]);
+            const T n1 = corner_contribution(T(0.6) - x1 * x1 - y1 * y1 - z1 * z1, gx1[k] * x1 + gy1[k] * y1 + gz1[k] * z1);
+            const T n2 = corner_contribution(T(0.6) - x2 * x2 - y2 * y2 - z2 * z2, gx2[k] * x2 + gy2[k] * y2 + gz2[k] * z2);
+            const T n3 = corner_contribution(T(0.6) - x3 * x3 - y3 * y3 - z3 * z3, gx3[k] * x3 + gy3[k] * y3 + gz3[k] * z3);
+            res[k]     = T(32.0) * (n0 + n1 + n2 + n3);
+        }
+        std::copy_n(res, m, result + b);
+    }
+}
+
+void simplex_noise::noise_row(unsigned n, const double* x, const double* y, double* result)
+{
+    interpolate2D_row(n, x, y, result);
+}
+
+void simplex_noise::noise_row(unsigned n, const float* x, const float* y, float* result)
+{
+    interpolate2D_row(n, x, y, result);
+}
+
+void simplex_noise::noise_row(unsigned n, const double* x, const double* y, const double* z, double* result)
+{
+    interpolate3D_row(n, x, y, z, result);
+}
+
+void simplex_noise::noise_row(unsigned n, const float* x, const float* y, const float* z, float* result)
+{
+    interpolate3D_row(n, x, y, z, result);
+}
+
 const int simplex_noise::grad3[12][3] = {
     {1, 1, 0},
     {-1, 1, 0},
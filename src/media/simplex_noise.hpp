@@ -24,7 +24,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "vector3.hpp"
 #include "vector4.hpp"
 
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <vector>
 
 class simplex_noise
@@ -47,11 +49,27 @@ class simplex_noise
     static double interpolate3D(const vector3& coord);
     static double interpolate4D(const vector4& coord);
 
+    static std::array<uint8_t, 512> get_gradient_index_table();
+    template<typename T>
+    static void interpolate2D_row(unsigned n, const T* xs, const T* ys, T* result);
+    template<typename T>
+    static void interpolate3D_row(unsigned n, const T* xs, const T* ys, const T* zs, T* result);
+
   public:
     static double noise(vector2 coord, unsigned ocatves = 1, float persistence = 1.0);
     static double noise(vector3 coord, unsigned ocatves = 1, float persistence = 1.0);
     static double noise(vector4 coord, unsigned ocatves = 1, float persistence = 1.0);
 
+    /// Evaluate one octave of noise for a row of n points given as coordinate arrays.
+    /** Much faster than calling noise() per point, as most of the work is done
+        with vector instructions. Double results are identical to noise(), float
+        results differ by less than 1e-4 for coordinates up to 100.
+    */
+    static void noise_row(unsigned n, const double* x, const double* y, double* result);
+    static void noise_row(unsigned n, const float* x, const float* y, float* result);
+    static void noise_row(unsigned n, const double* x, const double* y, const double* z, double* result);
+    static void noise_row(unsigned n, const float* x, const float* y, const float* z, float* result);
+
     static std::vector<uint8_t>
     noise_map2D(vector2i size, unsigned ocatves = 1, float persistence = 1.0, float coord_factor = 0.01);
 };
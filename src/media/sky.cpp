@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "daysky.hpp"
 #include "game.hpp"
 #include "global_data.hpp"
+#include "log.hpp"
 #include "matrix4.hpp"
 #include "model.hpp"
 #include "moon.hpp"
@@ -39,6 +40,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "texture.hpp"
 
 #include <GL/glu.h>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <memory>
@@ -73,36 +75,28 @@ sky::sky(const double tm, const unsigned int sectors_h, const unsigned int secto
     suntex  = std::make_unique<texture>(get_texture_dir() + "thesun.png", texture::LINEAR);
 
     // ********************************** init clouds
-    // clouds are generated with Perlin noise.
-    // We generate m levels of noise maps, m <= n, texture width = 2^n.
-    // here n = 10.
-    // Each level is a noise map of 2^(n-m+1) pixels wide and high, scaled to
-    // full size. For m = 4 we have 4 maps, 128x128 pixel each, scaled to
-    // 1024x1024, 512x512, 256x256 and 128x128. The maps are tiled and added on
-    // a 1024x1024 map (the result), with descending factors, that means level m
-    // gives factor 1/(2^(m-1)). So we add the 4 maps: 1*map0 + 1/2*map1 +
-    // 1/4*map2 + 1/8*map3. To animate clouds, just interpolate one level's
-    // noise map between two random noise maps. The result s is recomputed:
-    // cover (0-255), sharpness (0-255) clamp(clamp_at_zero(s - cover) *
-    // sharpness) This is used as alpha value for the texture. 0 = no clouds,
-    // transparent, 255 full cloud (white/grey) The final map is mapped to a
-    // hemisphere: Texture coords = height_in_sphere *
-    // cos/sin(direction_in_sphere). That means a circle with radius 512 of the
-    // original map is used.
-
-    cloud_levels    = 5;
+    // clouds are generated with noise maps of several levels, see
+    // cloud_generator. The final map is used as alpha value for the texture.
+    // 0 = no clouds, transparent, 255 full cloud (white/grey)
+    // The final map is mapped to a hemisphere: Texture coords =
+    // height_in_sphere * cos/sin(direction_in_sphere). That means a circle
+    // with radius 128 of the map is used.
+
     cloud_coverage  = 192; // 128;	// 0-256 (none-full)
     cloud_sharpness = 256; // 0-256
     cloud_animphase = 0;
 
-    cloud_interpolate_func.resize(256);
-    for (unsigned n = 0; n < 256; ++n) {
-        cloud_interpolate_func[n] = unsigned(128 - cos(n * M_PI / 256) * 128);
-    }
-
-    noisemaps_0 = compute_noisemaps();
-    noisemaps_1 = compute_noisemaps();
-    compute_clouds();
+    // first map is needed right now, later ones are computed in background
+    cloudgen = std::make_unique<cloud_generator>(uint32_t(rnd() * 4294967295.0));
+    cloudgen->compute(float(cloud_animphase), cloudmap_upload);
+    clouds = std::make_unique<texture>(
+        cloudmap_upload,
+        cloud_generator::map_resolution,
+        cloud_generator::map_resolution,
+        GL_LUMINANCE,
+        texture::LINEAR,
+        texture::REPEAT);
+    cloud_worker = std::make_unique<::thread>("sky-clouds", [this]() { cloud_worker_loop(); });
 
     clouds_texcoords.init_data(nr_sky_vertices * 2 * 4, nullptr, GL_STATIC_DRAW);
     auto* ptr = static_cast<float*>(clouds_texcoords.map(GL_WRITE_ONLY));
@@ -123,148 +117,85 @@ sky::sky(const double tm, const unsigned int sectors_h, const unsigned int secto
     loc_cloudstex = glsl_clouds->get_uniform_location("tex_cloud");
 }
 
+sky::~sky()
+{
+    {
+        std::unique_lock<std::mutex> ml(cloud_mutex);
+        cloud_stop = true;
+    }
+    cloud_cond.notify_one();
+    cloud_worker.reset();
+    log_info(
+        "clouds: " << cloud_uploads << " texture updates, render thread time " << cloud_main_thread_time << " ms");
+}
+
 void sky::advance_cloud_animation(double fac)
 {
-    int oldphase = int(cloud_animphase * 256);
+    const auto start = std::chrono::steady_clock::now();
+    int oldphase     = int(cloud_animphase * 256);
     cloud_animphase += fac;
     int newphase = int(cloud_animphase * 256);
     if (cloud_animphase >= 1.0) {
         cloud_animphase -= 1.0;
-        noisemaps_0 = noisemaps_1;
-        noisemaps_1 = compute_noisemaps();
+        request_clouds(true);
     } else {
         if (newphase > oldphase) {
-            compute_clouds();
+            request_clouds(false);
         }
     }
+    upload_clouds();
+    cloud_main_thread_time +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-void sky::compute_clouds()
+void sky::request_clouds(bool next_cycle)
 {
-    unsigned mapsize  = 8 - cloud_levels;
-    unsigned mapsize2 = (2 << mapsize);
-
-    // FIXME could we interpolate between accumulated noise maps
-    // to further speed up the process?
-    // in theory, yes. formula says that we can...
-    // NO! different noise levels must get animated with different speeds
-    // for realistic cloud form change (isn't done yet)...
-    // also bump mapping for clouds is missing.
-    // clouds facing away from the sun shouldn't be black though (because of
-    // bump mapping).
-    // FIXME use perlin noise generator here!
-    vector<vector<uint8_t>> cmaps = noisemaps_0;
-    float f                       = cloud_animphase;
-    for (unsigned i = 0; i < cloud_levels; ++i) {
-        for (unsigned j = 0; j < mapsize2 * mapsize2; ++j) {
-            cmaps[i][j] = uint8_t(noisemaps_0[i][j] * (1 - f) + noisemaps_1[i][j] * f);
-        }
+    {
+        std::unique_lock<std::mutex> ml(cloud_mutex);
+        // the worker only computes the latest phase, but all cycles count
+        cloud_request_phase = float(cloud_animphase);
+        cloud_request_cycles += next_cycle ? 1 : 0;
+        cloud_requested = true;
     }
-
-    // create full map
-    const unsigned res = 256;
-    vector<uint8_t> fullmap(res * res);
-    unsigned fullmapptr = 0;
-    for (unsigned y = 0; y < res; ++y) {
-        for (unsigned x = 0; x < res; ++x) {
-            unsigned v = 0;
-            // accumulate values
-            for (unsigned k = 0; k < cloud_levels; ++k) {
-                unsigned tv = get_value_from_bytemap(x, y, k, cmaps[k]);
-                v += (tv >> k);
-            }
-            // FIXME generate a lookup table for this function, depending on
-            // coverage/sharpness
-            if (v < 96) {
-                v = 96;
-            }
-            v -= 96;
-            if (v > 255) {
-                v = 255;
-            }
-            fullmap[fullmapptr++] = v;
-        }
-    }
-
-    clouds = std::make_unique<texture>(fullmap, res, res, GL_LUMINANCE, texture::LINEAR, texture::REPEAT);
+    cloud_cond.notify_one();
 }
 
-auto sky::compute_noisemaps() const -> vector<vector<uint8_t>>
+void sky::upload_clouds()
 {
-    unsigned mapsize  = 8 - cloud_levels;
-    unsigned mapsize2 = (2 << mapsize);
-    vector<vector<uint8_t>> noisemaps(cloud_levels);
-    for (unsigned i = 0; i < cloud_levels; ++i) {
-        noisemaps[i].resize(mapsize2 * mapsize2);
-        for (unsigned j = 0; j < mapsize2 * mapsize2; ++j) {
-            noisemaps[i][j] = static_cast<unsigned char>(255 * rnd());
+    {
+        std::unique_lock<std::mutex> ml(cloud_mutex);
+        if (!cloud_ready) {
+            return;
         }
-        smooth_and_equalize_bytemap(mapsize2, noisemaps[i]);
+        cloudmap_ready.swap(cloudmap_upload);
+        cloud_ready = false;
     }
-    return noisemaps;
-}
-
-auto sky::get_value_from_bytemap(unsigned x, unsigned y, unsigned level, const vector<uint8_t>& nmap) -> uint8_t
-{
-    // x,y are in 0...255, shift them according to level
-    unsigned shift    = cloud_levels - 1 - level;
-    unsigned mapshift = 9 - cloud_levels;
-    unsigned mapmask  = (1 << mapshift) - 1;
-    unsigned rshift   = 8 - shift;
-    unsigned xfrac    = ((x << rshift) & 255);
-    unsigned yfrac    = ((y << rshift) & 255);
-    x                 = (x >> shift);
-    y                 = (y >> shift);
-    x                 = x & mapmask;
-    y                 = y & mapmask;
-    unsigned x2       = (x + 1) & mapmask;
-    unsigned y2       = (y + 1) & mapmask;
-
-    xfrac = cloud_interpolate_func[xfrac];
-    yfrac = cloud_interpolate_func[yfrac];
-
-    unsigned v0 = nmap[(y << mapshift) + x];
-    unsigned v1 = nmap[(y << mapshift) + x2];
-    unsigned v2 = nmap[(y2 << mapshift) + x];
-    unsigned v3 = nmap[(y2 << mapshift) + x2];
-    unsigned v4 = (v0 * (256 - xfrac) + v1 * xfrac);
-    unsigned v5 = (v2 * (256 - xfrac) + v3 * xfrac);
-    unsigned v6 = (v4 * (256 - yfrac) + v5 * yfrac);
-    return uint8_t(v6 >> 16);
+    clouds->sub_image(
+        0, 0, cloud_generator::map_resolution, cloud_generator::map_resolution, cloudmap_upload, GL_LUMINANCE);
+    ++cloud_uploads;
 }
 
-void sky::smooth_and_equalize_bytemap(unsigned s, vector<uint8_t>& map1)
+void sky::cloud_worker_loop()
 {
-    vector<uint8_t> map2 = map1;
-    unsigned maxv        = 0;
-    unsigned minv        = 255;
-    for (unsigned y = 0; y < s; ++y) {
-        unsigned y1 = (y + s - 1) % s;
-        unsigned y2 = (y + 1) % s;
-        for (unsigned x = 0; x < s; ++x) {
-            unsigned x1 = (x + s - 1) % s;
-            unsigned x2 = (x + 1) % s;
-            unsigned v  = (unsigned(map2[y1 * s + x1]) + unsigned(map2[y1 * s + x2]) + unsigned(map2[y2 * s + x1])
-                          + unsigned(map2[y2 * s + x2]))
-                             / 16
-                         + (unsigned(map2[y * s + x1]) + unsigned(map2[y * s + x2]) + unsigned(map2[y1 * s + x])
-                            + unsigned(map2[y2 * s + x]))
-                               / 8
-                         + (unsigned(map2[y * s + x])) / 4;
-            map1[y * s + x] = uint8_t(v);
-            if (v < minv) {
-                minv = v;
-            }
-            if (v > maxv) {
-                maxv = v;
-            }
+    std::unique_lock<std::mutex> ml(cloud_mutex);
+    while (true) {
+        cloud_cond.wait(ml, [this]() { return cloud_stop || cloud_requested; });
+        if (cloud_stop) {
+            return;
         }
-    }
-    for (unsigned y = 0; y < s; ++y) {
-        for (unsigned x = 0; x < s; ++x) {
-            unsigned v      = map1[y * s + x];
-            map1[y * s + x] = uint8_t((v - minv) * 255 / (maxv - minv));
+        const float phase = cloud_request_phase;
+        // noise maps of older cycles than the last two are never seen
+        const unsigned cycles = std::min(cloud_request_cycles, 2U);
+        cloud_request_cycles  = 0;
+        cloud_requested       = false;
+        ml.unlock();
+        for (unsigned i = 0; i < cycles; ++i) {
+            cloudgen->next_cycle();
         }
+        cloudgen->compute(phase, cloudmap_work);
+        ml.lock();
+        cloudmap_work.swap(cloudmap_ready);
+        cloud_ready = true;
     }
 }
 
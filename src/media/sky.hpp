@@ -27,14 +27,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
     Stars, atmospheric color, sunglow, sun, moon, clouds, etc.
 */
 
+#include "cloud_generator.hpp"
 #include "color.hpp"
 #include "model.hpp"
 #include "moon.hpp"
 #include "shader.hpp"
 #include "stars.hpp"
+#include "thread.hpp"
 #include "vector3.hpp"
 #include "vertexbufferobject.hpp"
 
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 
 class game;
@@ -49,11 +53,25 @@ class sky
     texture::ptr clouds;
     texture::ptr suntex;
     double cloud_animphase; // 0-1 phase of interpolation
-    std::vector<std::vector<uint8_t>> noisemaps_0,
-        noisemaps_1; // interpolate to animate clouds
     vertexbufferobject clouds_texcoords;
-    unsigned cloud_levels, cloud_coverage, cloud_sharpness;
-    std::vector<unsigned> cloud_interpolate_func; // give fraction as uint8_t
+    unsigned cloud_coverage, cloud_sharpness;
+
+    // cloud maps are computed by a worker, the texture is only updated with
+    // finished maps. The worker fills its own buffer and hands it over in
+    // cloudmap_ready, which is swapped with the upload buffer.
+    std::unique_ptr<cloud_generator> cloudgen; // used by worker only
+    std::vector<uint8_t> cloudmap_work, cloudmap_ready, cloudmap_upload;
+    std::mutex cloud_mutex;
+    std::condition_variable cloud_cond;
+    float cloud_request_phase{0.0f}; // guarded by cloud_mutex
+    unsigned cloud_request_cycles{0};
+    bool cloud_requested{false};
+    bool cloud_ready{false};
+    bool cloud_stop{false};
+    std::unique_ptr<::thread> cloud_worker;
+    // render thread time spent on clouds, for profiling
+    double cloud_main_thread_time{0.0};
+    unsigned cloud_uploads{0};
 
     sky& operator=(const sky& other);
     sky(const sky& other);
@@ -61,10 +79,9 @@ class sky
     // generate new clouds, fac (0-1) gives animation phase. animation is
     // cyclic.
     void advance_cloud_animation(double fac); // 0-1
-    void compute_clouds();
-    std::vector<std::vector<uint8_t>> compute_noisemaps() const;
-    uint8_t get_value_from_bytemap(unsigned x, unsigned y, unsigned level, const std::vector<uint8_t>& nmap);
-    static void smooth_and_equalize_bytemap(unsigned s, std::vector<uint8_t>& map1);
+    void request_clouds(bool next_cycle);
+    void upload_clouds();
+    void cloud_worker_loop();
 
     stars _stars;
     moon _moon;
@@ -85,6 +102,7 @@ class sky
 
   public:
     sky(const double tm = 0.0, const unsigned int sectors_h = 64, const unsigned int sectors_v = 16);
+    ~sky();
     // fixme: this should recompute sky color! not display...
     void set_time(double tm);
 
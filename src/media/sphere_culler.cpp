@@ -0,0 +1,69 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// CPU culling of bounding spheres
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "sphere_culler.hpp"
+
+#include "constant.hpp"
+
+#include <cmath>
+#include <utility>
+
+sphere_culler::sphere_culler(frustum f, double max_view_dist_)
+    : viewfrustum(std::move(f))
+    , max_view_dist(max_view_dist_)
+    , viewer_horizon_dist(horizon_distance(viewfrustum.viewpos.z))
+{
+}
+
+auto sphere_culler::test(const vector3& center, double radius) -> result
+{
+    ++stats.submitted;
+    // cheapest test first, most objects are rejected by distance or frustum
+    const double dist = center.xy().distance(viewfrustum.viewpos.xy()) - radius;
+    if (dist > max_view_dist) {
+        ++stats.culled_distance;
+        return result::too_far;
+    }
+    if (!viewfrustum.is_sphere_visible(center, radius)) {
+        ++stats.culled_frustum;
+        return result::outside_frustum;
+    }
+    // the object is hidden by earth curvature if its top is below the line
+    // of sight that touches the horizon, i.e. the distance is larger than the
+    // sum of the horizon distances of viewer and object top. Below the water
+    // surface there is no horizon, only fog.
+    const double top = center.z + radius;
+    if ((viewfrustum.viewpos.z > 0.0 || top > 0.0) && dist > viewer_horizon_dist + horizon_distance(top)) {
+        ++stats.culled_horizon;
+        return result::beyond_horizon;
+    }
+    return result::visible;
+}
+
+auto sphere_culler::horizon_distance(double height) -> double
+{
+    // d^2 = (r + h)^2 - r^2 = 2rh + h^2
+    if (height <= 0.0) {
+        return 0.0;
+    }
+    return std::sqrt(height * (2.0 * constant::EARTH_RADIUS + height));
+}
@@ -0,0 +1,80 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// CPU culling of bounding spheres
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include "frustum.hpp"
+
+/// Culls bounding spheres by view frustum, view distance and earth curvature.
+/** All tests are done on the CPU with world coordinates, so objects that can't
+    be seen are rejected before any OpenGL state is touched. The culler counts
+    how many spheres were tested and for which reason they were rejected.
+*/
+class sphere_culler
+{
+  public:
+    /// result of a visibility test
+    enum class result
+    {
+        visible,
+        outside_frustum,
+        too_far,
+        beyond_horizon
+    };
+
+    /// counters of tested and culled spheres
+    struct statistics
+    {
+        unsigned submitted{0};
+        unsigned culled_frustum{0};
+        unsigned culled_distance{0};
+        unsigned culled_horizon{0};
+        [[nodiscard]] unsigned culled() const { return culled_frustum + culled_distance + culled_horizon; }
+        [[nodiscard]] unsigned visible() const { return submitted - culled(); }
+    };
+
+    /// create culler
+    ///@param f - view frustum in world coordinates, its viewpos is used for horizon tests
+    ///@param max_view_dist - maximum horizontal view distance
+    sphere_culler(frustum f, double max_view_dist);
+
+    /// test a bounding sphere and count the result
+    result test(const vector3& center, double radius);
+
+    /// test a bounding sphere, true if it could be visible
+    bool is_visible(const vector3& center, double radius) { return test(center, radius) == result::visible; }
+
+    /// get counters
+    [[nodiscard]] const statistics& get_statistics() const { return stats; }
+
+    /// reset counters
+    void reset_statistics() { stats = statistics(); }
+
+    /// distance to the geometric horizon seen from a height above sea level
+    static double horizon_distance(double height);
+
+  protected:
+    frustum viewfrustum;
+    double max_view_dist;
+    double viewer_horizon_dist; // horizon distance of viewer, cached
+    statistics stats;
+};
@@ -36,6 +36,7 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #define M  714025
@@ -50,6 +51,7 @@ class terrain : public height_generator
 
   protected:
     tile_cache<T> m_tile_cache;
+    std::mutex tile_cache_mutex; // heights are computed by several threads
     int num_levels;
     long int resolution, min_height, max_height, tile_size;
     vector2l bounds;
@@ -208,6 +210,9 @@ bivector<float> terrain<T>::generate_patch(int detail, const vector2i& coord_bl,
 
                 coord_geo *= (float) resolution;
 
+                // only the cache lookup needs the lock, so level workers
+                // don't serialize on whole patches
+                std::unique_lock<std::mutex> ml(tile_cache_mutex);
                 patch[vector2i(x, y)] =
                     m_tile_cache.get_value(vector2i(coord_geo.x + origin.x, coord_geo.y + origin.y));
             }
@@ -218,15 +223,19 @@ bivector<float> terrain<T>::generate_patch(int detail, const vector2i& coord_bl,
     if (detail == -1)
         return patch;
 
+    // evaluate noise for a row of points at once, coordinates are float like
+    // with single point evaluation
+    std::vector<double> px(coord_sz.x), py(coord_sz.x), pz(coord_sz.x), noise_row(coord_sz.x);
     for (int y = 0; y < coord_sz.y; ++y) {
         for (int x = 0; x < coord_sz.x; ++x) {
             vector2l coord(coord_bl.x + x, coord_bl.y + y);
-            vector3 point(
-                (coord.x << (detail + 1)) * noise_coord_factor,
-                (coord.y << (detail + 1)) * noise_coord_factor,
-                patch.at(x, y) * noise_coord_factor);
-
-            noise = frac->get_value_hybrid(vector3f(point), num_levels - detail) * scale;
+            px[x] = float((coord.x << (detail + 1)) * noise_coord_factor);
+            py[x] = float((coord.y << (detail + 1)) * noise_coord_factor);
+            pz[x] = float(patch.at(x, y) * noise_coord_factor);
+        }
+        frac->get_values_hybrid(coord_sz.x, px.data(), py.data(), pz.data(), noise_row.data(), num_levels - detail);
+        for (int x = 0; x < coord_sz.x; ++x) {
+            noise = noise_row[x] * scale;
             if ((patch.at(x, y) <= 0.0) && (noise > 0.0))
                 noise *= -1.0;
             if ((patch.at(x, y) >= 0.0) && (noise < 0.0))
@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <SDL.h>
 #include <SDL_image.h>
+#include <cmath>
 #include <fstream>
 #include <glu.h>
 #include <iostream>
@@ -216,6 +217,10 @@ auto sdl_image::get_height() const -> unsigned
 {
     return img->h;
 }
+auto sdl_image::get_byte_size() const -> std::size_t
+{
+    return std::size_t(img->pitch) * img->h;
+}
 
 // --------------------------------------------------
 
@@ -677,6 +682,130 @@ void texture::load_dds(const std::string& filename, dds_data& target)
 }
 #undef MAKEFOURCC
 
+// The texture kernels work on rows and handle the wrapped border texels
+// outside of the inner loops, so the compiler can vectorize them. Where the
+// compiler supports it they are compiled for AVX2 too, and the version that
+// matches the CPU is selected when the program is loaded. Results are
+// identical for all versions.
+#if defined(__x86_64__) && defined(__linux__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define TEXTURE_KERNEL __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef TEXTURE_KERNEL
+#define TEXTURE_KERNEL
+#endif
+
+namespace {
+template<unsigned bpp>
+inline void scale_half_rows(const uint8_t* row0, const uint8_t* row1, unsigned w, uint16_t* sum, uint8_t* dst)
+{
+    for (unsigned i = 0; i < w * bpp; ++i) {
+        sum[i] = uint16_t(row0[i] + row1[i]);
+    }
+    for (unsigned x = 0; x < w / 2; ++x) {
+        for (unsigned b = 0; b < bpp; ++b) {
+            dst[x * bpp + b] = uint8_t((sum[2 * x * bpp + b] + sum[(2 * x + 1) * bpp + b]) / 4);
+        }
+    }
+}
+
+TEXTURE_KERNEL void scale_half_kernel(const uint8_t* src, unsigned w, unsigned h, unsigned bpp, uint8_t* dst)
+{
+    std::vector<uint16_t> sum(w * bpp);
+    for (unsigned y = 0; y + 1 < h; y += 2) {
+        const uint8_t* row0 = src + y * w * bpp;
+        const uint8_t* row1 = row0 + w * bpp;
+        uint8_t* dstrow     = dst + (y / 2) * (w / 2) * bpp;
+        switch (bpp) {
+            case 1:
+                scale_half_rows<1>(row0, row1, w, sum.data(), dstrow);
+                break;
+            case 2:
+                scale_half_rows<2>(row0, row1, w, sum.data(), dstrow);
+                break;
+            case 3:
+                scale_half_rows<3>(row0, row1, w, sum.data(), dstrow);
+                break;
+            case 4:
+                scale_half_rows<4>(row0, row1, w, sum.data(), dstrow);
+                break;
+            default:
+                for (unsigned x = 0; x < w / 2; ++x) {
+                    for (unsigned b = 0; b < bpp; ++b) {
+                        dstrow[x * bpp + b] = uint8_t(
+                            (unsigned(row0[2 * x * bpp + b]) + unsigned(row0[(2 * x + 1) * bpp + b])
+                             + unsigned(row1[2 * x * bpp + b]) + unsigned(row1[(2 * x + 1) * bpp + b]))
+                            / 4);
+                    }
+                }
+        }
+    }
+}
+
+/// copy a row of heights to floats, with the wrapped neighbours at both ends
+inline void load_height_row(const uint8_t* src, unsigned src_bpp, unsigned w, float* row)
+{
+    for (unsigned x = 0; x < w; ++x) {
+        row[x + 1] = src[x * src_bpp];
+    }
+    row[0]     = row[w];
+    row[w + 1] = row[1];
+}
+
+/// compute normals of a height map with wrapping, heights are every src_bpp'th byte
+TEXTURE_KERNEL void make_normals_kernel(
+    const uint8_t* src,
+    unsigned src_bpp,
+    unsigned w,
+    unsigned h,
+    float zh,
+    uint8_t* dst,
+    unsigned dst_bpp)
+{
+    std::vector<float> heights(3 * (w + 2)); // rows above, at and below
+    std::vector<float> dx(w), dy(w);
+    std::vector<uint8_t> nx(w), ny(w), nz(w);
+    float* hu     = &heights[0];
+    float* hc     = &heights[w + 2];
+    float* hd     = &heights[2 * (w + 2)];
+    const float z = zh;
+    for (unsigned yy = 0; yy < h; ++yy) {
+        const unsigned y1 = (yy + h - 1) % h;
+        const unsigned y2 = (yy + 1) % h;
+        load_height_row(src + y1 * w * src_bpp, src_bpp, w, hu);
+        load_height_row(src + yy * w * src_bpp, src_bpp, w, hc);
+        load_height_row(src + y2 * w * src_bpp, src_bpp, w, hd);
+        for (unsigned xx = 0; xx < w; ++xx) {
+            // left minus right, below minus above
+            dx[xx] = hc[xx] - hc[xx + 2];
+            dy[xx] = hd[xx + 1] - hu[xx + 1];
+        }
+        // same operations as vector3f::normal(), to get identical results
+        for (unsigned xx = 0; xx < w; ++xx) {
+            const float len = std::sqrt(dx[xx] * dx[xx] + dy[xx] * dy[xx] + z * z);
+            const float inv = 1.0F / len;
+            nx[xx]          = uint8_t(int32_t(dx[xx] * inv * 127 + 128));
+            ny[xx]          = uint8_t(int32_t(dy[xx] * inv * 127 + 128));
+            nz[xx]          = uint8_t(int32_t(z * inv * 127 + 128));
+        }
+        uint8_t* dstrow = dst + yy * w * dst_bpp;
+        for (unsigned xx = 0; xx < w; ++xx) {
+            dstrow[xx * dst_bpp + 0] = nx[xx];
+            dstrow[xx * dst_bpp + 1] = ny[xx];
+            dstrow[xx * dst_bpp + 2] = nz[xx];
+        }
+        if (dst_bpp == 4) {
+            // alpha channel is kept
+            const uint8_t* srcrow = src + yy * w * src_bpp;
+            for (unsigned xx = 0; xx < w; ++xx) {
+                dstrow[xx * 4 + 3] = srcrow[xx * src_bpp + 1];
+            }
+        }
+    }
+}
+} // namespace
+
 auto texture::scale_half(const vector<uint8_t>& src, unsigned w, unsigned h, unsigned bpp) -> vector<uint8_t>
 {
     if (!size_non_power_two()) {
@@ -689,17 +818,7 @@ auto texture::scale_half(const vector<uint8_t>& src, unsigned w, unsigned h, uns
     }
 
     vector<uint8_t> dst(w * h * bpp / 4);
-    unsigned ptr = 0;
-    for (unsigned y = 0; y < h; y += 2) {
-        for (unsigned x = 0; x < w; x += 2) {
-            for (unsigned b = 0; b < bpp; ++b) {
-                dst[ptr++] = uint8_t(
-                    (unsigned(src[(y * w + x) * bpp + b]) + unsigned(src[(y * w + x + 1) * bpp + b])
-                     + unsigned(src[((y + 1) * w + x) * bpp + b]) + unsigned(src[((y + 1) * w + x + 1) * bpp + b]))
-                    / 4);
-            }
-        }
-    }
+    scale_half_kernel(src.data(), w, h, bpp, dst.data());
     return dst;
 }
 
@@ -712,58 +831,19 @@ auto texture::make_normals(const vector<uint8_t>& src, unsigned w, unsigned h, f
     // This depends on the size of the face the normal map is mapped onto.
     // but all other code is written to match 255/detailh, especially
     // bump scaling in model.cpp, so don't change this!
-    float zh     = /* 2.0f* */ 255.0F / detailh;
-    unsigned ptr = 0;
-    for (unsigned yy = 0; yy < h; ++yy) {
-        unsigned y1 = (yy + h - 1) & (h - 1);
-        unsigned y2 = (yy + 1) & (h - 1);
-        for (unsigned xx = 0; xx < w; ++xx) {
-            unsigned x1  = (xx + w - 1) & (w - 1);
-            unsigned x2  = (xx + 1) & (w - 1);
-            float hr     = src[yy * w + x2];
-            float hu     = src[y1 * w + xx];
-            float hl     = src[yy * w + x1];
-            float hd     = src[y2 * w + xx];
-            vector3f nm  = vector3f(hl - hr, hd - hu, zh).normal();
-            dst[ptr + 0] = uint8_t(nm.x * 127 + 128);
-            dst[ptr + 1] = uint8_t(nm.y * 127 + 128);
-            dst[ptr + 2] = uint8_t(nm.z * 127 + 128);
-            ptr += 3;
-        }
-    }
+    float zh = /* 2.0f* */ 255.0F / detailh;
+    make_normals_kernel(src.data(), 1, w, h, zh, dst.data(), 3);
     return dst;
 }
 
 auto texture::make_normals_with_alpha(const vector<uint8_t>& src, unsigned w, unsigned h, float detailh)
     -> vector<uint8_t>
 {
-    // src size must be w*h
+    // src size must be w*h*2
     vector<uint8_t> dst(4 * w * h);
-    // Note! zh must be multiplied with 2*sample_distance!
-    // sample_distance is real distance between texels, we assume 1 for it...
-    // This depends on the size of the face the normal map is mapped onto.
-    // but all other code is written to match 255/detailh, especially
-    // bump scaling in model.cpp, so don't change this!
-    float zh     = /* 2.0f* */ 255.0F / detailh;
-    unsigned ptr = 0;
-    for (unsigned yy = 0; yy < h; ++yy) {
-        unsigned y1 = (yy + h - 1) & (h - 1);
-        unsigned y2 = (yy + 1) & (h - 1);
-        for (unsigned xx = 0; xx < w; ++xx) {
-            unsigned x1  = (xx + w - 1) & (w - 1);
-            unsigned x2  = (xx + 1) & (w - 1);
-            float hr     = src[2 * (yy * w + x2) + 0];
-            float hu     = src[2 * (y1 * w + xx) + 0];
-            float hl     = src[2 * (yy * w + x1) + 0];
-            float hd     = src[2 * (y2 * w + xx) + 0];
-            vector3f nm  = vector3f(hl - hr, hd - hu, zh).normal();
-            dst[ptr + 0] = uint8_t(nm.x * 127 + 128);
-            dst[ptr + 1] = uint8_t(nm.y * 127 + 128);
-            dst[ptr + 2] = uint8_t(nm.z * 127 + 128);
-            dst[ptr + 3] = src[2 * (yy * w + xx) + 1];
-            ptr += 4;
-        }
-    }
+    // see make_normals
+    float zh = /* 2.0f* */ 255.0F / detailh;
+    make_normals_kernel(src.data(), 2, w, h, zh, dst.data(), 4);
     return dst;
 }
 
@@ -76,6 +76,9 @@ class sdl_image
     /// get height of image
     [[nodiscard]] unsigned get_height() const;
 
+    /// get memory used by pixel data in bytes
+    [[nodiscard]] std::size_t get_byte_size() const;
+
   protected:
     SDL_Surface* img;
 
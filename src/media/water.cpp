@@ -39,10 +39,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "texture.hpp"
 #include "water.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <glu.h>
 #include <iomanip>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <utility>
@@ -148,6 +151,21 @@ static auto cmpdtl(int x) -> unsigned
     return nextgteqpow2(unsigned(x));
 }
 
+namespace {
+/// run func(t) for all t in [0, nr_threads), t = 0 on the calling thread
+template<typename F>
+void run_on_threads(unsigned nr_threads, F func)
+{
+    std::vector<std::unique_ptr<::thread>> helpers;
+    for (unsigned t = 1; t < nr_threads; ++t) {
+        helpers.push_back(std::make_unique<::thread>("water-worker", [&func, t]() { func(t); }));
+    }
+    func(0);
+    // joins helpers
+    helpers.clear();
+}
+} // namespace
+
 water::water(double tm)
     : mytime(tm)
     , wave_phases(cfg::instance().geti("wave_phases"))
@@ -370,21 +388,21 @@ water::water(double tm)
     */
 
     // multithreaded construction of water data (faster).
-    // spawn 1 more thread (or 3 on 4-core cpus, but two threads are already
-    // fast enough)
-    // fixme multithreaded gives now segfault, but why on earth?!
-    if (true /* construction multithreaded */) {
-        auto w0 = ::thread("water-worker", [this]() {
-            auto myowg(owg);
-            construction_threaded(myowg, 0, 2);
-        });
-        auto w1 = ::thread("water-worker", [this]() {
-            auto myowg(owg);
-            construction_threaded(myowg, 1, 2);
-        });
-    } else {
-        construction_threaded(owg, 0, 1);
+    // Creating FFTW plans is not thread safe, so the copies of the wave
+    // generator for the other threads are made here.
+    const unsigned nr_of_threads = std::clamp(std::thread::hardware_concurrency(), 1U, wave_phases);
+    std::vector<std::unique_ptr<ocean_wave_generator<float>>> thread_owgs;
+    for (unsigned t = 1; t < nr_of_threads; ++t) {
+        thread_owgs.push_back(std::make_unique<ocean_wave_generator<float>>(owg));
     }
+    using clock      = std::chrono::steady_clock;
+    const auto start = clock::now();
+    run_on_threads(nr_of_threads, [&](unsigned t) {
+        construction_threaded((t == 0) ? owg : *thread_owgs[t - 1], t, nr_of_threads);
+    });
+    thread_owgs.clear();
+    [[maybe_unused]] const double t_tiles = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    log_info("water height data computed with " << nr_of_threads << " threads in " << t_tiles << "ms");
     add_loading_screen("water height data computed");
 
     // set up curr_wtp and subdetail
@@ -392,7 +410,7 @@ water::water(double tm)
 #ifdef MEASURE_WAVE_HEIGHTS
     cout << "total minh " << totalmin << " maxh " << totalmax << "\n";
 #endif
-    compute_amount_of_foam();
+    compute_amount_of_foam(nr_of_threads);
 
     add_loading_screen("water created");
     set_time(mytime);
@@ -549,7 +567,7 @@ void water::draw_foam_for_ship(const game& gm, const ship* shp, const vector3& v
     double tm = gm.get_time();
 
     // draw foam caused by trail.
-    const list<ship::prev_pos>& prevposn = shp->get_previous_positions();
+    const auto& prevposn = shp->get_previous_positions();
     // can render strip of quads only when more than one position is stored.
     if (prevposn.empty()) {
         return;
@@ -1188,102 +1206,208 @@ void water::generate_wavetile(ocean_wave_generator<float>& myowg, double tiletim
     */
 }
 
-void water::compute_amount_of_foam()
+namespace {
+/// compute foam spawned per sample from the Jacobian of the displacements
+void compute_foam_spawn(
+    const vector<vector3f>& wd,
+    unsigned res,
+    float deriv_fac,
+    float foam_spawn_fac,
+    vector<float>& foam_add,
+    float* spawn)
+{
+    // lambda has already been multiplied with x/y displacements, it is 1 here
+    for (unsigned y = 0; y < res; ++y) {
+        const vector3f* row   = &wd[y * res];
+        const vector3f* above = &wd[((y + res - 1) & (res - 1)) * res];
+        const vector3f* below = &wd[((y + 1) & (res - 1)) * res];
+        float* fa             = &foam_add[y * res];
+        const auto jacobian   = [&](unsigned x, unsigned xm1, unsigned xp1) {
+            const float dispx_dx = (row[xp1].x - row[xm1].x) * deriv_fac;
+            const float dispx_dy = (below[x].x - above[x].x) * deriv_fac;
+            const float dispy_dx = (row[xp1].y - row[xm1].y) * deriv_fac;
+            const float dispy_dy = (below[x].y - above[x].y) * deriv_fac;
+            return (1.0F + dispx_dx) * (1.0F + dispy_dy) - dispy_dx * dispx_dy;
+        };
+        // foam is added where the surface folds over (J < 0)
+        fa[0] = std::min(std::max(-jacobian(0, res - 1, 1 & (res - 1)), 0.0F), 1.0F);
+        for (unsigned x = 1; x + 1 < res; ++x) {
+            fa[x] = std::min(std::max(-jacobian(x, x - 1, x + 1), 0.0F), 1.0F);
+        }
+        if (res > 1) {
+            fa[res - 1] = std::min(std::max(-jacobian(res - 1, res - 2, 0), 0.0F), 1.0F);
+        }
+    }
+    // spawn foam also on neighbouring fields
+    for (unsigned y = 0; y < res; ++y) {
+        const float* fa    = &foam_add[y * res];
+        const float* above = &foam_add[((y + res - 1) & (res - 1)) * res];
+        const float* below = &foam_add[((y + 1) & (res - 1)) * res];
+        float* sp          = &spawn[y * res];
+        const auto sum     = [&](unsigned x, unsigned xm1, unsigned xp1) {
+            return (fa[x] + (above[x] + below[x] + fa[xm1] + fa[xp1]) * 0.5F) * foam_spawn_fac;
+        };
+        sp[0] = sum(0, res - 1, 1 & (res - 1));
+        for (unsigned x = 1; x + 1 < res; ++x) {
+            sp[x] = sum(x, x - 1, x + 1);
+        }
+        if (res > 1) {
+            sp[res - 1] = sum(res - 1, res - 2, 0);
+        }
+    }
+}
+
+/// Foam changes per phase as a = clamp(a + add, low, high) for every sample.
+/** Functions of that form stay of that form when chained, so the change over
+    many phases can be computed without knowing the foam at their start.
+*/
+struct foam_change
+{
+    vector<float> add, low, high;
+
+    foam_change(unsigned n)
+        : add(n, 0.0F)
+        , low(n, -std::numeric_limits<float>::infinity())
+        , high(n, std::numeric_limits<float>::infinity())
+    {
+    }
+
+    /// chain the change of a phase with given spawn and decay after this one
+    void append(const float* spawn, const vector<float>& decay)
+    {
+        const auto n = unsigned(add.size());
+        float* a     = add.data();
+        float* l     = low.data();
+        float* h     = high.data();
+        for (unsigned i = 0; i < n; ++i) {
+            // a phase changes a to max(min(a + spawn, 1) - decay, 0)
+            const float c      = spawn[i] - decay[i];
+            const float upper  = std::max(1.0F - decay[i], 0.0F);
+            const float lower  = l[i] + c;
+            const float higher = h[i] + c;
+            a[i] += c;
+            l[i] = std::min(std::max(lower, 0.0F), upper);
+            h[i] = std::min(std::max(higher, 0.0F), upper);
+        }
+    }
+
+    void apply(vector<float>& aof) const
+    {
+        for (unsigned i = 0; i < add.size(); ++i) {
+            const float a = aof[i] + add[i];
+            aof[i]        = std::min(std::max(a, low[i]), high[i]);
+        }
+    }
+};
+
+/// downsample amount of foam to half resolution, res is the new resolution
+void downsample_foam(const float* src, unsigned res, float* dst)
 {
-    // compute amount of foam per vertex sample
-    vector<float> aof(wave_resolution * wave_resolution);
+    for (unsigned y = 0; y < res; ++y) {
+        const float* r0 = &src[2 * y * 2 * res];
+        const float* r1 = r0 + 2 * res;
+        float* out      = &dst[y * res];
+        // size_t index, so 2 * x can't wrap and the loop gets vectorized
+        for (std::size_t x = 0; x < res; ++x) {
+            // fixme: maybe let foam vanish on upper mipmap levels
+            out[x] = (r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1]) * 0.25F;
+        }
+    }
+}
+} // namespace
 
+void water::compute_amount_of_foam(unsigned nr_of_threads)
+{
+    using clock        = std::chrono::steady_clock;
+    const auto elapsed = [](clock::time_point& start) {
+        const auto now = clock::now();
+        const double t = std::chrono::duration<double, std::milli>(now - start).count();
+        start          = now;
+        return t;
+    };
+    auto start = clock::now();
+
+    const unsigned n = wave_resolution * wave_resolution;
     float rndtab[37];
     for (float& k : rndtab) {
         k = rnd();
     }
 
     // factor to build derivatives correctly
-    const double deriv_fac      = wavetile_length_rcp * wave_resolution;
-    const double lambda         = 1.0; // lambda has already been multiplied with x/y displacements...
-    const double decay          = 4.0 / wave_phases;
-    const double decay_rnd      = 0.25 / wave_phases;
-    const double foam_spawn_fac = 0.25; // 0.125;
-    for (unsigned k = 0; k < wave_phases * 2; ++k) {
-        const vector<vector3f>& wd = wavetile_data[k % wave_phases].mipmaps[0].wavedata;
-        // compute for each sample how much foam is added (spawned)
-        for (unsigned y = 0; y < wave_resolution; ++y) {
-            unsigned ym1 = (y + wave_resolution - 1) & (wave_resolution - 1);
-            unsigned yp1 = (y + 1) & (wave_resolution - 1);
-            for (unsigned x = 0; x < wave_resolution; ++x) {
-                unsigned xm1    = (x + wave_resolution - 1) & (wave_resolution - 1);
-                unsigned xp1    = (x + 1) & (wave_resolution - 1);
-                double dispx_dx = (wd[y * wave_resolution + xp1].x - wd[y * wave_resolution + xm1].x) * deriv_fac;
-                double dispx_dy = (wd[yp1 * wave_resolution + x].x - wd[ym1 * wave_resolution + x].x) * deriv_fac;
-                double dispy_dx = (wd[y * wave_resolution + xp1].y - wd[y * wave_resolution + xm1].y) * deriv_fac;
-                double dispy_dy = (wd[yp1 * wave_resolution + x].y - wd[ym1 * wave_resolution + x].y) * deriv_fac;
-                double Jxx      = 1.0 + lambda * dispx_dx;
-                double Jyy      = 1.0 + lambda * dispy_dy;
-                double Jxy      = lambda * dispy_dx;
-                double Jyx      = lambda * dispx_dy;
-                double J        = Jxx * Jyy - Jxy * Jyx;
-                // printf("x,y=%u,%u, Jxx,yy=%f,%f Jxy,yx=%f,%f J=%f\n",
-                //       x,y, Jxx,Jyy, Jxy,Jyx, J);
-                // double foam_add = (J < 0.3) ? ((J < -1.0) ? 1.0 : (J -
-                // 0.3)/-1.3) : 0.0;
-                double foam_add = (J < 0.0) ? ((J < -1.0) ? 1.0 : -J) : 0.0;
-                aof[y * wave_resolution + x] += foam_add * foam_spawn_fac;
-                // spawn foam also on neighbouring fields
-                aof[ym1 * wave_resolution + x] += foam_add * foam_spawn_fac * 0.5;
-                aof[yp1 * wave_resolution + x] += foam_add * foam_spawn_fac * 0.5;
-                aof[y * wave_resolution + xm1] += foam_add * foam_spawn_fac * 0.5;
-                aof[y * wave_resolution + xp1] += foam_add * foam_spawn_fac * 0.5;
-            }
+    const float deriv_fac      = wavetile_length_rcp * wave_resolution;
+    const float foam_spawn_fac = 0.25F; // 0.125;
+    // decay depends on time with some randomness
+    const double decay     = 4.0 / wave_phases;
+    const double decay_rnd = 0.25 / wave_phases;
+    vector<float> decay_of_sample(n);
+    for (unsigned y = 0; y < wave_resolution; ++y) {
+        for (unsigned x = 0; x < wave_resolution; ++x) {
+            decay_of_sample[y * wave_resolution + x] = float(decay + decay_rnd * rndtab[(3 * x + 5 * y) % 37]);
         }
+    }
 
-        // compute decay, depends on time with some randomness
-        unsigned ptr = 0;
-        for (unsigned y = 0; y < wave_resolution; ++y) {
-            for (unsigned x = 0; x < wave_resolution; ++x) {
-                aof[ptr] = std::max(std::min(aof[ptr], 1.0F) - (decay + decay_rnd * rndtab[(3 * x + 5 * y) % 37]), 0.0);
-                ++ptr;
-            }
+    // Foam of a phase depends on the foam of the phase before, and the first
+    // phase on the last one. The original way runs twice over all phases, the
+    // first run builds up the foam. Here the phases are split into ranges,
+    // one per thread, and the change of foam over each range is computed in
+    // parallel. Chaining the changes of all ranges gives the foam at the start
+    // of each range, then the ranges can be processed in parallel again.
+    nr_of_threads = std::clamp(nr_of_threads, 1U, wave_phases);
+    const auto range_begin = [&](unsigned t) { return wave_phases * t / nr_of_threads; };
+
+    // spawned foam of each phase, stored where the amount of foam goes later
+    run_on_threads(nr_of_threads, [&](unsigned t) {
+        vector<float> foam_add(n);
+        for (unsigned k = range_begin(t); k < range_begin(t + 1); ++k) {
+            auto& mm0 = wavetile_data[k].mipmaps[0];
+            mm0.amount_of_foam.resize(n);
+            compute_foam_spawn(
+                mm0.wavedata, wave_resolution, deriv_fac, foam_spawn_fac, foam_add, mm0.amount_of_foam.data());
         }
-
-        // store amount of foam data when in second iteration
-        if (k >= wave_phases) {
-            wavetile_phase::mipmap_level& mm0 = wavetile_data[k - wave_phases].mipmaps[0];
-            mm0.amount_of_foam                = aof;
-            for (unsigned j = 1; j < wavetile_data[k - wave_phases].mipmaps.size(); ++j) {
-                unsigned res                            = wave_resolution >> j;
-                const wavetile_phase::mipmap_level& mm1 = wavetile_data[k - wave_phases].mipmaps[j - 1];
-                wavetile_phase::mipmap_level& mm2       = wavetile_data[k - wave_phases].mipmaps[j];
-                mm2.amount_of_foam.reserve(res * res);
-                unsigned ptr = 0;
-                for (unsigned y = 0; y < res; ++y) {
-                    for (unsigned x = 0; x < res; ++x) {
-                        float sum = mm1.amount_of_foam[ptr] + mm1.amount_of_foam[ptr + 1]
-                                    + mm1.amount_of_foam[ptr + 2 * res] + mm1.amount_of_foam[ptr + 1 + 2 * res];
-                        // fixme: maybe let foam vanish on upper mipmap levels
-                        mm2.amount_of_foam.push_back(sum * 0.25F);
-                        ptr += 2;
-                    }
-                    ptr += 2 * res;
-                }
-            }
+    });
+    [[maybe_unused]] const double t_spawn = elapsed(start);
+
+    // change of foam over each range of phases
+    vector<foam_change> changes(nr_of_threads, foam_change(n));
+    run_on_threads(nr_of_threads, [&](unsigned t) {
+        for (unsigned k = range_begin(t); k < range_begin(t + 1); ++k) {
+            changes[t].append(wavetile_data[k].mipmaps[0].amount_of_foam.data(), decay_of_sample);
         }
-
-#if 0
-        // test: write amount of foam as grey value image
-        ostringstream osfn;
-        osfn << "aof" << setw(4) << setfill('0') << k << ".pgm";
-        ofstream ofs(osfn.str().c_str());
-        ofs << "P5\n";
-        ofs <<wave_resolution<<" "<<wave_resolution<<"\n255\n";
-        ptr = 0;
-        for (unsigned y = 0; y < wave_resolution; ++y) {
-            for (unsigned x = 0; x < wave_resolution; ++x) {
-                uint8_t x = uint8_t(std::min(std::max(aof[ptr++], 0.0f), 1.0f) * 255.9);
-                ofs.write((const char*)&x, 1);
+    });
+    // foam at start of each range, the first run over all phases starts without foam
+    vector<vector<float>> range_start(nr_of_threads, vector<float>(n, 0.0F));
+    for (const auto& c : changes) {
+        c.apply(range_start[0]);
+    }
+    for (unsigned t = 1; t < nr_of_threads; ++t) {
+        range_start[t] = range_start[t - 1];
+        changes[t - 1].apply(range_start[t]);
+    }
+    changes.clear();
+    [[maybe_unused]] const double t_scan = elapsed(start);
+
+    // compute amount of foam of all phases and their mipmap levels
+    run_on_threads(nr_of_threads, [&](unsigned t) {
+        vector<float>& aof = range_start[t];
+        for (unsigned k = range_begin(t); k < range_begin(t + 1); ++k) {
+            auto& mipmaps = wavetile_data[k].mipmaps;
+            float* spawn  = mipmaps[0].amount_of_foam.data();
+            for (unsigned i = 0; i < n; ++i) {
+                aof[i] = std::max(std::min(aof[i] + spawn[i], 1.0F) - decay_of_sample[i], 0.0F);
+            }
+            mipmaps[0].amount_of_foam = aof;
+            for (unsigned j = 1; j < mipmaps.size(); ++j) {
+                const unsigned res = wave_resolution >> j;
+                mipmaps[j].amount_of_foam.resize(res * res);
+                downsample_foam(mipmaps[j - 1].amount_of_foam.data(), res, mipmaps[j].amount_of_foam.data());
             }
         }
-#endif
-    }
+    });
+    [[maybe_unused]] const double t_store = elapsed(start);
+
+    log_info(
+        "amount of foam computed with " << nr_of_threads << " threads: spawn " << t_spawn << "ms, scan " << t_scan
+                                        << "ms, phases and mipmaps " << t_store << "ms");
 }
 
 void water::generate_subdetail_texture()
@@ -1439,16 +1563,15 @@ water::wavetile_phase::mipmap_level::mipmap_level(
     : resolution(1 << res_shift)
     , resolution_shift(res_shift)
     , sampledist(sampledist_)
+    , wavedata(1 << (2 * res_shift))
 {
-    wavedata.reserve(1 << (2 * resolution_shift));
-    unsigned ptr = 0;
     for (unsigned y = 0; y < resolution; ++y) {
+        const vector3f* r0 = &wd[2 * y * 2 * resolution];
+        const vector3f* r1 = r0 + 2 * resolution;
         for (unsigned x = 0; x < resolution; ++x) {
-            vector3f sum = wd[ptr] + wd[ptr + 1] + wd[ptr + 2 * resolution] + wd[ptr + 1 + 2 * resolution];
-            wavedata.push_back(sum * 0.25F);
-            ptr += 2;
+            vector3f sum                 = r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1];
+            wavedata[y * resolution + x] = sum * 0.25F;
         }
-        ptr += 2 * resolution;
     }
     compute_normals();
     debug_dump();
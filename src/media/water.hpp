@@ -165,7 +165,7 @@ class water
 
     vector3f get_wave_normal_at(unsigned x, unsigned y) const;
 
-    void compute_amount_of_foam();
+    void compute_amount_of_foam(unsigned nr_of_threads);
     void generate_wavetile(ocean_wave_generator<float>& myowg, double tiletime, wavetile_phase& wtp);
     void generate_subdetail_texture();
 
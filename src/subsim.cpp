@@ -25,14 +25,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <windows.h>
 #endif
 
+#include "autosave.hpp"
 #include "cfg.hpp"
 #include "credits.hpp"
 #include "datadirs.hpp"
 #include "date.hpp"
 #include "faulthandler.hpp"
 #include "filehelper.hpp"
+#include "fixed_timestep.hpp"
 #include "game.hpp"
 #include "game_editor.hpp"
+#include "game_recorder.hpp"
 #include "global_data.hpp"
 #include "highscorelist.hpp"
 #include "image.hpp"
@@ -106,6 +109,19 @@ std::string savegamedirectory =
     std::string(getenv("HOME")) + "/.dangerdeep/";
 #endif
 
+// simulation runs with fixed time steps, independent of frame rate.
+constexpr double simulation_step_time = 1.0 / 30.0;
+
+// file to record player commands of the next game to, if given
+std::string recordfilename;
+
+auto get_savegame_name_for_number(unsigned num) -> std::string
+{
+    char tmp[20];
+    sprintf(tmp, "save_%04u.dftd", num);
+    return savegamedirectory + tmp;
+}
+
 auto get_savegame_name_for(const std::string& descr, std::map<std::string, std::string>& savegames) -> std::string
 {
     auto num = 1;
@@ -118,9 +134,7 @@ auto get_savegame_name_for(const std::string& descr, std::map<std::string, std::
             num = num2 + 1;
         }
     }
-    char tmp[20];
-    sprintf(tmp, "save_%04u.dftd", num);
-    return savegamedirectory + tmp;
+    return get_savegame_name_for_number(num);
 }
 
 auto is_savegame_name(const std::string& s) -> bool
@@ -255,7 +269,11 @@ void loadsavequit_dialogue::save()
     }
 
     gamesaved = true;
-    mygame->save(fn, gamename->get_text());
+    if (cfg::instance().getb("binary_savegames")) {
+        mygame->save_binary(fn, gamename->get_text());
+    } else {
+        mygame->save(fn, gamename->get_text());
+    }
 
     auto w(create_dialogue_ok(texts::get(186), texts::get(180) + gamename->get_text() + texts::get(187)));
 
@@ -418,7 +436,7 @@ void show_results_for_game(const game& gm)
 
 // main play loop
 // fixme: clean this up!!!
-auto game_exec(game& gm, const std::shared_ptr<user_interface>& ui) -> game::run_state
+auto game_exec(game& gm, const std::shared_ptr<user_interface>& ui, autosave& autosaver) -> game::run_state
 {
     // fixme: add special ui heir: playback
     // to record videos.
@@ -433,6 +451,15 @@ auto game_exec(game& gm, const std::shared_ptr<user_interface>& ui) -> game::run
     double totaltime    = 0;
     double measuretime  = 5; // seconds
 
+    // rendering interpolates object transforms between the last two
+    // simulation steps.
+    const unsigned max_steps_per_frame = 4; // per time scale unit
+    fixed_timestep timestep(simulation_step_time, max_steps_per_frame);
+    // frames taking longer are stalls (display switches, disk access), their
+    // time is not caught up by simulation steps
+    const double max_frame_time = 0.25; // seconds
+    bool was_paused             = true;
+
     ui->resume_all_sound();
 
     // draw one initial frame
@@ -441,23 +468,32 @@ auto game_exec(game& gm, const std::shared_ptr<user_interface>& ui) -> game::run
     ui->request_abort(false);
     SYS().add_input_event_handler(ui);
 
+    // don't count the initial frame's drawing time as simulation time
+    lasttime = SYS().millisec();
+
     while (gm.get_run_state() == game::running && !ui->abort_requested()) {
-        // this time_scaling is bad. hits may get computed wrong when time
-        // scaling is too high. fixme
         unsigned thistime = SYS().millisec();
         if (gm.get_freezetime_start() > 0) {
             THROW(error, "freeze_time() called without unfreeze_time() call");
         }
         lasttime += gm.process_freezetime();
         unsigned time_scale = ui->time_scaling();
-        double delta_time   = (thistime - lasttime) / 1000.0; // * time_scale;
-        totaltime += (thistime - lasttime) / 1000.0;
+        double delta_time   = (thistime - lasttime) / 1000.0;
+        totaltime += delta_time;
         lasttime = thistime;
 
-        // next simulation step
+        // next simulation steps
         if (!ui->paused()) {
-            for (unsigned j = 0; j < time_scale; ++j) {
-                gm.simulate(time_scale == 1 ? delta_time : (1.0 / 30.0));
+            if (was_paused || delta_time > max_frame_time) {
+                // start over after pause, loading (entering this function) or
+                // a stall instead of running catch-up steps
+                timestep.reset_accumulator();
+                delta_time = std::min(delta_time, timestep.get_step_time());
+            }
+            was_paused           = false;
+            const unsigned steps = timestep.advance(delta_time, time_scale);
+            for (unsigned j = 0; j < steps; ++j) {
+                gm.simulate(timestep.get_step_time());
                 // evaluate events of game, because they are cleared
                 // by next call of game::simulate and new ones are
                 // generated
@@ -466,6 +502,12 @@ auto game_exec(game& gm, const std::shared_ptr<user_interface>& ui) -> game::run
                     it->evaluate(*ui);
                 }
             }
+            gm.set_render_interpolation(timestep.get_alpha());
+
+            // between simulation steps the state is consistent, save it
+            autosaver.update(gm, delta_time);
+        } else {
+            was_paused = true;
         }
 
         // fixme: make use of game::job interface, 3600/256 = 14.25 secs job
@@ -474,10 +516,16 @@ auto game_exec(game& gm, const std::shared_ptr<user_interface>& ui) -> game::run
         ui->display();
         ++frames;
 
-        // record fps
+        // record fps and simulation timing
         if (totaltime - fpstime >= measuretime) {
             fpstime = totaltime;
-            log_info("fps " << (frames - lastframes) / measuretime);
+            log_info(
+                "fps " << (frames - lastframes) / measuretime << " sim/real time ratio " << timestep.get_time_ratio()
+                       << " (time scale " << time_scale << ") steps/frame " << timestep.get_steps_per_frame()
+                       << " dropped " << timestep.get_dropped_time() << "s in " << timestep.get_frames_clamped()
+                       << " frames");
+            ui->log_frame_statistics();
+            timestep.reset_stats();
             lastframes = frames;
         }
 
@@ -513,9 +561,18 @@ void run_game(std::unique_ptr<game> gm)
     auto ui                       = user_interface::create(*gm);
     gametheme                     = widget::replace_theme(std::move(tmp));
 
+    if (!recordfilename.empty()) {
+        gm->start_recording(recordfilename, simulation_step_time);
+    }
+
+    // autosave into the first savegame slot, so it shows up in the load menu.
+    // It lives as long as the game is played, so time in menus doesn't restart
+    // its interval.
+    autosave autosaver(get_savegame_name_for_number(0), double(cfg::instance().geti("autosave_interval")));
+
     while (true) {
         tmp                   = widget::replace_theme(std::move(gametheme));
-        game::run_state state = game_exec(*gm, ui);
+        game::run_state state = game_exec(*gm, ui, autosaver);
         gametheme             = widget::replace_theme(std::move(tmp));
 
         // if (state == 2) break;
@@ -550,6 +607,8 @@ void run_game(std::unique_ptr<game> gm)
             // this safes time to recompute map/water/sky etc.
             // this can only work if old and new game have same type
             // of player (and thus same type of ui)
+            // recording ends with the recorded game.
+            gm->stop_recording();
             gm.reset();
             ui = nullptr;
             gm = std::make_unique<game>(dlg.get_gamefilename_to_load());
@@ -569,10 +628,36 @@ void run_game(std::unique_ptr<game> gm)
 
         // SDL_ShowCursor(SDL_DISABLE);
     }
+    gm->stop_recording();
     show_results_for_game(*gm);
     check_for_highscore(*gm);
 }
 
+//
+// replay a recorded game without user interface as fast as possible, for
+// profiling the simulation with a reproducible workload
+//
+void replay_game(const std::string& filename)
+{
+    game_replay replay(filename);
+    auto gm = replay.create_game();
+    log_info(
+        "replaying " << filename << ": " << replay.get_nr_of_ticks() << " steps, " << replay.get_nr_of_commands()
+                     << " commands");
+
+    const unsigned starttime = SYS().millisec();
+    while (gm->get_tick() < replay.get_nr_of_ticks() && gm->get_run_state() == game::running) {
+        replay.apply(gm->get_tick(), *gm);
+        gm->simulate(replay.get_step_time());
+    }
+    const double realtime = (SYS().millisec() - starttime) / 1000.0;
+
+    const auto steps = gm->get_tick();
+    std::cout << "replayed " << steps << " steps (" << steps * replay.get_step_time() << "s game time) in "
+              << realtime << "s, " << (steps > 0 ? realtime * 1000.0 / steps : 0.0) << "ms per step, run state "
+              << gm->get_run_state() << "\n";
+}
+
 //
 // start and run a game editor, handle load/save (game menu), delete game
 //
@@ -596,11 +681,14 @@ void run_game_editor(std::unique_ptr<game> gm)
     // game is initially running, so pause it.
     ui->toggle_pause();
 
+    // no autosave in the editor
+    autosave autosaver(get_savegame_name_for_number(0), 0.0);
+
     while (true) {
         tmp = widget::replace_theme(std::move(gametheme));
         // 2006-12-01 doc1972 we should do some checks of the state if game
         // exits
-        /*game::run_state state =*/game_exec(*gm, ui);
+        /*game::run_state state =*/game_exec(*gm, ui, autosaver);
         gametheme = widget::replace_theme(std::move(tmp));
 
         music::instance().play_track(1, 500);
@@ -1763,6 +1851,7 @@ auto mymain(std::vector<std::string>& args) -> int
     unsigned res_y  = 0;
     bool fullscreen = true;
     std::string cmdmissionfilename;
+    std::string replayfilename;
     bool runeditor     = false;
     bool override_lang = false;
     bool use_sound     = true;
@@ -1783,6 +1872,9 @@ auto mymain(std::vector<std::string>& args) -> int
                  << "--editordate yyyy/mm/dd\tset start date for editor\n"
                  << "--mission fn\trun mission from file fn (just the filename "
                     "in the mission directory)\n"
+                 << "--record fn\trecord player commands of the game to file fn\n"
+                 << "--replay fn\treplay recorded game from file fn without "
+                    "user interface as fast as possible and print timing\n"
                  << "--nosound\tdon't use sound\n"
                  << "--datadir path\tset base directory of data, must point to "
                     "a directory with subdirs images/ textures/ objects/ and so "
@@ -1812,6 +1904,20 @@ auto mymain(std::vector<std::string>& args) -> int
                 cmdmissionfilename = *it2;
                 ++it;
             }
+        } else if (*it == "--record") {
+            auto it2 = it;
+            ++it2;
+            if (it2 != args.end()) {
+                recordfilename = *it2;
+                ++it;
+            }
+        } else if (*it == "--replay") {
+            auto it2 = it;
+            ++it2;
+            if (it2 != args.end()) {
+                replayfilename = *it2;
+                ++it;
+            }
         } else if (*it == "--editor") {
             runeditor = true;
         } else if (*it == "--editordate") {
@@ -1964,6 +2070,10 @@ auto mymain(std::vector<std::string>& args) -> int
     mycfg.register_option("cpucores", 1);
     mycfg.register_option("terrain_texture_resolution", 0.1F);
     mycfg.register_option("terrain_detail", 1);
+    mycfg.register_option("binary_savegames", false);
+    mycfg.register_option("autosave_interval", 300); // seconds, 0 = off
+    mycfg.register_option("model_lod_levels", 3);    // 0 = off
+    mycfg.register_option("model_lod_pixel_error", 1.0F);
 
     mycfg.register_key(key_names[unsigned(key_command::ZOOM_MAP)].name, key_code::PLUS, key_mod::none);
     mycfg.register_key(key_names[unsigned(key_command::UNZOOM_MAP)].name, key_code::MINUS, key_mod::none);
@@ -2080,6 +2190,8 @@ auto mymain(std::vector<std::string>& args) -> int
     texture::use_compressed_textures   = mycfg.getb("use_compressed_textures");
     texture::use_anisotropic_filtering = mycfg.getb("use_ani_filtering");
     texture::anisotropic_level         = mycfg.getf("anisotropic_level");
+    model::lod_levels                  = mycfg.geti("model_lod_levels");
+    model::lod_pixel_error             = mycfg.getf("model_lod_pixel_error");
     system_interface::create_instance(params);
     SYS().set_screenshot_directory(savegamedirectory);
 
@@ -2209,6 +2321,8 @@ auto mymain(std::vector<std::string>& args) -> int
             THROW(error, "could not create config directory.");
         }
     }
+    // data computed from the map files is kept with the configuration
+    set_cache_dir(configdirectory);
 
     try {
         directory highscoredir(highscoredirectory);
@@ -2233,7 +2347,9 @@ auto mymain(std::vector<std::string>& args) -> int
 
     // check if there was a mission given at the command line, or editor more
     // etc.
-    if (runeditor) {
+    if (!replayfilename.empty()) {
+        replay_game(replayfilename);
+    } else if (runeditor) {
         // reset loading screen here to show user we are doing something
         reset_loading_screen();
         run_game_editor(unique_ptr<game>(new game_editor(editor_start_date)));
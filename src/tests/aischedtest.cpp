@@ -0,0 +1,204 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// AI scheduler checks and benchmark with a synchronized escort group
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "ai_scheduler.hpp"
+#include "random_generator.hpp"
+#include "test_helper.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+/// burn CPU time like visibility/radar/sonar queries and pings of an escort
+void busy_wait_ms(double ms)
+{
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < ms) {
+    }
+}
+
+struct fake_ai
+{
+    double remaining_time{0};
+    unsigned priority{1};
+    double max_overdue{0};
+    unsigned thinks{0};
+};
+
+struct result
+{
+    double max_step_ms{0};
+    double max_overdue{0};
+    unsigned thinks{0};
+};
+
+/// escorts that all start thinking at the same time, as with the old per ship timers
+auto run_group(ai_scheduler& sched, unsigned nr_escorts, unsigned nr_steps, bool staggered, bool limited) -> result
+{
+    const double cycle_time = 10.0;
+    const double delta_t    = 1.0 / 30.0;
+    const double think_ms   = 0.2;
+    std::vector<fake_ai> ais(nr_escorts);
+    for (unsigned i = 0; i < nr_escorts; ++i) {
+        ais[i].remaining_time = staggered ? ai_scheduler::get_initial_delay(sea_object_id(i + 1), cycle_time) : 0.0;
+    }
+    ais[0].priority = 2; // one escort hunting the player
+    const unsigned max_thinks = limited ? sched.get_think_limit(nr_escorts, delta_t, cycle_time) : 0;
+    result res;
+    for (unsigned s = 0; s < nr_steps; ++s) {
+        for (unsigned i = 0; i < nr_escorts; ++i) {
+            auto& a = ais[i];
+            a.remaining_time -= delta_t;
+            if (a.remaining_time <= 0) {
+                sched.add_request(sea_object_id(i + 1), a.priority, -a.remaining_time);
+            }
+        }
+        sched.run(
+            [&](sea_object_id id) {
+                auto& a          = ais[id.id - 1];
+                a.max_overdue    = std::max(a.max_overdue, -a.remaining_time);
+                a.remaining_time = cycle_time;
+                ++a.thinks;
+                busy_wait_ms(think_ms);
+            },
+            max_thinks);
+        res.max_step_ms = std::max(res.max_step_ms, sched.get_last_step().time_ms);
+    }
+    for (const auto& a : ais) {
+        res.max_overdue = std::max(res.max_overdue, a.max_overdue);
+        res.thinks += a.thinks;
+    }
+    return res;
+}
+
+struct think_record
+{
+    unsigned step;
+    unsigned id;
+    float value;
+    bool operator==(const think_record& o) const { return step == o.step && id == o.id && value == o.value; }
+};
+
+/// game like loop where thinking draws from the shared random generator,
+/// as ai::think does with game::randomf. Returns the sequence of thinks.
+auto play(unsigned nr_ais, unsigned nr_steps, double think_ms) -> std::vector<think_record>
+{
+    const double cycle_time = 10.0;
+    const double delta_t    = 1.0 / 30.0;
+    ai_scheduler sched;
+    random_generator_deprecated rnd(1234);
+    std::vector<double> remaining(nr_ais);
+    for (unsigned i = 0; i < nr_ais; ++i) {
+        // all synchronized, so the budget defers many thinks
+        remaining[i] = (i % 2 == 0) ? 0.0 : ai_scheduler::get_initial_delay(sea_object_id(i + 1), cycle_time);
+    }
+    std::vector<think_record> records;
+    for (unsigned s = 0; s < nr_steps; ++s) {
+        for (unsigned i = 0; i < nr_ais; ++i) {
+            remaining[i] -= delta_t;
+            if (remaining[i] <= 0) {
+                sched.add_request(sea_object_id(i + 1), 1 + i % 3, -remaining[i]);
+            }
+        }
+        sched.run(
+            [&](sea_object_id id) {
+                const float r        = rnd.rndf();
+                remaining[id.id - 1] = cycle_time * (0.75 + 0.25 * r);
+                records.push_back({s, id.id, r});
+                // thinking costs vary with machine load
+                busy_wait_ms(think_ms * (1 + id.id % 4));
+            },
+            sched.get_think_limit(nr_ais, delta_t, cycle_time));
+    }
+    return records;
+}
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    // initial delays spread over the cycle
+    std::vector<double> delays;
+    for (unsigned i = 0; i < 40; ++i) {
+        delays.push_back(ai_scheduler::get_initial_delay(sea_object_id(i + 1), 10.0));
+    }
+    std::sort(delays.begin(), delays.end());
+    double max_gap = 0;
+    for (unsigned i = 1; i < delays.size(); ++i) {
+        max_gap = std::max(max_gap, delays[i] - delays[i - 1]);
+    }
+    check(delays.front() >= 0 && delays.back() < 10.0, "initial delays within cycle");
+    check(max_gap < 2 * 10.0 / 40, "initial delays spread evenly");
+    check(
+        ai_scheduler::get_initial_delay(sea_object_id(7), 10.0) == ai_scheduler::get_initial_delay(sea_object_id(7), 10.0),
+        "initial delay only depends on object");
+
+    // priority order and budget
+    ai_scheduler order;
+    order.add_request(sea_object_id(1), 0, 0.5);
+    order.add_request(sea_object_id(2), 2, 0.1);
+    order.add_request(sea_object_id(3), 1, 0.3);
+    order.add_request(sea_object_id(4), 1, 3.0); // overdue too long, forced first
+    std::vector<unsigned> seen;
+    order.run([&](sea_object_id id) { seen.push_back(id.id); }, 0);
+    check(seen == std::vector<unsigned>({4, 2, 3, 1}), "forced first, then by priority and waiting time");
+
+    ai_scheduler tight(2.0);
+    for (unsigned i = 0; i < 20; ++i) {
+        tight.add_request(sea_object_id(i + 1), 1, i >= 17 ? 2.5 : 0.0);
+    }
+    tight.run([](sea_object_id) {}, 2);
+    check(tight.get_last_step().thought == 3 && tight.get_last_step().deferred == 17, "thinking stops at budget");
+    check(tight.get_last_step().forced == 1, "overdue think forced over budget");
+    check(tight.get_think_limit(60, 1.0 / 30, 10.0) == 1 && tight.get_think_limit(600, 1.0 / 30, 10.0) == 4,
+          "think limit follows number of AIs");
+
+    // recorded games replay exactly, regardless of how long thinking takes
+    const auto recorded = play(200, 600, 0.0);
+    const auto replayed = play(200, 600, 0.05);
+    check(!recorded.empty() && recorded == replayed, "replay thinks the same AIs in the same order");
+
+    // escort group, all synchronized at mission start
+    const unsigned nr_escorts = 60;
+    const unsigned nr_steps   = 900; // 30 seconds
+    ai_scheduler unlimited;
+    const auto sync_res = run_group(unlimited, nr_escorts, nr_steps, false, false);
+    ai_scheduler budgeted;
+    const auto budget_res = run_group(budgeted, nr_escorts, nr_steps, false, true);
+    ai_scheduler spread;
+    const auto spread_res = run_group(spread, nr_escorts, nr_steps, true, true);
+    check(budget_res.max_overdue < 2.0 + 0.1, "no AI starves with budget");
+    check(budget_res.thinks >= sync_res.thinks * 9 / 10, "budget keeps think rate");
+    check(spread_res.max_step_ms < sync_res.max_step_ms / 4, "staggered thinking flattens step time");
+
+    std::cout << "\n" << nr_escorts << " escorts, 0.2 ms per think, 10 s think cycle, " << nr_steps << " steps\n";
+    std::cout << "synchronized, no budget\tmax " << sync_res.max_step_ms << " ms per step, " << sync_res.thinks
+              << " thinks\n";
+    std::cout << "synchronized, budget\tmax " << budget_res.max_step_ms << " ms per step, " << budget_res.thinks
+              << " thinks, max overdue " << budget_res.max_overdue << " s\n";
+    std::cout << "staggered, budget\tmax " << spread_res.max_step_ms << " ms per step, " << spread_res.thinks
+              << " thinks, max overdue " << spread_res.max_overdue << " s\n";
+    std::cout << "deferred " << budgeted.get_total().deferred << ", forced " << budgeted.get_total().forced << "\n";
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// cloud map synthesis test and benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "cloud_generator.hpp"
+#include "test_helper.hpp"
+
+#include <iostream>
+#include <vector>
+
+namespace {
+/// old way: interpolate every level's noise map per pixel
+auto get_value_from_bytemap(
+    const cloud_generator& gen,
+    unsigned x,
+    unsigned y,
+    unsigned level,
+    const std::vector<uint8_t>& nmap) -> uint8_t
+{
+    // x,y are in 0...255, shift them according to level
+    unsigned shift    = gen.get_levels() - 1 - level;
+    unsigned mapshift = 9 - gen.get_levels();
+    unsigned mapmask  = (1 << mapshift) - 1;
+    unsigned rshift   = 8 - shift;
+    unsigned xfrac    = ((x << rshift) & 255);
+    unsigned yfrac    = ((y << rshift) & 255);
+    x                 = (x >> shift) & mapmask;
+    y                 = (y >> shift) & mapmask;
+    unsigned x2       = (x + 1) & mapmask;
+    unsigned y2       = (y + 1) & mapmask;
+    xfrac             = gen.get_interpolation_weight(xfrac);
+    yfrac             = gen.get_interpolation_weight(yfrac);
+    unsigned v0       = nmap[(y << mapshift) + x];
+    unsigned v1       = nmap[(y << mapshift) + x2];
+    unsigned v2       = nmap[(y2 << mapshift) + x];
+    unsigned v3       = nmap[(y2 << mapshift) + x2];
+    unsigned v4       = (v0 * (256 - xfrac) + v1 * xfrac);
+    unsigned v5       = (v2 * (256 - xfrac) + v3 * xfrac);
+    unsigned v6       = (v4 * (256 - yfrac) + v5 * yfrac);
+    return uint8_t(v6 >> 16);
+}
+
+auto compute_per_pixel(const cloud_generator& gen, float f) -> std::vector<uint8_t>
+{
+    const unsigned levels = gen.get_levels();
+    const unsigned n      = gen.get_noisemap_size() * gen.get_noisemap_size();
+    std::vector<std::vector<uint8_t>> cmaps(levels, std::vector<uint8_t>(n));
+    for (unsigned i = 0; i < levels; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            cmaps[i][j] = uint8_t(gen.get_noisemap(0, i)[j] * (1 - f) + gen.get_noisemap(1, i)[j] * f);
+        }
+    }
+    const unsigned res = cloud_generator::map_resolution;
+    std::vector<uint8_t> fullmap(res * res);
+    unsigned fullmapptr = 0;
+    for (unsigned y = 0; y < res; ++y) {
+        for (unsigned x = 0; x < res; ++x) {
+            unsigned v = 0;
+            for (unsigned k = 0; k < levels; ++k) {
+                v += (get_value_from_bytemap(gen, x, y, k, cmaps[k]) >> k);
+            }
+            if (v < 96) {
+                v = 96;
+            }
+            v -= 96;
+            if (v > 255) {
+                v = 255;
+            }
+            fullmap[fullmapptr++] = v;
+        }
+    }
+    return fullmap;
+}
+
+volatile unsigned sink = 0;
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    for (unsigned levels = 3; levels <= 6; ++levels) {
+        cloud_generator gen(42, levels);
+        std::vector<uint8_t> result;
+        bool identical = true;
+        for (unsigned p = 0; p <= 8; ++p) {
+            const float phase = p / 8.0f;
+            gen.compute(phase, result);
+            identical = identical && result == compute_per_pixel(gen, phase);
+        }
+        gen.next_cycle();
+        gen.compute(0.3f, result);
+        identical = identical && result == compute_per_pixel(gen, 0.3f);
+        std::cout << levels << " levels: ";
+        check(identical, "row wise map is identical to per pixel map");
+    }
+
+    // the default sky setup, map is recomputed 256 times per animation cycle
+    cloud_generator gen(42);
+    std::vector<uint8_t> result;
+    const unsigned nr_maps = 64;
+    unsigned sum           = 0;
+    const double t_pixel   = measure_ms([&]() {
+        for (unsigned i = 0; i < nr_maps; ++i) {
+            sum += compute_per_pixel(gen, i / 256.0f)[i];
+        }
+    });
+    const double t_rows = measure_ms([&]() {
+        for (unsigned i = 0; i < nr_maps; ++i) {
+            gen.compute(i / 256.0f, result);
+            sum += result[i];
+        }
+    });
+    const double t_cycle = measure_ms([&]() {
+        for (unsigned i = 0; i < nr_maps; ++i) {
+            gen.next_cycle();
+        }
+    });
+    sink = sum;
+    std::cout << "\ncloud map " << cloud_generator::map_resolution << "x" << cloud_generator::map_resolution << ", "
+              << gen.get_levels() << " levels\n";
+    std::cout << "per pixel\t" << t_pixel / nr_maps << " ms per map\n";
+    std::cout << "row wise\t" << t_rows / nr_maps << " ms per map\n";
+    std::cout << "new cycle\t" << t_cycle / nr_maps << " ms per noise map generation\n";
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// coast distance field accuracy test and land proximity query benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "coast_distance.hpp"
+#include "test_helper.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+/// a continent in the east, some round islands and a fjord
+struct test_map
+{
+    unsigned w{1024};
+    unsigned h{640};
+    std::vector<uint8_t> land;
+
+    test_map()
+        : land(std::size_t(w) * h, 0)
+    {
+        const double islands[][3] = {{200, 300, 40}, {320, 120, 12}, {500, 500, 3}, {150, 560, 70}};
+        for (unsigned y = 0; y < h; ++y) {
+            for (unsigned x = 0; x < w; ++x) {
+                bool l = (x > 800 + 40 * std::sin(y * 0.05)) && !(y > 300 && y < 310 && x < 950);
+                for (const auto& i : islands) {
+                    l = l || (std::hypot(x + 0.5 - i[0], y + 0.5 - i[1]) < i[2]);
+                }
+                land[y * w + x] = l ? 1 : 0;
+            }
+        }
+    }
+
+    /// exact distance like the field defines it, by brute force, in pixels
+    [[nodiscard]] auto distance(double px, double py) const -> double
+    {
+        const auto cx   = std::min(unsigned(px), w - 1);
+        const auto cy   = std::min(unsigned(py), h - 1);
+        const bool ison = land[cy * w + cx] != 0;
+        double best     = 1e30;
+        for (unsigned y = 0; y < h; ++y) {
+            for (unsigned x = 0; x < w; ++x) {
+                if ((land[y * w + x] != 0) != ison) {
+                    best = std::min(best, std::hypot(x + 0.5 - px, y + 0.5 - py));
+                }
+            }
+        }
+        return ison ? -(best - 0.5) : best - 0.5;
+    }
+};
+
+volatile double sink = 0;
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const test_map map;
+    const double pixel_size = 5000.0;
+    const vector2 offset(-2e6, 1e6);
+    std::unique_ptr<coast_distance_field> field;
+    const double t_build = measure_ms([&]() {
+        field = std::make_unique<coast_distance_field>(map.land, map.w, map.h, pixel_size, offset);
+    });
+    std::cout << map.w << "x" << map.h << " map, " << field->get_nr_of_levels() << " levels, "
+              << field->get_data_size() / 1024 << " kb, built in " << t_build << " ms\n";
+
+    // compare with brute force at random positions on the map
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> rx(0.0, double(map.w)), ry(0.0, double(map.h));
+    double max_error_near = 0;
+    double max_error_far  = 0;
+    bool signs_ok         = true;
+    for (unsigned i = 0; i < 300; ++i) {
+        const double px    = rx(gen);
+        const double py    = ry(gen);
+        const double exact = map.distance(px, py);
+        const double d     = field->get_distance(offset + vector2(px, py) * pixel_size) / pixel_size;
+        // only the cell precision of the level used counts
+        if (std::abs(exact) < 30.0) {
+            max_error_near = std::max(max_error_near, std::abs(d - exact));
+        } else {
+            max_error_far = std::max(max_error_far, std::abs(d - exact) / std::abs(exact));
+        }
+        signs_ok = signs_ok && (std::abs(exact) < 1.0 || (d < 0) == (exact < 0));
+    }
+    std::cout << "maximum error near coast " << max_error_near << " pixels, far from coast "
+              << max_error_far * 100 << "%\n";
+    check(max_error_near < 1.0, "distance near coast within one pixel");
+    check(max_error_far < 0.1, "distance far from coast within 10%");
+    check(signs_ok, "land and sea detected");
+    check(field->is_land(offset + vector2(200, 300) * pixel_size), "island center is land");
+    check(!field->is_land(offset + vector2(900, 305) * pixel_size), "fjord is sea");
+    const vector2 dir = field->get_direction_to_sea(offset + vector2(200, 230) * pixel_size);
+    check(dir.y < -0.9, "direction to sea points away from island");
+
+    // batch queries along a convoy route give the same values
+    const unsigned n = 100000;
+    std::vector<double> xs(n), ys(n), batch(n);
+    for (unsigned i = 0; i < n; ++i) {
+        xs[i] = offset.x + (10.0 + i * 990.0 / n) * pixel_size;
+        ys[i] = offset.y + (320.0 + 200.0 * std::sin(i * 1e-4)) * pixel_size;
+    }
+    field->get_distances(n, xs.data(), ys.data(), batch.data());
+    bool batch_ok = true;
+    for (unsigned i = 0; i < n; ++i) {
+        batch_ok = batch_ok && (batch[i] == field->get_distance(vector2(xs[i], ys[i])));
+    }
+    check(batch_ok, "batch queries equal single queries");
+
+    // file round trip, the loaded field is memory mapped
+    const std::string filename = "coastdisttest.bin";
+    field->save(filename);
+    {
+        const coast_distance_field loaded(filename);
+        bool equal = loaded.get_data_size() == field->get_data_size();
+        for (unsigned i = 0; i < n; i += 97) {
+            equal = equal && (loaded.get_distance(vector2(xs[i], ys[i])) == batch[i]);
+        }
+        check(equal, "saved and mapped field gives same distances");
+    }
+    std::remove(filename.c_str());
+
+    // query rates, random positions over the whole map and along a route
+    std::vector<double> rxs(n), rys(n);
+    for (unsigned i = 0; i < n; ++i) {
+        rxs[i] = offset.x + rx(gen) * pixel_size;
+        rys[i] = offset.y + ry(gen) * pixel_size;
+    }
+    double sum            = 0;
+    const double t_random = measure_ms([&]() {
+        for (unsigned i = 0; i < n; ++i) {
+            sum += field->get_distance(vector2(rxs[i], rys[i]));
+        }
+    });
+    const double t_route_point = measure_ms([&]() {
+        for (unsigned i = 0; i < n; ++i) {
+            sum += field->get_distance(vector2(xs[i], ys[i]));
+        }
+    });
+    const double t_route_batch = measure_ms([&]() {
+        field->get_distances(n, xs.data(), ys.data(), batch.data());
+        sum += batch[n / 2];
+    });
+    sink = sum;
+    std::cout << "\nrandom positions\t" << n / t_random / 1000.0 << " M queries/s\n";
+    std::cout << "route, single\t\t" << n / t_route_point / 1000.0 << " M queries/s\n";
+    std::cout << "route, batch\t\t" << n / t_route_batch / 1000.0 << " M queries/s\n";
+
+    // real map if given
+    if (argc > 1) {
+        std::unique_ptr<coast_distance_field> real;
+        const double t_load = measure_ms([&]() { real = coast_distance_field::load_for_map(argv[1]); });
+        std::cout << "\n" << argv[1] << ": " << real->get_nr_of_levels() << " levels, "
+                  << real->get_data_size() / 1024 << " kb, loaded in " << t_load << " ms, maximum distance "
+                  << real->get_max_distance() / 1000.0 << " km\n";
+    }
+    return failures > 0 ? 1 : 0;
+}
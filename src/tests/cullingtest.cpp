@@ -0,0 +1,95 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// frustum and horizon culling test, runs without OpenGL context
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "frustum.hpp"
+#include "matrix4.hpp"
+#include "sphere_culler.hpp"
+#include "test_helper.hpp"
+
+#include <iostream>
+
+namespace {
+/// frustum of a camera at viewpos with bearing and pitch (degrees, negative is down)
+auto make_frustum(const vector3& viewpos, double bearing, double pitch) -> frustum
+{
+    // rot_x(-90) makes the camera look along world +y (north)
+    matrix4 mv   = matrix4::rot_x(-90.0 - pitch) * matrix4::rot_z(bearing);
+    matrix4 prj  = matrix4::frustum_fovx(70.0, 4.0 / 3.0, 0.2, 30000.0);
+    frustum f    = frustum::from_matrices(mv, prj);
+    f.translate(viewpos);
+    return f;
+}
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    using res = sphere_culler::result;
+    const vector3 viewpos(1000.0, 2000.0, 10.0);
+
+    {
+        sphere_culler c(make_frustum(viewpos, 0.0, 0.0), 20000.0);
+        check(c.test(viewpos + vector3(0, 500, 0), 10) == res::visible, "object ahead is visible");
+        check(c.test(viewpos + vector3(0, -500, 0), 10) == res::outside_frustum, "object behind is culled");
+        check(c.test(viewpos + vector3(2000, 500, 0), 10) == res::outside_frustum, "object far right is culled");
+        check(c.test(viewpos + vector3(420, 500, 0), 100) == res::visible, "object touching frustum side is visible");
+        check(c.test(viewpos + vector3(0, 25000, 0), 50) == res::too_far, "object beyond view distance is culled");
+        // viewer at 10m sees the horizon at 11.3km, a top at 2m is seen up to 5km beyond
+        check(c.test(viewpos + vector3(0, 18000, -9), 1) == res::beyond_horizon, "low object behind horizon");
+        check(c.test(viewpos + vector3(0, 18000, 30), 30) == res::visible, "tall object behind horizon");
+        const auto& s = c.get_statistics();
+        check(s.submitted == 7 && s.culled() == 4 && s.visible() == 3, "statistics count all tests");
+        check(s.culled_frustum == 2 && s.culled_distance == 1 && s.culled_horizon == 1, "statistics count reasons");
+        c.reset_statistics();
+        check(c.get_statistics().submitted == 0, "statistics reset");
+    }
+    {
+        // camera looking east, so the former visible object is now at the left side
+        sphere_culler c(make_frustum(viewpos, 90.0, 0.0), 20000.0);
+        check(c.test(viewpos + vector3(500, 0, 0), 10) == res::visible, "object east is visible");
+        check(c.test(viewpos + vector3(0, 500, 0), 10) == res::outside_frustum, "object north is culled");
+    }
+    {
+        // camera looking 30 degrees down to the water, an object high above is
+        // not seen, but its mirror image is
+        const frustum f = make_frustum(viewpos, 0.0, -30.0);
+        sphere_culler c(f, 1000.0);
+        sphere_culler m(f.get_mirrored(), 1000.0);
+        const vector3 high = viewpos + vector3(0, 300, 190);
+        check(c.test(high, 5) == res::outside_frustum, "object above view is culled");
+        check(m.test(high, 5) == res::visible, "mirror image of object above view is visible");
+        const vector3 low = viewpos + vector3(0, 100, -40);
+        check(c.test(low, 5) == res::visible, "submerged object in view is visible");
+        check(m.test(low, 5) == res::outside_frustum, "mirror image of submerged object is culled");
+    }
+    {
+        // submerged viewer, no horizon but objects in front are seen
+        const vector3 subpos(0.0, 0.0, -20.0);
+        sphere_culler c(make_frustum(subpos, 0.0, 0.0), 20000.0);
+        check(c.test(subpos + vector3(0, 50, 0), 10) == res::visible, "submerged object near submerged viewer");
+        check(c.test(subpos + vector3(0, 5000, 20), 0.5) == res::beyond_horizon, "low object far from submerged viewer");
+    }
+    check(sphere_culler::horizon_distance(0.0) == 0.0, "horizon at sea level");
+    check(sphere_culler::horizon_distance(-5.0) == 0.0, "no horizon below sea level");
+
+    std::cout << (failures == 0 ? "all tests passed\n" : "some tests failed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// lru cache eviction and budget checks and display switching hit rate benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "lru_cache.hpp"
+#include "test_helper.hpp"
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+/// stand-in for a decoded image, only its size matters
+struct synthetic_image
+{
+    std::size_t bytes{0};
+    unsigned id{0};
+};
+
+using image_cache_type = lru_cache<std::string, std::shared_ptr<const synthetic_image>>;
+
+auto make_image(unsigned id, std::size_t bytes) -> std::shared_ptr<const synthetic_image>
+{
+    return std::make_shared<const synthetic_image>(synthetic_image{bytes, id});
+}
+
+void insert(image_cache_type& cache, const std::string& name, unsigned id, std::size_t bytes)
+{
+    cache.insert(name, make_image(id, bytes), bytes);
+}
+
+volatile unsigned sink = 0;
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    {
+        image_cache_type cache(300);
+        insert(cache, "a", 1, 100);
+        insert(cache, "b", 2, 100);
+        insert(cache, "c", 3, 100);
+        check(cache.size() == 3 && cache.get_statistics().bytes == 300, "values up to budget are kept");
+        // a is used, so b is the least recently used one
+        check(cache.find("a") != nullptr, "cached value is found");
+        insert(cache, "d", 4, 100);
+        check(!cache.contains("b"), "least recently used value is evicted first");
+        check(cache.contains("a") && cache.contains("c") && cache.contains("d"), "recently used values are kept");
+        check(cache.get_statistics().evictions == 1, "eviction is counted");
+        insert(cache, "e", 5, 150);
+        check(!cache.contains("c") && !cache.contains("a"), "large value evicts several values in lru order");
+        check(cache.get_statistics().bytes == 250, "size is sum of kept values");
+    }
+    {
+        image_cache_type cache(1000);
+        insert(cache, "a", 1, 10);
+        check(cache.find("a") != nullptr && cache.find("a") != nullptr, "hits are found");
+        check(cache.find("x") == nullptr, "miss is not found");
+        const auto& st = cache.get_statistics();
+        check(st.hits == 2 && st.misses == 1, "hits and misses are counted");
+        check(!cache.contains("y") && st.misses == 1, "contains does not count misses");
+        insert(cache, "a", 2, 500);
+        const auto* img = cache.find("a");
+        check(img != nullptr && (*img)->id == 1 && st.bytes == 10, "inserting cached key keeps old value");
+        insert(cache, "big", 3, 2000);
+        check(!cache.contains("big") && cache.contains("a"), "value larger than budget is not cached");
+    }
+    {
+        image_cache_type cache(1000);
+        for (unsigned i = 0; i < 10; ++i) {
+            insert(cache, std::to_string(i), i, 100);
+        }
+        cache.find("0");
+        cache.set_budget(300);
+        check(cache.size() == 3 && cache.get_statistics().bytes <= 300, "lowering budget evicts values");
+        check(cache.contains("0") && cache.contains("9") && cache.contains("8"), "lowering budget keeps most recent");
+        auto kept = *cache.find("9");
+        cache.clear();
+        check(cache.size() == 0 && cache.get_statistics().bytes == 0, "clear removes all values");
+        check(kept->id == 9, "shared image stays valid after removal");
+    }
+
+    // display switching: decoded image size in MB of each display's images
+    // (daylight set of data/displays) and switching between random
+    // stations, hit rate depends on the budget
+    const std::vector<double> display_mb = {2.25, 2.25, 7.5,  3.0,  4.5,  3.3,  3.4,  2.85, 12.2, 6.8,
+                                            10.8, 2.25, 11.8, 11.5, 5.4,  4.6,  18.8, 3.5,  35.5};
+    const unsigned images_per_display    = 8;
+    const unsigned nr_switches           = 20000;
+    std::cout << "\n" << nr_switches << " switches between " << display_mb.size() << " displays\n";
+    for (std::size_t budget_mb : {16, 64, 128, 256}) {
+        image_cache_type cache(budget_mb << 20);
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<std::size_t> pick(0, display_mb.size() - 1);
+        const double t = measure_ms([&]() {
+            for (unsigned s = 0; s < nr_switches; ++s) {
+                const std::size_t d = pick(rng);
+                for (unsigned i = 0; i < images_per_display; ++i) {
+                    const std::string name = std::to_string(d) + "/" + std::to_string(i);
+                    if (const auto* img = cache.find(name)) {
+                        sink = sink + (*img)->id;
+                    } else {
+                        const auto bytes = std::size_t(display_mb[d] * (1 << 20)) / images_per_display;
+                        insert(cache, name, i, bytes);
+                    }
+                }
+            }
+        });
+        const auto& st = cache.get_statistics();
+        std::cout << "budget " << budget_mb << " MB\thit rate " << 100.0 * st.hits / (st.hits + st.misses) << "%\t"
+                  << st.evictions << " evictions\t" << 1000.0 * t / nr_switches << " us cache time per switch\n";
+    }
+    return failures > 0 ? 1 : 0;
+}
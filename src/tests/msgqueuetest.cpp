@@ -1,59 +1,165 @@
-/* compile:
-g++ -Wall test4.cpp error.cpp thread.cpp mutex.cpp condvar.cpp message_queue.cpp
--I/usr/include/SDL -lSDL
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
-#include "condvar.hpp"
-#include "error.hpp"
+// message queue test and throughput/latency benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "latency_histogram.hpp"
 #include "message_queue.hpp"
-#include "mutex.hpp"
-#include "thread.hpp"
+#include "test_helper.hpp"
 
+#include <atomic>
 #include <iostream>
-using namespace std;
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+std::atomic<unsigned> evaluated{0};
+std::atomic<unsigned> destroyed{0};
 
-struct msg_A : public message
+struct msg_ok : public message
 {
-    void eval() const { cout << "msg A eval\n"; }
+    void eval() const override { ++evaluated; }
 };
 
-struct msg_B : public message
+struct msg_owned : public msg_ok
 {
-    void eval() const
-    {
-        cout << "msg B eval\n";
-        throw error("no way!");
-    }
+    ~msg_owned() override { ++destroyed; }
 };
 
-struct msg_C : public message
+struct msg_fail : public message
 {
-    void eval() const { cout << "msg C eval\n"; }
+    void eval() const override { throw std::runtime_error("no way!"); }
 };
 
-class A : public thread
+/// receiver thread processing messages until stopped
+class receiver
 {
   public:
-    message_queue mq;
-    A() { cout << "A: c'tor " << this << "\n"; }
-    ~A() { cout << "A: D'tor " << this << "\n"; }
-    void loop()
+    message_queue& mq;
+    std::atomic<bool> stop{false};
+    std::thread worker;
+
+    receiver(message_queue& mq_)
+        : mq(mq_)
+        , worker([this]() {
+            while (!stop) {
+                mq.process_messages();
+            }
+        })
+    {
+    }
+
+    ~receiver()
     {
-        cout << "A: waiting for messages\n";
-        mq.process_messages();
+        stop = true;
+        mq.wakeup_receiver();
+        worker.join();
     }
 };
+} // namespace
 
-int main(int, char**)
+int main(int /*argc*/, char** /*argv*/)
 {
-    cout << "Here we go.\n";
-    auto a = std::make_unique<A>();
-    thread::sleep(2000);
-    cout << "send msg_A = " << a->mq.send(message::ptr(new msg_A())) << "\n";
-    cout << "send msg_B = " << a->mq.send(message::ptr(new msg_B())) << "\n";
-    cout << "send msg_C = " << a->mq.send(message::ptr(new msg_C()), false) << "\n";
-    thread::sleep(2000);
-    a->request_abort();
-    a->mq.wakeup_receiver();
-    cout << "cleaned up!\n";
+    {
+        message_queue mq;
+        receiver r(mq);
+        msg_ok a;
+        msg_fail b;
+        check(mq.send(a), "synchronous message succeeds");
+        check(!mq.send(b), "synchronous failing message reports failure");
+        check(mq.post(a) && a.wait() && a.is_done(), "posted message can be waited for");
+        check(mq.send(std::make_unique<msg_owned>(), false), "owned asynchronous message accepted");
+    }
+    check(destroyed == 1, "owned message deleted by queue");
+
+    {
+        // no receiver, teardown must complete pending messages and not hang
+        std::vector<msg_ok> pending(4);
+        auto mq = std::make_unique<message_queue>();
+        for (auto& m : pending) {
+            mq->post(m);
+        }
+        check(!mq->post(pending[0]), "queued message can't be posted twice");
+        mq->send(std::make_unique<msg_owned>(), false);
+        std::thread waiter([&]() { pending[3].wait(); });
+        mq.reset();
+        waiter.join();
+        bool all_failed = true;
+        for (auto& m : pending) {
+            all_failed = all_failed && m.is_done() && !m.get_result();
+        }
+        check(all_failed, "pending messages reported as failed on teardown");
+        check(destroyed == 2, "pending owned message deleted on teardown");
+    }
+
+    // round trip latency of synchronous messages, no allocation per message
+    const unsigned nr_messages = 200000;
+    latency_histogram round_trip;
+    double t_async = 0;
+    {
+        message_queue mq;
+        receiver r(mq);
+        msg_ok m;
+        for (unsigned i = 0; i < nr_messages / 10; ++i) {
+            round_trip.measure([&]() { mq.send(m); });
+        }
+
+        // throughput with a pool of messages, posted in bursts like per frame
+        // and waited for before they are reused
+        const unsigned pool_size = 250;
+        std::vector<msg_ok> pool(pool_size);
+        evaluated = 0;
+        t_async   = measure_ms([&]() {
+            for (unsigned i = 0; i < nr_messages / pool_size; ++i) {
+                for (auto& p : pool) {
+                    mq.post(p);
+                }
+                for (auto& p : pool) {
+                    p.wait();
+                }
+            }
+        });
+        check(evaluated == nr_messages, "all posted messages evaluated");
+    }
+
+    // throughput with heap allocated owned messages
+    double t_owned = 0;
+    {
+        message_queue mq;
+        receiver r(mq);
+        evaluated = 0;
+        t_owned   = measure_ms([&]() {
+            for (unsigned i = 0; i < nr_messages; ++i) {
+                mq.send(std::make_unique<msg_ok>(), false);
+            }
+            while (evaluated < nr_messages) {
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    std::cout << "\nsynchronous round trip\t" << round_trip << "\n";
+    std::cout << "median " << round_trip.get_percentile_us(0.5) << "us, 99% " << round_trip.get_percentile_us(0.99)
+              << "us\n";
+    std::cout << "posted, message pool\t" << nr_messages / t_async / 1000.0 << " M messages/s\n";
+    std::cout << "posted, owned messages\t" << nr_messages / t_owned / 1000.0 << " M messages/s\n";
+    return failures > 0 ? 1 : 0;
 }
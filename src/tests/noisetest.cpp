@@ -0,0 +1,164 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// batch simplex and fractal noise test and benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "fractal.hpp"
+#include "simplex_noise.hpp"
+#include "test_helper.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+template<typename T>
+auto max_difference(const std::vector<T>& a, const std::vector<double>& b) -> double
+{
+    double result = 0;
+    for (unsigned i = 0; i < a.size(); ++i) {
+        result = std::max(result, std::abs(double(a[i]) - b[i]));
+    }
+    return result;
+}
+
+struct points
+{
+    std::vector<double> x, y, z;
+    std::vector<float> xf, yf, zf;
+
+    points(unsigned n, double range)
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> coord(-range, range);
+        for (unsigned i = 0; i < n; ++i) {
+            // float coordinates, so float and double evaluation get the same input
+            xf.push_back(float(coord(gen)));
+            yf.push_back(float(coord(gen)));
+            zf.push_back(float(coord(gen)));
+        }
+        // integral coordinates are a special case for flooring
+        xf[0] = -1.0F;
+        yf[0] = 2.0F;
+        zf[0] = 0.0F;
+        x.assign(xf.begin(), xf.end());
+        y.assign(yf.begin(), yf.end());
+        z.assign(zf.begin(), zf.end());
+    }
+};
+
+volatile double sink = 0;
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    // odd count, so the last block is partial
+    const unsigned n = 10007;
+    const points p(n, 100.0);
+    std::vector<double> exact(n), result(n);
+    std::vector<float> result_f(n);
+
+    for (unsigned i = 0; i < n; ++i) {
+        exact[i] = simplex_noise::noise(vector2(p.x[i], p.y[i]));
+    }
+    simplex_noise::noise_row(n, p.x.data(), p.y.data(), result.data());
+    check(max_difference(result, exact) == 0.0, "2D double batch is identical");
+    simplex_noise::noise_row(n, p.xf.data(), p.yf.data(), result_f.data());
+    std::cout << "2D float batch maximum error " << max_difference(result_f, exact) << "\n";
+    check(max_difference(result_f, exact) < 1e-4, "2D float batch within 1e-4 for coordinates up to 100");
+
+    for (unsigned i = 0; i < n; ++i) {
+        exact[i] = simplex_noise::noise(vector3(p.x[i], p.y[i], p.z[i]));
+    }
+    simplex_noise::noise_row(n, p.x.data(), p.y.data(), p.z.data(), result.data());
+    check(max_difference(result, exact) == 0.0, "3D double batch is identical");
+    simplex_noise::noise_row(n, p.xf.data(), p.yf.data(), p.zf.data(), result_f.data());
+    std::cout << "3D float batch maximum error " << max_difference(result_f, exact) << "\n";
+    check(max_difference(result_f, exact) < 1e-4, "3D float batch within 1e-4 for coordinates up to 100");
+
+    // fractals, with parameters like the terrain
+    const int octaves = 8;
+    fractal_noise frac(0.25, 2.0, octaves, 0.7, 1.0);
+    const points q(n, 1.0);
+    for (unsigned i = 0; i < n; ++i) {
+        exact[i] = frac.get_value_hybrid(vector3(q.x[i], q.y[i], q.z[i]), octaves);
+    }
+    frac.get_values_hybrid(n, q.x.data(), q.y.data(), q.z.data(), result.data(), octaves);
+    check(max_difference(result, exact) == 0.0, "hybrid fractal double batch is identical");
+    frac.get_values_hybrid(n, q.xf.data(), q.yf.data(), q.zf.data(), result_f.data(), octaves);
+    std::cout << "hybrid fractal float batch maximum error " << max_difference(result_f, exact) << "\n";
+    check(max_difference(result_f, exact) < 1e-4, "hybrid fractal float batch within 1e-4");
+    for (unsigned i = 0; i < n; ++i) {
+        exact[i] = frac.get_value_ridged(vector3(q.x[i], q.y[i], q.z[i]), octaves);
+    }
+    frac.get_values_ridged(n, q.x.data(), q.y.data(), q.z.data(), result.data(), octaves);
+    check(max_difference(result, exact) == 0.0, "ridged fractal double batch is identical");
+    for (unsigned i = 0; i < n; ++i) {
+        exact[i] = frac.get_value_fbm(vector3(q.x[i], q.y[i], q.z[i]), octaves);
+    }
+    frac.get_values_fbm(n, q.x.data(), q.y.data(), q.z.data(), result.data(), octaves);
+    check(max_difference(result, exact) == 0.0, "3D fbm fractal double batch is identical");
+    for (unsigned i = 0; i < n; ++i) {
+        exact[i] = frac.get_value_fbm(vector2(q.x[i], q.y[i]), octaves);
+    }
+    frac.get_values_fbm(n, q.x.data(), q.y.data(), result.data(), octaves);
+    check(max_difference(result, exact) == 0.0, "2D fbm fractal double batch is identical");
+
+    // terrain patch generation: hybrid fractal over a grid, row by row
+    const unsigned patch_size = 256;
+    const double spacing      = 1.0 / 256;
+    std::vector<double> xs(patch_size), ys(patch_size), zs(patch_size), row(patch_size);
+    std::vector<float> xf(patch_size), yf(patch_size), zf(patch_size), row_f(patch_size);
+    for (unsigned x = 0; x < patch_size; ++x) {
+        xs[x] = xf[x] = float(x * spacing);
+        zs[x] = zf[x] = float(0.1 * std::sin(x * 0.05));
+    }
+    double sum           = 0;
+    const double t_point = measure_ms([&]() {
+        for (unsigned y = 0; y < patch_size; ++y) {
+            for (unsigned x = 0; x < patch_size; ++x) {
+                sum += frac.get_value_hybrid(vector3(xs[x], float(y * spacing), zs[x]), octaves);
+            }
+        }
+    });
+    const double t_double = measure_ms([&]() {
+        for (unsigned y = 0; y < patch_size; ++y) {
+            std::fill(ys.begin(), ys.end(), float(y * spacing));
+            frac.get_values_hybrid(patch_size, xs.data(), ys.data(), zs.data(), row.data(), octaves);
+            sum += row[y];
+        }
+    });
+    const double t_float = measure_ms([&]() {
+        for (unsigned y = 0; y < patch_size; ++y) {
+            std::fill(yf.begin(), yf.end(), float(y * spacing));
+            frac.get_values_hybrid(patch_size, xf.data(), yf.data(), zf.data(), row_f.data(), octaves);
+            sum += row_f[y];
+        }
+    });
+    sink = sum;
+    const double samples = double(patch_size) * patch_size;
+    std::cout << "\n" << patch_size << "x" << patch_size << " terrain patch, hybrid fractal with " << octaves
+              << " octaves\n";
+    std::cout << "per point\t" << samples / t_point / 1000.0 << " M samples/s\n";
+    std::cout << "batch double\t" << samples / t_double / 1000.0 << " M samples/s\n";
+    std::cout << "batch float\t" << samples / t_float / 1000.0 << " M samples/s\n";
+    return failures > 0 ? 1 : 0;
+}
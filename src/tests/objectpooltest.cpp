@@ -0,0 +1,168 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// object pool checks and projectile barrage benchmark against std::vector
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "object_pool.hpp"
+#include "test_helper.hpp"
+
+#include <array>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+/// stand-in for a gun shell or depth charge, with similar size
+struct projectile
+{
+    unsigned id{0};
+    double pos[3]{};
+    double vel[3]{};
+    double lifetime{0};
+    bool dead{false};
+    std::array<double, 48> state{}; // rigid body state, trail, etc.
+
+    projectile() = default;
+    projectile(unsigned id_, double lifetime_)
+        : id(id_)
+        , lifetime(lifetime_)
+    {
+        vel[0] = 300.0;
+        vel[2] = 100.0;
+    }
+
+    void simulate(double delta_t)
+    {
+        for (unsigned i = 0; i < 3; ++i) {
+            pos[i] += vel[i] * delta_t;
+        }
+        vel[2] -= 9.81 * delta_t;
+        lifetime -= delta_t;
+        dead = lifetime <= 0;
+    }
+    [[nodiscard]] bool is_dead() const { return dead; }
+};
+
+/// the old way of removing dead objects
+void cleanup(std::vector<projectile>& v)
+{
+    for (auto it = v.begin(); it != v.end();) {
+        if (it->is_dead()) {
+            it = v.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+volatile double sink = 0;
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    using pool_type = object_pool<projectile>;
+    pool_type pool(100);
+    check(pool.capacity() >= 100, "capacity preallocated");
+    std::vector<pool_type::handle> handles;
+    for (unsigned i = 0; i < 100; ++i) {
+        handles.push_back(pool.insert(projectile(i, 1.0)).first);
+    }
+    const projectile* first = pool.get(handles[0]);
+    for (unsigned i = 100; i < 1000; ++i) {
+        handles.push_back(pool.insert(projectile(i, 1.0)).first);
+    }
+    check(pool.get(handles[0]) == first, "objects don't move when pool grows");
+
+    // kill every third object
+    for (unsigned i = 0; i < 1000; i += 3) {
+        pool.get(handles[i])->dead = true;
+    }
+    const auto removed = pool.compact([](const projectile& p) { return p.is_dead(); });
+    check(removed == 334 && pool.size() == 666, "dead objects removed");
+    bool handles_ok = true;
+    for (unsigned i = 0; i < 1000; ++i) {
+        const projectile* p = pool.get(handles[i]);
+        handles_ok          = handles_ok && ((i % 3 == 0) ? (p == nullptr) : (p != nullptr && p->id == i));
+    }
+    check(handles_ok, "handles of removed objects invalid, others follow their object");
+    const auto h = pool.insert(projectile(5000, 1.0)).first;
+    check(pool.get(handles[0]) == nullptr && pool.get(h)->id == 5000, "reused slot does not revive old handle");
+    unsigned nr_iterated = 0;
+    for (const auto& p : pool) {
+        nr_iterated += p.is_dead() ? 0 : 1;
+    }
+    check(nr_iterated == 667, "iteration visits all live objects");
+
+    // barrage: every tick escorts fire shells and drop depth charges, all
+    // live for some seconds and are removed when dead
+    const unsigned nr_ticks        = 600;
+    const unsigned spawns_per_tick = 40;
+    const double delta_t           = 1.0 / 30.0;
+    auto barrage                   = [&](auto&& spawn, auto&& simulate_all, auto&& cleanup_all) {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> lifetime(1.0, 8.0);
+        unsigned id = 0;
+        for (unsigned t = 0; t < nr_ticks; ++t) {
+            cleanup_all();
+            for (unsigned i = 0; i < spawns_per_tick; ++i) {
+                spawn(projectile(id++, lifetime(gen)));
+            }
+            simulate_all();
+        }
+    };
+
+    std::vector<projectile> vec;
+    std::size_t max_vec  = 0;
+    const double t_vector = measure_ms([&]() {
+        barrage(
+            [&](projectile&& p) { vec.push_back(std::move(p)); },
+            [&]() {
+                for (auto& p : vec) {
+                    p.simulate(delta_t);
+                }
+                max_vec = std::max(max_vec, vec.size());
+            },
+            [&]() { cleanup(vec); });
+    });
+    object_pool<projectile> barrage_pool(4096);
+    std::size_t max_pool = 0;
+    const double t_pool  = measure_ms([&]() {
+        barrage(
+            [&](projectile&& p) { barrage_pool.insert(std::move(p)); },
+            [&]() {
+                for (auto& p : barrage_pool) {
+                    p.simulate(delta_t);
+                }
+                max_pool = std::max(max_pool, barrage_pool.size());
+            },
+            [&]() { barrage_pool.compact([](const projectile& p) { return p.is_dead(); }); });
+    });
+    check(max_vec == max_pool && vec.size() == barrage_pool.size(), "same number of projectiles alive");
+    double sum = 0;
+    for (const auto& p : barrage_pool) {
+        sum += p.pos[0];
+    }
+    sink = sum;
+    std::cout << "\n" << nr_ticks << " ticks, " << spawns_per_tick << " projectiles fired per tick, up to " << max_pool
+              << " alive\n";
+    std::cout << "vector with erase\t" << t_vector / nr_ticks << " ms per tick\n";
+    std::cout << "object_pool\t\t" << t_pool / nr_ticks << " ms per tick\n";
+    return failures > 0 ? 1 : 0;
+}
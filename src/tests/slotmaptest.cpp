@@ -0,0 +1,168 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// slot map test and benchmark against unordered_map
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "slot_map.hpp"
+#include "test_helper.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+/// handle type like sea_object_id
+struct handle
+{
+    unsigned id{0};
+    handle() = default;
+    handle(unsigned n) : id(n) { }
+    bool operator==(const handle& other) const { return id == other.id; }
+};
+
+struct handle_hash
+{
+    std::size_t operator()(const handle& h) const noexcept { return h.id; }
+};
+
+/// stand in for a sea object, large with the often used data at the start
+struct object
+{
+    double position{0.0};
+    std::array<double, 255> other_data{};
+    object() = default;
+    object(double p) : position(p) { }
+};
+
+template<typename F>
+auto measure_ns(unsigned runs, F func) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < runs; ++i) {
+        func();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / runs;
+}
+
+void benchmark(unsigned n)
+{
+    slot_allocator ids;
+    slot_map<handle, object> sm;
+    std::unordered_map<handle, object, handle_hash> um;
+    std::vector<handle> keys;
+    // mix spawning and removal, like a game does over time
+    std::mt19937 rnd(n);
+    for (unsigned i = 0; i < 2 * n; ++i) {
+        handle h(ids.allocate());
+        sm.insert(h, object(i));
+        um.emplace(h, object(i));
+        keys.push_back(h);
+        if (i % 2 == 1) {
+            const auto k = rnd() % keys.size();
+            sm.erase(keys[k]);
+            um.erase(keys[k]);
+            ids.release(keys[k].id);
+            keys[k] = keys.back();
+            keys.pop_back();
+        }
+    }
+    std::shuffle(keys.begin(), keys.end(), rnd);
+
+    const unsigned runs = 1000000 / n;
+    double sum          = 0.0;
+    const double it_um  = measure_ns(runs, [&]() {
+        for (auto& [h, obj] : um) {
+            obj.position += 1.0;
+            sum += obj.position;
+        }
+    });
+    const double it_sm  = measure_ns(runs, [&]() {
+        for (auto& [h, obj] : sm) {
+            obj.position += 1.0;
+            sum += obj.position;
+        }
+    });
+    const double lu_um  = measure_ns(runs, [&]() {
+        for (auto h : keys) {
+            sum += um.find(h)->second.position;
+        }
+    });
+    const double lu_sm  = measure_ns(runs, [&]() {
+        for (auto h : keys) {
+            sum += sm.find(h)->second.position;
+        }
+    });
+    // sum is printed, so the loops can't be optimized away
+    std::cout << std::setw(6) << n << "\titeration " << std::setw(8) << it_um / n << " / " << std::setw(8)
+              << it_sm / n << " ns\tlookup " << std::setw(8) << lu_um / n << " / " << std::setw(8) << lu_sm / n
+              << " ns\t(" << sum << ")\n";
+}
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    slot_allocator ids;
+    slot_map<handle, object> sm;
+    const handle a(ids.allocate());
+    const handle b(ids.allocate());
+    const handle c(ids.allocate());
+    check(a.id != 0 && a.id != b.id && b.id != c.id, "handles are valid and unique");
+    sm.insert(a, object(1.0));
+    sm.insert(b, object(2.0));
+    sm.insert(c, object(3.0));
+    check(sm.size() == 3 && sm.find(b)->second.position == 2.0, "lookup finds object");
+    const auto relocations = sm.get_relocation_count();
+    check(sm.erase(a), "erase by key");
+    check(sm.get_relocation_count() != relocations, "erase of first element relocates last one");
+    check(!sm.contains(a) && sm.find(c)->second.position == 3.0, "moved element is still found");
+    ids.release(a.id);
+    const handle d(ids.allocate());
+    check(slot_allocator::index(d.id) == slot_allocator::index(a.id) && d.id != a.id, "slot reused, new generation");
+    sm.insert(d, object(4.0));
+    check(!sm.contains(a) && sm.find(d)->second.position == 4.0, "old handle to reused slot is invalid");
+    check(!sm.erase(a), "erasing stale handle fails");
+    for (auto it = sm.begin(); it != sm.end();) {
+        it = (it->second.position > 2.5) ? sm.erase(it) : it + 1;
+    }
+    check(sm.size() == 1 && sm.contains(b), "erase while iterating");
+
+    slot_allocator loaded;
+    loaded.reserve(c.id);
+    const handle e(loaded.allocate());
+    check(e.id != c.id && e.id != 0, "allocation skips reserved handle");
+    bool thrown = false;
+    try {
+        loaded.reserve(c.id);
+    } catch (std::exception& /*e*/) {
+        thrown = true;
+    }
+    check(thrown, "reserving a used handle throws");
+
+    std::cout << "\nper object, unordered_map / slot_map\n";
+    for (unsigned n : {10U, 100U, 1000U}) {
+        benchmark(n);
+    }
+    return failures > 0 ? 1 : 0;
+}
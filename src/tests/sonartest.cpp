@@ -0,0 +1,203 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// GHG response table and spectrum accuracy test and passive sonar listening benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "sonar.hpp"
+#include "test_helper.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+struct contact
+{
+    vector2 relpos;
+    double speed;
+    noise_signature signature;
+};
+
+auto make_contacts(unsigned nr) -> std::vector<contact>
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> pos(-20000.0, 20000.0);
+    std::uniform_real_distribution<double> speed(0.0, 12.0);
+    std::vector<contact> result(nr);
+    for (auto& c : result) {
+        c.relpos = vector2(pos(gen), pos(gen));
+        c.speed  = speed(gen);
+        for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+            c.signature.band_data[b] = {90.0 + b * 5.0, 0.5};
+        }
+    }
+    return result;
+}
+
+/// old way: propagation and GHG response computed per contact and direction
+auto listen_exact(const std::vector<contact>& contacts, angle rel_listening_dir) -> noise
+{
+    noise n;
+    const bool listen_to_starboard = (rel_listening_dir.value_pm180() >= 0);
+    for (const auto& c : contacts) {
+        angle rel_dir(c.relpos);
+        if (listen_to_starboard == (rel_dir.value_pm180() >= 0)) {
+            noise nsig = c.signature.compute_signal_strength(c.relpos.length(), c.speed, false);
+            for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+                nsig.frequencies[b] *=
+                    compute_signal_strength_GHG(rel_dir, noise::typical_frequency[b], rel_listening_dir);
+            }
+            n += nsig;
+        }
+    }
+    return n;
+}
+
+auto receive(const std::vector<contact>& contacts) -> std::vector<received_noise>
+{
+    std::vector<received_noise> result;
+    result.reserve(contacts.size());
+    for (const auto& c : contacts) {
+        angle rel_dir(c.relpos);
+        result.push_back({rel_dir,
+                          rel_dir.value_pm180() >= 0,
+                          c.signature.compute_signal_strength(c.relpos.length(), c.speed, false)});
+    }
+    return result;
+}
+
+volatile double sink = 0;
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    // table vs. exact formula, sample between table entries too
+    const auto& tables = get_GHG_response_tables();
+    double max_error   = 0;
+    for (unsigned b = 0; b < noise::NR_OF_FREQUENCY_BANDS; ++b) {
+        for (unsigned i = 0; i < 36000; ++i) {
+            const angle sig(i * 0.01 + 0.003);
+            const angle app(37.5);
+            const double exact = compute_signal_strength_GHG(sig, noise::typical_frequency[b], app);
+            max_error          = std::max(max_error, std::abs(tables[b].get(sig - app) - exact));
+        }
+    }
+    std::cout << "maximum absolute error of GHG response table " << max_error << "\n";
+    check(max_error < 1e-3, "GHG response table matches formula");
+    check(std::abs(tables[3].get(angle(0.0)) - 1.0) < 1e-9, "full response in listening direction");
+    check(tables[0].get(angle(180.0)) == 0.0, "no response from behind");
+
+    // summed signals vs. exact computation
+    const unsigned nr_of_contacts = 128;
+    const auto contacts           = make_contacts(nr_of_contacts);
+    const auto received           = receive(contacts);
+    double max_rel_error          = 0;
+    for (unsigned d = 0; d < 360; ++d) {
+        const noise exact = listen_exact(contacts, angle(double(d)));
+        noise fast;
+        add_GHG_signals(fast, received, angle(double(d)));
+        max_rel_error = std::max(max_rel_error,
+                                 std::abs(fast.compute_total_noise_strength() - exact.compute_total_noise_strength())
+                                     / exact.compute_total_noise_strength());
+    }
+    std::cout << "maximum relative error of total noise " << max_rel_error << "\n";
+    check(max_rel_error < 1e-2, "table based listening matches exact computation");
+
+    // spectrum of all bearings vs. per direction computation
+    sonar_spectrum spectrum;
+    spectrum.compute(noise(), received);
+    double max_spectrum_error = 0;
+    for (unsigned d = 0; d < 3600; ++d) {
+        // skip listening directions at the sides' borders, the signal jumps there
+        const angle a(d * 0.1 + 0.05);
+        if (std::abs(a.value_pm180()) < 1.0 || std::abs(a.value_pm180()) > 179.0) {
+            continue;
+        }
+        noise exact;
+        add_GHG_signals(exact, received, a);
+        const noise fast = spectrum.get_noise(a);
+        max_spectrum_error =
+            std::max(max_spectrum_error,
+                     std::abs(fast.compute_total_noise_strength_dB() - exact.compute_total_noise_strength_dB()));
+    }
+    std::cout << "maximum error of spectrum " << max_spectrum_error << " dB\n";
+    check(max_spectrum_error < 0.1, "spectrum matches per direction computation");
+
+    // full 360 degree sweep as done by sonar displays and operator
+    const unsigned nr_of_sweeps = 20;
+    double sum                  = 0;
+    const double t_exact        = measure_ms([&]() {
+        for (unsigned s = 0; s < nr_of_sweeps; ++s) {
+            for (unsigned d = 0; d < 360; ++d) {
+                sum += listen_exact(contacts, angle(double(d))).compute_total_noise_strength();
+            }
+        }
+    });
+    const double t_table = measure_ms([&]() {
+        for (unsigned s = 0; s < nr_of_sweeps; ++s) {
+            // per step the propagation is computed once for all directions
+            const auto rcv = receive(contacts);
+            for (unsigned d = 0; d < 360; ++d) {
+                noise n;
+                add_GHG_signals(n, rcv, angle(double(d)));
+                sum += n.compute_total_noise_strength();
+            }
+        }
+    });
+    const double t_spectrum = measure_ms([&]() {
+        for (unsigned s = 0; s < nr_of_sweeps; ++s) {
+            const auto rcv = receive(contacts);
+            spectrum.compute(noise(), rcv);
+            for (unsigned d = 0; d < 360; ++d) {
+                sum += spectrum.get_noise(angle(double(d))).compute_total_noise_strength();
+            }
+        }
+    });
+    std::cout << "\n" << nr_of_contacts << " contacts, 360 directions per sweep\n";
+    std::cout << "exact\t\t" << t_exact / nr_of_sweeps << " ms per sweep\n";
+    std::cout << "table\t\t" << t_table / nr_of_sweeps << " ms per sweep\n";
+    std::cout << "spectrum\t" << t_spectrum / nr_of_sweeps << " ms per sweep\n";
+
+    // cost of table lookups grows with contacts, spectrum is bounded by bins
+    const auto many_received = receive(make_contacts(1024));
+    const double t_table_many = measure_ms([&]() {
+        for (unsigned s = 0; s < nr_of_sweeps; ++s) {
+            for (unsigned d = 0; d < 360; ++d) {
+                noise n;
+                add_GHG_signals(n, many_received, angle(double(d)));
+                sum += n.compute_total_noise_strength();
+            }
+        }
+    });
+    const double t_spectrum_many = measure_ms([&]() {
+        for (unsigned s = 0; s < nr_of_sweeps; ++s) {
+            spectrum.compute(noise(), many_received);
+            for (unsigned d = 0; d < 360; ++d) {
+                sum += spectrum.get_noise(angle(double(d))).compute_total_noise_strength();
+            }
+        }
+    });
+    sink = sum;
+    std::cout << "\n1024 contacts, 360 directions per sweep, propagation precomputed\n";
+    std::cout << "table\t\t" << t_table_many / nr_of_sweeps << " ms per sweep\n";
+    std::cout << "spectrum\t" << t_spectrum_many / nr_of_sweeps << " ms per sweep\n";
+    return failures > 0 ? 1 : 0;
+}
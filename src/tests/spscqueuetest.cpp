@@ -0,0 +1,195 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// lock free command queue test and benchmark against blocking message queue
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "latency_histogram.hpp"
+#include "message_queue.hpp"
+#include "spsc_queue.hpp"
+#include "test_helper.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// like a sound effect command, with a name that must not allocate
+struct command
+{
+    std::string name;
+    unsigned value{0};
+    command() { name.reserve(64); }
+};
+
+volatile unsigned sink = 0;
+
+struct command_message : public message
+{
+    std::string name;
+    unsigned value;
+    command_message(std::string name_, unsigned value_)
+        : name(std::move(name_))
+        , value(value_)
+    {
+    }
+    void eval() const override { sink = sink + value + unsigned(name.size()); }
+};
+
+/// consumer that sleeps until commands arrive, as the music player does
+class consumer
+{
+  public:
+    spsc_queue<command> queue{256};
+    std::atomic<bool> waiting{false};
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned> processed{0};
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::thread worker;
+
+    consumer()
+        : worker([this]() { loop(); })
+    {
+    }
+
+    ~consumer()
+    {
+        {
+            std::unique_lock<std::mutex> ml(mtx);
+            stop = true;
+            cond.notify_all();
+        }
+        worker.join();
+    }
+
+    bool send(const char* name, unsigned value)
+    {
+        const bool sent = queue.push([&](command& c) {
+            c.name  = name;
+            c.value = value;
+        });
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
+            std::unique_lock<std::mutex> ml(mtx);
+            cond.notify_one();
+        }
+        return sent;
+    }
+
+    void loop()
+    {
+        while (!stop) {
+            processed += unsigned(queue.pop_all([](command& c) { sink = sink + c.value + unsigned(c.name.size()); }));
+            std::unique_lock<std::mutex> ml(mtx);
+            waiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cond.wait(ml, [this]() { return !queue.empty() || stop; });
+            waiting = false;
+        }
+    }
+};
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    // single threaded behaviour
+    spsc_queue<unsigned> q(5);
+    check(q.capacity() == 8, "capacity rounded up to power of two");
+    unsigned pushed = 0;
+    while (q.push([&](unsigned& v) { v = pushed; })) {
+        ++pushed;
+    }
+    check(pushed == 8, "push fails when queue is full");
+    std::vector<unsigned> popped;
+    q.pop_all([&](unsigned& v) { popped.push_back(v); });
+    check(popped == std::vector<unsigned>({0, 1, 2, 3, 4, 5, 6, 7}), "elements popped in order");
+    check(q.empty(), "queue empty after pop");
+
+    // two threads, order and completeness
+    const unsigned nr_values = 1000000;
+    spsc_queue<unsigned> tq(1024);
+    bool in_order = true;
+    std::thread reader([&]() {
+        unsigned expected = 0;
+        while (expected < nr_values) {
+            tq.pop_all([&](unsigned& v) {
+                in_order = in_order && (v == expected);
+                ++expected;
+            });
+        }
+    });
+    for (unsigned i = 0; i < nr_values;) {
+        if (tq.push([&](unsigned& v) { v = i; })) {
+            ++i;
+        }
+    }
+    reader.join();
+    check(in_order, "all values received in order by other thread");
+
+    // latency of the sending thread, sound effect like commands at a few per frame
+    const unsigned nr_commands = 20000;
+    latency_histogram blocking, lockfree;
+    {
+        message_queue mq;
+        std::atomic<bool> stop{false};
+        std::thread receiver([&]() {
+            while (!stop) {
+                mq.process_messages();
+            }
+        });
+        for (unsigned i = 0; i < nr_commands; ++i) {
+            blocking.measure([&]() { mq.send(std::make_unique<command_message>("depth-charge-explode", i)); });
+        }
+        stop = true;
+        mq.wakeup_receiver();
+        receiver.join();
+    }
+    unsigned dropped = 0;
+    {
+        consumer c;
+        for (unsigned i = 0; i < nr_commands; ++i) {
+            lockfree.measure([&]() {
+                if (!c.send("depth-charge-explode", i)) {
+                    ++dropped;
+                }
+            });
+            if (i % 64 == 63) {
+                // let the consumer catch up, like frames in between
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        while (c.processed + dropped < nr_commands) {
+            std::this_thread::yield();
+        }
+    }
+    check(dropped == 0, "no commands dropped at moderate rate");
+    std::cout << "\nsender time per command\n";
+    std::cout << "message_queue, waiting\t" << blocking << "\n";
+    std::cout << "spsc_queue\t\t" << lockfree << "\n";
+    std::cout << "median " << blocking.get_percentile_us(0.5) << "us vs. " << lockfree.get_percentile_us(0.5)
+              << "us, 99% " << blocking.get_percentile_us(0.99) << "us vs. " << lockfree.get_percentile_us(0.99)
+              << "us\n";
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// Checks and timing shared by the standalone unit tests
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+/// number of failed checks, main returns non-zero if there were any
+inline int failures = 0;
+
+/// report a check and count it if it failed
+inline void check(bool ok, const char* what)
+{
+    std::cout << (ok ? "ok     " : "FAILED ") << what << "\n";
+    if (!ok) {
+        ++failures;
+    }
+}
+
+/// wall clock time of one call to func in milliseconds
+template<typename F>
+auto measure_ms(F func) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
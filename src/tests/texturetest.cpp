@@ -0,0 +1,205 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// texture mipmap and normal map kernel test and benchmark with the model textures
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "datadirs.hpp"
+#include "filehelper.hpp"
+#include "test_helper.hpp"
+#include "texture.hpp"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+/// old implementation, texel by texel
+auto scale_half_exact(const std::vector<uint8_t>& src, unsigned w, unsigned h, unsigned bpp) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> dst(w * h * bpp / 4);
+    unsigned ptr = 0;
+    for (unsigned y = 0; y < h; y += 2) {
+        for (unsigned x = 0; x < w; x += 2) {
+            for (unsigned b = 0; b < bpp; ++b) {
+                dst[ptr++] = uint8_t(
+                    (unsigned(src[(y * w + x) * bpp + b]) + unsigned(src[(y * w + x + 1) * bpp + b])
+                     + unsigned(src[((y + 1) * w + x) * bpp + b]) + unsigned(src[((y + 1) * w + x + 1) * bpp + b]))
+                    / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+/// old implementation, texel by texel, height every src_bpp'th byte
+auto make_normals_exact(const std::vector<uint8_t>& src, unsigned src_bpp, unsigned w, unsigned h, float detailh)
+    -> std::vector<uint8_t>
+{
+    const unsigned dst_bpp = src_bpp + 2;
+    std::vector<uint8_t> dst(dst_bpp * w * h);
+    float zh     = 255.0F / detailh;
+    unsigned ptr = 0;
+    for (unsigned yy = 0; yy < h; ++yy) {
+        unsigned y1 = (yy + h - 1) & (h - 1);
+        unsigned y2 = (yy + 1) & (h - 1);
+        for (unsigned xx = 0; xx < w; ++xx) {
+            unsigned x1  = (xx + w - 1) & (w - 1);
+            unsigned x2  = (xx + 1) & (w - 1);
+            float hr     = src[src_bpp * (yy * w + x2)];
+            float hu     = src[src_bpp * (y1 * w + xx)];
+            float hl     = src[src_bpp * (yy * w + x1)];
+            float hd     = src[src_bpp * (y2 * w + xx)];
+            vector3f nm  = vector3f(hl - hr, hd - hu, zh).normal();
+            dst[ptr + 0] = uint8_t(nm.x * 127 + 128);
+            dst[ptr + 1] = uint8_t(nm.y * 127 + 128);
+            dst[ptr + 2] = uint8_t(nm.z * 127 + 128);
+            if (src_bpp == 2) {
+                dst[ptr + 3] = src[2 * (yy * w + xx) + 1];
+            }
+            ptr += dst_bpp;
+        }
+    }
+    return dst;
+}
+
+auto random_bytes(unsigned n, std::mt19937& gen) -> std::vector<uint8_t>
+{
+    std::uniform_int_distribution<int> value(0, 255);
+    std::vector<uint8_t> result(n);
+    for (auto& v : result) {
+        v = uint8_t(value(gen));
+    }
+    return result;
+}
+
+/// height map of a model texture, the green channel like texture does for rgb2grey
+struct height_map
+{
+    std::vector<uint8_t> data;
+    unsigned w{0};
+    unsigned h{0};
+};
+
+auto load_height_maps(const std::string& path) -> std::vector<height_map>
+{
+    std::vector<height_map> result;
+    directory::walk(path, [&](const std::string& filename) {
+        if (filename.find("bump") == std::string::npos && filename.find("normal") == std::string::npos) {
+            return;
+        }
+        const auto ext = filename.substr(filename.rfind('.') + 1);
+        if (ext != "jpg" && ext != "png") {
+            return;
+        }
+        sdl_image img(filename);
+        height_map hm;
+        unsigned bpp = 0;
+        auto pixels  = img.get_plain_data(hm.w, hm.h, bpp);
+        if ((hm.w & (hm.w - 1)) != 0 || (hm.h & (hm.h - 1)) != 0) {
+            return;
+        }
+        hm.data.resize(hm.w * hm.h);
+        for (unsigned i = 0; i < hm.w * hm.h; ++i) {
+            hm.data[i] = pixels[i * bpp + (bpp >= 3 ? 1 : 0)];
+        }
+        result.push_back(std::move(hm));
+    });
+    return result;
+}
+
+volatile unsigned sink = 0;
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::mt19937 gen(42);
+
+    // all sizes down to 1x1, all texel sizes
+    bool scale_ok   = true;
+    bool normals_ok = true;
+    bool alpha_ok   = true;
+    for (unsigned w = 1; w <= 512; w *= 2) {
+        for (unsigned h = 1; h <= 64; h *= 2) {
+            if (w > 1 && h > 1) {
+                for (unsigned bpp = 1; bpp <= 4; ++bpp) {
+                    const auto src = random_bytes(w * h * bpp, gen);
+                    scale_ok &= texture::scale_half(src, w, h, bpp) == scale_half_exact(src, w, h, bpp);
+                }
+            }
+            const auto heights = random_bytes(w * h, gen);
+            normals_ok &= texture::make_normals(heights, w, h, 4.0F) == make_normals_exact(heights, 1, w, h, 4.0F);
+            const auto heights_alpha = random_bytes(2 * w * h, gen);
+            alpha_ok &= texture::make_normals_with_alpha(heights_alpha, w, h, 4.0F)
+                        == make_normals_exact(heights_alpha, 2, w, h, 4.0F);
+        }
+    }
+    check(scale_ok, "scale_half is identical for 1 to 4 bytes per texel");
+    check(normals_ok, "make_normals is identical");
+    check(alpha_ok, "make_normals_with_alpha is identical");
+
+    // steep and flat height fields, detail heights of the models
+    const std::vector<uint8_t> steps = {0, 255, 0, 255, 255, 0, 255, 0, 0, 255, 0, 255, 255, 0, 255, 0};
+    const std::vector<uint8_t> flat(16, 77);
+    bool extremes_ok = true;
+    for (float detailh : {0.5F, 1.0F, 4.0F, 16.0F, 255.0F}) {
+        extremes_ok &= texture::make_normals(steps, 4, 4, detailh) == make_normals_exact(steps, 1, 4, 4, detailh);
+        extremes_ok &= texture::make_normals(flat, 4, 4, detailh) == make_normals_exact(flat, 1, 4, 4, detailh);
+    }
+    check(extremes_ok, "make_normals is identical for extreme slopes");
+
+    // model textures, normal map of every mip level like the texture loader
+    const auto maps = load_height_maps(argc > 1 ? std::string(argv[1]) : get_data_dir() + "objects/");
+    std::size_t texels = 0;
+    bool real_ok       = true;
+    for (const auto& hm : maps) {
+        texels += hm.w * hm.h;
+        real_ok &= texture::make_normals(hm.data, hm.w, hm.h, 4.0F) == make_normals_exact(hm.data, 1, hm.w, hm.h, 4.0F);
+    }
+    check(real_ok, "make_normals is identical for model textures");
+
+    const auto mip_chain = [&](bool exact) {
+        unsigned sum = 0;
+        for (const auto& hm : maps) {
+            std::vector<uint8_t> level = hm.data;
+            unsigned w                 = hm.w;
+            unsigned h                 = hm.h;
+            while (true) {
+                const auto nm = exact ? make_normals_exact(level, 1, w, h, 4.0F) : texture::make_normals(level, w, h, 4.0F);
+                sum += nm[nm.size() / 2];
+                if (w < 2 || h < 2) {
+                    break;
+                }
+                level = exact ? scale_half_exact(level, w, h, 1) : texture::scale_half(level, w, h, 1);
+                w /= 2;
+                h /= 2;
+            }
+        }
+        return sum;
+    };
+    unsigned sum         = 0;
+    const double t_exact = measure_ms([&]() { sum += mip_chain(true); });
+    const double t_fast  = measure_ms([&]() { sum += mip_chain(false); });
+    sink                 = sum;
+    std::cout << "\n" << maps.size() << " model height maps, " << texels / 1024 << "k texels, with mip levels\n";
+    std::cout << "texel by texel\t" << t_exact << " ms\n";
+    std::cout << "kernels\t\t" << t_fast << " ms\n";
+    return failures > 0 ? 1 : 0;
+}
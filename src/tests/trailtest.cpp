@@ -0,0 +1,136 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// trail recording and vertex generation test and benchmark
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "ring_buffer.hpp"
+#include "ship.hpp"
+#include "test_helper.hpp"
+
+#include <iostream>
+#include <list>
+#include <vector>
+
+namespace {
+constexpr unsigned nr_of_ships = 200;
+constexpr unsigned nr_of_steps = 3600; // one hour, one sample per second
+
+auto sample(unsigned ship, unsigned step) -> ship::prev_pos
+{
+    return {vector2(ship * 100.0, step * 6.0), vector2(0, 1), double(step), 6.0};
+}
+
+volatile float sink = 0;
+
+/// old way: linked list per ship and line strip per ship
+auto benchmark_list() -> double
+{
+    std::vector<std::list<ship::prev_pos>> trails(nr_of_ships);
+    float checksum = 0;
+    const double t = measure_ms([&]() {
+        for (unsigned step = 0; step < nr_of_steps; ++step) {
+            for (unsigned s = 0; s < nr_of_ships; ++s) {
+                trails[s].push_front(sample(s, step));
+                if (trails[s].size() > ship::TRAIL_LENGTH) {
+                    trails[s].pop_back();
+                }
+            }
+            for (const auto& trail : trails) {
+                // like a primitives object per trail
+                std::vector<vector3f> vertices(trail.size() + 1);
+                std::vector<color> colors(trail.size() + 1);
+                const float la = 1.0F / float(trail.size());
+                float lc       = 0;
+                unsigned trc   = 1;
+                for (const auto& it : trail) {
+                    colors[trc]   = color(255, 255, 255, uint8_t(255 * (1 - lc)));
+                    vertices[trc] = vector3f(512 + it.pos.x, 384 - it.pos.y, 0);
+                    lc += la;
+                    ++trc;
+                }
+                checksum += vertices.back().y;
+            }
+        }
+    });
+    // keep the compiler from dropping the vertex generation
+    sink = checksum;
+    return t;
+}
+
+/// new way: ring buffer per ship and one line strip for all
+auto benchmark_ring_buffer() -> double
+{
+    std::vector<ring_buffer<ship::prev_pos>> trails(nr_of_ships, ring_buffer<ship::prev_pos>(ship::TRAIL_LENGTH));
+    std::vector<vector3f> vertices;
+    std::vector<color> colors;
+    return measure_ms([&]() {
+        for (unsigned step = 0; step < nr_of_steps; ++step) {
+            for (unsigned s = 0; s < nr_of_ships; ++s) {
+                trails[s].push_front(sample(s, step));
+            }
+            vertices.clear();
+            colors.clear();
+            for (unsigned s = 0; s < nr_of_ships; ++s) {
+                ship::append_trail_strip(
+                    sample(s, step).pos, trails[s], vector2(512, 384), vector2(1, -1), vertices, colors);
+            }
+        }
+    });
+}
+} // namespace
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    ring_buffer<int> rb(3);
+    check(rb.empty() && rb.capacity() == 3, "new buffer is empty");
+    rb.push_front(1);
+    rb.push_front(2);
+    check(rb.size() == 2 && rb.front() == 2 && rb.back() == 1, "newest element first");
+    rb.push_front(3);
+    rb.push_front(4);
+    check(rb.full() && rb[0] == 4 && rb[1] == 3 && rb[2] == 2, "oldest element is overwritten");
+    int sum = 0;
+    for (int i : rb) {
+        sum = sum * 10 + i;
+    }
+    check(sum == 432, "iteration from newest to oldest");
+
+    ring_buffer<ship::prev_pos> trail(4);
+    std::vector<vector3f> vertices;
+    std::vector<color> colors;
+    ship::append_trail_strip(vector2(0, 0), trail, vector2(0, 0), vector2(1, 1), vertices, colors);
+    check(vertices.empty(), "empty trail gives no vertices");
+    trail.push_front({vector2(10, 0), vector2(1, 0), 0.0, 1.0});
+    trail.push_front({vector2(20, 0), vector2(1, 0), 1.0, 1.0});
+    ship::append_trail_strip(vector2(30, 0), trail, vector2(512, 384), vector2(2, -2), vertices, colors);
+    check(vertices.size() == 3 && colors.size() == 3, "one vertex per position");
+    check(vertices[0] == vector3f(572, 384, 0) && vertices[2] == vector3f(532, 384, 0), "strip from ship to oldest");
+    check(colors[0].a == 255 && colors[1].a < 255 && colors[2].a == 0, "alpha fades out");
+    ship::append_trail_strip(vector2(0, 50), trail, vector2(0, 0), vector2(1, 1), vertices, colors);
+    check(vertices.size() == 7 && vertices[3] == vertices[4], "trails are joined");
+    check(colors[3].a == 0 && colors[4].a == 255, "joining line is invisible");
+
+    const double t_list = benchmark_list();
+    const double t_ring = benchmark_ring_buffer();
+    std::cout << "\n" << nr_of_ships << " ships, " << nr_of_steps << " steps, recording and drawing trails\n"
+              << "std::list\t" << t_list / nr_of_steps << " ms per step\n"
+              << "ring_buffer\t" << t_ring / nr_of_steps << " ms per step\n";
+    return failures > 0 ? 1 : 0;
+}
@@ -21,6 +21,7 @@
 
 #include "../mymain.cpp"
 #include "bzip.hpp"
+#include "coast_distance.hpp"
 #include "morton_bivector.hpp"
 #include "terrain.hpp"
 #include "vector2.hpp"
@@ -66,6 +67,19 @@ load_tile(ifstream& file, morton_bivector<Sint16>& tile, vector2i tl, vector2i m
     }
 }
 
+inline int precompute_coast_distance(const std::string& mapfile)
+{
+    const std::string outfile = coast_distance_field::get_field_filename(mapfile);
+    std::cout << "computing coast distance field of " << mapfile << std::endl;
+    auto field = coast_distance_field::compute_for_map(mapfile);
+    field->save(outfile);
+    std::cout << "\tlevels: " << field->get_nr_of_levels() << std::endl;
+    std::cout << "\tsize: " << field->get_data_size() << " bytes" << std::endl;
+    std::cout << "\tmaximum distance: " << field->get_max_distance() << " m" << std::endl;
+    std::cout << "written to " << outfile << std::endl;
+    return 0;
+}
+
 int mymain(std::vector<string>& args)
 {
 
@@ -97,9 +111,17 @@ int mymain(std::vector<string>& args)
                       << "\t\t\t\tthe first X,Y pair are the top left coords, the "
                          "second pair are the bottom right coords."
                       << std::endl
-                      << "\t\t\t\tNOTE: the coordinates have to fit the tile size!" << std::endl;
+                      << "\t\t\t\tNOTE: the coordinates have to fit the tile size!" << std::endl
+                      << "\t--coastdist <map.xml>\tonly compute the coast distance field of a map" << std::endl;
             return 0;
         }
+        if (*it == "--coastdist") {
+            auto it2 = it;
+            ++it2;
+            if (it2 != args.end()) {
+                return precompute_coast_distance(*it2);
+            }
+        }
         if (*it == "--mapsize=") {
             auto it2 = it;
             ++it2;
@@ -0,0 +1,128 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// generate mesh LOD chains of a model file and report reduction and error
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "../mymain.cpp"
+#include "datadirs.hpp"
+#include "model.hpp"
+#include "system_interface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// print triangles and error of every level of a mesh
+void print_mesh(const model::mesh& m)
+{
+    const unsigned nrtris = m.get_nr_of_triangles();
+    std::cout << m.name << "\t" << m.vertices.size() << " vertices, " << nrtris << " triangles, " << m.lods.size()
+              << " levels\n";
+    for (unsigned l = 1; l <= m.lods.size(); ++l) {
+        const unsigned lodtris = m.get_nr_of_triangles(l);
+        std::cout << "\tLOD " << l << "\t" << lodtris << " triangles\t" << std::setprecision(3)
+                  << 100.0 * lodtris / nrtris << "%\terror " << m.get_lod_error(l) << " m\n";
+    }
+}
+
+void process_model(const std::string& filename, unsigned nr_of_levels)
+{
+    // load without levels, so computing them can be timed alone
+    model::lod_levels = 0;
+    model mdl(filename, false);
+    const auto start = std::chrono::steady_clock::now();
+    mdl.compute_lods(nr_of_levels);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << filename << "\t" << mdl.get_nr_of_lods() - 1 << " levels in " << ms << " ms\n";
+    for (unsigned i = 0; i < mdl.get_nr_of_meshes(); ++i) {
+        print_mesh(mdl.get_mesh(i));
+    }
+    // meshes with less levels render their coarsest level for the others
+    unsigned total = 0;
+    for (unsigned i = 0; i < mdl.get_nr_of_meshes(); ++i) {
+        total += mdl.get_mesh(i).get_nr_of_triangles();
+    }
+    std::cout << "model\t" << total << " triangles\n";
+    for (unsigned l = 1; l < mdl.get_nr_of_lods(); ++l) {
+        unsigned lodtris = 0;
+        for (unsigned i = 0; i < mdl.get_nr_of_meshes(); ++i) {
+            lodtris += mdl.get_mesh(i).get_nr_of_triangles(l);
+        }
+        std::cout << "\tLOD " << l << "\t" << lodtris << " triangles\t" << std::setprecision(3)
+                  << 100.0 * lodtris / total << "%\terror " << mdl.get_lod_error(l) << " m\n";
+    }
+}
+} // namespace
+
+int mymain(std::vector<std::string>& args)
+{
+    unsigned nr_of_levels = 3;
+    std::vector<std::string> files;
+    for (auto it = args.begin(); it != args.end(); ++it) {
+        if (*it == "--help") {
+            std::cout << "DftD mesh LOD generator, usage:\n"
+                      << "meshlod [--levels n] FILE.ddxml...\n"
+                      << "\tcompute LOD chain for all triangle meshes of the models\n"
+                      << "\tand print triangle counts and geometric error per level\n"
+                      << "--datadir path\tset base directory of data\n";
+            return 0;
+        } else if (*it == "--levels" && it + 1 != args.end()) {
+            nr_of_levels = unsigned(std::max(1, atoi((++it)->c_str())));
+        } else if (*it == "--datadir" && it + 1 != args.end()) {
+            std::string datadir = *++it;
+            if (datadir[datadir.length() - 1] != '/') {
+                datadir += "/";
+            }
+            set_data_dir(datadir);
+        } else {
+            files.push_back(*it);
+        }
+    }
+    if (files.empty()) {
+        std::cout << "no model files given, see --help\n";
+        return -1;
+    }
+
+    // the model loader needs an OpenGL context for its buffers
+    system_interface::parameters params;
+    params.near_z       = 1.0;
+    params.far_z        = 1000.0;
+    params.resolution   = {640, 480};
+    params.resolution2d = {1024, 768};
+    params.fullscreen   = false;
+    system_interface::create_instance(params);
+
+    for (const auto& filename : files) {
+        try {
+            process_model(filename, nr_of_levels);
+        } catch (std::exception& e) {
+            std::cout << filename << ": " << e.what() << "\n";
+        }
+    }
+    return 0;
+}
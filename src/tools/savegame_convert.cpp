@@ -0,0 +1,165 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// convert savegames between XML and binary format and measure save/load time
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "../mymain.cpp"
+#include "cfg.hpp"
+#include "convoy.hpp"
+#include "datadirs.hpp"
+#include "date.hpp"
+#include "filehelper.hpp"
+#include "game.hpp"
+#include "global_data.hpp"
+#include "system_interface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace
+{
+/// measure time of function in milliseconds
+template<typename F>
+auto measure_ms(F func) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+auto file_size(const std::string& filename) -> long
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    return in.good() ? long(in.tellg()) : -1;
+}
+
+void benchmark(game& gm, const std::string& basename, unsigned runs)
+{
+    const std::string xmlname = basename + ".xml";
+    const std::string binname = basename + ".bin";
+    double xml_save = 0, xml_load = 0, bin_save = 0, bin_load = 0;
+    for (unsigned i = 0; i < runs; ++i) {
+        xml_save += measure_ms([&]() { gm.save(xmlname, "benchmark"); });
+        bin_save += measure_ms([&]() { gm.save_binary(binname, "benchmark"); });
+        xml_load += measure_ms([&]() { game tmp(xmlname); });
+        bin_load += measure_ms([&]() { game tmp(binname); });
+    }
+    std::cout << "format\tsize (bytes)\tsave (ms)\tload (ms)\n"
+              << "XML\t" << file_size(xmlname) << "\t" << xml_save / runs << "\t" << xml_load / runs << "\n"
+              << "binary\t" << file_size(binname) << "\t" << bin_save / runs << "\t" << bin_load / runs << "\n";
+    std::remove(xmlname.c_str());
+    std::remove(binname.c_str());
+}
+} // namespace
+
+int mymain(std::vector<std::string>& args)
+{
+    std::string infile, outfile;
+    bool to_binary      = true;
+    bool run_benchmark  = false;
+    unsigned runs       = 5;
+    unsigned convoysize = convoy::large;
+
+    for (auto it = args.begin(); it != args.end(); ++it) {
+        if (*it == "--help") {
+            std::cout << "DftD savegame converter, usage:\n"
+                      << "savegame_convert [--toxml|--tobinary] INFILE OUTFILE\n"
+                      << "\tconvert savegame or mission, default is to binary\n"
+                      << "savegame_convert --benchmark [--runs n] [--convoy 0-2] [INFILE]\n"
+                      << "\tmeasure save and load time of both formats for given file\n"
+                      << "\tor a generated convoy mission of given size (default 2, large)\n"
+                      << "--datadir path\tset base directory of data\n";
+            return 0;
+        } else if (*it == "--toxml") {
+            to_binary = false;
+        } else if (*it == "--tobinary") {
+            to_binary = true;
+        } else if (*it == "--benchmark") {
+            run_benchmark = true;
+        } else if (*it == "--runs" && it + 1 != args.end()) {
+            runs = std::max(1, atoi((++it)->c_str()));
+        } else if (*it == "--convoy" && it + 1 != args.end()) {
+            convoysize = std::min(2, std::max(0, atoi((++it)->c_str())));
+        } else if (*it == "--datadir" && it + 1 != args.end()) {
+            std::string datadir = *++it;
+            if (datadir[datadir.length() - 1] != '/') {
+                datadir += "/";
+            }
+            set_data_dir(datadir);
+        } else if (infile.empty()) {
+            infile = *it;
+        } else {
+            outfile = *it;
+        }
+    }
+    if (!run_benchmark && (infile.empty() || outfile.empty())) {
+        std::cout << "missing file names, see --help\n";
+        return -1;
+    }
+
+    // game creation needs the options for water and terrain and an OpenGL context
+    cfg& mycfg = cfg::instance();
+    mycfg.register_option("use_hqsfx", true);
+    mycfg.register_option("water_detail", 128);
+    mycfg.register_option("wave_fft_res", 128);
+    mycfg.register_option("wave_phases", 256);
+    mycfg.register_option("wavetile_length", 256.0F);
+    mycfg.register_option("wave_tidecycle_time", 10.24F);
+    mycfg.register_option("cpucores", 1);
+    mycfg.register_option("terrain_texture_resolution", 0.1F);
+    mycfg.register_option("terrain_detail", 1);
+
+    system_interface::parameters params;
+    params.near_z       = 1.0;
+    params.far_z        = 1000.0;
+    params.resolution   = {640, 480};
+    params.resolution2d = {1024, 768};
+    params.fullscreen   = false;
+    system_interface::create_instance(params);
+
+    // make sure data file list is read before timing
+    data_file();
+
+    std::unique_ptr<game> gm;
+    const double load_time = measure_ms([&]() {
+        if (infile.empty()) {
+            gm = std::make_unique<game>(
+                "submarine_VIIc", convoysize, convoy::etlarge, 2 /* day */, date(1941, 6, 1));
+        } else {
+            gm = std::make_unique<game>(infile);
+        }
+    });
+    std::cout << (infile.empty() ? std::string("generated convoy mission") : infile) << " created in " << load_time
+              << " ms\n";
+
+    if (run_benchmark) {
+        benchmark(*gm, "savegame_benchmark", runs);
+    } else if (to_binary) {
+        gm->save_binary(outfile, "converted from " + infile);
+    } else {
+        gm->save(outfile, "converted from " + infile);
+    }
+
+    return 0;
+}
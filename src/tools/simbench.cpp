@@ -0,0 +1,139 @@
+/*
+Danger from the Deep - Open source submarine simulation
+Copyright (C) 2003-2020  Thorsten Jordan, Luis Barrancos and others.
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+// measure simulation and sensor times of a game with a large convoy
+// subsim (C)+(W) Thorsten Jordan. SEE LICENSE
+
+#include "../mymain.cpp"
+#include "cfg.hpp"
+#include "convoy.hpp"
+#include "datadirs.hpp"
+#include "date.hpp"
+#include "game.hpp"
+#include "global_data.hpp"
+#include "ship.hpp"
+#include "system_interface.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace
+{
+/// measure time of function in milliseconds
+template<typename F>
+auto measure_ms(F func) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+int mymain(std::vector<std::string>& args)
+{
+    unsigned steps      = 300;
+    unsigned convoysize = convoy::large;
+    std::string infile;
+
+    for (auto it = args.begin(); it != args.end(); ++it) {
+        if (*it == "--help") {
+            std::cout << "DftD simulation benchmark, usage:\n"
+                      << "simbench [--steps n] [--convoy 0-2] [INFILE]\n"
+                      << "\tsimulate given game or a generated convoy mission of given size\n"
+                      << "\t(default 2, large) and print time per simulation step and\n"
+                      << "\tper sensor sweep (lookout, radar and sonar of all ships)\n"
+                      << "--datadir path\tset base directory of data\n";
+            return 0;
+        } else if (*it == "--steps" && it + 1 != args.end()) {
+            steps = std::max(1, atoi((++it)->c_str()));
+        } else if (*it == "--convoy" && it + 1 != args.end()) {
+            convoysize = std::min(2, std::max(0, atoi((++it)->c_str())));
+        } else if (*it == "--datadir" && it + 1 != args.end()) {
+            std::string datadir = *++it;
+            if (datadir[datadir.length() - 1] != '/') {
+                datadir += "/";
+            }
+            set_data_dir(datadir);
+        } else {
+            infile = *it;
+        }
+    }
+
+    // game creation needs the options for water and terrain and an OpenGL context
+    cfg& mycfg = cfg::instance();
+    mycfg.register_option("use_hqsfx", true);
+    mycfg.register_option("water_detail", 128);
+    mycfg.register_option("wave_fft_res", 128);
+    mycfg.register_option("wave_phases", 256);
+    mycfg.register_option("wavetile_length", 256.0F);
+    mycfg.register_option("wave_tidecycle_time", 10.24F);
+    mycfg.register_option("cpucores", 1);
+    mycfg.register_option("terrain_texture_resolution", 0.1F);
+    mycfg.register_option("terrain_detail", 1);
+
+    system_interface::parameters params;
+    params.near_z       = 1.0;
+    params.far_z        = 1000.0;
+    params.resolution   = {640, 480};
+    params.resolution2d = {1024, 768};
+    params.fullscreen   = false;
+    system_interface::create_instance(params);
+
+    std::unique_ptr<game> gm;
+    if (infile.empty()) {
+        gm = std::make_unique<game>("submarine_VIIc", convoysize, convoy::etlarge, 2 /* day */, date(1941, 6, 1));
+    } else {
+        gm = std::make_unique<game>(infile);
+    }
+    auto allships = gm->get_all_ships();
+    std::cout << allships.size() << " ships, submarines and torpedoes\n";
+
+    // warm up, so first time effects like spawning particles don't count
+    const double step_time = 1.0 / 30.0;
+    for (unsigned i = 0; i < 30; ++i) {
+        gm->simulate(step_time);
+    }
+    // the game may end early, e.g. when the player's submarine is sunk
+    unsigned steps_run         = 0;
+    const double simulate_time = measure_ms([&]() {
+        for (; steps_run < steps && gm->get_run_state() == game::running; ++steps_run) {
+            gm->simulate(step_time);
+        }
+    });
+
+    allships           = gm->get_all_ships();
+    std::size_t found  = 0;
+    const double sweep = measure_ms([&]() {
+        for (unsigned i = 0; i < steps; ++i) {
+            for (const auto* s : allships) {
+                found += gm->visible_sea_objects(s).size();
+                found += gm->radar_sea_objects(s).size();
+                found += gm->sonar_sea_objects(s).size();
+            }
+        }
+    });
+
+    std::cout << "simulation step\t" << simulate_time / std::max(steps_run, 1U) << " ms (" << steps_run
+              << " steps)\n"
+              << "sensor sweep\t" << sweep / steps << " ms (" << found / steps << " contacts)\n";
+    return 0;
+}
@@ -28,7 +28,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "binstream.hpp"
 #include "coastmap.hpp"
 #include "datadirs.hpp"
+#include "filehelper.hpp"
 #include "global_data.hpp"
+#include "log.hpp"
 #include "model.hpp"
 #include "primitives.hpp"
 #include "system_interface.hpp"
@@ -37,6 +39,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "xml.hpp"
 
 #include <SDL_image.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <list>
 #include <memory>
@@ -781,7 +787,8 @@ void coastmap::divide_and_distribute_cl(const std::vector<vector2i>& cl, bool cl
     }
 }
 
-void coastmap::process_coastline(int x, int y)
+// returns false for invalid coastlines, that are skipped
+auto coastmap::trace_coastline(int x, int y, coastline& cl) -> bool
 {
     ASSERT((mapf(x, y) & 0x80) == 0, "map pos already handled!");
 
@@ -795,7 +802,7 @@ void coastmap::process_coastline(int x, int y)
     // valid %u\n", x,y,points.size(),cyclic,beginborder,endborder,valid);
 
     if (!valid) {
-        return; // skip
+        return false; // skip
     }
 
     // create bspline curve
@@ -878,37 +885,31 @@ void coastmap::process_coastline(int x, int y)
     }
 
     // create smooth version of the coastline.
-    bsplinet<vector2> curve(n, tmp); // points in map pixel coordinates
+    cl.curve  = std::make_unique<bsplinet<vector2>>(n, tmp);
+    cl.cyclic = cyclic;
 
     // smooth points will be scaled so that each segment is (2^16)-1 units long.
     auto nrpts = unsigned(tmp.size() * BSPLINE_DETAIL);
     ASSERT(nrpts >= 2, " nrpts < 2?");
-    tmp.clear();
-    std::vector<vector2i> spoints;
-    spoints.reserve(nrpts);
-    double sscal = double(SEGSCALE) / pixels_per_seg;
-    //	cout << "generating " << nrpts << " pts\n";
-    for (unsigned i = 0; i < nrpts; ++i) {
+    cl.points.resize(nrpts);
+    return true;
+}
+
+// compute points [begin, end) of the smoothed coastline, parts of a coastline
+// can be computed in parallel
+void coastmap::sample_coastline(coastline& cl, unsigned begin, unsigned end) const
+{
+    // the curve caches intermediate values, so every caller needs its own copy
+    auto curve         = *cl.curve;
+    const auto nrpts   = unsigned(cl.points.size());
+    const double sscal = double(SEGSCALE) / pixels_per_seg;
+    for (unsigned i = begin; i < end; ++i) {
         vector2 cv = curve.value(float(i) / (nrpts - 1));
         // fixme: gcc4.0.1 strange values occour, are written here. but also
         // generated here? either cv values are weird/out of bounds or the
         // transformation here is buggy
-        vector2i cvi = vector2i(int(round(cv.x * sscal)), int(round(cv.y * sscal)));
-        /*
-                cout << "generated point " << i << "/" << nrpts << " -> " << cvi
-           << " cv is " << cv << " sscal " << sscal << " roundx: " << round(cv.x
-           * sscal) << " roundy " << round(cv.y * sscal) << " intrx " <<
-           int(round(cv.x * sscal)) << " intry " << int(round(cv.y * sscal)) <<
-           "\n";
-        */
-        // avoid double points here., fixme assert them?
-        if (spoints.empty() || !(spoints.back() == cvi)) {
-            spoints.push_back(cvi);
-        }
+        cl.points[i] = vector2i(int(round(cv.x * sscal)), int(round(cv.y * sscal)));
     }
-
-    divide_and_distribute_cl(spoints, cyclic);
-    ++global_clnr;
 }
 
 void coastmap::process_segment(int sx, int sy)
@@ -1034,8 +1035,9 @@ auto coastmap::segcoord_to_texc(int segx, int segy) const -> vector2f
 }
 
 // load from xml description file
-coastmap::coastmap(const std::string& filename, object_store<model>& model_store_)
+coastmap::coastmap(const std::string& filename, object_store<model>& model_store_, unsigned nr_of_threads_)
     : model_store(model_store_)
+    , nr_of_threads(nr_of_threads_ > 0 ? nr_of_threads_ : std::max(std::thread::hardware_concurrency(), 1U))
 {
     atlanticmap = std::make_unique<texture>(get_texture_dir() + "atlanticmap.jpg", texture::LINEAR, texture::CLAMP);
 
@@ -1068,30 +1070,21 @@ coastmap::coastmap(const std::string& filename, object_store<model>& model_store
         }
     }
 
-    {
-        sdl_image surf(get_map_dir() + et.attr("image"));
-        mapw        = surf->w;
-        maph        = surf->h;
-        pixelw_real = realwidth / mapw;
-        realheight  = maph * realwidth / mapw;
-        // compute integer number of pixels per segment
-        auto pixperseqnonpower2 = unsigned(ceil(60000 / pixelw_real));
-        // find next power of 2 that is larger or equal than computed nonpower2
-        // pixel width
-        for (pixels_per_seg = 1; pixels_per_seg < pixperseqnonpower2; pixels_per_seg <<= 1) {
-            ;
-        }
+    const std::string image = get_map_dir() + et.attr("image");
+    map_hash                = compute_file_hash(image);
+    const auto slash        = filename.rfind('/');
+    const auto namebegin    = (slash == std::string::npos) ? 0 : slash + 1;
+    cachefilename = get_cache_dir() + filename.substr(namebegin, filename.rfind('.') - namebegin) + "_coastmap.cache";
+    if (load_cache()) {
+        add_loading_screen("coastmap read from cache");
+        return;
+    }
 
-        segsx     = mapw / pixels_per_seg;
-        segsy     = maph / pixels_per_seg;
-        segw_real = pixelw_real * pixels_per_seg;
-        if (segsx * pixels_per_seg != mapw || segsy * pixels_per_seg != maph) {
-            THROW(
-                error,
-                std::string("coastmap: map size must be integer multiple of segment "
-                            "size, in")
-                    + filename);
-        }
+    {
+        sdl_image surf(image);
+        mapw = surf->w;
+        maph = surf->h;
+        compute_segment_layout(filename);
 
         themap.resize(mapw * maph);
 
@@ -1126,44 +1119,278 @@ coastmap::coastmap(const std::string& filename, object_store<model>& model_store
 
 coastmap::~coastmap() = default;
 
+void coastmap::compute_segment_layout(const std::string& filename)
+{
+    pixelw_real = realwidth / mapw;
+    realheight  = maph * realwidth / mapw;
+    // compute integer number of pixels per segment
+    auto pixperseqnonpower2 = unsigned(ceil(60000 / pixelw_real));
+    // find next power of 2 that is larger or equal than computed nonpower2
+    // pixel width
+    for (pixels_per_seg = 1; pixels_per_seg < pixperseqnonpower2; pixels_per_seg <<= 1) {
+        ;
+    }
+
+    segsx     = mapw / pixels_per_seg;
+    segsy     = maph / pixels_per_seg;
+    segw_real = pixelw_real * pixels_per_seg;
+    if (segsx * pixels_per_seg != mapw || segsy * pixels_per_seg != maph) {
+        THROW(
+            error,
+            std::string("coastmap: map size must be integer multiple of segment "
+                        "size, in")
+                + filename);
+    }
+}
+
+namespace {
+const uint32_t cache_magic = 0x50414d43; // "CMAP"
+// increase when construction of segments changes
+const uint32_t cache_version = 1;
+} // namespace
+
+// read segments of cache file if it is valid for the map image
+auto coastmap::load_cache() -> bool
+{
+    std::ifstream in(cachefilename, std::ios::in | std::ios::binary);
+    if (!in.good()) {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (read_u32(in) != cache_magic || read_u32(in) != cache_version || read_u64(in) != map_hash) {
+        log_info("coastmap cache " << cachefilename << " is outdated");
+        return false;
+    }
+    mapw                             = read_u32(in);
+    maph                             = read_u32(in);
+    const unsigned cached_seg_pixels = read_u32(in);
+    if (!in.good() || mapw == 0 || maph == 0) {
+        return false;
+    }
+    compute_segment_layout(cachefilename);
+    if (pixels_per_seg != cached_seg_pixels) {
+        // real size of map changed
+        return false;
+    }
+    coastsegments.resize(segsx * segsy);
+    for (auto& cs : coastsegments) {
+        cs.atlanticmap = &*atlanticmap;
+        cs.type        = read_u8(in);
+        cs.segcls.resize(in.good() ? read_u32(in) : 0);
+        for (auto& scl : cs.segcls) {
+            scl.global_clnr = read_i32(in);
+            scl.beginpos    = read_i32(in);
+            scl.endpos      = read_i32(in);
+            scl.next        = read_i32(in);
+            scl.cyclic      = read_bool(in);
+            scl.points.resize(in.good() ? read_u32(in) : 0);
+            // points are most of the data, read them as a block
+            static_assert(sizeof(coastsegment::segpos) == 2 * sizeof(uint16_t), "segpos must be packed");
+            in.read(
+                reinterpret_cast<char*>(scl.points.data()),
+                std::streamsize(scl.points.size() * sizeof(coastsegment::segpos)));
+#ifdef BIG_ENDIAN
+            for (auto& p : scl.points) {
+                p.x = swap_endianess_on_big_endian_machine(uint16_t(p.x));
+                p.y = swap_endianess_on_big_endian_machine(uint16_t(p.y));
+            }
+#endif
+        }
+    }
+    if (!in.good()) {
+        log_warning("coastmap cache " << cachefilename << " is damaged");
+        coastsegments.clear();
+        return false;
+    }
+    [[maybe_unused]] const double t_load =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    log_info("coastmap read from cache in " << t_load << "ms");
+    return true;
+}
+
+// write segments to cache file, the cache is optional so errors are only logged
+void coastmap::save_cache() const
+{
+    // write to temporary file, so an aborted write never leaves a broken cache
+    const std::string tmpfilename = cachefilename + ".tmp";
+    {
+        std::ofstream out(tmpfilename, std::ios::out | std::ios::binary);
+        write_u32(out, cache_magic);
+        write_u32(out, cache_version);
+        write_u64(out, map_hash);
+        write_u32(out, mapw);
+        write_u32(out, maph);
+        write_u32(out, pixels_per_seg);
+        for (const auto& cs : coastsegments) {
+            write_u8(out, uint8_t(cs.type));
+            write_u32(out, uint32_t(cs.segcls.size()));
+            for (const auto& scl : cs.segcls) {
+                write_i32(out, scl.global_clnr);
+                write_i32(out, scl.beginpos);
+                write_i32(out, scl.endpos);
+                write_i32(out, scl.next);
+                write_bool(out, scl.cyclic);
+                write_u32(out, uint32_t(scl.points.size()));
+                for (const auto& p : scl.points) {
+                    write_u16(out, p.x);
+                    write_u16(out, p.y);
+                }
+            }
+        }
+        if (!out.good()) {
+            log_warning("could not write coastmap cache " << tmpfilename);
+            return;
+        }
+    }
+    std::remove(cachefilename.c_str());
+    if (std::rename(tmpfilename.c_str(), cachefilename.c_str()) != 0) {
+        log_warning("could not write coastmap cache " << cachefilename);
+        std::remove(tmpfilename.c_str());
+    }
+}
+
+// find all positions where coastlines could start in map rows [y0, y1)
+void coastmap::find_coastline_starts(unsigned y0, unsigned y1, std::vector<vector2i>& starts)
+{
+    // when to start processing: all patterns, except: 0,5,10,15
+    for (int yy = int(y0); yy < int(y1); ++yy) {
+        for (int xx = 0; xx < int(mapw); ++xx) {
+            uint8_t pattern = 0;
+            if (xx > 0 && yy > 0) {
+                // no clamping needed, pixels in order of dmx/dmy
+                const uint8_t* below = &themap[(yy - 1) * mapw + xx - 1];
+                const uint8_t* above = below + mapw;
+                pattern              = (below[0] & 0x7f) | ((below[1] & 0x7f) << 1);
+                pattern |= ((above[1] & 0x7f) << 2) | ((above[0] & 0x7f) << 3);
+            } else {
+                for (int j = 0; j < 4; ++j) {
+                    pattern |= (mapf(xx + dmx[j], yy + dmy[j]) & 0x7f) << j;
+                }
+            }
+            if (patternprocessok[pattern]) {
+                starts.emplace_back(xx, yy);
+            }
+        }
+    }
+}
+
+namespace {
+/// call func(i) for all i in [0, nr), spread over nr_threads threads
+template<typename F>
+void parallel_for(unsigned nr, unsigned nr_threads, F func)
+{
+    std::atomic<unsigned> next{0};
+    auto work = [&]() {
+        for (unsigned i = next++; i < nr; i = next++) {
+            func(i);
+        }
+    };
+    std::vector<std::unique_ptr<::thread>> helpers;
+    for (unsigned t = 1; t < std::min(nr_threads, nr); ++t) {
+        helpers.push_back(std::make_unique<::thread>("coastmap-helper", work));
+    }
+    work();
+    // joins helpers
+    helpers.clear();
+}
+} // namespace
+
 void coastmap::construction_threaded()
 {
-    // they are filled in by process_coastline
+    using clock        = std::chrono::steady_clock;
+    const auto elapsed = [](clock::time_point& start) {
+        const auto now = clock::now();
+        const double t = std::chrono::duration<double, std::milli>(now - start).count();
+        start          = now;
+        return t;
+    };
+    auto start = clock::now();
+
+    // they are filled in by divide_and_distribute_cl
     coastsegments.resize(segsx * segsy);
     for (auto& coastsegment : coastsegments) {
         coastsegment.atlanticmap = &*atlanticmap;
     }
 
-    // find coastlines
-    // when to start processing: all patterns, except: 0,5,10,15
-    for (int yy = 0; yy < int(maph); ++yy) {
-        for (int xx = 0; xx < int(mapw); ++xx) {
-            if ((mapf(xx, yy) & 0x80) != 0) {
+    // find positions where coastlines could start, in stripes of the map in
+    // parallel. Tracing a coastline marks the land along it as handled, which
+    // only removes start positions, so the positions found on the unmarked
+    // map are a superset of those the tracing needs.
+    const unsigned stripe_height = pixels_per_seg;
+    const unsigned nr_of_stripes = (maph + stripe_height - 1) / stripe_height;
+    std::vector<std::vector<vector2i>> starts(nr_of_stripes);
+    parallel_for(nr_of_stripes, nr_of_threads, [&](unsigned s) {
+        find_coastline_starts(s * stripe_height, std::min((s + 1) * stripe_height, maph), starts[s]);
+    });
+    [[maybe_unused]] const double t_scan = elapsed(start);
+
+    // trace coastlines in scan order, because they are marked while tracing.
+    // This follows every coastline as a whole over the map, it is fast.
+    std::vector<coastline> coastlines;
+    for (const auto& stripe : starts) {
+        for (const auto& p : stripe) {
+            if ((mapf(p.x, p.y) & 0x80) != 0) {
                 continue;
             }
-            uint8_t pattern = 0;
-            uint8_t marker  = 0;
+            uint8_t marker = 0;
             for (int j = 0; j < 4; ++j) {
-                uint8_t c = mapf(xx + dmx[j], yy + dmy[j]);
-                pattern |= (c & 0x7f) << j;
-                marker |= c;
+                marker |= mapf(p.x + dmx[j], p.y + dmy[j]);
             }
-            if (patternprocessok[pattern] && ((marker & 0x80) == 0)) {
-                process_coastline(xx, yy);
+            if ((marker & 0x80) == 0) {
+                coastline cl;
+                if (trace_coastline(p.x, p.y, cl)) {
+                    coastlines.push_back(std::move(cl));
+                }
             }
         }
     }
+    starts.clear();
+    [[maybe_unused]] const double t_trace = elapsed(start);
+
+    // compute the smoothed coastlines in parallel, in blocks of points, so
+    // the few long coastlines of the continents are split over all threads
+    const unsigned points_per_block = 4096;
+    std::vector<std::pair<unsigned, unsigned>> blocks; // coastline, first point
+    for (unsigned i = 0; i < coastlines.size(); ++i) {
+        for (unsigned b = 0; b < coastlines[i].points.size(); b += points_per_block) {
+            blocks.emplace_back(i, b);
+        }
+    }
+    parallel_for(unsigned(blocks.size()), nr_of_threads, [&](unsigned i) {
+        auto& cl           = coastlines[blocks[i].first];
+        const unsigned end = std::min(blocks[i].second + points_per_block, unsigned(cl.points.size()));
+        sample_coastline(cl, blocks[i].second, end);
+    });
+    [[maybe_unused]] const double t_smooth = elapsed(start);
+
+    // merge blocks, distribute coastlines to segments in the original order
+    for (auto& cl : coastlines) {
+        // avoid double points here., fixme assert them?
+        cl.points.erase(std::unique(cl.points.begin(), cl.points.end()), cl.points.end());
+        divide_and_distribute_cl(cl.points, cl.cyclic);
+        ++global_clnr;
+        cl = coastline();
+    }
+    [[maybe_unused]] const double t_distribute = elapsed(start);
 
-    // find coastsegment type and successors of cls.
-    for (unsigned yy = 0; yy < segsy; ++yy) {
+    // find coastsegment type and successors of cls, segments are independent.
+    parallel_for(segsy, nr_of_threads, [&](unsigned yy) {
         for (unsigned xx = 0; xx < segsx; ++xx) {
             process_segment(xx, yy);
         }
-    }
+    });
+    [[maybe_unused]] const double t_segments = elapsed(start);
+
+    log_info(
+        "coastmap constructed with " << nr_of_threads << " threads, " << global_clnr << " coastlines: scan " << t_scan
+                                     << "ms, trace " << t_trace << "ms, smooth " << t_smooth << "ms, distribute "
+                                     << t_distribute << "ms, segments " << t_segments << "ms");
+
+    save_cache();
 
-    // fixme: clear "themap" so save space.
     // information wether a position on the map is land or sea can be computed
-    // from segment data. This will save 6MB of space at least.
+    // from segment data, so the map isn't needed any longer.
+    std::vector<uint8_t>().swap(themap);
 }
 
 void coastmap::finish_construction()
@@ -171,12 +171,31 @@ class coastmap
 
     void divide_and_distribute_cl(const std::vector<vector2i>& cl, bool clcyclic);
 
-    void process_coastline(int x, int y);
+    /// a coastline found in the map and its smoothing curve
+    struct coastline
+    {
+        std::unique_ptr<bsplinet<vector2>> curve; // in map pixel coordinates
+        std::vector<vector2i> points;             // points of curve, in segment scale
+        bool cyclic{false};
+    };
+
+    void find_coastline_starts(unsigned y0, unsigned y1, std::vector<vector2i>& starts);
+    bool trace_coastline(int x, int y, coastline& cl);
+    void sample_coastline(coastline& cl, unsigned begin, unsigned end) const;
     void process_segment(int x, int y);
 
+    unsigned nr_of_threads;
     std::unique_ptr<::thread> myworker;
     void construction_threaded();
 
+    // the finished segments are cached in a file, so the map image only needs
+    // to be decoded and processed once.
+    uint64_t map_hash{0};      // hash of map image file, cache is only valid for it
+    std::string cachefilename; // name of cache file
+    void compute_segment_layout(const std::string& filename);
+    bool load_cache();
+    void save_cache() const;
+
   public:
     // returns quadrant of vector d (0: - 0 degr, 1: - ]0...90[ degr, 2 - 90
     // degr ... 7: ..360[ degr.)
@@ -186,7 +205,8 @@ class coastmap
     [[nodiscard]] vector2f segcoord_to_texc(int segx, int segy) const;
 
     /// create from xml file
-    coastmap(const std::string& filename, object_store<model>& model_store_);
+    ///@param nr_of_threads_ - threads used for construction, 0 for all cores
+    coastmap(const std::string& filename, object_store<model>& model_store_, unsigned nr_of_threads_ = 0);
     ~coastmap();
 
     /// MUST be called after construction of coastmap and before using it!
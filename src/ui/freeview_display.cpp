@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "freeview_display.hpp"
 
 #include "airplane.hpp"
+#include "constant.hpp"
 #include "depth_charge.hpp"
 #include "frustum.hpp"
 #include "game.hpp"
@@ -35,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "primitives.hpp"
 #include "ship.hpp"
 #include "sky.hpp"
+#include "sphere_culler.hpp"
 #include "submarine.hpp"
 #include "system_interface.hpp"
 #include "texture.hpp"
@@ -44,6 +46,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "water_splash.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <utility>
 
@@ -140,7 +143,7 @@ freeview_display::~freeview_display() = default;
 
 auto freeview_display::get_viewpos(class game& gm) const -> vector3
 {
-    return gm.get_player()->get_pos() + add_pos;
+    return gm.get_player()->get_render_pos(gm.get_render_interpolation()) + add_pos;
 }
 
 void freeview_display::display() const
@@ -249,21 +252,19 @@ void freeview_display::draw_objects(
     // d = PI/2*r - r*arcsin(z/r+1), fixme implement
 
     sea_object* player = gm.get_player();
+    const double alpha = gm.get_render_interpolation();
 
+    // objects are already culled and filtered by cull_objects, mirror lists
+    // contain no torpedoes.
     for (const auto* object : objects) {
-        bool istorp = (dynamic_cast<const torpedo*>(object) != nullptr);
-        if (istorp && !withunderwaterweapons) {
-            continue;
-        }
-
-        if (aboard && object == player) {
-            continue;
-        }
+        // select level of detail by screen size of the object
+        const double dist  = std::max(object->get_render_pos(alpha).distance(viewpos), 1.0);
+        const unsigned lod = object->select_lod(lod_pixel_scale / dist);
         glPushMatrix();
 
-        if (mirrorclip && !istorp) {
+        if (mirrorclip) {
             // viewpos.z is already mirrored...
-            vector3 pos = object->get_pos();
+            vector3 pos = object->get_render_pos(alpha);
             glTranslated(pos.x - viewpos.x, pos.y - viewpos.y, -viewpos.z);
             // orientation affects tex#1 matrix, for the code below
             glActiveTexture(GL_TEXTURE1);
@@ -280,30 +281,26 @@ void freeview_display::draw_objects(
             // inflicts geoclipmap rendering as well...
             glTranslated(0, 0, pos.z);
         } else {
-            vector3 pos = object->get_pos() - viewpos;
+            vector3 pos = object->get_render_pos(alpha) - viewpos;
             // pos.z += EARTH_RADIUS * (sin(M_PI/2 -
             // pos.xy().length()/EARTH_RADIUS) - 1.0);
             glTranslated(pos.x, pos.y, pos.z);
         }
         const ship* shp = dynamic_cast<const ship*>(object);
         if (shp != nullptr) {
-            shp->get_orientation().rotmat4().multiply_gl();
+            shp->get_render_orientation(alpha).rotmat4().multiply_gl();
         }
         if (mirrorclip) {
-            // torpedoes are normally fully underwater and thus need not to get
-            // rendered for mirror images
-            if (!istorp) {
-                // finished modifying tex#1 matrix
-                glMatrixMode(GL_MODELVIEW);
-                object->display_mirror_clip();
-            }
+            // finished modifying tex#1 matrix
+            glMatrixMode(GL_MODELVIEW);
+            object->display_mirror_clip(lod);
             // cleanup
             glActiveTexture(GL_TEXTURE1);
             glMatrixMode(GL_TEXTURE);
             glLoadIdentity();
             glMatrixMode(GL_MODELVIEW);
         } else {
-            object->display(under_water ? ui.get_caustics().get_map() : nullptr);
+            object->display(under_water ? ui.get_caustics().get_map() : nullptr, lod);
         }
         glPopMatrix();
     }
@@ -324,7 +321,7 @@ void freeview_display::draw_objects(
         auto depth_charges = gm.visible_depth_charges(player);
         for (const auto* it : depth_charges) {
             glPushMatrix();
-            vector3 pos = it->get_pos() - viewpos;
+            vector3 pos = it->get_render_pos(alpha) - viewpos;
             glTranslated(pos.x, pos.y, pos.z);
             glRotatef(-it->get_heading().value(), 0, 0, 1);
             it->display(under_water ? ui.get_caustics().get_map() : nullptr);
@@ -335,7 +332,7 @@ void freeview_display::draw_objects(
     auto gun_shells = gm.visible_gun_shells(player);
     for (const auto* it : gun_shells) {
         glPushMatrix();
-        vector3 pos = it->get_pos() - viewpos;
+        vector3 pos = it->get_render_pos(alpha) - viewpos;
         glTranslated(pos.x, pos.y, pos.z);
         glRotatef(-it->get_heading().value(), 0, 0, 1);
         it->display();
@@ -367,6 +364,35 @@ void freeview_display::draw_objects(
     glDepthMask(GL_TRUE);
 }
 
+auto freeview_display::cull_objects(
+    game& gm,
+    const vector<const sea_object*>& objects,
+    sphere_culler& culler,
+    bool mirror) const -> vector<const sea_object*>
+{
+    // Test bounding spheres before any GL work is done. The mirrored scene is
+    // tested with the mirrored frustum, so real positions are used for both.
+    const sea_object* player = gm.get_player();
+    const double alpha       = gm.get_render_interpolation();
+    vector<const sea_object*> result;
+    result.reserve(objects.size());
+    for (const auto* object : objects) {
+        if (aboard && object == player) {
+            continue;
+        }
+        // torpedoes are normally fully underwater and thus need not to get
+        // rendered for mirror images
+        const bool istorp = (dynamic_cast<const torpedo*>(object) != nullptr);
+        if (istorp && (mirror || !withunderwaterweapons)) {
+            continue;
+        }
+        if (culler.is_visible(object->get_render_pos(alpha), object->get_bounding_radius())) {
+            result.push_back(object);
+        }
+    }
+    return result;
+}
+
 void freeview_display::draw_view(game& gm, const vector3& viewpos) const
 {
     double max_view_dist = gm.get_max_view_distance();
@@ -395,6 +421,15 @@ void freeview_display::draw_view(game& gm, const vector3& viewpos) const
     // ****************************************
     set_modelview_matrix(gm, viewpos);
 
+    // frustum for culling in world space. The modelview matrix has no
+    // translation, so move the frustum to the viewing position.
+    frustum cull_frustum = frustum::from_matrices(
+        matrix4::get_gl(GL_MODELVIEW_MATRIX),
+        matrix4::frustum_fovx(pd.fov_x, double(pd.w) / double(pd.h), pd.near_z, pd.far_z));
+    cull_frustum.translate(viewpos);
+    // pixels per meter at distance 1m, for level of detail selection
+    lod_pixel_scale = pd.w / (2.0 * std::tan(pd.fov_x * constant::PI / 360.0));
+
     // **************** prepare drawing
     // ***************************************************
 
@@ -437,6 +472,10 @@ void freeview_display::draw_view(game& gm, const vector3& viewpos) const
     // fixme: the lookout sensor must give all ships seens around, not cull away
     // ships out of the frustum, or their foam is lost as well, even it would be
     // visible...
+    // So foam uses all objects, but only the ones passing frustum and horizon
+    // tests are drawn.
+    sphere_culler culler(cull_frustum, max_view_dist);
+    const auto objects_culled = cull_objects(gm, objects, culler, false);
 
     // ********************* draw mirrored scene
 
@@ -505,14 +544,10 @@ void freeview_display::draw_view(game& gm, const vector3& viewpos) const
         // would be perfect which is highly unrealistic.
         // so remove entries that are too far away. Torpedoes can't be seen
         // so they don't need to get rendered.
-        vector<const sea_object*> objects_mirror;
-        objects_mirror.reserve(objects.size());
         const double MIRROR_DIST = 1000.0; // 1km or so...
-        for (const auto* object : objects) {
-            if (object->get_pos().xy().square_distance(viewpos.xy()) < MIRROR_DIST * MIRROR_DIST) {
-                objects_mirror.push_back(object);
-            }
-        }
+        sphere_culler culler_mirror(cull_frustum.get_mirrored(), MIRROR_DIST);
+        const auto objects_mirror = cull_objects(gm, objects, culler_mirror, true);
+        cull_stats_mirror         = culler_mirror.get_statistics();
         draw_objects(gm, viewpos_mirror, objects_mirror, lightcol, false /* under_water */, true /* mirror */);
 
         glCullFace(GL_BACK);
@@ -715,7 +750,8 @@ void freeview_display::draw_view(game& gm, const vector3& viewpos) const
     // matrix4::get_gl(GL_MODELVIEW_MATRIX).column(3) << "\n";
 
     // substract player pos.
-    draw_objects(gm, viewpos, objects, lightcol, above_water < 0 /* under water */, false /* mirrorclip */);
+    draw_objects(gm, viewpos, objects_culled, lightcol, above_water < 0 /* under water */, false /* mirrorclip */);
+    cull_stats = culler.get_statistics();
 
     // ******************** draw the bridge in higher detail
     if (aboard && drawbridge) {
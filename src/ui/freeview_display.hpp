@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #pragma once
 
 #include "angle.hpp"
+#include "sphere_culler.hpp"
 #include "user_display.hpp"
 #include "vector3.hpp"
 class sea_object;
@@ -63,6 +64,20 @@ class freeview_display : public user_display
     virtual void set_modelview_matrix(class game& gm, const vector3& viewpos) const;
     virtual void post_display() const;
 
+    // select the objects to draw, culled on the CPU by frustum and horizon
+    std::vector<const sea_object*> cull_objects(
+        class game& gm,
+        const std::vector<const sea_object*>& objects,
+        sphere_culler& culler,
+        bool mirror) const;
+
+    // culling counters of the last frame, for the scene and its reflection
+    mutable sphere_culler::statistics cull_stats;
+    mutable sphere_culler::statistics cull_stats_mirror;
+
+    // screen size in pixels of one meter at one meter distance, for LOD selection
+    mutable double lod_pixel_scale{1000.0};
+
     // draw all sea_objects
     virtual void draw_objects(
         class game& gm,
@@ -86,4 +101,10 @@ class freeview_display : public user_display
     bool handle_key_event(const key_data&) override;
     bool handle_mouse_motion_event(const mouse_motion_data&) override;
     bool handle_mouse_wheel_event(const mouse_wheel_data&) override;
+
+    /// culling counters of the last frame, of main or mirrored scene
+    [[nodiscard]] const sphere_culler::statistics& get_culling_statistics(bool mirror = false) const
+    {
+        return mirror ? cull_stats_mirror : cull_stats;
+    }
 };
@@ -86,34 +86,33 @@ void map_display::draw_vessel_symbol(const vector2& offset, const sea_object* so
     primitives::line(vector2f(p.x - d.x * l, p.y + d.y * l), vector2f(p.x + d.x * l, p.y - d.y * l), c).render();
 }
 
-void map_display::draw_trail(const sea_object* so, const vector2& offset) const
+void map_display::draw_trails(const std::vector<const sea_object*>& objs, const vector2& offset) const
 {
     // fixme: clean up this mess. maybe merge with function in water.cpp
     // we draw trails in both functions.
-    const auto* shp = dynamic_cast<const ship*>(so);
-    if (shp != nullptr) {
-        const list<ship::prev_pos>& l = shp->get_previous_positions();
-        if (l.empty()) {
-            return;
+    // trails of all objects are drawn as one line strip
+    trail_vertices.clear();
+    trail_colors.clear();
+    const vector2 origin(512 + offset.x * mapzoom, 384 - offset.y * mapzoom);
+    const vector2 scale(mapzoom, -mapzoom);
+    for (const auto* so : objs) {
+        const auto* shp = dynamic_cast<const ship*>(so);
+        if (shp != nullptr) {
+            ship::append_trail_strip(
+                shp->get_pos().xy(), shp->get_previous_positions(), origin, scale, trail_vertices, trail_colors);
         }
-        vector2 p = (shp->get_pos().xy() + offset) * mapzoom;
-        primitives tr(GL_LINE_STRIP, l.size() + 1);
-        tr.vertices[0].x = 512 + p.x;
-        tr.vertices[0].y = 384 - p.y;
-        tr.colors[0]     = colorf(1, 1, 1, 1);
-        float la         = 1.0 / float(l.size());
-        float lc         = 0;
-        unsigned trc     = 1;
-        for (const auto& it : l) {
-            tr.colors[trc]     = colorf(1, 1, 1, 1 - lc);
-            vector2 p          = (it.pos + offset) * mapzoom;
-            tr.vertices[trc].x = 512 + p.x;
-            tr.vertices[trc].y = 384 - p.y;
-            lc += la;
-            ++trc;
-        }
-        tr.render();
     }
+    if (trail_vertices.empty()) {
+        return;
+    }
+    // the buffers are swapped in, so constructing allocates nothing
+    primitives tr(GL_LINE_STRIP, 0);
+    tr.vertices.swap(trail_vertices);
+    tr.colors.swap(trail_colors);
+    tr.render();
+    // keep the memory for the next frame
+    tr.vertices.swap(trail_vertices);
+    tr.colors.swap(trail_colors);
 }
 
 void map_display::draw_pings(class game& gm, const vector2& offset) const
@@ -217,9 +216,7 @@ void map_display::draw_visual_contacts(class game& /*gm*/, const sea_object* pla
     const auto& objs = player->get_visible_objects();
 
     // draw trails
-    for (const auto* obj : objs) {
-        draw_trail(obj, offset);
-    }
+    draw_trails(objs, offset);
 
     // draw vessel symbols
     for (const auto* obj : objs) {
@@ -242,9 +239,7 @@ void map_display::draw_radar_contacts(class game& /*gm*/, const sea_object* play
     const auto& objs = player->get_radar_objects();
 
     // draw trails
-    for (const auto* obj : objs) {
-        draw_trail(obj, offset);
-    }
+    draw_trails(objs, offset);
 
     // draw vessel symbols
     for (const auto* obj : objs) {
@@ -717,7 +712,7 @@ void map_display::display() const
         draw_sound_contact(gm, sub_player, -offset);
 
         // draw player trails and player
-        draw_trail(player, -offset);
+        draw_trails({player}, -offset);
         draw_vessel_symbol(-offset, sub_player, color(255, 255, 128));
 
         // Special handling for submarine player: When the submarine is
@@ -748,9 +743,10 @@ void map_display::display() const
     vector<pair<double, noise>> signal_strengths;
     const unsigned signal_res = 360;
     signal_strengths.resize(signal_res);
+    const auto& spectrum = gm.sonar_listen_all_directions(sub_player);
     for (unsigned i = 0; i < signal_res; ++i) {
         angle a(360.0 * i / signal_res);
-        signal_strengths[i] = gm.sonar_listen_ships(sub_player, a);
+        signal_strengths[i] = spectrum.get_signal(a);
     }
     // render the strengths as circles with various colors
     primitives circle(GL_LINE_LOOP, signal_res, colorf(1, 1, 1, 1));
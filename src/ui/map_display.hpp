@@ -27,9 +27,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "sea_object_id.hpp"
 #include "user_display.hpp"
 #include "vector2.hpp"
+#include "vector3.hpp"
 #include "widget.hpp"
 
 #include <unordered_set>
+#include <vector>
 
 class game;
 class game_editor;
@@ -46,8 +48,12 @@ class map_display : public user_display
     vector2i mouse_position; // last mouse position
     int mapmode;
 
+    // temporary buffers for trail drawing, avoid allocations every frame
+    mutable std::vector<vector3f> trail_vertices;
+    mutable std::vector<color> trail_colors;
+
     void draw_vessel_symbol(const vector2& offset, const sea_object* so, color c) const;
-    void draw_trail(const sea_object* so, const vector2& offset) const;
+    void draw_trails(const std::vector<const sea_object*>& objs, const vector2& offset) const;
     void draw_pings(game& gm, const vector2& offset) const;
     void draw_sound_contact(game& gm, const sea_object* player, double max_view_dist, const vector2& offset) const;
     void draw_sound_contact(game& gm, const submarine* player, const vector2& offset) const;
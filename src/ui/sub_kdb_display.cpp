@@ -112,14 +112,15 @@ auto sub_kdb_display::handle_mouse_motion_event(const mouse_motion_data& m) -> b
 
 auto find_peak_noise(angle startangle, double step, double maxstep, game& gm) -> std::pair<angle, double>
 {
-    auto* player    = dynamic_cast<submarine*>(gm.get_player());
-    angle ang_peak  = startangle;
-    double peak_val = gm.sonar_listen_ships(player, startangle).first;
+    auto* player         = dynamic_cast<submarine*>(gm.get_player());
+    const auto& spectrum = gm.sonar_listen_all_directions(player);
+    angle ang_peak       = startangle;
+    double peak_val      = spectrum.get_signal(startangle).first;
     startangle += step;
     bool direction_found = false;
     double ang_scan_step = step;
     for (double ang_scanned = 0; ang_scanned < maxstep; ang_scanned += ang_scan_step) {
-        double tstr = gm.sonar_listen_ships(player, startangle).first;
+        double tstr = spectrum.get_signal(startangle).first;
         if (tstr >= peak_val) {
             // getting closer to peak
             ang_peak        = startangle;
@@ -65,7 +65,8 @@ auto sub_periscope_display::get_projection_data(class game& gm) const -> freevie
 auto sub_periscope_display::get_viewpos(class game& gm) const -> vector3
 {
     const auto* sub = dynamic_cast<const submarine*>(gm.get_player());
-    return sub->get_pos() + add_pos + vector3(0, 0, 6) * sub->get_scope_raise_level();
+    return sub->get_render_pos(gm.get_render_interpolation()) + add_pos
+           + vector3(0, 0, 6) * sub->get_scope_raise_level();
 }
 
 void sub_periscope_display::set_modelview_matrix(game& gm, const vector3& /*viewpos*/) const
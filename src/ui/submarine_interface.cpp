@@ -72,7 +72,6 @@ using namespace std;
 submarine_interface::submarine_interface(game& gm)
     : user_interface(gm)
     , selected_tube(0)
-    , torpedo_cam_track_nr(0)
 {
     auto* player = dynamic_cast<submarine*>(gm.get_player());
 
@@ -169,6 +168,7 @@ submarine_interface::submarine_interface(game& gm)
 
     // Important! call enter() here for current display.
     displays[current_display]->enter(gm.is_day_mode());
+    prefetch_reachable_displays();
 
     add_loading_screen("submarine interface initialized");
 }
@@ -181,7 +181,8 @@ void submarine_interface::fire_tube(submarine* player, int nr)
     // request the ID from a sea_object ptr. This must be avoided elsewhere.
     if (mygame->is_valid(player->get_target())) {
         auto& mytarget = mygame->get_object(player->get_target());
-        bool ok        = player->launch_torpedo(nr, mytarget.get_pos(), *mygame);
+        bool ok =
+            mygame->execute_command(player_command(player_command::launch_torpedo, nr, mytarget.get_pos())) != 0;
         if (ok) {
             add_message(texts::get(49));
             ostringstream oss;
@@ -282,65 +283,66 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
             goto_torpedosettings();
         } else if (is_configured_key(key_command::SHOW_TORPEDO_CAMERA, k)) {
             // show next torpedo in torpedo camera view
-            torpedo_cam_track_nr++;
+            torpedo_cam_track = mygame->get_torpedo_for_camera_track(torpedo_cam_track);
 
             // MOVEMENT
         } else if (is_configured_key(key_command::RUDDER_LEFT, k)) {
-            player->set_rudder(ship::rudderleft);
+            mygame->execute_command(player_command(player_command::set_rudder, 0, vector3(ship::rudderleft, 0, 0)));
             add_message(texts::get(33));
         } else if (is_configured_key(key_command::RUDDER_HARD_LEFT, k)) {
-            player->set_rudder(ship::rudderfullleft);
+            mygame->execute_command(player_command(player_command::set_rudder, 0, vector3(ship::rudderfullleft, 0, 0)));
             add_message(texts::get(35));
         } else if (is_configured_key(key_command::RUDDER_RIGHT, k)) {
-            player->set_rudder(ship::rudderright);
+            mygame->execute_command(player_command(player_command::set_rudder, 0, vector3(ship::rudderright, 0, 0)));
             add_message(texts::get(34));
         } else if (is_configured_key(key_command::RUDDER_HARD_RIGHT, k)) {
-            player->set_rudder(ship::rudderfullright);
+            mygame->execute_command(
+                player_command(player_command::set_rudder, 0, vector3(ship::rudderfullright, 0, 0)));
             add_message(texts::get(36));
         } else if (is_configured_key(key_command::RUDDER_UP, k)) {
-            player->set_planes_to(-0.5, *mygame);
+            mygame->execute_command(player_command(player_command::set_planes, 0, vector3(-0.5, 0, 0)));
             add_message(texts::get(37));
         } else if (is_configured_key(key_command::RUDDER_HARD_UP, k)) {
-            player->set_planes_to(-1.0, *mygame);
+            mygame->execute_command(player_command(player_command::set_planes, 0, vector3(-1.0, 0, 0)));
             add_message(texts::get(37));
         } else if (is_configured_key(key_command::RUDDER_DOWN, k)) {
             add_message(texts::get(38));
-            player->set_planes_to(0.5, *mygame);
+            mygame->execute_command(player_command(player_command::set_planes, 0, vector3(0.5, 0, 0)));
         } else if (is_configured_key(key_command::RUDDER_HARD_DOWN, k)) {
             add_message(texts::get(38));
-            player->set_planes_to(1.0, *mygame);
+            mygame->execute_command(player_command(player_command::set_planes, 0, vector3(1.0, 0, 0)));
         } else if (is_configured_key(key_command::CENTER_RUDDERS, k)) {
-            player->set_rudder(ship::ruddermidships);
-            player->set_planes_to(0, *mygame);
+            mygame->execute_command(player_command(player_command::set_rudder, 0, vector3(ship::ruddermidships, 0, 0)));
+            mygame->execute_command(player_command(player_command::set_planes, 0, vector3(0, 0, 0)));
             add_message(texts::get(42));
 
             // THROTTLE
         } else if (is_configured_key(key_command::THROTTLE_LISTEN, k)) {
-            player->set_throttle(ship::aheadlisten);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::aheadlisten));
             add_message(texts::get(139));
         } else if (is_configured_key(key_command::THROTTLE_SLOW, k)) {
-            player->set_throttle(ship::aheadslow);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::aheadslow));
             add_message(texts::get(43));
         } else if (is_configured_key(key_command::THROTTLE_HALF, k)) {
-            player->set_throttle(ship::aheadhalf);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::aheadhalf));
             add_message(texts::get(44));
         } else if (is_configured_key(key_command::THROTTLE_FULL, k)) {
-            player->set_throttle(ship::aheadfull);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::aheadfull));
             add_message(texts::get(45));
         } else if (is_configured_key(key_command::THROTTLE_FLANK, k)) {
-            player->set_throttle(ship::aheadflank);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::aheadflank));
             add_message(texts::get(46));
         } else if (is_configured_key(key_command::THROTTLE_STOP, k)) {
-            player->set_throttle(ship::stop);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::stop));
             add_message(texts::get(47));
         } else if (is_configured_key(key_command::THROTTLE_REVERSE, k)) {
-            player->set_throttle(ship::reverse);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::reverse));
             add_message(texts::get(48));
         } else if (is_configured_key(key_command::THROTTLE_REVERSEHALF, k)) {
-            player->set_throttle(ship::reversehalf);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::reversehalf));
             add_message(texts::get(140));
         } else if (is_configured_key(key_command::THROTTLE_REVERSEFULL, k)) {
-            player->set_throttle(ship::reversefull);
+            mygame->execute_command(player_command(player_command::set_throttle, ship::reversefull));
             add_message(texts::get(141));
 
             // TORPEDOES
@@ -361,7 +363,7 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
         } else if (is_configured_key(key_command::SELECT_TARGET, k)) {
             auto tgt = mygame->contact_in_direction(player, get_absolute_bearing());
             // set initial tdc values, also do that when tube is switched
-            player->set_target(tgt, *mygame);
+            mygame->execute_command(player_command(player_command::set_target, int32_t(tgt.id)));
             if (mygame->is_valid(tgt)) {
                 add_message(texts::get(50));
                 mygame->add_logbook_entry(texts::get(50));
@@ -372,32 +374,33 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
             // DEPTH, SNORKEL, SCOPE
         } else if (is_configured_key(key_command::SCOPE_UP_DOWN, k)) {
             if (player->is_scope_up()) {
-                player->scope_down();
+                mygame->execute_command(player_command(player_command::scope, 0));
                 add_message(texts::get(54));
             } else {
-                player->scope_up();
+                mygame->execute_command(player_command(player_command::scope, 1));
                 add_message(texts::get(55));
             }
         } else if (is_configured_key(key_command::CRASH_DIVE, k)) {
             add_message(texts::get(41));
             mygame->add_logbook_entry(texts::get(41));
-            player->crash_dive(*mygame);
+            mygame->execute_command(player_command(player_command::crash_dive));
         } else if (is_configured_key(key_command::GO_TO_SNORKEL_DEPTH, k)) {
             if (player->has_snorkel()) {
-                player->dive_to_depth(unsigned(player->get_snorkel_depth()), *mygame);
+                mygame->execute_command(
+                    player_command(player_command::dive_to_depth, int32_t(player->get_snorkel_depth())));
                 add_message(texts::get(12));
                 mygame->add_logbook_entry(texts::get(97));
             }
         } else if (is_configured_key(key_command::TOGGLE_SNORKEL, k)) {
             if (player->has_snorkel()) {
                 if (player->is_snorkel_up()) {
-                    player->snorkel_down();
+                    mygame->execute_command(player_command(player_command::snorkel, 0));
                     // fixme: was an if, why? say "snorkel down only when it was
                     // down"
                     add_message(texts::get(96));
                     mygame->add_logbook_entry(texts::get(96));
                 } else {
-                    player->snorkel_up();
+                    mygame->execute_command(player_command(player_command::snorkel, 1));
                     // fixme: was an if, why? say "snorkel up only when it was
                     // up"
                     add_message(texts::get(95));
@@ -405,7 +408,8 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
                 }
             }
         } else if (is_configured_key(key_command::SET_HEADING_TO_VIEW, k)) {
-            player->head_to_course(get_absolute_bearing());
+            mygame->execute_command(
+                player_command(player_command::head_to_course, 0, vector3(get_absolute_bearing().value(), 0, 0)));
         } else if (is_configured_key(key_command::IDENTIFY_TARGET, k)) {
             // calculate distance to target for identification detail
             if (mygame->is_valid(player->get_target())) {
@@ -419,9 +423,10 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
         } else if (is_configured_key(key_command::GO_TO_PERISCOPE_DEPTH, k)) {
             add_message(texts::get(40));
             mygame->add_logbook_entry(texts::get(40));
-            player->dive_to_depth(unsigned(player->get_periscope_depth()), *mygame);
+            mygame->execute_command(
+                player_command(player_command::dive_to_depth, int32_t(player->get_periscope_depth())));
         } else if (is_configured_key(key_command::GO_TO_SURFACE, k)) {
-            player->dive_to_depth(0, *mygame);
+            mygame->execute_command(player_command(player_command::dive_to_depth, 0));
             add_message(texts::get(39));
             mygame->add_logbook_entry(texts::get(39));
 
@@ -452,8 +457,10 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
             if (player->has_deck_gun()) {
                 if (!player->is_submerged()) {
                     if (mygame->is_valid(player->get_target()) /*fixme && player->get_target() != player*/) {
-                        int res =
-                            player->fire_shell_at(mygame->get_object(player->get_target()).get_pos().xy(), *mygame);
+                        int res = mygame->execute_command(player_command(
+                            player_command::fire_deck_gun,
+                            0,
+                            mygame->get_object(player->get_target()).get_pos()));
                         if (ship::TARGET_OUT_OF_RANGE == res) {
                             add_message(texts::get(218));
                         } else if (ship::NO_AMMO_REMAINING == res) {
@@ -479,11 +486,11 @@ auto submarine_interface::handle_key_event(const key_data& k) -> bool
                 if (!player->is_submerged()) {
                     if (key_mod_shift(k.mod)) {
                         if (player->is_gun_manned()) {
-                            if (player->unman_guns()) {
+                            if (mygame->execute_command(player_command(player_command::man_guns, 0)) != 0) {
                                 add_message(texts::get(126));
                             }
                         } else {
-                            if (player->man_guns()) {
+                            if (mygame->execute_command(player_command(player_command::man_guns, 1)) != 0) {
                                 add_message(texts::get(133));
                             }
                         }
@@ -556,6 +563,28 @@ void submarine_interface::set_time(double tm)
     }
 }
 
+auto submarine_interface::get_reachable_displays(unsigned display) const -> std::vector<unsigned>
+{
+    switch (display) {
+        // attack stations, switched between during an attack
+        case display_mode_periscope:
+        case display_mode_uzo:
+        case display_mode_bridge:
+            return {display_mode_tdc, display_mode_torpsetup, display_mode_map, display_mode_periscope,
+                    display_mode_uzo};
+        case display_mode_tdc:
+        case display_mode_tdc2:
+        case display_mode_torpsetup:
+            return {display_mode_periscope, display_mode_uzo, display_mode_tdc, display_mode_tdc2,
+                    display_mode_torpsetup};
+        // forced switch when diving below periscope depth
+        case display_mode_map:
+            return {display_mode_periscope, display_mode_gauges, display_mode_sonar};
+        default:
+            return user_interface::get_reachable_displays(display);
+    }
+}
+
 void submarine_interface::goto_gauges()
 {
     set_current_display(display_mode_gauges);
@@ -722,8 +751,8 @@ void submarine_interface::display() const
 
     // panel is drawn in each display function, so the above code is all...
 
-    if (torpedo_cam_track_nr > 0) {
-        const torpedo* tt = mygame->get_torpedo_for_camera_track(torpedo_cam_track_nr - 1);
+    if (torpedo_cam_track.id != 0) {
+        const torpedo* tt = mygame->get_torpedo(torpedo_cam_track);
         torpedo_cam_view->set_tracker(tt);
         if (tt != nullptr) {
             /*
@@ -740,7 +769,7 @@ void submarine_interface::display() const
             glPopMatrix();
             */
         } else {
-            torpedo_cam_track_nr = 0;
+            torpedo_cam_track = {};
         }
     } else {
         torpedo_cam_view->set_tracker(nullptr);
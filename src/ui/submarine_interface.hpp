@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #pragma once
 
+#include "object_pool.hpp"
 #include "submarine.hpp"
 
 #include <list>
@@ -87,11 +88,14 @@ class submarine_interface : public user_interface
   protected:
     unsigned selected_tube;
     std::unique_ptr<class torpedo_camera_display> torpedo_cam_view;
-    mutable unsigned torpedo_cam_track_nr;
+    mutable object_pool<torpedo>::handle torpedo_cam_track; ///< empty if camera is off
 
     /// overloaded from user_interface, for forced screen switching
     void set_time(double tm) override;
 
+    /// overloaded from user_interface, stations used together are reachable
+    [[nodiscard]] std::vector<unsigned> get_reachable_displays(unsigned display) const override;
+
   public:
     // public, because the functions could be called by heirs of user_display,
     // and should be called only from there.
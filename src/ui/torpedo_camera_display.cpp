@@ -65,10 +65,10 @@ void torpedo_camera_display::post_display() const
     // nothing to do
 }
 
-auto torpedo_camera_display::get_viewpos(class game& /*gm*/) const -> vector3
+auto torpedo_camera_display::get_viewpos(class game& gm) const -> vector3
 {
     if (trackobj != nullptr) {
-        return trackobj->get_pos() + add_pos;
+        return trackobj->get_render_pos(gm.get_render_interpolation()) + add_pos;
     }
     return {};
 }
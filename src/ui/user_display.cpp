@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "user_display.hpp"
 
+#include "image_cache.hpp"
 #include "system_interface.hpp"
 #include "user_interface.hpp"
 #include "xml.hpp"
@@ -230,11 +231,10 @@ auto user_display::elem2D::is_mouse_over(const vector2i& pos, int tolerance) con
 
 void user_display::elem2D::init(bool is_day)
 {
-    // init all textures
+    // init all textures, decoded images come from the cache if possible
     for (auto i = 0U; i < nr_of_phases(); ++i) {
-        tex[i] = std::make_unique<texture>(
-            (is_day || !has_night || filenames_night[i].empty()) ? filenames_day[i] : filenames_night[i],
-            texture::LINEAR);
+        const auto img = image_cache::instance().get(get_filename(is_day, i));
+        tex[i] = std::make_unique<texture>(*img, 0, 0, img->get_width(), img->get_height(), texture::LINEAR);
     }
     // Determine size from image if there is one (only use first phase for size)
     if (!tex.empty()) {
@@ -242,6 +242,11 @@ void user_display::elem2D::init(bool is_day)
     }
 }
 
+auto user_display::elem2D::get_filename(bool is_day, unsigned phase) const -> const std::string&
+{
+    return (is_day || !has_night || filenames_night[phase].empty()) ? filenames_day[phase] : filenames_night[phase];
+}
+
 void user_display::elem2D::deinit()
 {
     // delete all textures
@@ -347,3 +352,14 @@ void user_display::leave()
         e.deinit();
     }
 }
+
+void user_display::prefetch(bool is_day) const
+{
+    std::vector<std::string> filenames;
+    for (const auto& e : elements) {
+        for (auto i = 0U; i < e.nr_of_phases(); ++i) {
+            filenames.push_back(e.get_filename(is_day, i));
+        }
+    }
+    image_cache::instance().prefetch(filenames);
+}
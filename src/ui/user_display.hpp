@@ -62,6 +62,8 @@ class user_display : public input_event_handler
         void init(bool is_day);
         /// Deinitialize texture
         void deinit();
+        /// Get image file name of a phase
+        const std::string& get_filename(bool is_day, unsigned phase) const;
         /// Get position
         const vector2i& get_position() const { return position; }
         /// For storage in vector
@@ -142,6 +144,9 @@ class user_display : public input_event_handler
     /// overload with code that deinits data for that display, like freeing
     /// images
     virtual void leave();
+    /// load images of the display in background, so enter() doesn't need to
+    /// read and decode them
+    virtual void prefetch(bool is_day) const;
 
   protected:
     // common functions: draw_infopanel(class game& gm)
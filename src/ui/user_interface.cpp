@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "vector3.hpp"
 #include "widget.hpp"
 
+#include <chrono>
 #include <glu.h>
 #include <iomanip>
 #include <iostream>
@@ -39,8 +40,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 //#include "ship_interface.hpp"
 //#include "airplane_interface.hpp"
 #include "cfg.hpp"
+#include "freeview_display.hpp"
 #include "global_data.hpp"
+#include "image_cache.hpp"
 #include "keys.hpp"
+#include "log.hpp"
 #include "matrix4.hpp"
 #include "music.hpp"
 #include "particle.hpp"
@@ -125,7 +129,7 @@ user_interface::user_interface(game& gm)
     auto playlist =
         music_playlist->add_child_near_last_child(std::make_unique<musiclist>(0, 0, music_playlist_width, 512));
     music& m                     = music::instance();
-    std::vector<std::string> mpl = m.get_playlist();
+    std::vector<std::string> mpl = m.get_playlist().get();
     for (const auto& it : mpl) {
         playlist->append_entry(it);
     }
@@ -355,9 +359,36 @@ auto user_interface::create(game& gm) -> std::shared_ptr<user_interface>
 
 user_interface::~user_interface()
 {
+    [[maybe_unused]] const auto st = image_cache::instance().get_statistics();
+    log_info(
+        "display switches: " << display_switches << ", avg/max time "
+                             << (display_switches > 0 ? display_switch_time / display_switches : 0.0) << "/"
+                             << max_display_switch_time << " ms, image cache hits " << st.hits << " misses "
+                             << st.misses << " waits " << st.waits << " prefetched " << st.prefetched
+                             << " evictions " << st.evictions);
     particle::deinit();
 }
 
+void user_interface::log_frame_statistics()
+{
+    if (mygeoclipmap) {
+        mygeoclipmap->log_update_statistics();
+        mygeoclipmap->reset_update_statistics();
+    }
+    // culling counters are only available for 3d views
+    const auto* fv = current_display < displays.size()
+                         ? dynamic_cast<const freeview_display*>(displays[current_display].get())
+                         : nullptr;
+    if (fv != nullptr) {
+        [[maybe_unused]] const auto& st  = fv->get_culling_statistics();
+        [[maybe_unused]] const auto& stm = fv->get_culling_statistics(true);
+        log_info(
+            "culling: submitted " << st.submitted << " culled " << st.culled() << " (frustum " << st.culled_frustum
+                                  << " distance " << st.culled_distance << " horizon " << st.culled_horizon
+                                  << "), mirror submitted " << stm.submitted << " culled " << stm.culled());
+    }
+}
+
 auto user_interface::get_water() const -> const water&
 {
     return mygame->get_water();
@@ -440,8 +471,9 @@ void user_interface::set_time(double tm)
             displays[current_display]->leave();
             displays[current_display]->enter(newdaymode);
             mygame->unfreeze_time();
+            daymode = newdaymode;
+            prefetch_reachable_displays();
         }
-        daymode = newdaymode;
     }
 
     mysky->set_time(tm);
@@ -812,8 +844,11 @@ void user_interface::set_current_display(unsigned curdis)
     if (mygame != nullptr) {
         mygame->freeze_time();
     }
+    auto start = std::chrono::steady_clock::now();
     displays[current_display]->leave();
     current_display = curdis;
+    double switch_time =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
     // clear both screen buffers
     glClearColor(0, 0, 0, 0);
@@ -822,7 +857,14 @@ void user_interface::set_current_display(unsigned curdis)
     glClear(GL_COLOR_BUFFER_BIT);
     SYS().finish_frame();
 
+    start = std::chrono::steady_clock::now();
     displays[current_display]->enter(daymode);
+    switch_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++display_switches;
+    display_switch_time += switch_time;
+    max_display_switch_time = std::max(max_display_switch_time, switch_time);
+    log_info("switched to display " << current_display << " in " << switch_time << " ms");
+    prefetch_reachable_displays();
     if (mygame != nullptr) {
         mygame->unfreeze_time();
     }
@@ -837,6 +879,21 @@ void user_interface::set_current_display(unsigned curdis)
     }
 }
 
+auto user_interface::get_reachable_displays(unsigned display) const -> std::vector<unsigned>
+{
+    const auto n = unsigned(displays.size());
+    return {(display + n - 1) % n, (display + 1) % n};
+}
+
+void user_interface::prefetch_reachable_displays() const
+{
+    for (auto d : get_reachable_displays(current_display)) {
+        if (d != current_display) {
+            displays[d]->prefetch(daymode);
+        }
+    }
+}
+
 void user_interface::playlist_mode_changed()
 {
     if (playlist_repeat_checkbox->is_checked()) {
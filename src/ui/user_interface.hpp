@@ -133,6 +133,18 @@ class user_interface : public input_event_handler
     // performed automatically
     void set_current_display(unsigned curdis);
 
+    /// displays the player will probably switch to next, their images are
+    /// prefetched. Default is the previous and next display.
+    [[nodiscard]] virtual std::vector<unsigned> get_reachable_displays(unsigned display) const;
+
+    /// let displays reachable from current display prefetch their images
+    void prefetch_reachable_displays() const;
+
+    // time needed for display switches, for profiling
+    unsigned display_switches{0};
+    double display_switch_time{0.0};     // sum, ms
+    double max_display_switch_time{0.0}; // ms
+
     virtual void playlist_mode_changed();
     virtual void playlist_mute();
 
@@ -186,6 +198,9 @@ class user_interface : public input_event_handler
 
     virtual void toggle_pause();
     [[nodiscard]] virtual bool paused() const { return pause; }
+
+    /// log rendering counters since the last call, called with the fps statistics
+    void log_frame_statistics();
     [[nodiscard]] virtual unsigned time_scaling() const { return time_scale; }
     virtual void add_message(const std::string& s);
     virtual bool time_scale_up(); // returns true on success